@@ -18,11 +18,21 @@
 #define __APP_CORE_H__
 
 #include "vkex/Application.h"
+#include "vkex/PassTraffic.h"
 
 #include "ConstantBufferManager.h"
+#include "DrawList.h"
+#include "FrameCapture.h"
+#include "FrameRecording.h"
+#include "FrustumCuller.h"
 #include "GLTFModel.h"
+#include "GpuCuller.h"
+#include "ImageMetrics.h"
+#include "LodSelector.h"
+#include "SettingsSweep.h"
 #include "SharedShaderConstants.h"
 #include "SimpleRenderPass.h"
+#include "StressScene.h"
 
 using float2 = vkex::float2;
 using float3 = vkex::float3;
@@ -64,6 +74,19 @@ enum AppShaderList {
   UpscalingCAS = 4,
   CheckerboardUpscale = 5,
   GeometryCB = 6,
+  // Stress scene variants of Geometry and GeometryCB, only built when the
+  // stress scene is enabled
+  GeometryInstanced = 7,
+  GeometryCBInstanced = 8,
+  // GPU culling of the stress scene, only built when GPU culling is
+  // available
+  HiZBuild = 9,
+  HiZBuildMS = 10,
+  HiZDownsample = 11,
+  GpuCull = 12,
+  // Image quality metrics, subgroup variants when they're supported
+  ImageMetricsTile = 13,
+  ImageMetricsReduce = 14,
   NumTypes,
 };
 
@@ -86,6 +109,9 @@ struct GeneratedShaderState {
     vkex::ComputePipeline compute_pipeline;
   };
   std::vector<vkex::DescriptorSet> descriptor_sets;
+  // Scene shaders only, one set per frame per material indexed as
+  // (frame_index * material_count) + material_index
+  std::vector<vkex::DescriptorSet> material_descriptor_sets;
 };
 
 enum LightType {
@@ -158,6 +184,8 @@ enum TimerTag {
   kUpscaleInternal = 1,
   kTotalInternal = 2,
   kSceneRenderTarget = 3,
+  kGpuCullInternal = 4,
+  kImageMetricsTarget = 5,
   kTimerTagCount,
   kTimerQueryCount = kTimerTagCount * 2,
 };
@@ -179,8 +207,17 @@ struct PerFrameData {
 
   std::vector<GpuTimerInfo> issued_gpu_timers;
 
+  // Modeled image traffic of each timer's pass, one per TimerTag. Built when
+  // the timestamps are recorded, and moved next to the timers when they're
+  // read back, since the next recording overwrites it before the GUI draws.
+  std::vector<vkex::PassTraffic> recorded_pass_traffic;
+  std::vector<vkex::PassTraffic> pass_traffic;
+
   uint32_t cb_frame_index;
 
+  // SettingsSweep sample slot of the frame last recorded with this data
+  uint32_t sweep_sample = SettingsSweep::kNotMeasured;
+
   // TODO: Other stuff that might need to be inspected from previous
   // frames, such as targeted resolution or previous frame images
 };
@@ -198,6 +235,7 @@ class VkexInfoApp : public vkex::Application {
   void Update(double frame_elapsed_time);
   void Render(vkex::Application::RenderData* p_data);
   void Present(vkex::Application::PresentData* p_data);
+  void Destroy();
 
  protected:
   // AppUtil.cpp
@@ -222,6 +260,23 @@ class VkexInfoApp : public vkex::Application {
   void BuildCBResolutionTextList(std::vector<const char*>& internal_text_list);
   void BuildTargetResolutionTextList(
       std::vector<const char*>& target_text_list);
+  void BuildTimerTagNameList(std::vector<std::string>& timer_name_list);
+
+  // Every technique, internal and target resolution combination the present
+  // resolution allows, CAS once per sharpness value
+  void BuildSweepConfigurations(
+      const SweepSpec& spec, std::vector<SweepConfiguration>& configurations);
+  void ApplySweepConfiguration(const SweepConfiguration& configuration);
+  void StartSettingsSweep();
+  void UpdateSettingsSweep();
+  // Hands the timers and metrics just read back for 'frame_index' to the
+  // sweep, and tags the frame about to be recorded
+  void RecordSweepSample(uint32_t frame_index);
+
+  // Opened on the first captured frame, so the Y4M streams take the
+  // resolutions it renders at
+  bool StartFrameCapture();
+  void CaptureFrame();
 
   void IssueGpuTimeStart(vkex::CommandBuffer cmd, PerFrameData& per_frame_data,
                          TimerTag tag);
@@ -230,12 +285,23 @@ class VkexInfoApp : public vkex::Application {
   void ReadbackGpuTimestamps(uint32_t frame_index);
   double CalculateGpuTimeRange(const PerFrameData& per_frame_data,
                                TimerTag requested_range, double nano_scaler);
+  // Fills recorded_pass_traffic from the current technique and resolutions
+  void BuildPassTraffic(PerFrameData& per_frame_data);
+  // The timer's time, and the bandwidth its pass achieved when its traffic
+  // is modeled
+  void DrawGpuTimerValue(const PerFrameData& per_frame_data, TimerTag tag,
+                         double ms);
+  void DrawFrameMetricRow(const char* name, const vkex::FrameMetric& metric);
 
   GPULightInfo ConvertCPULightInfoToGPULightInfo(CPULightInfo& cpuLight);
-  void UpdateMaterialConstants();
   void UpdateImageDeltaConstants();
   void UpdateDebugConstants();
 
+  const GeneratedShaderState& GetSceneShaderState(AppShaderList shader);
+  bool IsGpuCullingActive();
+  // LodSelector::ComputePixelScale for the internal render area
+  float GetLodPixelScale();
+
   vkex::uint3 CalculateSimpleDispatchDimensions(
       GeneratedShaderState& gen_shader_state, VkExtent2D image_extent);
 
@@ -251,10 +317,16 @@ class VkexInfoApp : public vkex::Application {
   void UpscaleInternalToTarget(vkex::CommandBuffer cmd, uint32_t frame_index);
   void VisualizeInternalTargetDelta(vkex::CommandBuffer cmd,
                                     uint32_t frame_index);
+  void MeasureInternalTargetQuality(vkex::CommandBuffer cmd,
+                                    uint32_t frame_index);
   void RenderSceneTargetResolution(vkex::CommandBuffer cmd,
                                    uint32_t frame_index);
 
-  void DrawModel(vkex::CommandBuffer cmd);
+  void BuildDrawList();
+  void DrawModel(vkex::CommandBuffer cmd,
+                 const GeneratedShaderState& shader_state,
+                 uint32_t frame_index, uint32_t per_frame_dynamic_offset,
+                 bool gpu_culled = false, bool full_detail = false);
 
   // AppSetup.cpp
   void SetupImagesAndRenderPasses(const VkExtent2D present_extent,
@@ -266,6 +338,15 @@ class VkexInfoApp : public vkex::Application {
   void CheckVulkanFeaturesForPipelines();
   void ConfigureCustomSampleLocationsState();
   void SetupInitialConstantBufferValues();
+  void SetupMaterialDescriptorSets();
+  void UpdateConstantBufferDescriptors(uint32_t frame_index);
+
+  // Benchmark.cpp
+  void RunObjectStorageBenchmark(uint32_t object_count);
+  void RunGeometryBuilderBenchmark(uint32_t triangle_count);
+  void RunTransformBenchmark(uint32_t node_count);
+  void RunImageComparison(const std::string& test_path,
+                          const std::string& reference_path);
 
   // CAS.cpp
   void UpdateCASConstants(const VkExtent2D& srcExtent,
@@ -281,10 +362,15 @@ class VkexInfoApp : public vkex::Application {
   // CPU side state
   bool m_animation_enabled = true;
   float m_animation_progress = 0.0f;
+  // The animation advances 1 / rate seconds a frame, so runs render the same
+  // frames however fast they go. 0 follows the frame time instead.
+  uint32_t m_animation_rate = 60;
+  vkex::PerspCamera m_camera;
   std::vector<CPULightInfo> m_light_infos;
 
   std::vector<GeneratedShaderState> m_generated_shader_states;
   vkex::DescriptorPool m_shared_descriptor_pool = nullptr;
+  vkex::DescriptorPool m_material_descriptor_pool = nullptr;
 
   PerFrameConstants m_per_frame_constants = {};
   PerObjectConstants m_per_object_constants = {};
@@ -339,15 +425,68 @@ class VkexInfoApp : public vkex::Application {
   DeltaVisualizerMode m_delta_visualizer_mode = kDisabled;
   float m_delta_amplifier = 1.0f;
 
+  ImageMetrics m_image_metrics;
+  bool m_image_metrics_enabled = true;
+  // Subgroup arithmetic in compute shaders, for the reductions
+  bool m_image_metrics_wave_ops = false;
+
+  // GB/s the achieved pass bandwidths are reported against, 0 leaves the
+  // percentages out. The default is the Stadia GPU's HBM2.
+  double m_peak_bandwidth_gbps = 484.0;
+
+  // Every GPU timer's time in milliseconds, one per TimerTag, added as the
+  // timestamps are read back. Passes that were skipped are left out.
+  vkex::FrameMetric m_gpu_timer_metrics[TimerTag::kTimerTagCount];
+  std::vector<std::string> m_gpu_timer_names;
+
   // TODO: Eventually this becomes a list of models (somewhere) and a pointer
   // for the active model
   GLTFModel m_helmet_model;
+  DrawList m_draw_list;
+  FrustumCuller m_frustum_culler;
+  bool m_frustum_culling_enabled = true;
+  StressScene m_stress_scene;
+  GpuCuller m_gpu_culler;
+  bool m_gpu_culling_available = false;
+  bool m_gpu_culling_enabled = true;
+  bool m_gpu_occlusion_culling_enabled = true;
+  LodSelector m_lod_selector;
 
   ConstantBufferManager m_constant_buffer_manager;
 
   CASUpscalingParams m_cas_info;
 
   std::vector<PerFrameData> m_per_frame_datas;
+
+  // Reused by DrawAppInfoGUI so building combo item lists does not allocate
+  // every frame
+  std::vector<const char*> m_gui_text_list;
+
+  uint32_t m_object_storage_benchmark_count = 0;
+  uint32_t m_geometry_benchmark_triangle_count = 0;
+  uint32_t m_transform_benchmark_node_count = 0;
+  // Saved frames to compare at startup, upscaled then native
+  std::string m_compare_test_path;
+  std::string m_compare_reference_path;
+
+  // Camera and animation state, per frame, empty unless given
+  std::string m_record_path;
+  std::string m_replay_path;
+  FrameRecorder m_frame_recorder;
+  FramePlayer m_frame_player;
+
+  // Empty unless --capture is given. Stream names in capture order
+  std::string m_capture_path;
+  std::vector<std::string> m_capture_streams;
+  bool m_capture_raw = false;
+  FrameCapture m_frame_capture;
+
+  // Empty unless --sweep is given
+  std::string m_sweep_spec_path;
+  SettingsSweep m_settings_sweep;
+  // From SettingsSweep::NextFrame for the frame being built
+  uint32_t m_sweep_sample = SettingsSweep::kNotMeasured;
+  std::string m_model_path = "models/DamagedHelmet/glTF/DamagedHelmet.gltf";
 };
 
 #endif  // __APP_CORE_H__
@@ -23,9 +23,13 @@ void VkexInfoApp::RenderInternalAndTarget(vkex::CommandBuffer cmd,
   auto per_frame_dynamic_offset =
       m_constant_buffer_manager.UploadConstantsToDynamicBuffer(
           m_per_frame_constants);
-  auto per_object_dynamic_offset =
-      m_constant_buffer_manager.UploadConstantsToDynamicBuffer(
-          m_per_object_constants);
+
+  // The target resolution reference pass always draws everything
+  const bool gpu_culled = IsGpuCullingActive();
+  if (gpu_culled) {
+    m_gpu_culler.UpdateDraws(frame_index, m_helmet_model,
+                             m_draw_list.GetItems());
+  }
 
   cmd->Begin();
 
@@ -33,31 +37,52 @@ void VkexInfoApp::RenderInternalAndTarget(vkex::CommandBuffer cmd,
     cmd->CmdResetQueryPool(per_frame_data.timer_query_pool, 0,
                            TimerTag::kTimerQueryCount);
     per_frame_data.timestamps_issued = true;
+    BuildPassTraffic(per_frame_data);
   }
 
   IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kTotalInternal);
   {
+    // Always issued, so the query pool readback never waits on a missing
+    // timestamp
+    IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kGpuCullInternal);
+    if (gpu_culled) {
+      m_gpu_culler.Record(
+          cmd, frame_index, m_constant_buffer_manager,
+          m_per_frame_constants.data.viewProjectionMatrix,
+          m_camera.GetEyePosition(),
+          m_lod_selector.GetScaledPixelScale(GetLodPixelScale()),
+          m_stress_scene.GetInstanceCount(), m_gpu_occlusion_culling_enabled);
+    }
+    IssueGpuTimeEnd(cmd, per_frame_data, TimerTag::kGpuCullInternal);
+
     IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kSceneRenderInternal);
     {
       vkex::RenderPass render_pass;
-      GeneratedShaderState* pipeline;
+      const GeneratedShaderState* pipeline;
       VkViewport viewport;
       void* render_pass_begin_pNext = nullptr;
+      vkex::Texture depth_texture = nullptr;
+      bool depth_multisampled = false;
 
       switch (GetUpscalingTechnique()) {
         case UpscalingTechniqueKey::kuNone:
         case UpscalingTechniqueKey::CAS: {
           render_pass = m_internal_draw_simple_render_pass.render_pass;
-          pipeline = &m_generated_shader_states[AppShaderList::Geometry];
+          pipeline = &GetSceneShaderState(AppShaderList::Geometry);
           viewport = vkex::BuildInvertedYViewport(m_internal_render_area);
+          depth_texture = m_internal_draw_simple_render_pass.dsv_texture;
           break;
         }
         case UpscalingTechniqueKey::Checkerboard: {
           render_pass =
               m_checkerboard_simple_render_pass[per_frame_data.cb_frame_index]
                   .render_pass;
-          pipeline = &m_generated_shader_states[AppShaderList::GeometryCB];
+          pipeline = &GetSceneShaderState(AppShaderList::GeometryCB);
           viewport = m_cb_viewport;
+          depth_texture =
+              m_checkerboard_simple_render_pass[per_frame_data.cb_frame_index]
+                  .dsv_texture;
+          depth_multisampled = true;
           if (m_sample_locations_enabled) {
             // Technically, we don't need this on platforms that support
             // variableSampleLocations and our particular management
@@ -84,28 +109,30 @@ void VkexInfoApp::RenderInternalAndTarget(vkex::CommandBuffer cmd,
       VkClearValue dsv_clear = {};
       dsv_clear.depthStencil.depth = 1.0f;
       dsv_clear.depthStencil.stencil = 0xFF;
-      std::vector<VkClearValue> clear_values = {rtv_clear, rtv_clear,
-                                                dsv_clear};
-      cmd->CmdBeginRenderPass(render_pass, &clear_values,
+      const VkClearValue clear_values[] = {rtv_clear, rtv_clear, dsv_clear};
+      cmd->CmdBeginRenderPass(render_pass, clear_values,
                               VK_SUBPASS_CONTENTS_INLINE,
                               render_pass_begin_pNext);
 
-      std::vector<VkViewport> vps = {viewport};
-      cmd->CmdSetViewport(0, &vps);
+      cmd->CmdSetViewport(0, {viewport});
 
       cmd->CmdSetScissor(m_internal_render_area);
 
       cmd->CmdBindPipeline(pipeline->graphics_pipeline);
 
-      std::vector<uint32_t> dynamic_offsets = {per_frame_dynamic_offset,
-                                               per_object_dynamic_offset};
-      cmd->CmdBindDescriptorSets(
-          VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipeline->pipeline_layout), 0,
-          {*(pipeline->descriptor_sets[frame_index])}, &dynamic_offsets);
-
-      DrawModel(cmd);
+      DrawModel(cmd, *pipeline, frame_index, per_frame_dynamic_offset,
+                gpu_culled);
 
       cmd->CmdEndRenderPass();
+
+      // Next frame's occlusion test runs against this pass's depth
+      if (gpu_culled && (depth_texture != nullptr)) {
+        m_gpu_culler.SetDepthHistory(
+            depth_texture, m_internal_render_area.extent, depth_multisampled,
+            m_per_frame_constants.data.viewProjectionMatrix);
+      } else {
+        m_gpu_culler.ClearDepthHistory();
+      }
     }
     IssueGpuTimeEnd(cmd, per_frame_data, TimerTag::kSceneRenderInternal);
 
@@ -115,6 +142,7 @@ void VkexInfoApp::RenderInternalAndTarget(vkex::CommandBuffer cmd,
 
   RenderSceneTargetResolution(cmd, frame_index);
   VisualizeInternalTargetDelta(cmd, frame_index);
+  MeasureInternalTargetQuality(cmd, frame_index);
 
   cmd->End();
 }
@@ -136,12 +164,12 @@ void VkexInfoApp::NaiveUpscale(vkex::CommandBuffer cmd, uint32_t frame_index) {
 
   cmd->CmdBindPipeline(naive_upscale_shader_state.compute_pipeline);
 
-  std::vector<uint32_t> dynamic_offsets = {scaled_copy_dynamic_offset};
+  const uint32_t dynamic_offsets[] = {scaled_copy_dynamic_offset};
   cmd->CmdBindDescriptorSets(
       VK_PIPELINE_BIND_POINT_COMPUTE,
       *(naive_upscale_shader_state.pipeline_layout),
       0, {*(naive_upscale_descriptor_set)},
-      &dynamic_offsets);
+      dynamic_offsets);
 
   IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kUpscaleInternal);
   {
@@ -217,13 +245,13 @@ void VkexInfoApp::VisualizeInternalTargetDelta(vkex::CommandBuffer cmd,
 
   cmd->CmdBindPipeline(delta_shader_state.compute_pipeline);
 
-  std::vector<uint32_t> dynamic_offsets = {scaled_copy_dynamic_offset,
-                                           image_delta_dynamic_offset};
+  const uint32_t dynamic_offsets[] = {scaled_copy_dynamic_offset,
+                                      image_delta_dynamic_offset};
   cmd->CmdBindDescriptorSets(
       VK_PIPELINE_BIND_POINT_COMPUTE, *(delta_shader_state.pipeline_layout),
       0,
       {*(delta_shader_state.descriptor_sets[frame_index])},
-      &dynamic_offsets);
+      dynamic_offsets);
 
   vkex::uint3 dispatchDims = CalculateSimpleDispatchDimensions(
       delta_shader_state, GetTargetResolutionExtent());
@@ -239,6 +267,41 @@ void VkexInfoApp::VisualizeInternalTargetDelta(vkex::CommandBuffer cmd,
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 }
 
+void VkexInfoApp::MeasureInternalTargetQuality(vkex::CommandBuffer cmd,
+                                               uint32_t frame_index) {
+  auto& per_frame_data = m_per_frame_datas[frame_index];
+
+  // Always issued, so the query pool readback never waits on a missing
+  // timestamp
+  IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kImageMetricsTarget);
+  if (m_image_metrics_enabled) {
+    auto reference_texture =
+        m_internal_as_target_draw_simple_render_pass.color_texture;
+
+    cmd->CmdTransitionImageLayout(
+        m_current_target_texture, VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    cmd->CmdTransitionImageLayout(reference_texture,
+                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    m_image_metrics.Record(cmd, frame_index, m_constant_buffer_manager,
+                           m_current_target_texture, reference_texture,
+                           GetTargetResolutionExtent());
+
+    cmd->CmdTransitionImageLayout(
+        m_current_target_texture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    cmd->CmdTransitionImageLayout(
+        reference_texture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  }
+  IssueGpuTimeEnd(cmd, per_frame_data, TimerTag::kImageMetricsTarget);
+}
+
 void VkexInfoApp::RenderSceneTargetResolution(vkex::CommandBuffer cmd,
                                               uint32_t frame_index) {
   auto& per_frame_data = m_per_frame_datas[frame_index];
@@ -246,61 +309,178 @@ void VkexInfoApp::RenderSceneTargetResolution(vkex::CommandBuffer cmd,
   auto per_frame_dynamic_offset =
       m_constant_buffer_manager.UploadConstantsToDynamicBuffer(
           m_per_frame_constants);
-  auto per_object_dynamic_offset =
-      m_constant_buffer_manager.UploadConstantsToDynamicBuffer(
-          m_per_object_constants);
 
   IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kSceneRenderTarget);
   {
     auto render_pass = m_internal_as_target_draw_simple_render_pass.render_pass;
     const auto& scene_shader_state =
-        m_generated_shader_states[AppShaderList::Geometry];
+        GetSceneShaderState(AppShaderList::Geometry);
 
     VkClearValue rtv_clear = {};
     VkClearValue dsv_clear = {};
     dsv_clear.depthStencil.depth = 1.0f;
     dsv_clear.depthStencil.stencil = 0xFF;
-    std::vector<VkClearValue> clear_values = {rtv_clear, rtv_clear, dsv_clear};
-    cmd->CmdBeginRenderPass(render_pass, &clear_values);
+    const VkClearValue clear_values[] = {rtv_clear, rtv_clear, dsv_clear};
+    cmd->CmdBeginRenderPass(render_pass, clear_values);
     cmd->CmdSetViewport(m_target_render_area);
     cmd->CmdSetScissor(m_target_render_area);
     cmd->CmdBindPipeline(scene_shader_state.graphics_pipeline);
 
-    std::vector<uint32_t> dynamic_offsets = {per_frame_dynamic_offset,
-                                             per_object_dynamic_offset};
-    cmd->CmdBindDescriptorSets(
-        VK_PIPELINE_BIND_POINT_GRAPHICS, *(scene_shader_state.pipeline_layout),
-        0, {*(scene_shader_state.descriptor_sets[frame_index])},
-        &dynamic_offsets);
-
-    DrawModel(cmd);
+    // Full detail, so image comparisons take in the LOD error along with the
+    // upscaling
+    DrawModel(cmd, scene_shader_state, frame_index, per_frame_dynamic_offset,
+              false, true);
 
     cmd->CmdEndRenderPass();
   }
   IssueGpuTimeEnd(cmd, per_frame_data, TimerTag::kSceneRenderTarget);
 }
 
-void VkexInfoApp::DrawModel(vkex::CommandBuffer cmd) {
-  // TODO: In the future, we'll want to formally loop over multiple
-  // nodes/meshes/prims
-  // TODO: Once we toggle models, we'll need to bind pre-generated descriptor
-  //       sets, or build the constant buffers/descriptors live
+void VkexInfoApp::BuildDrawList() {
+  // Stress scene instances are spread over the whole view, so one instance's
+  // bounds say nothing about whether its draw is visible
+  const bool cull = m_frustum_culling_enabled && !m_stress_scene.IsEnabled();
+
+  const uint8_t* p_visible = nullptr;
+  if (cull) {
+    m_frustum_culler.Clear();
+    m_frustum_culler.AddModel(m_helmet_model);
+    m_frustum_culler.Cull(m_camera);
+    p_visible = m_frustum_culler.GetVisibility();
+  }
 
-  uint32_t node_index = 0;
-  uint32_t primitive_index = 0;
+  // Stress scene instances share their draws, so their levels are picked per
+  // instance by the GPU culler, or not at all
+  const uint8_t* p_levels = nullptr;
+  if (!m_stress_scene.IsEnabled()) {
+    m_lod_selector.Select(m_helmet_model, m_camera.GetEyePosition(),
+                          GetLodPixelScale());
+    p_levels = m_lod_selector.GetLevels();
+  }
 
-  auto index_buffer =
-      m_helmet_model.GetIndexBuffer(node_index, primitive_index);
-  auto index_type = m_helmet_model.GetIndexType(node_index, primitive_index);
+  m_draw_list.Clear();
+  m_draw_list.AddModel(m_helmet_model, 0, p_visible, p_levels);
+  m_draw_list.Sort();
+
+  // Per object constants are uploaded once and shared by every pass that
+  // draws the list this frame
+  const auto& scene = m_helmet_model.GetFlattenedScene();
+  auto& constants = m_per_object_constants.data;
+  for (auto& item : m_draw_list.GetItems()) {
+    const auto& material = m_helmet_model.GetMaterial(item.material_index);
+    const auto& primitive =
+        m_helmet_model
+            .GetMesh(uint32_t(scene.mesh_indices[item.instance_index]))
+            .primitives[item.primitive_index];
+
+    constants.worldMatrix =
+        scene.transforms.GetWorldMatrix(item.instance_index);
+    constants.prevWorldMatrix =
+        scene.transforms.GetPrevWorldMatrix(item.instance_index);
+    constants.baseColorFactor =
+        float4(material.baseColorFactor[0], material.baseColorFactor[1],
+               material.baseColorFactor[2], material.baseColorFactor[3]);
+    constants.emissiveFactor =
+        float3(material.emissiveFactor[0], material.emissiveFactor[1],
+               material.emissiveFactor[2]);
+    constants.metallicFactor = material.metallicFactor;
+    constants.roughnessFactor = material.roughnessFactor;
+    constants.positionDequantMatrix = primitive.position_dequant_matrix;
+
+    item.constants_offset =
+        m_constant_buffer_manager.UploadConstantsToDynamicBuffer(
+            m_per_object_constants);
+  }
+}
 
-  cmd->CmdBindIndexBuffer(index_buffer, 0, index_type);
+void VkexInfoApp::DrawModel(vkex::CommandBuffer cmd,
+                            const GeneratedShaderState& shader_state,
+                            uint32_t frame_index,
+                            uint32_t per_frame_dynamic_offset,
+                            bool gpu_culled, bool full_detail) {
+  vkex::Timer record_timer;
+  record_timer.Start();
+
+  // Models whose geometry the draw list refers to, by the buffer index in
+  // the sort key (see BuildDrawList). Each model's geometry lives in one
+  // buffer, so its binding is shared by every primitive drawn from it.
+  GLTFModel* geometry_models[] = {&m_helmet_model};
+  const uint32_t geometry_model_count =
+      uint32_t(sizeof(geometry_models) / sizeof(geometry_models[0]));
+
+  // The per object constants are a dynamic offset on the material's set, so
+  // the set is rebound for every draw whose material or constants differ
+  // from the previous draw's. Sorting by material keeps the set itself the
+  // same across runs of draws, only deduplicated constants skip the bind.
+  const uint32_t material_count = m_helmet_model.GetMaterialCount();
+  const vkex::DescriptorSet* p_material_sets =
+      &shader_state.material_descriptor_sets[frame_index * material_count];
+
+  // Stress scene instances share every draw, each reads its transform from
+  // the instance buffer
+  const uint32_t instance_count = m_stress_scene.GetInstanceCount();
+
+  // Culled draws come from the culler's command run for the item, one
+  // command per surviving instance with the instance as firstInstance
+  VkBuffer command_buffer = VK_NULL_HANDLE;
+  VkBuffer count_buffer = VK_NULL_HANDLE;
+  if (gpu_culled) {
+    command_buffer = *(m_gpu_culler.GetCommandBuffer(frame_index));
+    count_buffer = *(m_gpu_culler.GetCounterBuffer(frame_index));
+  }
 
-  const VkDeviceSize offsets[] = {0, 0, 0};
-  std::vector<VkBuffer> vertex_buffers;
-  m_helmet_model.GetVertexBuffers(node_index, primitive_index, vertex_buffers);
-  cmd->CmdBindVertexBuffers(0, uint32_t(vertex_buffers.size()),
-                            vertex_buffers.data(), offsets);
+  const auto& scene = m_helmet_model.GetFlattenedScene();
+  auto draw_items = m_draw_list.GetItems();
+  uint32_t bound_buffer_index = UINT32_MAX;
+  uint32_t bound_material_index = UINT32_MAX;
+  uint32_t bound_constants_offset = UINT32_MAX;
+  for (uint32_t draw_index = 0; draw_index < uint32_t(draw_items.size());
+       draw_index++) {
+    const auto& item = draw_items[draw_index];
+    const uint32_t buffer_index = DrawList::GetBufferIndex(item.sort_key);
+    if (buffer_index != bound_buffer_index) {
+      VKEX_ASSERT(buffer_index < geometry_model_count);
+      GLTFModel& geometry_model = *geometry_models[buffer_index];
+      cmd->CmdBindIndexBuffer(geometry_model.GetIndexBuffer(),
+                              geometry_model.GetIndexBufferOffset(),
+                              geometry_model.GetIndexType());
+
+      VkBuffer vertex_buffers[GLTFModel::BufferType::BufferTypeCount] = {};
+      VkDeviceSize offsets[GLTFModel::BufferType::BufferTypeCount] = {};
+      geometry_model.GetVertexBuffers(vertex_buffers, offsets);
+      cmd->CmdBindVertexBuffers(0, GLTFModel::BufferType::BufferTypeCount,
+                                vertex_buffers, offsets);
+      bound_buffer_index = buffer_index;
+    }
+    if ((item.material_index != bound_material_index) ||
+        (item.constants_offset != bound_constants_offset)) {
+      const uint32_t dynamic_offsets[] = {per_frame_dynamic_offset,
+                                          item.constants_offset};
+      cmd->CmdBindDescriptorSets(
+          VK_PIPELINE_BIND_POINT_GRAPHICS, *(shader_state.pipeline_layout), 0,
+          {*(p_material_sets[item.material_index])}, dynamic_offsets);
+      bound_material_index = item.material_index;
+      bound_constants_offset = item.constants_offset;
+    }
+    if (gpu_culled) {
+      cmd->CmdDrawIndexedIndirectCount(
+          command_buffer, m_gpu_culler.GetCommandOffset(draw_index),
+          count_buffer, GpuCuller::GetCountOffset(draw_index), instance_count,
+          GpuCuller::kCommandStride);
+    } else if (full_detail && (item.lod > 0)) {
+      const auto& primitive =
+          m_helmet_model
+              .GetMesh(uint32_t(scene.mesh_indices[item.instance_index]))
+              .primitives[item.primitive_index];
+      cmd->CmdDrawIndexed(primitive.index_count, instance_count,
+                          primitive.first_index, item.vertex_offset, 0);
+    } else {
+      cmd->CmdDrawIndexed(item.index_count, instance_count, item.first_index,
+                          item.vertex_offset, 0);
+    }
+  }
 
-  auto index_count = m_helmet_model.GetIndexCount(node_index, primitive_index);
-  cmd->CmdDrawIndexed(index_count, 1, 0, 0, 0);
+  record_timer.Stop();
+  m_draw_list.AddRecordTime(record_timer.Millis(),
+                            uint32_t(draw_items.size()));
 }
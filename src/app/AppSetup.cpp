@@ -127,6 +127,12 @@ void VkexInfoApp::BuildCheckerboardMaterialSampler() {
       checkerboard_sampler_ci, &m_cb_grad_adj_sampler));
 }
 
+// Shaders that draw the model with per material descriptor sets. The
+// instanced variants only exist when the stress scene is enabled.
+static const AppShaderList kSceneShaders[] = {
+    AppShaderList::Geometry, AppShaderList::GeometryCB,
+    AppShaderList::GeometryInstanced, AppShaderList::GeometryCBInstanced};
+
 void ConfigureDynamicUbos(vkex::DescriptorSetLayoutCreateInfo& create_info) {
   for (auto& binding : create_info.bindings) {
     if (binding.descriptorType ==
@@ -147,10 +153,16 @@ void VkexInfoApp::SetupShaders(
   for (auto& shader_input : shader_inputs) {
     GeneratedShaderState gen_shader_state = {};
 
+    // Optional shaders without paths keep an empty state so the list can
+    // still be indexed by AppShaderList
+    if (shader_input.shader_paths.empty()) {
+      generated_shader_states.push_back(gen_shader_state);
+      continue;
+    }
+
     {
       gen_shader_state.pipeline_type = shader_input.pipeline_type;
 
-      // TODO: Check shader_paths length?
       if (gen_shader_state.pipeline_type == ShaderPipelineType::Compute) {
         VKEX_CALL(asset_util::CreateShaderProgramCompute(
             GetDevice(), shader_input.shader_paths[0],
@@ -216,6 +228,10 @@ void VkexInfoApp::SetupShaders(
   }
 
   for (auto& gen_shader_state : generated_shader_states) {
+    if (gen_shader_state.program == nullptr) {
+      continue;
+    }
+
     vkex::DescriptorSetAllocateInfo allocate_info = {};
     allocate_info.layouts.push_back(gen_shader_state.descriptor_set_layout);
 
@@ -262,6 +278,38 @@ void VkexInfoApp::CheckVulkanFeaturesForPipelines() {
                .variableSampleLocations == VK_TRUE);
     }
   }
+
+  // Without a count buffer every indirect draw would have to be recorded at
+  // the full instance count, so GPU culling needs the extension
+  if (m_stress_scene.IsEnabled()) {
+    std::string draw_indirect_count_name =
+        VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME;
+    if (vkex::Contains(GetDevice()->GetLoadedExtensions(),
+                       draw_indirect_count_name)) {
+      m_gpu_culling_available = true;
+    } else {
+      VKEX_LOG_WARN(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
+                    " not enabled, the stress scene will be drawn without GPU "
+                    "culling.");
+    }
+  }
+
+  // The image metrics reductions fall back to groupshared memory alone
+  {
+    const auto& subgroup_properties =
+        GetDevice()->GetPhysicalDevice()->GetSubgroupProperties();
+    const VkSubgroupFeatureFlags required_operations =
+        VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    m_image_metrics_wave_ops =
+        ((subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) !=
+         0) &&
+        ((subgroup_properties.supportedOperations & required_operations) ==
+         required_operations);
+    VKEX_LOG_INFO("Image metrics: subgroup size "
+                  << subgroup_properties.subgroupSize << ", "
+                  << (m_image_metrics_wave_ops ? "subgroup" : "groupshared")
+                  << " reductions");
+  }
 }
 
 void VkexInfoApp::ConfigureCustomSampleLocationsState() {
@@ -340,3 +388,146 @@ void VkexInfoApp::SetupInitialConstantBufferValues() {
   m_per_frame_constants.data.viewProjectionMatrix = float4x4(1.f);
   m_per_frame_constants.data.prevViewProjectionMatrix = float4x4(1.f);
 }
+
+void VkexInfoApp::SetupMaterialDescriptorSets() {
+  const uint32_t frame_count = GetConfiguration().frame_count;
+  const uint32_t material_count = m_helmet_model.GetMaterialCount();
+
+  {
+    vkex::DescriptorPoolCreateInfo create_info = {};
+    for (auto shader : kSceneShaders) {
+      if (m_generated_shader_states[shader].program == nullptr) {
+        continue;
+      }
+      create_info.pool_sizes += m_generated_shader_states[shader]
+                                    .program->GetInterface()
+                                    .GetDescriptorPoolSizes();
+    }
+    // Uniform buffers are bound as dynamic, see ConfigureDynamicUbos
+    create_info.pool_sizes.uniform_buffer_dynamic +=
+        create_info.pool_sizes.uniform_buffer;
+    create_info.pool_sizes.uniform_buffer = 0;
+    create_info.pool_sizes *= (frame_count * material_count);
+    VKEX_CALL(GetDevice()->CreateDescriptorPool(create_info,
+                                                &m_material_descriptor_pool));
+  }
+
+  for (auto shader : kSceneShaders) {
+    auto& shader_state = m_generated_shader_states[shader];
+    if (shader_state.program == nullptr) {
+      continue;
+    }
+
+    vkex::DescriptorSetAllocateInfo allocate_info = {};
+    allocate_info.layouts.push_back(shader_state.descriptor_set_layout);
+
+    // The checkerboard pass biases texture LOD with its own sampler
+    const bool use_checkerboard_sampler =
+        (shader == AppShaderList::GeometryCB) ||
+        (shader == AppShaderList::GeometryCBInstanced);
+    const bool use_instance_buffer =
+        (shader == AppShaderList::GeometryInstanced) ||
+        (shader == AppShaderList::GeometryCBInstanced);
+
+    shader_state.material_descriptor_sets.resize(frame_count * material_count);
+    for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
+      for (uint32_t material_index = 0; material_index < material_count;
+           material_index++) {
+        auto& descriptor_set =
+            shader_state.material_descriptor_sets[(frame_index *
+                                                   material_count) +
+                                                  material_index];
+        VKEX_CALL(m_material_descriptor_pool->AllocateDescriptorSets(
+            allocate_info, &descriptor_set));
+
+        // The base color sampler is shared by all of the material's textures
+        vkex::Sampler sampler =
+            use_checkerboard_sampler
+                ? m_cb_grad_adj_sampler
+                : m_helmet_model.GetVkSamplerFromMaterial(
+                      material_index,
+                      GLTFModel::MaterialTextureType::BaseColor);
+        descriptor_set->UpdateDescriptor(2, sampler);
+
+        for (uint32_t texture_index = 0;
+             texture_index <
+             GLTFModel::MaterialTextureType::MaterialComponentTypeCount;
+             texture_index++) {
+          const uint32_t kTextureSlotOffset =
+              3;  // TODO: Source from shared header
+          uint32_t binding_slot = texture_index + kTextureSlotOffset;
+
+          descriptor_set->UpdateDescriptor(
+              binding_slot, m_helmet_model.GetVkTextureFromMaterial(
+                                material_index,
+                                GLTFModel::MaterialTextureType(texture_index)));
+        }
+
+        if (use_instance_buffer) {
+          const uint32_t kInstanceBufferSlot = 8;
+          descriptor_set->UpdateDescriptor(
+              kInstanceBufferSlot, m_stress_scene.GetInstanceBuffer());
+        }
+      }
+    }
+  }
+}
+
+void VkexInfoApp::UpdateConstantBufferDescriptors(uint32_t frame_index) {
+  auto constant_buffer = m_constant_buffer_manager.GetBuffer(frame_index);
+
+  // Scene shaders draw with their material sets
+  const uint32_t material_count = m_helmet_model.GetMaterialCount();
+  for (auto shader : kSceneShaders) {
+    auto& material_sets =
+        m_generated_shader_states[shader].material_descriptor_sets;
+    if (material_sets.empty()) {
+      continue;
+    }
+    for (uint32_t material_index = 0; material_index < material_count;
+         material_index++) {
+      auto descriptor_set =
+          material_sets[(frame_index * material_count) + material_index];
+      descriptor_set->UpdateDescriptor(0, constant_buffer,
+                                       m_per_frame_constants.size);
+      descriptor_set->UpdateDescriptor(1, constant_buffer,
+                                       m_per_object_constants.size);
+    }
+  }
+
+  m_generated_shader_states[AppShaderList::InternalToTargetScaledCopy]
+      .descriptor_sets[frame_index]
+      ->UpdateDescriptor(0, constant_buffer,
+                         m_internal_to_target_scaled_copy_constants.size);
+
+  m_generated_shader_states[AppShaderList::InternalTargetImageDelta]
+      .descriptor_sets[frame_index]
+      ->UpdateDescriptor(0, constant_buffer,
+                         m_internal_to_target_scaled_copy_constants.size);
+  m_generated_shader_states[AppShaderList::InternalTargetImageDelta]
+      .descriptor_sets[frame_index]
+      ->UpdateDescriptor(1, constant_buffer,
+                         m_image_delta_options_constants.size);
+
+  m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy]
+      .descriptor_sets[frame_index]
+      ->UpdateDescriptor(0, constant_buffer,
+                         m_target_to_present_scaled_copy_constants.size);
+
+  m_generated_shader_states[AppShaderList::UpscalingCAS]
+      .descriptor_sets[frame_index]
+      ->UpdateDescriptor(0, constant_buffer, m_cas_upscaling_constants.size);
+
+  m_generated_shader_states[AppShaderList::CheckerboardUpscale]
+      .descriptor_sets[frame_index]
+      ->UpdateDescriptor(0, constant_buffer, m_cb_upscaling_constants.size);
+
+  if (m_gpu_culler.IsInitialized()) {
+    m_gpu_culler.UpdateConstantBufferDescriptors(frame_index, constant_buffer);
+  }
+
+  if (m_image_metrics.IsInitialized()) {
+    m_image_metrics.UpdateConstantBufferDescriptors(frame_index,
+                                                    constant_buffer);
+  }
+}
@@ -16,6 +16,8 @@
 
 #include "AppCore.h"
 
+#include <algorithm>
+
 // Enable if we want simple CPU metrics in GUI
 //#define GUI_CPU_STATS
 
@@ -30,6 +32,8 @@
 struct UpscalingTechniqueInfo {
   UpscalingTechniqueKey id;
   std::string name;
+  // For command line options and reports
+  std::string short_name;
 };
 
 struct ResolutionInfo {
@@ -59,9 +63,9 @@ struct PresentResolutionChain {
 
 static UpscalingTechniqueInfo
     s_upscaling_techniques[UpscalingTechniqueKey::kuCount] = {
-        {UpscalingTechniqueKey::kuNone, "None"},
-        {UpscalingTechniqueKey::CAS, "FidelityFX CAS"},
-        {UpscalingTechniqueKey::Checkerboard, "Checkerboard"},
+        {UpscalingTechniqueKey::kuNone, "None", "none"},
+        {UpscalingTechniqueKey::CAS, "FidelityFX CAS", "cas"},
+        {UpscalingTechniqueKey::Checkerboard, "Checkerboard", "checkerboard"},
 };
 
 static ResolutionInfo s_resolution_infos[ResolutionInfoKey::krCount] = {
@@ -258,6 +262,234 @@ void VkexInfoApp::BuildTargetResolutionTextList(
   }
 }
 
+void VkexInfoApp::BuildTimerTagNameList(
+    std::vector<std::string>& timer_name_list) {
+  static const char* s_timer_tag_names[TimerTag::kTimerTagCount] = {
+      "scene_render_internal", "upscale_internal",  "total_internal",
+      "scene_render_target",   "gpu_cull_internal", "image_metrics_target",
+  };
+  timer_name_list.assign(std::begin(s_timer_tag_names),
+                         std::end(s_timer_tag_names));
+}
+
+void VkexInfoApp::BuildSweepConfigurations(
+    const SweepSpec& spec, std::vector<SweepConfiguration>& configurations) {
+  configurations.clear();
+
+  for (const auto& technique_name : spec.techniques) {
+    const bool known = std::any_of(
+        std::begin(s_upscaling_techniques), std::end(s_upscaling_techniques),
+        [&technique_name](const UpscalingTechniqueInfo& technique) {
+          return technique.short_name == technique_name;
+        });
+    if (!known) {
+      VKEX_LOG_WARN("Unknown upscaling technique in sweep: " << technique_name);
+    }
+  }
+
+  const auto& target_keys =
+      s_present_resolutions[m_present_resolution_key].target_resolution_keys;
+  for (uint32_t target_index = 0; target_index < target_keys.size();
+       target_index++) {
+    const auto& target_chain = s_target_resolutions[target_keys[target_index]];
+
+    for (uint32_t technique_index = 0;
+         technique_index < UpscalingTechniqueKey::kuCount; technique_index++) {
+      const auto& technique = s_upscaling_techniques[technique_index];
+      if (!spec.techniques.empty() &&
+          (std::find(spec.techniques.begin(), spec.techniques.end(),
+                     technique.short_name) == spec.techniques.end())) {
+        continue;
+      }
+
+      SweepConfiguration configuration = {};
+      configuration.technique_index = technique_index;
+      configuration.target_index = target_index;
+      configuration.technique_name = technique.short_name;
+      configuration.target_extent =
+          s_resolution_infos[target_chain.resolution_info_key]
+              .resolution_extent;
+
+      if (technique.id == UpscalingTechniqueKey::Checkerboard) {
+        configuration.internal_index = 0;
+        configuration.internal_extent =
+            s_cb_resolution_infos[target_chain
+                                      .checkerboard_resolution_info_key]
+                .resolution_extent;
+        configurations.push_back(configuration);
+        continue;
+      }
+
+      const auto& internal_keys = target_chain.internal_resolution_info_keys;
+      for (uint32_t internal_index = 0; internal_index < internal_keys.size();
+           internal_index++) {
+        configuration.internal_index = internal_index;
+        configuration.internal_extent =
+            s_resolution_infos[internal_keys[internal_index]].resolution_extent;
+
+        if (technique.id == UpscalingTechniqueKey::CAS) {
+          for (float sharpness : spec.sharpness_values) {
+            configuration.sharpness = sharpness;
+            configurations.push_back(configuration);
+          }
+        } else {
+          configurations.push_back(configuration);
+        }
+      }
+    }
+  }
+}
+
+void VkexInfoApp::ApplySweepConfiguration(
+    const SweepConfiguration& configuration) {
+  // Changing the target resets the internal resolution, so it goes first
+  m_selected_target_resolution_index = configuration.target_index;
+  UpdateTargetResolutionState();
+
+  m_selected_upscaling_technique_index = configuration.technique_index;
+  switch (s_upscaling_techniques[configuration.technique_index].id) {
+    case UpscalingTechniqueKey::Checkerboard:
+      m_selected_cb_internal_resolution_index = configuration.internal_index;
+      break;
+    case UpscalingTechniqueKey::CAS:
+      m_cas_info.sharpness = configuration.sharpness;
+      m_selected_internal_resolution_index = configuration.internal_index;
+      break;
+    default:
+      m_selected_internal_resolution_index = configuration.internal_index;
+      break;
+  }
+}
+
+void VkexInfoApp::StartSettingsSweep() {
+  SweepSpec spec = {};
+  if (!SettingsSweep::LoadSpec(m_sweep_spec_path, &spec)) {
+    VKEX_LOG_WARN("Sweep spec has errors, sweeping what could be read");
+  }
+
+  std::vector<SweepConfiguration> configurations;
+  BuildSweepConfigurations(spec, configurations);
+
+  std::vector<std::string> timer_names;
+  BuildTimerTagNameList(timer_names);
+
+  // Quality is measured against the native reference every frame, and the
+  // model holds still so every configuration renders the same image
+  m_image_metrics_enabled = true;
+  m_animation_enabled = false;
+
+  m_settings_sweep.Start(spec, configurations, timer_names,
+                         TimerTag::kTotalInternal,
+                         GetConfiguration().frame_count,
+                         m_peak_bandwidth_gbps);
+}
+
+void VkexInfoApp::UpdateSettingsSweep() {
+  const SweepConfiguration* p_configuration =
+      m_settings_sweep.NextFrame(&m_sweep_sample);
+  if (p_configuration != nullptr) {
+    ApplySweepConfiguration(*p_configuration);
+    return;
+  }
+
+  m_settings_sweep.WriteReports();
+  Quit();
+}
+
+void VkexInfoApp::RecordSweepSample(uint32_t frame_index) {
+  auto& per_frame_data = m_per_frame_datas[frame_index];
+
+  if ((per_frame_data.sweep_sample != SettingsSweep::kNotMeasured) &&
+      per_frame_data.timestamps_readback) {
+    double timer_ms[TimerTag::kTimerTagCount] = {};
+    uint64_t timer_bytes[TimerTag::kTimerTagCount] = {};
+    for (uint32_t tag_index = 0; tag_index < TimerTag::kTimerTagCount;
+         tag_index++) {
+      timer_ms[tag_index] =
+          CalculateGpuTimeRange(per_frame_data, TimerTag(tag_index),
+                                VKEX_TIMER_NANOS_TO_MILLIS);
+      timer_bytes[tag_index] =
+          per_frame_data.pass_traffic[tag_index].GetTotalBytes();
+    }
+
+    ImageQualityMetrics metrics = {};
+    m_image_metrics.GetMetrics(&metrics);
+    m_settings_sweep.AddSample(per_frame_data.sweep_sample, timer_ms,
+                               timer_bytes, metrics);
+  }
+
+  per_frame_data.sweep_sample = m_sweep_sample;
+}
+
+bool VkexInfoApp::StartFrameCapture() {
+  std::vector<FrameCaptureStreamInfo> streams;
+  for (const auto& name : m_capture_streams) {
+    FrameCaptureStreamInfo info = {};
+    info.name = name;
+    info.container = m_capture_raw ? FrameCaptureContainer::kRaw
+                                   : FrameCaptureContainer::kY4M;
+    info.extent = GetTargetResolutionExtent();
+    if ((name == "internal") || (name == "velocity")) {
+      info.extent = m_internal_render_area.extent;
+    }
+    // Two 16 bit floats a pixel, only the raw container keeps them
+    if (name == "velocity") {
+      info.container = FrameCaptureContainer::kRaw;
+    }
+    streams.push_back(info);
+  }
+
+  // Every capture target is allocated at the present resolution
+  const uint32_t frame_rate = (m_animation_rate > 0) ? m_animation_rate : 60;
+  return m_frame_capture.Initialize(GetDevice(), m_capture_path, streams,
+                                    GetPresentResolutionExtent(), frame_rate);
+}
+
+void VkexInfoApp::CaptureFrame() {
+  if (m_capture_path.empty()) {
+    return;
+  }
+  if (!m_frame_capture.IsActive() && !StartFrameCapture()) {
+    m_capture_path.clear();
+    return;
+  }
+
+  m_frame_capture.Poll();
+
+  // The checkerboard pass is multisampled and can't be copied to a buffer
+  const bool internal_single_sampled =
+      (GetUpscalingTechnique() != UpscalingTechniqueKey::Checkerboard);
+
+  std::vector<FrameCaptureSource> sources;
+  for (const auto& name : m_capture_streams) {
+    FrameCaptureSource source = {};
+    source.extent = GetTargetResolutionExtent();
+    if (name == "target") {
+      source.image = m_current_target_texture->GetImage();
+      source.layout = VK_IMAGE_LAYOUT_GENERAL;
+    } else if (name == "reference") {
+      source.image =
+          m_internal_as_target_draw_simple_render_pass.color_texture
+              ->GetImage();
+      source.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    } else if (name == "history") {
+      source.image = m_previous_target_texture->GetImage();
+      source.layout = VK_IMAGE_LAYOUT_GENERAL;
+    } else if (internal_single_sampled) {
+      source.image =
+          (name == "velocity")
+              ? m_internal_draw_simple_render_pass.velocity_texture->GetImage()
+              : m_internal_draw_simple_render_pass.color_texture->GetImage();
+      source.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+      source.extent = m_internal_render_area.extent;
+    }
+    sources.push_back(source);
+  }
+
+  VKEX_CALL(m_frame_capture.Capture(GetGraphicsQueue(), sources,
+                                    GetElapsedFrames()));
+}
+
 void VkexInfoApp::IssueGpuTimeStart(vkex::CommandBuffer cmd,
                                     PerFrameData& per_frame_data,
                                     TimerTag tag) {
@@ -284,7 +516,7 @@ void VkexInfoApp::ReadbackGpuTimestamps(uint32_t frame_index) {
 
   const uint32_t query_count = TimerTag::kTimerQueryCount;
 
-  std::vector<uint64_t> data(query_count);
+  auto data = GetFrameAllocator().Allocate<uint64_t>(query_count);
   const uint32_t stride = sizeof(uint64_t);
   const size_t data_size = data.size() * stride;
 
@@ -302,6 +534,20 @@ void VkexInfoApp::ReadbackGpuTimestamps(uint32_t frame_index) {
     per_frame_data.issued_gpu_timers[tag_index].end_time =
         data[slot_start_index + 1];
   }
+  per_frame_data.pass_traffic = per_frame_data.recorded_pass_traffic;
+
+  // Skipped passes still write their timestamps, keep their zeros out of the
+  // percentiles
+  for (uint32_t tag_index = 0; tag_index < TimerTag::kTimerTagCount;
+       tag_index++) {
+    if (((tag_index == TimerTag::kGpuCullInternal) && !IsGpuCullingActive()) ||
+        ((tag_index == TimerTag::kImageMetricsTarget) &&
+         !m_image_metrics_enabled)) {
+      continue;
+    }
+    m_gpu_timer_metrics[tag_index].Add(CalculateGpuTimeRange(
+        per_frame_data, TimerTag(tag_index), VKEX_TIMER_NANOS_TO_MILLIS));
+  }
 
   per_frame_data.timestamps_readback = true;
 }
@@ -323,6 +569,114 @@ double VkexInfoApp::CalculateGpuTimeRange(const PerFrameData& per_frame_data,
   return (gpu_ticks * timestamp_period * nano_scaler);
 }
 
+void VkexInfoApp::BuildPassTraffic(PerFrameData& per_frame_data) {
+  auto& traffic = per_frame_data.recorded_pass_traffic;
+  std::fill(traffic.begin(), traffic.end(), vkex::PassTraffic());
+
+  const VkExtent2D internal_extent = m_internal_render_area.extent;
+  const VkExtent2D target_extent = GetTargetResolutionExtent();
+
+  // Color and velocity written once, depth tested and written once. Vertex,
+  // index and material texture fetches depend on the scene and aren't
+  // modeled, so only fill bound scene passes come out near the peak.
+  auto add_scene_pass = [](const SimpleRenderPass& render_pass,
+                           VkExtent2D extent, vkex::PassTraffic* p_traffic) {
+    p_traffic->AddWrite(render_pass.color_texture, extent);
+    p_traffic->AddWrite(render_pass.velocity_texture, extent);
+    p_traffic->AddRead(render_pass.dsv_texture, extent);
+    p_traffic->AddWrite(render_pass.dsv_texture, extent);
+  };
+
+  auto& scene_internal = traffic[TimerTag::kSceneRenderInternal];
+  auto& upscale_internal = traffic[TimerTag::kUpscaleInternal];
+  if (GetUpscalingTechnique() == UpscalingTechniqueKey::Checkerboard) {
+    const auto& cb_render_pass =
+        m_checkerboard_simple_render_pass[per_frame_data.cb_frame_index];
+    add_scene_pass(cb_render_pass, internal_extent, &scene_internal);
+
+    // Both samples of color and velocity, and the previous resolve for the
+    // pixels this frame didn't render
+    upscale_internal.AddRead(cb_render_pass.color_texture, internal_extent);
+    upscale_internal.AddRead(cb_render_pass.velocity_texture, internal_extent);
+    upscale_internal.AddRead(m_previous_target_texture, target_extent);
+  } else {
+    add_scene_pass(m_internal_draw_simple_render_pass, internal_extent,
+                   &scene_internal);
+
+    // Bilinear and CAS neighborhoods overlap, so each source texel is read
+    // about once
+    upscale_internal.AddRead(m_internal_draw_simple_render_pass.color_texture,
+                             internal_extent);
+  }
+  upscale_internal.AddWrite(m_current_target_texture, target_extent);
+
+  // The cull pass moves buffers, only the passes around it are modeled
+  auto& total_internal = traffic[TimerTag::kTotalInternal];
+  total_internal.Add(scene_internal);
+  total_internal.Add(upscale_internal);
+
+  add_scene_pass(m_internal_as_target_draw_simple_render_pass, target_extent,
+                 &traffic[TimerTag::kSceneRenderTarget]);
+
+  // The per tile results are tiny next to the two images
+  if (m_image_metrics_enabled) {
+    auto& image_metrics = traffic[TimerTag::kImageMetricsTarget];
+    image_metrics.AddRead(m_current_target_texture, target_extent);
+    image_metrics.AddRead(
+        m_internal_as_target_draw_simple_render_pass.color_texture,
+        target_extent);
+  }
+}
+
+void VkexInfoApp::DrawGpuTimerValue(const PerFrameData& per_frame_data,
+                                    TimerTag tag, double ms) {
+  const uint64_t bytes = per_frame_data.pass_traffic[tag].GetTotalBytes();
+  const double gbps = vkex::AchievedBandwidth(bytes, ms);
+  if (gbps <= 0.0) {
+    ImGui::Text("%f ms", ms);
+  } else if (m_peak_bandwidth_gbps <= 0.0) {
+    ImGui::Text("%f ms, %.1f GB/s", ms, gbps);
+  } else {
+    ImGui::Text("%f ms, %.1f GB/s (%.0f%%)", ms, gbps,
+                (gbps * 100.0) / m_peak_bandwidth_gbps);
+  }
+}
+
+void VkexInfoApp::DrawFrameMetricRow(const char* name,
+                                     const vkex::FrameMetric& metric) {
+  vkex::QuantileSummary summary = {};
+  metric.GetRun().GetSummary(&summary);
+  ImGui::Text("  %s", name);
+  ImGui::NextColumn();
+  ImGui::Text("%.3f / %.3f / %.3f / %.3f ms", summary.p50, summary.p95,
+              summary.p99, summary.max);
+  ImGui::NextColumn();
+}
+
+const GeneratedShaderState& VkexInfoApp::GetSceneShaderState(
+    AppShaderList shader) {
+  VKEX_ASSERT((shader == AppShaderList::Geometry) ||
+              (shader == AppShaderList::GeometryCB));
+
+  if (m_stress_scene.IsEnabled()) {
+    shader = (shader == AppShaderList::Geometry)
+                 ? AppShaderList::GeometryInstanced
+                 : AppShaderList::GeometryCBInstanced;
+  }
+  return m_generated_shader_states[shader];
+}
+
+bool VkexInfoApp::IsGpuCullingActive() {
+  return m_gpu_culling_enabled && m_gpu_culler.IsInitialized();
+}
+
+float VkexInfoApp::GetLodPixelScale() {
+  // Detail follows the internal resolution, coarser levels kick in sooner
+  // when rendering below the target resolution
+  return LodSelector::ComputePixelScale(m_camera.GetProjectionMatrix(),
+                                        m_internal_render_area.extent.height);
+}
+
 vkex::uint3 VkexInfoApp::CalculateSimpleDispatchDimensions(
     GeneratedShaderState& gen_shader_state, VkExtent2D image_extent) {
   auto tg_dims =
@@ -346,31 +700,6 @@ GPULightInfo VkexInfoApp::ConvertCPULightInfoToGPULightInfo(
   return gpuLightOut;
 }
 
-void VkexInfoApp::UpdateMaterialConstants() {
-  // TODO: Pass in model reference?
-
-  m_per_object_constants.data.baseColorFactor[0] =
-      (m_helmet_model.GetBaseColorFactor(0, 0))[0];
-  m_per_object_constants.data.baseColorFactor[1] =
-      (m_helmet_model.GetBaseColorFactor(0, 0))[1];
-  m_per_object_constants.data.baseColorFactor[2] =
-      (m_helmet_model.GetBaseColorFactor(0, 0))[2];
-  m_per_object_constants.data.baseColorFactor[3] =
-      (m_helmet_model.GetBaseColorFactor(0, 0))[3];
-
-  m_per_object_constants.data.emissiveFactor[0] =
-      (m_helmet_model.GetEmissiveFactor(0, 0))[0];
-  m_per_object_constants.data.emissiveFactor[1] =
-      (m_helmet_model.GetEmissiveFactor(0, 0))[1];
-  m_per_object_constants.data.emissiveFactor[2] =
-      (m_helmet_model.GetEmissiveFactor(0, 0))[2];
-
-  m_per_object_constants.data.metallicFactor =
-      m_helmet_model.GetMetallicFactor(0, 0);
-  m_per_object_constants.data.roughnessFactor =
-      m_helmet_model.GetRoughnessFactor(0, 0);
-}
-
 void VkexInfoApp::UpdateImageDeltaConstants() {
   m_image_delta_options_constants.data.deltaAmplifier = m_delta_amplifier;
 
@@ -451,6 +780,288 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
         ImGui::Checkbox("##AnimationEnabled", &m_animation_enabled);
         ImGui::NextColumn();
       }
+      if (m_frame_player.IsLoaded()) {
+        ImGui::Text("Replay");
+        ImGui::NextColumn();
+        ImGui::Text("%u / %u", m_frame_player.GetFrameIndex(),
+                    m_frame_player.GetFrameCount());
+        ImGui::NextColumn();
+      }
+      if (m_frame_recorder.IsOpen()) {
+        ImGui::Text("Recording");
+        ImGui::NextColumn();
+        ImGui::Text("%u frames", m_frame_recorder.GetFrameCount());
+        ImGui::NextColumn();
+      }
+      if (m_frame_capture.IsActive()) {
+        ImGui::Text("Capture");
+        ImGui::NextColumn();
+        ImGui::Text("%llu written, %llu dropped",
+                    static_cast<unsigned long long>(
+                        m_frame_capture.GetWrittenCount()),
+                    static_cast<unsigned long long>(
+                        m_frame_capture.GetDroppedCount()));
+        ImGui::NextColumn();
+      }
+      if (m_settings_sweep.IsActive()) {
+        ImGui::Text("Settings Sweep");
+        ImGui::NextColumn();
+        ImGui::Text("%u / %u",
+                    std::min(m_settings_sweep.GetConfigurationIndex() + 1,
+                             m_settings_sweep.GetConfigurationCount()),
+                    m_settings_sweep.GetConfigurationCount());
+        ImGui::NextColumn();
+      }
+      ImGui::Columns(1);
+    }
+
+    ImGui::Separator();
+
+    // Constant buffer ring
+    {
+      ConstantBufferStatistics cb_stats = {};
+      m_constant_buffer_manager.GetStatistics(&cb_stats);
+
+      ImGui::Columns(2);
+      {
+        ImGui::Text("Constant Buffer Ring");
+        ImGui::NextColumn();
+        ImGui::Text("%llu KiB (%u buffers, grown %u times)",
+                    static_cast<unsigned long long>(cb_stats.ring_size / 1024),
+                    cb_stats.buffer_count, cb_stats.growth_count);
+        ImGui::NextColumn();
+      }
+      {
+        ImGui::Text("  Frame Bytes");
+        ImGui::NextColumn();
+        ImGui::Text(
+            "%llu (high water %llu, in flight %llu)",
+            static_cast<unsigned long long>(cb_stats.frame_bytes),
+            static_cast<unsigned long long>(cb_stats.frame_high_water_mark),
+            static_cast<unsigned long long>(
+                cb_stats.in_flight_high_water_mark));
+        ImGui::NextColumn();
+      }
+      {
+        ImGui::Text("  Uploads/Frame");
+        ImGui::NextColumn();
+        ImGui::Text("%u (%u deduplicated)", cb_stats.frame_upload_count,
+                    cb_stats.frame_deduplicated_count);
+        ImGui::NextColumn();
+      }
+      ImGui::Columns(1);
+    }
+
+    ImGui::Separator();
+
+    // Draw list
+    {
+      DrawListStatistics draw_stats = {};
+      m_draw_list.GetStatistics(&draw_stats);
+
+      ImGui::Columns(2);
+      {
+        ImGui::Text("Draws");
+        ImGui::NextColumn();
+        ImGui::Text("%u (%u materials, %u buffers)", draw_stats.draw_count,
+                    draw_stats.material_switch_count,
+                    draw_stats.buffer_switch_count);
+        ImGui::NextColumn();
+      }
+      {
+        // Normalized so scenes of different sizes can be compared
+        const double us_per_1k_draws =
+            (draw_stats.recorded_draw_count > 0)
+                ? (draw_stats.record_time_ms * 1000.0 * 1000.0 /
+                   draw_stats.recorded_draw_count)
+                : 0.0;
+        ImGui::Text("  CPU Record");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms, %.1f us per 1k draws", draw_stats.record_time_ms,
+                    us_per_1k_draws);
+        ImGui::NextColumn();
+      }
+      if (m_stress_scene.IsEnabled()) {
+        int instance_count = int(m_stress_scene.GetInstanceCount());
+        ImGui::Text("Stress Instances");
+        ImGui::NextColumn();
+        ImGui::SliderInt("##StressInstances", &instance_count, 1,
+                         int(m_stress_scene.GetMaxInstanceCount()));
+        m_stress_scene.SetInstanceCount(uint32_t(instance_count));
+        ImGui::NextColumn();
+      }
+      {
+        const uint64_t triangle_count =
+            (draw_stats.index_count / 3) * m_stress_scene.GetInstanceCount();
+        ImGui::Text("  Triangles");
+        ImGui::NextColumn();
+        ImGui::Text("%.2f M per pass", double(triangle_count) / 1000000.0);
+        ImGui::NextColumn();
+      }
+      {
+        const auto& geometry_stats = m_helmet_model.GetGeometryStatistics();
+        ImGui::Text("  Vertex Cache ACMR");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f (%.3f as loaded)", geometry_stats.acmr_after,
+                    geometry_stats.acmr_before);
+        ImGui::NextColumn();
+
+        // Modeled from the index order, before any culling
+        const uint64_t instance_count = m_stress_scene.GetInstanceCount();
+        ImGui::Text("  Vertex Fetch");
+        ImGui::NextColumn();
+        ImGui::Text("%.2f MiB per pass (%.2f MiB as loaded)%s",
+                    double(geometry_stats.fetch_bytes_after * instance_count) /
+                        (1024.0 * 1024.0),
+                    double(geometry_stats.fetch_bytes_before * instance_count) /
+                        (1024.0 * 1024.0),
+                    geometry_stats.quantized ? ", quantized" : "");
+        ImGui::NextColumn();
+      }
+      ImGui::Columns(1);
+    }
+
+    ImGui::Separator();
+
+    // Frustum culling
+    {
+      FrustumCullStatistics cull_stats = {};
+      m_frustum_culler.GetStatistics(&cull_stats);
+
+      ImGui::Columns(2);
+      {
+        ImGui::Text("Frustum Culling");
+        ImGui::NextColumn();
+        ImGui::Checkbox("##FrustumCulling", &m_frustum_culling_enabled);
+        ImGui::SameLine();
+        if (m_stress_scene.IsEnabled()) {
+          ImGui::Text("off with stress scene");
+        } else {
+          ImGui::Text("%s", FrustumCuller::GetKernelName());
+        }
+        ImGui::NextColumn();
+      }
+      if (m_frustum_culling_enabled && !m_stress_scene.IsEnabled()) {
+        {
+          ImGui::Text("  Culled");
+          ImGui::NextColumn();
+          ImGui::Text("%u of %u primitives",
+                      cull_stats.tested_count - cull_stats.visible_count,
+                      cull_stats.tested_count);
+          ImGui::NextColumn();
+        }
+        {
+          ImGui::Text("  CPU Cull");
+          ImGui::NextColumn();
+          ImGui::Text("%.3f ms (test %.3f ms)", cull_stats.cull_time_ms,
+                      cull_stats.kernel_time_ms);
+          ImGui::NextColumn();
+        }
+      }
+      ImGui::Columns(1);
+    }
+
+    // GPU culling
+    if (m_stress_scene.IsEnabled()) {
+      GpuCullStatistics gpu_cull_stats = {};
+      m_gpu_culler.GetStatistics(&gpu_cull_stats);
+
+      ImGui::Columns(2);
+      {
+        ImGui::Text("GPU Culling");
+        ImGui::NextColumn();
+        if (m_gpu_culler.IsInitialized()) {
+          ImGui::Checkbox("##GpuCulling", &m_gpu_culling_enabled);
+          ImGui::SameLine();
+          ImGui::Checkbox("Hi-Z##GpuOcclusionCulling",
+                          &m_gpu_occlusion_culling_enabled);
+        } else {
+          ImGui::Text("unavailable");
+        }
+        ImGui::NextColumn();
+      }
+      if (IsGpuCullingActive()) {
+        {
+          ImGui::Text("  Tested");
+          ImGui::NextColumn();
+          ImGui::Text("%u instance draws", gpu_cull_stats.tested_count);
+          ImGui::NextColumn();
+        }
+        {
+          ImGui::Text("  Frustum Culled");
+          ImGui::NextColumn();
+          ImGui::Text("%u", gpu_cull_stats.frustum_culled_count);
+          ImGui::NextColumn();
+        }
+        {
+          ImGui::Text("  Hi-Z Culled");
+          ImGui::NextColumn();
+          if (gpu_cull_stats.occlusion_tested) {
+            ImGui::Text("%u", gpu_cull_stats.occlusion_culled_count);
+          } else {
+            ImGui::Text("no depth history");
+          }
+          ImGui::NextColumn();
+        }
+        {
+          ImGui::Text("  Drawn");
+          ImGui::NextColumn();
+          ImGui::Text("%u", gpu_cull_stats.drawn_count);
+          ImGui::NextColumn();
+        }
+      }
+      ImGui::Columns(1);
+    }
+
+    // Level of detail
+    {
+      const auto& geometry_stats = m_helmet_model.GetGeometryStatistics();
+
+      ImGui::Columns(2);
+      {
+        float error_threshold = m_lod_selector.GetErrorThreshold();
+        ImGui::Text("LOD Error");
+        ImGui::NextColumn();
+        ImGui::SliderFloat("##LodError", &error_threshold, 0.0f, 8.0f,
+                           "%.2f px");
+        m_lod_selector.SetErrorThreshold(error_threshold);
+        ImGui::NextColumn();
+      }
+      {
+        ImGui::Text("  Generated");
+        ImGui::NextColumn();
+        ImGui::Text("%u of %u primitives, %u indices, %.1f ms",
+                    geometry_stats.lod_primitive_count,
+                    geometry_stats.primitive_count,
+                    geometry_stats.lod_index_count,
+                    geometry_stats.lod_time_ms);
+        ImGui::NextColumn();
+      }
+      {
+        // Per primitive on the CPU, or per stress instance on the GPU
+        uint32_t level_counts[LOD_MAX_COUNT] = {};
+        if (!m_stress_scene.IsEnabled()) {
+          LodStatistics lod_stats = {};
+          m_lod_selector.GetStatistics(&lod_stats);
+          std::copy(lod_stats.level_counts,
+                    lod_stats.level_counts + LOD_MAX_COUNT, level_counts);
+        } else if (IsGpuCullingActive()) {
+          GpuCullStatistics gpu_cull_stats = {};
+          m_gpu_culler.GetStatistics(&gpu_cull_stats);
+          std::copy(gpu_cull_stats.lod_drawn_counts,
+                    gpu_cull_stats.lod_drawn_counts + LOD_MAX_COUNT,
+                    level_counts);
+        }
+        ImGui::Text("  Drawn per LOD");
+        ImGui::NextColumn();
+        if (m_stress_scene.IsEnabled() && !IsGpuCullingActive()) {
+          ImGui::Text("full detail without GPU culling");
+        } else {
+          ImGui::Text("%u / %u / %u / %u", level_counts[0], level_counts[1],
+                      level_counts[2], level_counts[3]);
+        }
+        ImGui::NextColumn();
+      }
       ImGui::Columns(1);
     }
 
@@ -465,7 +1076,8 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
       //          Delta visualizers...
       ImGui::Columns(2);
       {
-        std::vector<const char*> upscaling_techniques;
+        auto& upscaling_techniques = m_gui_text_list;
+        upscaling_techniques.clear();
         BuildUpscalingTechniqueList(upscaling_techniques);
 
         ImGui::Text("Upscaling technique");
@@ -479,7 +1091,8 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
         switch (GetUpscalingTechnique()) {
           case UpscalingTechniqueKey::kuNone:
           case UpscalingTechniqueKey::CAS: {
-            std::vector<const char*> resolution_items;
+            auto& resolution_items = m_gui_text_list;
+            resolution_items.clear();
             BuildInternalResolutionTextList(resolution_items);
 
             ImGui::Text("Internal resolution");
@@ -491,7 +1104,8 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
             break;
           }
           case UpscalingTechniqueKey::Checkerboard: {
-            std::vector<const char*> resolution_items;
+            auto& resolution_items = m_gui_text_list;
+            resolution_items.clear();
             BuildCBResolutionTextList(resolution_items);
 
             ImGui::Text("Checkerboard resolution");
@@ -510,7 +1124,8 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
         }
       }
       {
-        std::vector<const char*> resolution_items;
+        auto& resolution_items = m_gui_text_list;
+        resolution_items.clear();
         BuildTargetResolutionTextList(resolution_items);
 
         ImGui::Text("Target Resolution");
@@ -526,14 +1141,14 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
         ImGui::NextColumn();
       }
       {
-        std::vector<const char*> visualizer_items = {"Off", "Luma delta",
-                                                     "RGB delta"};
-        VKEX_ASSERT(int(visualizer_items.size()) ==
-                    int(DeltaVisualizerMode::kDeltaVizCount));
+        const char* const visualizer_items[] = {"Off", "Luma delta",
+                                                "RGB delta"};
+        VKEX_ASSERT(vkex::CountU32(visualizer_items) ==
+                    uint32_t(DeltaVisualizerMode::kDeltaVizCount));
         ImGui::Text("Delta Visualizer");
         ImGui::NextColumn();
         ImGui::Combo("##DeltaViz", (int*)(&m_delta_visualizer_mode),
-                     visualizer_items.data(), int(visualizer_items.size()));
+                     visualizer_items, int(vkex::CountU32(visualizer_items)));
         ImGui::NextColumn();
       }
       {
@@ -567,7 +1182,17 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
 
         ImGui::Text("  Total Time");
         ImGui::NextColumn();
-        ImGui::Text("%f ms", ms_diff);
+        DrawGpuTimerValue(per_frame_data, TimerTag::kTotalInternal, ms_diff);
+        ImGui::NextColumn();
+      }
+      if (IsGpuCullingActive()) {
+        double ms_diff =
+            CalculateGpuTimeRange(per_frame_data, TimerTag::kGpuCullInternal,
+                                  VKEX_TIMER_NANOS_TO_MILLIS);
+
+        ImGui::Text("    GPU Cull Time");
+        ImGui::NextColumn();
+        DrawGpuTimerValue(per_frame_data, TimerTag::kGpuCullInternal, ms_diff);
         ImGui::NextColumn();
       }
       {
@@ -577,7 +1202,7 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
 
         ImGui::Text("    Scene Draw Time");
         ImGui::NextColumn();
-        ImGui::Text("%f ms", ms_diff);
+        DrawGpuTimerValue(per_frame_data, TimerTag::kSceneRenderInternal, ms_diff);
         ImGui::NextColumn();
       }
       {
@@ -587,7 +1212,7 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
 
         ImGui::Text("    Upscale Time");
         ImGui::NextColumn();
-        ImGui::Text("%f ms", ms_diff);
+        DrawGpuTimerValue(per_frame_data, TimerTag::kUpscaleInternal, ms_diff);
         ImGui::NextColumn();
       }
       {
@@ -602,9 +1227,119 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
 
         ImGui::Text("  Scene Render Time");
         ImGui::NextColumn();
-        ImGui::Text("%f ms", ms_diff);
+        DrawGpuTimerValue(per_frame_data, TimerTag::kSceneRenderTarget, ms_diff);
+        ImGui::NextColumn();
+      }
+      if (m_image_metrics_enabled) {
+        double ms_diff =
+            CalculateGpuTimeRange(per_frame_data, TimerTag::kImageMetricsTarget,
+                                  VKEX_TIMER_NANOS_TO_MILLIS);
+
+        ImGui::Text("  Image Metrics Time");
+        ImGui::NextColumn();
+        DrawGpuTimerValue(per_frame_data, TimerTag::kImageMetricsTarget, ms_diff);
+        ImGui::NextColumn();
+      }
+    }
+
+    // What held frames back, over the frame bound window
+    {
+      const vkex::FrameBoundStats& stats = GetFrameBoundStats();
+
+      ImGui::Columns(2);
+      {
+        ImGui::Text("Frame Bound");
+        ImGui::NextColumn();
+        ImGui::Text("CPU %.0f%% GPU %.0f%% Present %.0f%%",
+                    stats.GetBoundPercent(vkex::FrameBound::Cpu),
+                    stats.GetBoundPercent(vkex::FrameBound::Gpu),
+                    stats.GetBoundPercent(vkex::FrameBound::Present));
+        ImGui::NextColumn();
+      }
+      {
+        ImGui::Text("  GPU Busy");
+        ImGui::NextColumn();
+        if (stats.gpu_timed) {
+          ImGui::Text("%.3f ms%s", stats.gpu_busy_ms,
+                      stats.calibrated ? "" : " (uncalibrated)");
+        } else {
+          ImGui::Text("n/a");
+        }
+        ImGui::NextColumn();
+      }
+      {
+        ImGui::Text("  GPU Waits");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.wait_ms[vkex::kFrameWaitFrameFence] +
+                                   stats.wait_ms[vkex::kFrameWaitRenderFence]);
+        ImGui::NextColumn();
+      }
+      {
+        ImGui::Text("  Display Waits");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.wait_ms[vkex::kFrameWaitAcquire] +
+                                   stats.wait_ms[vkex::kFrameWaitPacing] +
+                                   stats.wait_ms[vkex::kFrameWaitPresent]);
+        ImGui::NextColumn();
+      }
+      ImGui::Columns(1);
+    }
+
+    // Percentiles over the whole run, fixed memory however long it is
+    {
+      ImGui::Columns(2);
+      {
+        ImGui::Text("Frame Times");
+        ImGui::NextColumn();
+        ImGui::Text("P50 / P95 / P99 / Max");
+        ImGui::NextColumn();
+      }
+      for (uint32_t i = 0; i < kFrameMetricCount; i++) {
+        FrameMetricTag tag = static_cast<FrameMetricTag>(i);
+        DrawFrameMetricRow(GetFrameMetricName(tag), GetFrameMetric(tag));
+      }
+      for (uint32_t tag_index = 0; tag_index < TimerTag::kTimerTagCount;
+           tag_index++) {
+        if (m_gpu_timer_metrics[tag_index].GetRun().GetCount() > 0) {
+          DrawFrameMetricRow(m_gpu_timer_names[tag_index].c_str(),
+                             m_gpu_timer_metrics[tag_index]);
+        }
+      }
+      ImGui::Columns(1);
+    }
+
+    // Upscaled against native, a few frames behind the timings above
+    {
+      ImageQualityMetrics metrics = {};
+      m_image_metrics.GetMetrics(&metrics);
+
+      ImGui::Columns(2);
+      {
+        ImGui::Text("Image Quality");
+        ImGui::NextColumn();
+        ImGui::Checkbox("##ImageMetrics", &m_image_metrics_enabled);
         ImGui::NextColumn();
       }
+      if (m_image_metrics_enabled && metrics.valid) {
+        {
+          ImGui::Text("  PSNR");
+          ImGui::NextColumn();
+          ImGui::Text("%.2f dB", metrics.psnr);
+          ImGui::NextColumn();
+        }
+        {
+          ImGui::Text("  SSIM");
+          ImGui::NextColumn();
+          ImGui::Text("%.4f", metrics.ssim);
+          ImGui::NextColumn();
+        }
+        {
+          ImGui::Text("  FLIP-style Error");
+          ImGui::NextColumn();
+          ImGui::Text("%.4f", metrics.perceptual_error);
+          ImGui::NextColumn();
+        }
+      }
     }
 
     if (GetUpscalingTechnique() == UpscalingTechniqueKey::CAS) {
@@ -634,16 +1369,17 @@ void VkexInfoApp::DrawAppInfoGUI(uint32_t frame_index) {
           ImGui::NextColumn();
         }
         {
-          std::vector<const char*> cb_sample_mode_items = {
-              "Viewport Jitter", "Custom Sample Locs"};
+          const char* const cb_sample_mode_items[] = {"Viewport Jitter",
+                                                      "Custom Sample Locs"};
           VKEX_ASSERT(vkex::CountU32(cb_sample_mode_items) ==
                       static_cast<uint32_t>(
                           CheckerboardSampleMode::kCBSampleModeCount));
           ImGui::Text("Sample Generation");
           ImGui::NextColumn();
-          ImGui::Combo("##CBSampleGen", (int*)(&m_checkerboard_samples_mode),
-                       vkex::DataPtr(cb_sample_mode_items),
-                       static_cast<int32_t>(cb_sample_mode_items.size()));
+          ImGui::Combo(
+              "##CBSampleGen", (int*)(&m_checkerboard_samples_mode),
+              cb_sample_mode_items,
+              static_cast<int32_t>(vkex::CountU32(cb_sample_mode_items)));
           ImGui::NextColumn();
         }
 #if (CB_RESOLVE_DEBUG > 0)
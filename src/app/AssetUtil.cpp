@@ -97,46 +97,102 @@ vkex::Result CreateShaderProgram(vkex::Device device,
   return vkex::Result::Success;
 }
 
-vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
-                           vkex::Queue queue, MemoryUsage memory_usage,
-                           vkex::Texture* p_texture) {
-  VKEX_ASSERT_MSG(queue, "Invalid queue object");
-  if (!queue) {
-    return vkex::Result::ErrorInvalidQueueObject;
-  }
+// Asset loading happens on one thread, so none of this is locked
+static bool s_direct_upload_enabled = true;
+static UploadStatistics s_upload_statistics[UPLOAD_PATH_COUNT] = {};
 
-  VKEX_ASSERT_MSG(p_texture != nullptr, "Target texture object is null");
-  if (p_texture == nullptr) {
-    return vkex::Result::ErrorUnexpectedNullPointer;
+static const char* GetUploadPathName(UploadPath upload_path) {
+  switch (upload_path) {
+    default:
+      break;
+    case UPLOAD_PATH_STAGING:
+      return "Staging";
+    case UPLOAD_PATH_DIRECT:
+      return "Direct";
   }
+  return "Unknown";
+}
 
-  vkex::Device device = queue->GetDevice();
+static void RecordUpload(UploadPath upload_path, uint64_t resource_bytes,
+                         uint64_t staging_bytes, double load_time_ms) {
+  auto& statistics = s_upload_statistics[upload_path];
+  statistics.resource_count += 1;
+  statistics.resource_bytes += resource_bytes;
+  statistics.peak_staging_bytes =
+      std::max(statistics.peak_staging_bytes, staging_bytes);
+  // Staging buffers only live for one upload, so the footprint peaks while
+  // the current one is alive next to everything loaded so far.
+  statistics.peak_memory_bytes = std::max(
+      statistics.peak_memory_bytes, statistics.resource_bytes + staging_bytes);
+  statistics.load_time_ms += load_time_ms;
+}
 
-  // Load bitmap
-  std::unique_ptr<vkex::Bitmap> bitmap;
-  vkex::fs::path mip_path = image_file_path + ".mip";
-  if (vkex::fs::exists(mip_path)) {
-    MIPFile mip_file = {};
-    bool result = MIPLoadFile(mip_path, &mip_file);
-    VKEX_LOG_INFO("File loaded: " << mip_path);
+void SetDirectUploadEnabled(bool enabled) { s_direct_upload_enabled = enabled; }
 
-    bitmap = std::make_unique<vkex::Bitmap>(mip_file);
-  } else {
-    auto file_data = LoadFile(image_file_path);
-    VKEX_ASSERT_MSG(!file_data.empty(), "Texture failed to load!");
+bool IsDirectUploadEnabled(vkex::Device device) {
+  return s_direct_upload_enabled &&
+         device->GetPhysicalDevice()->SupportsDirectUpload();
+}
 
-    vkex::Result result =
-        vkex::Bitmap::Create(file_data.size(), file_data.data(), 0, &bitmap);
-    if (!result) {
-      return result;
-    }
+const UploadStatistics& GetUploadStatistics(UploadPath upload_path) {
+  VKEX_ASSERT(upload_path < UPLOAD_PATH_COUNT);
+  return s_upload_statistics[upload_path];
+}
+
+void LogUploadStatistics() {
+  VKEX_LOG_INFO("Asset upload statistics:");
+  for (uint32_t path_index = 0; path_index < UPLOAD_PATH_COUNT; ++path_index) {
+    const auto& statistics = s_upload_statistics[path_index];
+    VKEX_LOG_INFO("  " << GetUploadPathName(UploadPath(path_index)) << ": "
+                       << statistics.resource_count << " resources, "
+                       << (statistics.resource_bytes / 1024) << " KiB, "
+                       << statistics.load_time_ms << " ms, peak staging "
+                       << (statistics.peak_staging_bytes / 1024)
+                       << " KiB, peak memory "
+                       << (statistics.peak_memory_bytes / 1024) << " KiB");
   }
+}
+
+// Sampling a linear image is only as fast as optimal tiling where the GPU
+// reads system memory anyway, so textures are written in place on unified
+// memory devices alone; on resizable BAR only buffers are. Linear tiling
+// support is also much narrower than optimal tiling, and CTexture turns on
+// every usage besides storage, so check for exactly that.
+static bool SupportsDirectTexture(vkex::Device device,
+                                  const vkex::Bitmap& bitmap) {
+  if (vkex::FormatSize(bitmap.GetFormat()) == 0) {
+    return false;
+  }
+
+  auto physical_device = device->GetPhysicalDevice();
+  if (!physical_device->IsUnifiedMemory()) {
+    return false;
+  }
+  const VkFormatFeatureFlags linear_features =
+      physical_device->GetLinearTilingFeatures(bitmap.GetFormat());
+  if ((linear_features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+    return false;
+  }
+
+  VkImageUsageFlags usage =
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+      VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+  return physical_device->IsImageFormatSupported(
+      bitmap.GetFormat(), VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_LINEAR, usage,
+      bitmap.GetExtent(), bitmap.GetMipLevels());
+}
+
+static vkex::Result CreateTextureStaged(const vkex::Bitmap& bitmap,
+                                        vkex::Queue queue,
+                                        MemoryUsage memory_usage,
+                                        vkex::Texture* p_texture) {
+  vkex::Device device = queue->GetDevice();
 
   // Create staging buffer and copy bitmap
   vkex::Buffer cpu_buffer = nullptr;
+  uint64_t data_size = bitmap.GetDataSizeAllLevels();
   {
-    uint64_t data_size = bitmap->GetDataSizeAllLevels();
-
     vkex::BufferCreateInfo create_info = {};
     create_info.size = data_size;
     create_info.usage_flags.bits.transfer_src = true;
@@ -149,7 +205,7 @@ vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
     }
 
     // Copy bitmap to data
-    result = cpu_buffer->Copy(data_size, bitmap->GetData());
+    result = cpu_buffer->Copy(data_size, bitmap.GetData());
     if (!result) {
       return result;
     }
@@ -159,10 +215,11 @@ vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
   {
     vkex::TextureCreateInfo create_info = {};
     create_info.image.image_type = VK_IMAGE_TYPE_2D;
-    create_info.image.format = bitmap->GetFormat();
-    create_info.image.extent = bitmap->GetExtent();
-    create_info.image.mip_levels = bitmap->GetMipLevels();
+    create_info.image.format = bitmap.GetFormat();
+    create_info.image.extent = bitmap.GetExtent();
+    create_info.image.mip_levels = bitmap.GetMipLevels();
     create_info.image.tiling = VK_IMAGE_TILING_OPTIMAL;
+    create_info.image.usage_flags.bits.sampled = true;
     create_info.image.usage_flags.bits.transfer_dst = true;
     create_info.image.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
     create_info.image.committed = true;
@@ -175,21 +232,17 @@ vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
     }
   }
 
-  // Transition from VK_IMAGE_LAYOUT_PREINITIALIZED to
-  // VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL for
-  // VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT.
   vkex::Result result = vkex::TransitionImageLayout(
       queue, (*p_texture)->GetImage(), VK_IMAGE_LAYOUT_UNDEFINED,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT);
   if (!result) {
     return result;
   }
 
   std::vector<VkBufferImageCopy> regions;
-  for (uint32_t level = 0; level < bitmap->GetMipLevels(); ++level) {
+  for (uint32_t level = 0; level < bitmap.GetMipLevels(); ++level) {
     vkex::Bitmap::Mip mip = {};
-    bitmap->GetMipLayout(level, &mip);
+    bitmap.GetMipLayout(level, &mip);
     VkBufferImageCopy region = {};
     region.bufferOffset = mip.data_offset;
     region.bufferRowLength = mip.width;
@@ -210,9 +263,6 @@ vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
   vkex::CopyResource(queue, cpu_buffer, (*p_texture)->GetImage(),
                      vkex::CountU32(regions), vkex::DataPtr(regions));
 
-  // Transition from VK_IMAGE_LAYOUT_PREINITIALIZED to
-  // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for
-  // VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT.
   result = vkex::TransitionImageLayout(queue, (*p_texture)->GetImage(),
                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
@@ -230,8 +280,87 @@ vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
   return vkex::Result::Success;
 }
 
-vkex::Result CreateTexture(size_t src_data_size, const uint8_t* p_src_data,
-                           int width, int height, VkFormat format,
+// Writes each mip straight into a linear, host visible, device local image.
+// The only queue work left is the layout transition.
+static vkex::Result CreateTextureDirect(const vkex::Bitmap& bitmap,
+                                        vkex::Queue queue,
+                                        vkex::Texture* p_texture) {
+  vkex::Device device = queue->GetDevice();
+
+  {
+    vkex::TextureCreateInfo create_info = {};
+    create_info.image.image_type = VK_IMAGE_TYPE_2D;
+    create_info.image.format = bitmap.GetFormat();
+    create_info.image.extent = bitmap.GetExtent();
+    create_info.image.mip_levels = bitmap.GetMipLevels();
+    create_info.image.tiling = VK_IMAGE_TILING_LINEAR;
+    create_info.image.usage_flags.bits.sampled = true;
+    create_info.image.initial_layout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+    create_info.image.committed = true;
+    create_info.view.derive_from_image = true;
+    DetermineMemoryFlags(MEMORY_USAGE_CPU_TO_GPU,
+                         create_info.image.device_local,
+                         create_info.image.host_visible);
+    vkex::Result result = device->CreateTexture(create_info, p_texture);
+    if (!result) {
+      return result;
+    }
+  }
+
+  for (uint32_t level = 0; level < bitmap.GetMipLevels(); ++level) {
+    vkex::Bitmap::Mip mip = {};
+    bitmap.GetMipLayout(level, &mip);
+    vkex::Result result = (*p_texture)->CopyToMipLevel(
+        level, 0, mip.row_stride, mip.height, bitmap.GetData(level));
+    if (!result) {
+      return result;
+    }
+  }
+
+  vkex::Result result = vkex::TransitionImageLayout(
+      queue, (*p_texture)->GetImage(), VK_IMAGE_LAYOUT_PREINITIALIZED,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  if (!result) {
+    return result;
+  }
+
+  return vkex::Result::Success;
+}
+
+static vkex::Result CreateTextureFromBitmap(const vkex::Bitmap& bitmap,
+                                            vkex::Queue queue,
+                                            MemoryUsage memory_usage,
+                                            vkex::Texture* p_texture) {
+  vkex::Device device = queue->GetDevice();
+
+  const bool direct_upload = (memory_usage == MEMORY_USAGE_GPU_ONLY) &&
+                             IsDirectUploadEnabled(device) &&
+                             SupportsDirectTexture(device, bitmap);
+
+  vkex::Timer timer;
+  timer.Start();
+  vkex::Result result =
+      direct_upload
+          ? CreateTextureDirect(bitmap, queue, p_texture)
+          : CreateTextureStaged(bitmap, queue, memory_usage, p_texture);
+  if (!result) {
+    return result;
+  }
+  timer.Stop();
+
+  if (direct_upload) {
+    RecordUpload(UPLOAD_PATH_DIRECT, (*p_texture)->GetMemorySize(), 0,
+                 timer.Millis());
+  } else {
+    RecordUpload(UPLOAD_PATH_STAGING, (*p_texture)->GetMemorySize(),
+                 bitmap.GetDataSizeAllLevels(), timer.Millis());
+  }
+
+  return vkex::Result::Success;
+}
+
+vkex::Result CreateTexture(const vkex::fs::path& image_file_path,
                            vkex::Queue queue, MemoryUsage memory_usage,
                            vkex::Texture* p_texture) {
   VKEX_ASSERT_MSG(queue, "Invalid queue object");
@@ -244,110 +373,75 @@ vkex::Result CreateTexture(size_t src_data_size, const uint8_t* p_src_data,
     return vkex::Result::ErrorUnexpectedNullPointer;
   }
 
-  vkex::Device device = queue->GetDevice();
-
   // Load bitmap
   std::unique_ptr<vkex::Bitmap> bitmap;
-  {
-    vkex::Result result = vkex::Bitmap::Create(src_data_size, p_src_data, width,
-                                               height, format, 0, &bitmap);
+  vkex::fs::path mip_path = image_file_path + ".mip";
+  if (vkex::fs::exists(mip_path)) {
+    MIPFile mip_file = {};
+    bool result = MIPLoadFile(mip_path, &mip_file);
+    VKEX_LOG_INFO("File loaded: " << mip_path);
+
+    bitmap = std::make_unique<vkex::Bitmap>(mip_file);
+  } else {
+    auto file_data = LoadFile(image_file_path);
+    VKEX_ASSERT_MSG(!file_data.empty(), "Texture failed to load!");
+
+    vkex::Result result =
+        vkex::Bitmap::Create(file_data.size(), file_data.data(), 0, &bitmap);
     if (!result) {
       return result;
     }
   }
 
-  // Create staging buffer and copy bitmap
-  vkex::Buffer cpu_buffer = nullptr;
-  {
-    uint64_t data_size = bitmap->GetDataSizeAllLevels();
+  return CreateTextureFromBitmap(*bitmap, queue, memory_usage, p_texture);
+}
 
-    vkex::BufferCreateInfo create_info = {};
-    create_info.size = data_size;
-    create_info.usage_flags.bits.transfer_src = true;
-    create_info.committed = true;
-    DetermineMemoryFlags(MEMORY_USAGE_CPU_ONLY, create_info.device_local,
-                         create_info.host_visible);
-    vkex::Result result = device->CreateStorageBuffer(create_info, &cpu_buffer);
-    if (!result) {
-      return result;
-    }
+vkex::Result CreateTexture(size_t src_data_size, const uint8_t* p_src_data,
+                           int width, int height, VkFormat format,
+                           vkex::Queue queue, MemoryUsage memory_usage,
+                           vkex::Texture* p_texture) {
+  VKEX_ASSERT_MSG(queue, "Invalid queue object");
+  if (!queue) {
+    return vkex::Result::ErrorInvalidQueueObject;
+  }
 
-    // Copy bitmap to data
-    result = cpu_buffer->Copy(data_size, bitmap->GetData());
-    if (!result) {
-      return result;
-    }
+  VKEX_ASSERT_MSG(p_texture != nullptr, "Target texture object is null");
+  if (p_texture == nullptr) {
+    return vkex::Result::ErrorUnexpectedNullPointer;
   }
 
-  // Create image
+  // Load bitmap
+  std::unique_ptr<vkex::Bitmap> bitmap;
   {
-    vkex::TextureCreateInfo create_info = {};
-    create_info.image.image_type = VK_IMAGE_TYPE_2D;
-    create_info.image.format = bitmap->GetFormat();
-    create_info.image.extent = bitmap->GetExtent();
-    create_info.image.mip_levels = bitmap->GetMipLevels();
-    create_info.image.tiling = VK_IMAGE_TILING_OPTIMAL;
-    create_info.image.usage_flags.bits.sampled = true;
-    create_info.image.usage_flags.bits.transfer_dst = true;
-    create_info.image.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
-    create_info.image.committed = true;
-    create_info.view.derive_from_image = true;
-    DetermineMemoryFlags(memory_usage, create_info.image.device_local,
-                         create_info.image.host_visible);
-    vkex::Result result = device->CreateTexture(create_info, p_texture);
+    vkex::Result result = vkex::Bitmap::Create(src_data_size, p_src_data, width,
+                                               height, format, 0, &bitmap);
     if (!result) {
       return result;
     }
   }
 
-  vkex::Result result = vkex::TransitionImageLayout(
-      queue, (*p_texture)->GetImage(), VK_IMAGE_LAYOUT_UNDEFINED,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT);
-  if (!result) {
-    return result;
-  }
-
-  std::vector<VkBufferImageCopy> regions;
-  for (uint32_t level = 0; level < bitmap->GetMipLevels(); ++level) {
-    vkex::Bitmap::Mip mip = {};
-    bitmap->GetMipLayout(level, &mip);
-    VkBufferImageCopy region = {};
-    region.bufferOffset = mip.data_offset;
-    region.bufferRowLength = mip.width;
-    region.bufferImageHeight = mip.height;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = level;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset.x = 0;
-    region.imageOffset.y = 0;
-    region.imageOffset.z = 0;
-    region.imageExtent.width = mip.width;
-    region.imageExtent.height = mip.height;
-    region.imageExtent.depth = 1;
-    regions.push_back(region);
-  }
-
-  vkex::CopyResource(queue, cpu_buffer, (*p_texture)->GetImage(),
-                     vkex::CountU32(regions), vkex::DataPtr(regions));
+  return CreateTextureFromBitmap(*bitmap, queue, memory_usage, p_texture);
+}
 
-  result = vkex::TransitionImageLayout(queue, (*p_texture)->GetImage(),
-                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-  if (!result) {
-    return result;
+static vkex::Result WriteBuffer(vkex::Buffer buffer, size_t size,
+                                const BufferWriter& writer) {
+  VKEX_ASSERT(buffer->IsHostVisible());
+  if (buffer->GetMemorySize() < size) {
+    return vkex::Result::ErrorResouceSizeIsInsufficient;
   }
 
-  result = device->DestroyStorageBuffer(cpu_buffer);
-  if (!result) {
-    return result;
+  void* p_mapped = nullptr;
+  VkResult vk_result = buffer->MapMemory(&p_mapped);
+  if (vk_result != VK_SUCCESS) {
+    return vkex::Result(vk_result);
   }
+  writer(p_mapped);
+  buffer->UnmapMemory();
 
   return vkex::Result::Success;
 }
 
-static vkex::Result CreateBuffer(size_t size, const void* p_data,
+static vkex::Result CreateBuffer(size_t size, const BufferWriter& writer,
                                  vkex::Queue queue,
                                  const vkex::BufferUsageFlags& usage_flags,
                                  MemoryUsage memory_usage,
@@ -365,6 +459,19 @@ static vkex::Result CreateBuffer(size_t size, const void* p_data,
   // Grab device
   vkex::Device device = queue->GetDevice();
 
+  // GPU_ONLY data goes straight into host visible device local memory when
+  // all of it is host visible, skipping the staging copy.
+  const bool has_data = static_cast<bool>(writer);
+  const bool direct_upload = (memory_usage == MEMORY_USAGE_GPU_ONLY) &&
+                             has_data &&
+                             IsDirectUploadEnabled(device);
+  if (direct_upload) {
+    memory_usage = MEMORY_USAGE_CPU_TO_GPU;
+  }
+
+  vkex::Timer timer;
+  timer.Start();
+
   // Create requested buffer
   {
     vkex::BufferCreateInfo create_info = {};
@@ -381,16 +488,16 @@ static vkex::Result CreateBuffer(size_t size, const void* p_data,
 
   if ((memory_usage == MEMORY_USAGE_CPU_ONLY) ||
       (memory_usage == MEMORY_USAGE_CPU_TO_GPU)) {
-    // Copy data to buffer
-    if (p_data != nullptr) {
-      vkex::Result result = (*p_buffer)->Copy(size, p_data);
+    // Write data to buffer
+    if (has_data) {
+      vkex::Result result = WriteBuffer(*p_buffer, size, writer);
       if (!result) {
         return result;
       }
     }
   } else {
-    // Create staging buffer and copy data
-    if (p_data != nullptr) {
+    // Create staging buffer and write data
+    if (has_data) {
       vkex::Buffer cpu_buffer = nullptr;
       {
         // Create buffer
@@ -405,8 +512,8 @@ static vkex::Result CreateBuffer(size_t size, const void* p_data,
           return result;
         }
 
-        // Copy data
-        result = cpu_buffer->Copy(size, p_data);
+        // Write data
+        result = WriteBuffer(cpu_buffer, size, writer);
         if (!result) {
           return result;
         }
@@ -421,12 +528,41 @@ static vkex::Result CreateBuffer(size_t size, const void* p_data,
       if (!result) {
         return result;
       }
+
+      result = device->DestroyBuffer(cpu_buffer);
+      if (!result) {
+        return result;
+      }
+
+      timer.Stop();
+      RecordUpload(UPLOAD_PATH_STAGING, (*p_buffer)->GetMemorySize(), size,
+                   timer.Millis());
     }
   }
+
+  if (direct_upload) {
+    timer.Stop();
+    RecordUpload(UPLOAD_PATH_DIRECT, (*p_buffer)->GetMemorySize(), 0,
+                 timer.Millis());
+  }
+
   // Success
   return vkex::Result::Success;
 }
 
+static vkex::Result CreateBuffer(size_t size, const void* p_data,
+                                 vkex::Queue queue,
+                                 const vkex::BufferUsageFlags& usage_flags,
+                                 MemoryUsage memory_usage,
+                                 vkex::Buffer* p_buffer) {
+  BufferWriter writer;
+  if (p_data != nullptr) {
+    writer = [size, p_data](void* p_dst) { std::memcpy(p_dst, p_data, size); };
+  }
+  return CreateBuffer(size, writer, queue, usage_flags, memory_usage,
+                      p_buffer);
+}
+
 vkex::Result CreateConstantBuffer(size_t size, const void* p_data,
                                   vkex::Queue queue, MemoryUsage memory_usage,
                                   vkex::Buffer* p_buffer) {
@@ -488,6 +624,22 @@ vkex::Result CreateGeometryBuffer(size_t size, const void* p_data,
   return vkex::Result::Success;
 }
 
+vkex::Result CreateGeometryBuffer(size_t size, const BufferWriter& writer,
+                                  vkex::Queue queue, MemoryUsage memory_usage,
+                                  vkex::Buffer* p_buffer) {
+  vkex::BufferUsageFlags usage_flags = {};
+  usage_flags.bits.transfer_dst = true;
+  usage_flags.bits.vertex_buffer = true;
+  usage_flags.bits.index_buffer = true;
+
+  vkex::Result result =
+      CreateBuffer(size, writer, queue, usage_flags, memory_usage, p_buffer);
+  if (!result) {
+    return result;
+  }
+  return vkex::Result::Success;
+}
+
 vkex::Result CreateStorageBuffer(size_t size, const void* p_data,
                                  vkex::Queue queue, MemoryUsage memory_usage,
                                  vkex::Buffer* p_buffer) {
@@ -504,4 +656,21 @@ vkex::Result CreateStorageBuffer(size_t size, const void* p_data,
   return vkex::Result::Success;
 }
 
+vkex::Result CreateIndirectBuffer(size_t size, const void* p_data,
+                                  vkex::Queue queue, MemoryUsage memory_usage,
+                                  vkex::Buffer* p_buffer) {
+  vkex::BufferUsageFlags usage_flags = {};
+  usage_flags.bits.transfer_src = true;
+  usage_flags.bits.transfer_dst = true;
+  usage_flags.bits.storage_buffer = true;
+  usage_flags.bits.indirect_buffer = true;
+
+  vkex::Result result =
+      CreateBuffer(size, p_data, queue, usage_flags, memory_usage, p_buffer);
+  if (!result) {
+    return result;
+  }
+  return vkex::Result::Success;
+}
+
 }  // namespace asset_util
@@ -19,6 +19,8 @@
 
 #include "vkex/Application.h"
 
+#include <functional>
+
 namespace asset_util {
 
 enum MemoryUsage {
@@ -34,10 +36,48 @@ enum MemoryUsage {
   MEMORY_USAGE_CPU_TO_GPU,
 };
 
+// How initial data reaches a MEMORY_USAGE_GPU_ONLY resource
+enum UploadPath {
+  // Copied from a CPU_ONLY staging buffer on the queue
+  UPLOAD_PATH_STAGING = 0,
+
+  // Written in place, the device local memory is host visible
+  UPLOAD_PATH_DIRECT,
+
+  UPLOAD_PATH_COUNT,
+};
+
+struct UploadStatistics {
+  uint32_t resource_count;
+  // Memory held by the uploaded resources
+  uint64_t resource_bytes;
+  // Largest amount of staging memory alive at once
+  uint64_t peak_staging_bytes;
+  // Largest resource + staging footprint reached while loading
+  uint64_t peak_memory_bytes;
+  double load_time_ms;
+};
+
+// Produces a buffer's initial contents in place. 'p_dst' is mapped memory of
+// either the buffer itself or its staging buffer, so data can be written
+// straight into upload memory without an intermediate copy.
+using BufferWriter = std::function<void(void* p_dst)>;
+
 std::vector<uint8_t> LoadFile(const vkex::fs::path& file_path);
 void DetermineMemoryFlags(MemoryUsage memory_usage, bool& device_local,
                           bool& host_visible);
 
+// Direct upload is used for GPU_ONLY resources when the device supports it
+// (see CPhysicalDevice::SupportsDirectUpload) and it has not been disabled
+// here. Disabling it forces the staging path, e.g. to compare the two.
+// Textures additionally need a unified memory device and linear sampling
+// support for their format, otherwise they stay optimally tiled and staged.
+void SetDirectUploadEnabled(bool enabled);
+bool IsDirectUploadEnabled(vkex::Device device);
+
+const UploadStatistics& GetUploadStatistics(UploadPath upload_path);
+void LogUploadStatistics();
+
 vkex::Result CreateShaderProgramCompute(vkex::Device device,
                                         const vkex::fs::path& cs_path,
                                         vkex::ShaderProgram* p_shader_program);
@@ -72,10 +112,19 @@ vkex::Result CreateGeometryBuffer(size_t size, const void* p_data,
                                   vkex::Queue queue, MemoryUsage memory_usage,
                                   vkex::Buffer* p_buffer);
 
+vkex::Result CreateGeometryBuffer(size_t size, const BufferWriter& writer,
+                                  vkex::Queue queue, MemoryUsage memory_usage,
+                                  vkex::Buffer* p_buffer);
+
 vkex::Result CreateStorageBuffer(size_t size, const void* p_data,
                                  vkex::Queue queue, MemoryUsage memory_usage,
                                  vkex::Buffer* p_buffer);
 
+// Storage buffer that can also source indirect draw arguments and counts
+vkex::Result CreateIndirectBuffer(size_t size, const void* p_data,
+                                  vkex::Queue queue, MemoryUsage memory_usage,
+                                  vkex::Buffer* p_buffer);
+
 }  // namespace asset_util
 
 #endif  // __COMMON_ASSET_UTIL_H__
\ No newline at end of file
@@ -0,0 +1,420 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "AppCore.h"
+
+#include <cmath>
+#include <thread>
+
+// Destroy order used by the benchmarks. A large odd stride touches the
+// storage in a scattered order instead of the LIFO order the free list
+// would trivially favor. The stride is prime, so it visits every index as
+// long as the count is not a multiple of it.
+static uint32_t ScatteredIndex(uint32_t i, uint32_t count) {
+  const uint64_t kStride = 7919;
+  if ((count % kStride) == 0) {
+    return i;
+  }
+  return static_cast<uint32_t>((uint64_t(i) * kStride) % count);
+}
+
+static void LogBenchmarkResult(const char* label, uint32_t count,
+                               double create_ms, double destroy_ms) {
+  double create_ns_per_object = (create_ms * 1000000.0) / count;
+  double destroy_ns_per_object = (destroy_ms * 1000000.0) / count;
+  VKEX_LOG_INFO("  " << label << ": create " << create_ms << " ms ("
+                     << create_ns_per_object << " ns/object), destroy "
+                     << destroy_ms << " ms (" << destroy_ns_per_object
+                     << " ns/object)");
+}
+
+void VkexInfoApp::RunObjectStorageBenchmark(uint32_t object_count) {
+  auto device = GetDevice();
+
+  VKEX_LOG_INFO("Object storage benchmark (" << object_count << " objects)");
+
+  // Uncommitted buffers keep VMA out of the measurement, so this is the cost
+  // of vkCreateBuffer plus the device's object bookkeeping.
+  vkex::BufferCreateInfo buffer_create_info = {};
+  buffer_create_info.size = 256;
+  buffer_create_info.usage_flags.bits.uniform_buffer = true;
+  buffer_create_info.sharing_mode = VK_SHARING_MODE_EXCLUSIVE;
+  buffer_create_info.committed = false;
+
+  // Buffers
+  {
+    std::vector<vkex::Buffer> buffers(object_count, nullptr);
+
+    vkex::Timer create_timer;
+    create_timer.Start();
+    for (uint32_t i = 0; i < object_count; ++i) {
+      VKEX_CALL(device->CreateBuffer(buffer_create_info, &buffers[i]));
+    }
+    create_timer.Stop();
+
+    vkex::Timer destroy_timer;
+    destroy_timer.Start();
+    for (uint32_t i = 0; i < object_count; ++i) {
+      VKEX_CALL(device->DestroyBuffer(buffers[ScatteredIndex(i, object_count)]));
+    }
+    destroy_timer.Stop();
+
+    LogBenchmarkResult("Buffers", object_count, create_timer.Millis(),
+                       destroy_timer.Millis());
+  }
+
+  // Image views
+  {
+    vkex::ImageCreateInfo image_create_info = {};
+    image_create_info.image_type = VK_IMAGE_TYPE_2D;
+    image_create_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_create_info.extent = {16, 16, 1};
+    image_create_info.mip_levels = 1;
+    image_create_info.array_layers = 1;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.usage_flags.bits.sampled = true;
+    image_create_info.sharing_mode = VK_SHARING_MODE_EXCLUSIVE;
+    image_create_info.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_create_info.committed = true;
+    image_create_info.device_local = true;
+
+    vkex::Image image = nullptr;
+    VKEX_CALL(device->CreateImage(image_create_info, &image));
+
+    vkex::ImageViewCreateInfo view_create_info = {};
+    view_create_info.image = image;
+    view_create_info.view_type = VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format = image_create_info.format;
+    view_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    view_create_info.components = vkex::ComponentMappingRGBA();
+    view_create_info.subresource_range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,
+                                          1};
+
+    std::vector<vkex::ImageView> views(object_count, nullptr);
+
+    vkex::Timer create_timer;
+    create_timer.Start();
+    for (uint32_t i = 0; i < object_count; ++i) {
+      VKEX_CALL(device->CreateImageView(view_create_info, &views[i]));
+    }
+    create_timer.Stop();
+
+    vkex::Timer destroy_timer;
+    destroy_timer.Start();
+    for (uint32_t i = 0; i < object_count; ++i) {
+      VKEX_CALL(device->DestroyImageView(views[ScatteredIndex(i, object_count)]));
+    }
+    destroy_timer.Stop();
+
+    LogBenchmarkResult("Image views", object_count, create_timer.Millis(),
+                       destroy_timer.Millis());
+
+    VKEX_CALL(device->DestroyImage(image));
+  }
+
+  // Buffers from worker threads
+  {
+    const uint32_t thread_count =
+        std::max<uint32_t>(2, std::thread::hardware_concurrency());
+    const uint32_t per_thread_count = object_count / thread_count;
+
+    std::vector<double> create_ms(thread_count, 0.0);
+    std::vector<double> destroy_ms(thread_count, 0.0);
+
+    std::vector<std::thread> threads;
+    for (uint32_t thread_index = 0; thread_index < thread_count;
+         ++thread_index) {
+      threads.emplace_back([&, thread_index]() {
+        std::vector<vkex::Buffer> buffers(per_thread_count, nullptr);
+
+        vkex::Timer create_timer;
+        create_timer.Start();
+        for (uint32_t i = 0; i < per_thread_count; ++i) {
+          VKEX_CALL(device->CreateBuffer(buffer_create_info, &buffers[i]));
+        }
+        create_timer.Stop();
+
+        vkex::Timer destroy_timer;
+        destroy_timer.Start();
+        for (uint32_t i = 0; i < per_thread_count; ++i) {
+          VKEX_CALL(device->DestroyBuffer(
+              buffers[ScatteredIndex(i, per_thread_count)]));
+        }
+        destroy_timer.Stop();
+
+        create_ms[thread_index] = create_timer.Millis();
+        destroy_ms[thread_index] = destroy_timer.Millis();
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // Wall time is bounded by the slowest thread
+    double max_create_ms = *std::max_element(create_ms.begin(), create_ms.end());
+    double max_destroy_ms =
+        *std::max_element(destroy_ms.begin(), destroy_ms.end());
+
+    std::string label =
+        "Buffers (" + std::to_string(thread_count) + " threads)";
+    LogBenchmarkResult(label.c_str(), per_thread_count * thread_count,
+                       max_create_ms, max_destroy_ms);
+  }
+}
+
+static void LogGeometryResult(const char* label, uint32_t triangle_count,
+                              double build_ms) {
+  double ns_per_triangle = (build_ms * 1000000.0) / triangle_count;
+  double million_per_second = (triangle_count / 1000.0) / build_ms;
+  VKEX_LOG_INFO("  " << label << ": " << build_ms << " ms ("
+                     << ns_per_triangle << " ns/triangle, "
+                     << million_per_second << " M triangles/s)");
+}
+
+// Appends a UV sphere through TriangleList, one AppendData per attribute and
+// index. Trig comes from the same per row and per column tables the builder
+// uses, so the difference is in how vertices are written.
+static void BuildTriangleListSphere(uint32_t slices, uint32_t stacks,
+                                    bool reserve,
+                                    vkex::TriangleList* p_triangle_list) {
+  const float kPi = 3.14159265358979323846f;
+  std::vector<float> cos_theta(slices + 1);
+  std::vector<float> sin_theta(slices + 1);
+  for (uint32_t column = 0; column <= slices; ++column) {
+    float theta = 2.0f * kPi * column / static_cast<float>(slices);
+    cos_theta[column] = cosf(theta);
+    sin_theta[column] = sinf(theta);
+  }
+
+  if (reserve) {
+    p_triangle_list->Reserve((slices + 1) * (stacks + 1), 2 * slices * stacks);
+  }
+
+  for (uint32_t row = 0; row <= stacks; ++row) {
+    float v = row / static_cast<float>(stacks);
+    float sin_phi = sinf(kPi * v);
+    float cos_phi = cosf(kPi * v);
+    for (uint32_t column = 0; column <= slices; ++column) {
+      vkex::TriangleList::Vertex vertex = {};
+      vertex.normal = vkex::float3(sin_phi * cos_theta[column], cos_phi,
+                                   sin_phi * sin_theta[column]);
+      vertex.position = vertex.normal;
+      vertex.tex_coord =
+          vkex::float2(column / static_cast<float>(slices), v);
+      p_triangle_list->AppendVertex(vertex);
+    }
+  }
+  for (uint32_t row = 0; row < stacks; ++row) {
+    for (uint32_t column = 0; column < slices; ++column) {
+      uint32_t a = row * (slices + 1) + column;
+      uint32_t b = a + slices + 1;
+      p_triangle_list->AppendTriangle(a, b + 1, b);
+      p_triangle_list->AppendTriangle(a, a + 1, b + 1);
+    }
+  }
+}
+
+void VkexInfoApp::RunGeometryBuilderBenchmark(uint32_t triangle_count) {
+  // 2 * slices * stacks triangles, with twice as many slices as stacks
+  const uint32_t stacks = std::max<uint32_t>(
+      2, static_cast<uint32_t>(sqrtf(triangle_count / 4.0f)));
+  const uint32_t slices = 2 * stacks;
+  const uint32_t sphere_triangle_count = 2 * slices * stacks;
+  const uint32_t thread_count =
+      std::max<uint32_t>(1, std::thread::hardware_concurrency());
+
+  VKEX_LOG_INFO("Geometry builder benchmark ("
+                << sphere_triangle_count << " triangles, "
+                << vkex::GeometryBuilder::GetKernelName() << " kernel)");
+
+  // Current path
+  for (bool reserve : {false, true}) {
+    vkex::TriangleList::Options options;
+    options.indices = true;
+    options.tex_coords = true;
+    options.normals = true;
+    vkex::TriangleList triangle_list(options);
+
+    vkex::Timer timer;
+    timer.Start();
+    BuildTriangleListSphere(slices, stacks, reserve, &triangle_list);
+    timer.Stop();
+
+    LogGeometryResult(reserve ? "TriangleList (reserved)" : "TriangleList",
+                      sphere_triangle_count, timer.Millis());
+  }
+
+  // Builder, one thread then every thread
+  struct BuilderCase {
+    const char* label;
+    vkex::GeometryBuilder::Layout layout;
+    uint32_t thread_count;
+  };
+  const std::string threaded_label =
+      "GeometryBuilder interleaved (" + std::to_string(thread_count) +
+      " threads)";
+  const BuilderCase cases[] = {
+      {"GeometryBuilder interleaved",
+       vkex::GeometryBuilder::LAYOUT_INTERLEAVED, 1},
+      {"GeometryBuilder planar", vkex::GeometryBuilder::LAYOUT_PLANAR, 1},
+      {threaded_label.c_str(), vkex::GeometryBuilder::LAYOUT_INTERLEAVED,
+       thread_count},
+  };
+  for (const auto& builder_case : cases) {
+    vkex::GeometryBuilder::Options options;
+    options.layout = builder_case.layout;
+    options.tex_coords = true;
+    options.normals = true;
+    options.thread_count = builder_case.thread_count;
+
+    vkex::GeometryBuilder builder(options);
+
+    vkex::Timer timer;
+    timer.Start();
+    builder.Sphere(1.0f, slices, stacks);
+    timer.Stop();
+
+    LogGeometryResult(builder_case.label, sphere_triangle_count,
+                      timer.Millis());
+  }
+}
+
+// Every node spins about Y at its own rate, each frame
+static float GetNodeAngle(uint32_t node, uint32_t frame) {
+  return 0.01f * float(frame) * float(1 + (node % 7));
+}
+
+void VkexInfoApp::RunTransformBenchmark(uint32_t node_count) {
+  // Short chains under many roots, like a crowd of animated skeletons
+  const uint32_t kChainLength = 8;
+  const uint32_t kFrameCount = 16;
+  node_count = std::max(node_count, kChainLength);
+  auto get_parent = [](uint32_t node) -> int32_t {
+    return ((node % kChainLength) == 0) ? -1 : int32_t(node - 1);
+  };
+  const vkex::float3 offset = vkex::float3(0.0f, 1.0f, 0.0f);
+
+  VKEX_LOG_INFO("Transform benchmark ("
+                << node_count << " nodes, " << kFrameCount << " frames, "
+                << TransformHierarchy::GetKernelName() << " kernel)");
+
+  // Current path, a lazily evaluated vkex::Transform per node
+  {
+    std::vector<vkex::Transform> transforms(node_count);
+    std::vector<vkex::float4x4> world_matrices(node_count);
+    for (uint32_t node = 0; node < node_count; ++node) {
+      transforms[node].SetTranslation(offset);
+    }
+
+    vkex::Timer timer;
+    timer.Start();
+    for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+      for (uint32_t node = 0; node < node_count; ++node) {
+        transforms[node].SetRotation(0.0f, GetNodeAngle(node, frame), 0.0f);
+        const int32_t parent = get_parent(node);
+        const vkex::float4x4& local_matrix =
+            transforms[node].GetConcatenatedMatrix();
+        world_matrices[node] = (parent >= 0)
+                                   ? world_matrices[parent] * local_matrix
+                                   : local_matrix;
+      }
+    }
+    timer.Stop();
+
+    VKEX_LOG_INFO("  vkex::Transform: " << (timer.Millis() / kFrameCount)
+                                        << " ms/frame");
+  }
+
+  const uint32_t thread_count =
+      std::max<uint32_t>(1, std::thread::hardware_concurrency());
+  for (uint32_t threads : {1u, thread_count}) {
+    TransformHierarchy hierarchy;
+    hierarchy.Reserve(node_count);
+    hierarchy.SetThreadCount(threads);
+    for (uint32_t node = 0; node < node_count; ++node) {
+      hierarchy.AddNode(get_parent(node));
+      hierarchy.SetTranslation(node, offset);
+    }
+
+    vkex::Timer timer;
+    timer.Start();
+    for (uint32_t frame = 0; frame < kFrameCount; ++frame) {
+      for (uint32_t node = 0; node < node_count; ++node) {
+        hierarchy.SetRotation(
+            node, glm::angleAxis(GetNodeAngle(node, frame),
+                                 vkex::float3(0.0f, 1.0f, 0.0f)));
+      }
+      hierarchy.Update();
+    }
+    timer.Stop();
+
+    TransformStatistics statistics = {};
+    hierarchy.GetStatistics(&statistics);
+    VKEX_LOG_INFO("  TransformHierarchy ("
+                  << statistics.thread_count << " threads): "
+                  << (timer.Millis() / kFrameCount) << " ms/frame, "
+                  << statistics.update_time_ms << " ms in Update()");
+  }
+}
+
+void VkexInfoApp::RunImageComparison(const std::string& test_path,
+                                     const std::string& reference_path) {
+  VKEX_LOG_INFO("Image comparison: " << test_path << " against "
+                                     << reference_path);
+
+  std::unique_ptr<vkex::Bitmap> test_bitmap;
+  std::unique_ptr<vkex::Bitmap> reference_bitmap;
+  if (!vkex::Bitmap::Create(test_path, 1, &test_bitmap)) {
+    VKEX_LOG_WARN("  Unable to load " << test_path);
+    return;
+  }
+  if (!vkex::Bitmap::Create(reference_path, 1, &reference_bitmap)) {
+    VKEX_LOG_WARN("  Unable to load " << reference_path);
+    return;
+  }
+
+  const uint32_t width = test_bitmap->GetWidth();
+  const uint32_t height = test_bitmap->GetHeight();
+  if ((reference_bitmap->GetWidth() != width) ||
+      (reference_bitmap->GetHeight() != height)) {
+    VKEX_LOG_WARN("  Image sizes differ: "
+                  << width << "x" << height << " against "
+                  << reference_bitmap->GetWidth() << "x"
+                  << reference_bitmap->GetHeight());
+    return;
+  }
+
+  // Both load as RGBA8, so they share a row stride
+  ImageQualityMetrics metrics = {};
+  const uint32_t thread_count =
+      std::max<uint32_t>(1, std::thread::hardware_concurrency());
+  for (uint32_t threads : {1u, thread_count}) {
+    vkex::Timer timer;
+    timer.Start();
+    ImageMetrics::Compare(test_bitmap->GetData(), reference_bitmap->GetData(),
+                          width, height, test_bitmap->GetRowStride(), threads,
+                          &metrics);
+    timer.Stop();
+
+    VKEX_LOG_INFO("  " << ImageMetrics::GetKernelName() << " (" << threads
+                       << " threads): " << timer.Millis() << " ms");
+  }
+
+  VKEX_LOG_INFO("  " << width << "x" << height << ": PSNR " << metrics.psnr
+                     << " dB, SSIM " << metrics.ssim
+                     << ", FLIP-style error " << metrics.perceptual_error);
+}
@@ -55,14 +55,14 @@ void VkexInfoApp::CASUpscale(vkex::CommandBuffer cmd, uint32_t frame_index) {
           m_cas_upscaling_constants);
   cmd->CmdBindPipeline(
       m_generated_shader_states[AppShaderList::UpscalingCAS].compute_pipeline);
-  std::vector<uint32_t> dynamic_offsets = {cas_dynamic_offset};
+  const uint32_t dynamic_offsets[] = {cas_dynamic_offset};
   cmd->CmdBindDescriptorSets(
       VK_PIPELINE_BIND_POINT_COMPUTE,
       *(m_generated_shader_states[AppShaderList::UpscalingCAS].pipeline_layout),
       0,
       {*(m_generated_shader_states[AppShaderList::UpscalingCAS]
              .descriptor_sets[frame_index])},
-      &dynamic_offsets);
+      dynamic_offsets);
 
   IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kUpscaleInternal);
   {
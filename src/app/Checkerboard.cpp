@@ -107,13 +107,12 @@ void VkexInfoApp::CheckerboardUpscale(vkex::CommandBuffer cmd,
 
   cmd->CmdBindPipeline(cb_shader_state.compute_pipeline);
 
-  std::vector<uint32_t> dynamic_offsets = {
-      checkerboard_constants_dynamic_offset};
+  const uint32_t dynamic_offsets[] = {checkerboard_constants_dynamic_offset};
   cmd->CmdBindDescriptorSets(
       VK_PIPELINE_BIND_POINT_COMPUTE, *(cb_shader_state.pipeline_layout),
       0,
       {*(cb_shader_state.descriptor_sets[frame_index])},
-      &dynamic_offsets);
+      dynamic_offsets);
 
   IssueGpuTimeStart(cmd, per_frame_data, TimerTag::kUpscaleInternal);
   {
@@ -18,80 +18,297 @@
 
 #include "AssetUtil.h"
 
+static const uint64_t kFrameRetired = UINT64_MAX;
+
+// FNV-1a over the size and contents. Constant blocks are a few hundred bytes
+// at most, so a simple byte loop is plenty.
+static uint64_t HashConstants(const void* p_src, size_t size) {
+  const uint64_t kPrime = 1099511628211ull;
+  uint64_t hash = 14695981039346656037ull;
+
+  hash = (hash ^ uint64_t(size)) * kPrime;
+  const uint8_t* p_bytes = static_cast<const uint8_t*>(p_src);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p_bytes[i]) * kPrime;
+  }
+
+  // Zero marks an empty dedup entry
+  return (hash != 0) ? hash : 1;
+}
+
 vkex::Result ConstantBufferManager::Initialize(vkex::Device device,
                                                vkex::Queue queue,
                                                uint32_t frame_count,
-                                               size_t per_frame_buffer_size) {
+                                               size_t initial_ring_size) {
+  m_device = device;
+  m_queue = queue;
   m_frame_count = frame_count;
-  m_dynamic_constant_buffers.resize(frame_count);
-  m_mapped_pointers.resize(frame_count);
-
-  m_current_frame_index = 0;
-  m_current_offset = 0;
   m_min_uniform_buffer_offset_alignment = device->GetPhysicalDevice()
                                               ->GetPhysicalDeviceLimits()
                                               .minUniformBufferOffsetAlignment;
 
-  for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
-    VKEX_CALL(asset_util::CreateConstantBuffer(
-        per_frame_buffer_size, nullptr, queue,
-        asset_util::MEMORY_USAGE_CPU_TO_GPU,
-        &m_dynamic_constant_buffers[frame_index]));
+  vkex::Result result = CreateRingBuffer(initial_ring_size, &m_ring);
+  if (!result) {
+    return result;
+  }
+  m_ring_shadow.assign(size_t(m_ring.size), 0);
 
-    {
-      VkResult vk_result;
-      VKEX_VULKAN_RESULT_CALL(
-          vk_result, m_dynamic_constant_buffers[frame_index]->MapMemory(
-                         (void**)&(m_mapped_pointers[frame_index])));
+  m_head.store(0);
+  m_tail = 0;
+  m_frame_begin.assign(frame_count, kFrameRetired);
+  m_frame_ring_generation.assign(frame_count, m_ring_generation);
+  m_current_frame_index = UINT32_MAX;
 
-      // TODO: Tear this down later?
-    }
+  ResetDedupTable();
+
+  return vkex::Result::Success;
+}
+
+vkex::Result ConstantBufferManager::CreateRingBuffer(VkDeviceSize size,
+                                                     RingBuffer* p_ring) {
+  // Keeping the ring a multiple of the offset alignment keeps every physical
+  // offset aligned, including the ones that wrap back to the start.
+  const auto alignment = m_min_uniform_buffer_offset_alignment;
+  const auto aligned_size = (size + (alignment - 1)) & ~(alignment - 1);
+  VKEX_ASSERT(aligned_size <= UINT32_MAX);
+
+  vkex::Buffer buffer = nullptr;
+  vkex::Result result = asset_util::CreateConstantBuffer(
+      size_t(aligned_size), nullptr, m_queue,
+      asset_util::MEMORY_USAGE_CPU_TO_GPU, &buffer);
+  if (!result) {
+    return result;
   }
 
+  void* p_mapped = nullptr;
+  VkResult vk_result;
+  VKEX_VULKAN_RESULT_CALL(vk_result, buffer->MapMemory(&p_mapped));
+
+  p_ring->buffer = buffer;
+  p_ring->p_mapped = static_cast<uint8_t*>(p_mapped);
+  p_ring->size = aligned_size;
+  p_ring->retire_countdown = 0;
+
   return vkex::Result::Success;
 }
 
+void ConstantBufferManager::GrowRing(VkDeviceSize required_size) {
+  vkex::FlightScope flight_scope("upload", "grow constant buffer ring",
+                                 required_size);
+
+  VkDeviceSize new_size = m_ring.size * 2;
+  while (new_size < required_size) {
+    new_size *= 2;
+  }
+
+  RingBuffer new_ring = {};
+  VKEX_CALL(CreateRingBuffer(new_size, &new_ring));
+
+  // Frames in flight still read from the old buffer. Once every frame index
+  // has come around again, none of them can.
+  m_ring.retire_countdown = m_frame_count;
+  m_retired_rings.push_back(m_ring);
+  m_ring = new_ring;
+  m_ring_shadow.assign(size_t(m_ring.size), 0);
+  ++m_ring_generation;
+  ++m_statistics.growth_count;
+
+  // The new ring starts out empty, nothing in flight lives in it
+  m_head.store(0);
+  m_tail = 0;
+  std::fill(m_frame_begin.begin(), m_frame_begin.end(), kFrameRetired);
+
+  VKEX_LOG_INFO("Constant buffer ring grown to "
+                << (m_ring.size / 1024) << " KiB (frame high water mark "
+                << m_statistics.frame_high_water_mark << " bytes)");
+}
+
+void ConstantBufferManager::ResetDedupTable() {
+  for (auto& entry : m_dedup_table) {
+    entry.key.store(0, std::memory_order_relaxed);
+    entry.location.store(0, std::memory_order_relaxed);
+  }
+}
+
 vkex::Buffer ConstantBufferManager::GetBuffer(uint32_t frame_index) {
   VKEX_ASSERT(frame_index < m_frame_count);
-  return m_dynamic_constant_buffers[frame_index];
+  return m_ring.buffer;
 }
 
-void ConstantBufferManager::NewFrame(uint32_t new_frame_index) {
+bool ConstantBufferManager::NewFrame(uint32_t new_frame_index) {
   VKEX_ASSERT(new_frame_index < m_frame_count);
 
-  m_current_offset = 0;
+  // Close out the frame that was just recorded
+  const uint64_t head = m_head.load(std::memory_order_acquire);
+  if (m_current_frame_index != UINT32_MAX &&
+      m_frame_begin[m_current_frame_index] != kFrameRetired) {
+    const VkDeviceSize frame_bytes =
+        head - m_frame_begin[m_current_frame_index];
+    m_statistics.frame_bytes = frame_bytes;
+    m_statistics.frame_high_water_mark =
+        std::max(m_statistics.frame_high_water_mark, frame_bytes);
+    m_statistics.in_flight_high_water_mark =
+        std::max(m_statistics.in_flight_high_water_mark, head - m_tail);
+  }
+  m_statistics.frame_upload_count = m_frame_upload_count.exchange(0);
+  m_statistics.frame_deduplicated_count =
+      m_frame_deduplicated_count.exchange(0);
+  const uint32_t failed_upload_count = m_failed_upload_count.exchange(0);
+  m_statistics.failed_upload_count += failed_upload_count;
+
+  // The previous frame that used this index has completed
+  m_frame_begin[new_frame_index] = kFrameRetired;
+
+  for (auto it = m_retired_rings.begin(); it != m_retired_rings.end();) {
+    if (--(it->retire_countdown) == 0) {
+      VKEX_CALL(m_device->DestroyBuffer(it->buffer));
+      it = m_retired_rings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Size the ring for every frame in flight at the high water mark, plus one
+  // frame of headroom so a frame can grow past it without failing.
+  const VkDeviceSize frame_size =
+      std::max(m_statistics.frame_high_water_mark, m_reserved_frame_bytes);
+  const VkDeviceSize required_size = frame_size * (m_frame_count + 1);
+  if ((required_size > m_ring.size) || (failed_upload_count > 0)) {
+    GrowRing(required_size);
+  }
+
+  m_frame_begin[new_frame_index] = m_head.load(std::memory_order_relaxed);
+  m_tail = m_frame_begin[new_frame_index];
+  for (uint32_t frame_index = 0; frame_index < m_frame_count; ++frame_index) {
+    if (m_frame_begin[frame_index] != kFrameRetired) {
+      m_tail = std::min(m_tail, m_frame_begin[frame_index]);
+    }
+  }
+
+  // Offsets are only shared within a frame, older frames' space is reclaimed
+  // while this one may still be in flight.
+  ResetDedupTable();
+
   m_current_frame_index = new_frame_index;
+
+  const bool buffer_changed =
+      (m_frame_ring_generation[new_frame_index] != m_ring_generation);
+  m_frame_ring_generation[new_frame_index] = m_ring_generation;
+  return buffer_changed;
+}
+
+void ConstantBufferManager::ReserveFrameUploads(size_t size, size_t count) {
+  const auto alignment = m_min_uniform_buffer_offset_alignment;
+  const auto aligned_size = (size + (alignment - 1)) & ~(alignment - 1);
+  m_reserved_frame_bytes += aligned_size * count;
 }
 
 bool ConstantBufferManager::AllocDynamicBufferSpace(size_t size, void** out_ptr,
                                                     uint32_t& dynamic_offset) {
-  auto current_offset = m_current_offset;
-
   const auto alignment = m_min_uniform_buffer_offset_alignment;
   const auto aligned_size = (size + (alignment - 1)) & ~(alignment - 1);
 
-  const auto buffer_size =
-      m_dynamic_constant_buffers[m_current_frame_index]->GetMemorySize();
-  if ((current_offset + aligned_size) > buffer_size) {
+  const uint64_t ring_size = m_ring.size;
+  if (aligned_size > ring_size) {
     return false;
   }
 
-  dynamic_offset = current_offset;
-  *out_ptr = (void*)(m_mapped_pointers[m_current_frame_index] + current_offset);
+  // The head is always aligned, every allocation size is rounded up and the
+  // ring size is a multiple of the alignment.
+  uint64_t head = m_head.load(std::memory_order_relaxed);
+  uint64_t physical_offset = 0;
+  for (;;) {
+    uint64_t begin = head;
+    physical_offset = begin % ring_size;
+    // Allocations never straddle the end of the ring
+    if ((physical_offset + aligned_size) > ring_size) {
+      begin += ring_size - physical_offset;
+      physical_offset = 0;
+    }
 
-  m_current_offset += uint32_t(aligned_size);
+    const uint64_t end = begin + aligned_size;
+    if ((end - m_tail) > ring_size) {
+      return false;
+    }
+
+    if (m_head.compare_exchange_weak(head, end, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  dynamic_offset = uint32_t(physical_offset);
+  *out_ptr = (void*)(m_ring.p_mapped + physical_offset);
 
   return true;
 }
 
 uint32_t ConstantBufferManager::UploadToDynamicBuffer(size_t size,
                                                       const void* p_src) {
-  uint32_t dynamic_offset = UINT32_MAX;
+  VKEX_ASSERT(size > 0);
+  VKEX_ASSERT(m_current_frame_index != UINT32_MAX);
+
+  m_frame_upload_count.fetch_add(1, std::memory_order_relaxed);
+
+  // Look for an identical upload earlier in the frame, or claim an entry to
+  // publish this one. A key match is confirmed against the shadow copy, the
+  // mapped ring is write-combined on most devices and never read back.
+  const uint64_t key = HashConstants(p_src, size);
+  const uint32_t kTableMask = kDedupTableSize - 1;
+  DedupEntry* p_claimed_entry = nullptr;
+  for (uint32_t probe = 0; probe < kDedupMaxProbes; ++probe) {
+    auto& entry = m_dedup_table[(uint32_t(key) + probe) & kTableMask];
+
+    uint64_t entry_key = entry.key.load(std::memory_order_acquire);
+    if ((entry_key == 0) &&
+        entry.key.compare_exchange_strong(entry_key, key,
+                                          std::memory_order_acq_rel)) {
+      p_claimed_entry = &entry;
+      break;
+    }
+
+    if (entry_key == key) {
+      // A zero location means the entry is still being written
+      const uint64_t location = entry.location.load(std::memory_order_acquire);
+      const uint32_t entry_size = uint32_t(location >> 32);
+      const uint32_t entry_offset = uint32_t(location & UINT32_MAX);
+      if ((entry_size == size) &&
+          (std::memcmp(m_ring_shadow.data() + entry_offset, p_src, size) ==
+           0)) {
+        m_frame_deduplicated_count.fetch_add(1, std::memory_order_relaxed);
+        return entry_offset;
+      }
+    }
+  }
+
+  uint32_t dynamic_offset = kInvalidDynamicOffset;
   void* dest_ptr = nullptr;
 
   bool result = AllocDynamicBufferSpace(size, &dest_ptr, dynamic_offset);
-  VKEX_ASSERT(result);
+  if (!result) {
+    // The ring grows at the next NewFrame(), this frame's descriptors already
+    // point at the current buffer
+    if (m_failed_upload_count.fetch_add(1) == 0) {
+      VKEX_LOG_ERROR("Constant buffer ring exhausted ("
+                     << m_ring.size << " bytes), growing next frame");
+    }
+    VKEX_ASSERT_MSG(false, "Constant buffer ring exhausted, reserve the "
+                           "frame's uploads with ReserveFrameUploads()");
+    return kInvalidDynamicOffset;
+  }
   std::memcpy(dest_ptr, p_src, size);
+  std::memcpy(m_ring_shadow.data() + dynamic_offset, p_src, size);
+
+  if (p_claimed_entry != nullptr) {
+    const uint64_t location = (uint64_t(size) << 32) | dynamic_offset;
+    p_claimed_entry->location.store(location, std::memory_order_release);
+  }
 
   return dynamic_offset;
 }
+
+void ConstantBufferManager::GetStatistics(
+    ConstantBufferStatistics* p_statistics) const {
+  *p_statistics = m_statistics;
+  p_statistics->ring_size = m_ring.size;
+  p_statistics->buffer_count = 1 + uint32_t(m_retired_rings.size());
+}
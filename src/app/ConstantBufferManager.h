@@ -19,18 +19,68 @@
 
 #include "vkex/Application.h"
 
+#include <atomic>
+
+struct ConstantBufferStatistics {
+  VkDeviceSize ring_size;
+  uint32_t buffer_count;
+  uint32_t growth_count;
+
+  // Bytes sub-allocated by the most recently completed frame, and the largest
+  // amount any single frame has used so far.
+  VkDeviceSize frame_bytes;
+  VkDeviceSize frame_high_water_mark;
+
+  // Largest amount of the ring held by all frames in flight at once.
+  VkDeviceSize in_flight_high_water_mark;
+
+  uint32_t frame_upload_count;
+  uint32_t frame_deduplicated_count;
+  uint32_t failed_upload_count;
+};
+
+// Persistently mapped ring of dynamic uniform buffer memory shared by all
+// frames in flight. Each frame sub-allocates from the head of the ring, and
+// the space is reclaimed when the frame index comes around again (its fence
+// has been waited on by then).
+//
+// When the observed high water mark no longer fits, a larger buffer is
+// chained in at the next NewFrame(). The old buffer is kept alive until every
+// frame that could still reference it has completed. Since dynamic offsets are
+// relative to the buffer bound in the descriptor, NewFrame() reports when the
+// frame's descriptors must be pointed at the new buffer.
+//
+// UploadToDynamicBuffer may be called from multiple threads; sub-allocation
+// is a single compare-and-swap on the ring head. Identical uploads within a
+// frame are deduplicated and share a dynamic offset: a content hash finds the
+// earlier upload, and a CPU side shadow of the ring confirms the contents
+// match without reading the write-combined mapping.
+//
+// Running out of ring space mid-frame is a sizing bug: the buffer can't
+// change under recorded descriptors, so the upload asserts and returns
+// kInvalidDynamicOffset. ReserveFrameUploads() sizes the ring for the uploads
+// a frame is known to make before the first one.
 class ConstantBufferManager {
  public:
   ConstantBufferManager() {}
   virtual ~ConstantBufferManager() {}
 
+  static const uint32_t kInvalidDynamicOffset = UINT32_MAX;
+
   vkex::Result Initialize(
       vkex::Device device, vkex::Queue queue, uint32_t frame_count,
-      size_t per_frame_buffer_size = kDefaultBufferSizeInBytes);
+      size_t initial_ring_size = kDefaultRingSizeInBytes);
 
   vkex::Buffer GetBuffer(uint32_t frame_index);
 
-  void NewFrame(uint32_t new_frame_index);
+  // Returns true if GetBuffer(new_frame_index) changed since the frame index
+  // was last used, in which case descriptors referencing the constant buffer
+  // must be updated before recording.
+  bool NewFrame(uint32_t new_frame_index);
+
+  // Every frame makes at least 'count' uploads of 'size' bytes, the ring is
+  // grown for them at the next NewFrame()
+  void ReserveFrameUploads(size_t size, size_t count);
 
   uint32_t UploadToDynamicBuffer(size_t size, const void* p_src);
   template <typename T>
@@ -40,22 +90,67 @@ class ConstantBufferManager {
                                  &constant_buffer_data.data);
   }
 
+  void GetStatistics(ConstantBufferStatistics* p_statistics) const;
+
  protected:
-  // TODO: This number is totally magical, and will be
-  // replaced by a value based on actual usage _soon_
+  // Starting size only, the ring grows to fit the observed high water mark
   enum ConstantBufferManagerConstants {
-    kDefaultBufferSizeInBytes = 4 * 1024 * 1024,
+    kDefaultRingSizeInBytes = 256 * 1024,
+    kDedupTableSize = 256,
+    kDedupMaxProbes = 8,
   };
 
   bool AllocDynamicBufferSpace(size_t size, void** out_ptr,
                                uint32_t& dynamic_offset);
 
  private:
-  std::vector<vkex::Buffer> m_dynamic_constant_buffers;
-  std::vector<uint8_t*> m_mapped_pointers;
-  VkDeviceSize m_min_uniform_buffer_offset_alignment;
+  struct RingBuffer {
+    vkex::Buffer buffer = nullptr;
+    uint8_t* p_mapped = nullptr;
+    VkDeviceSize size = 0;
+    // NewFrame() calls left until no frame in flight can reference the buffer
+    uint32_t retire_countdown = 0;
+  };
+
+  // 'key' is the content hash of an upload, 'location' packs its size and
+  // dynamic offset. A claimed entry with a zero location is still being
+  // written by another thread.
+  struct DedupEntry {
+    std::atomic<uint64_t> key{0};
+    std::atomic<uint64_t> location{0};
+  };
+
+  vkex::Result CreateRingBuffer(VkDeviceSize size, RingBuffer* p_ring);
+  void GrowRing(VkDeviceSize required_size);
+  void ResetDedupTable();
+
+ private:
+  vkex::Device m_device = nullptr;
+  vkex::Queue m_queue = nullptr;
+  VkDeviceSize m_min_uniform_buffer_offset_alignment = 0;
+
+  RingBuffer m_ring;
+  // What was written to m_ring, the dedup compares against this
+  std::vector<uint8_t> m_ring_shadow;
+  std::vector<RingBuffer> m_retired_rings;
+  uint32_t m_ring_generation = 0;
+
+  // Ring positions are virtual byte offsets that only increase, the physical
+  // offset is the virtual offset modulo the ring size. Everything between
+  // m_tail and m_head belongs to frames in flight.
+  std::atomic<uint64_t> m_head{0};
+  uint64_t m_tail = 0;
+  std::vector<uint64_t> m_frame_begin;
+  std::vector<uint32_t> m_frame_ring_generation;
+  VkDeviceSize m_reserved_frame_bytes = 0;
+
+  DedupEntry m_dedup_table[kDedupTableSize];
+
+  std::atomic<uint32_t> m_frame_upload_count{0};
+  std::atomic<uint32_t> m_frame_deduplicated_count{0};
+  std::atomic<uint32_t> m_failed_upload_count{0};
+  ConstantBufferStatistics m_statistics = {};
 
-  uint32_t m_current_offset = UINT32_MAX;
   uint32_t m_frame_count = 0;
   uint32_t m_current_frame_index = UINT32_MAX;
 };
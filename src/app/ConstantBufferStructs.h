@@ -56,6 +56,54 @@ struct PerObjectConstantData {
   float metallicFactor;
   float roughnessFactor;
   uint2 padding2;
+
+  // Object space from quantized positions, see GLTFModel::GeometryOptions
+  float4x4 positionDequantMatrix;
+};
+
+// Stress scene instance transform, read from a structured buffer by the
+// instanced scene shaders and applied on top of worldMatrix
+struct InstanceData {
+  float4x4 worldMatrix;
+};
+
+// One draw list item as seen by the GPU culling pass. Bounds are the world
+// space box of the primitive before the instance transform, for this frame
+// and the last one.
+struct CullDrawData {
+  float3 boundsCenter;
+  uint lodCount;
+  float3 boundsExtent;
+  uint padding1;
+  float3 prevBoundsCenter;
+  int vertexOffset;
+  float3 prevBoundsExtent;
+  uint flags;
+  // Index range of each LOD, LOD 0 being the full detail primitive
+  uint4 lodFirstIndex;
+  uint4 lodIndexCount;
+  // World space error of each LOD, before the instance's scale
+  float4 lodError;
+};
+
+struct GpuCullData {
+  float4x4 viewProjectionMatrix;
+  // Camera the Hi-Z source depth was rendered with
+  float4x4 hizViewProjectionMatrix;
+  uint instanceCount;
+  uint drawCount;
+  uint maxInstanceCount;
+  uint occlusionEnabled;
+  // Extent of the depth buffer the Hi-Z pyramid was built from. The
+  // pyramid's first level is half of it, rounded up.
+  uint depthWidth;
+  uint depthHeight;
+  uint hizMipCount;
+  // Pixels per unit of LOD error at distance one, over the error threshold.
+  // Zero keeps every instance at LOD 0.
+  float lodPixelScale;
+  float3 eyePosition;
+  uint padding1;
 };
 
 struct ScaledTexCopyDimensionsData {
@@ -69,6 +117,14 @@ struct ImageDeltaOptions {
   uint2 padding1;
 };
 
+struct ImageMetricsData {
+  uint width;
+  uint height;
+  // Windows of IMAGE_METRICS_TILE_SIZE squared pixels covering the image
+  uint tileCountX;
+  uint tileCount;
+};
+
 struct CASData {
   uint4 const0;
   uint4 const1;
@@ -0,0 +1,141 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "DrawList.h"
+
+#include <algorithm>
+
+uint64_t DrawList::MakeSortKey(uint32_t material_index, uint32_t buffer_index,
+                               uint32_t first_index) {
+  VKEX_ASSERT(material_index < (1u << kMaterialBits));
+  VKEX_ASSERT(buffer_index < (1u << kBufferBits));
+
+  uint64_t key = material_index;
+  key = (key << kBufferBits) | buffer_index;
+  key = (key << kFirstIndexBits) | first_index;
+  return key;
+}
+
+uint32_t DrawList::GetBufferIndex(uint64_t sort_key) {
+  return uint32_t(sort_key >> kFirstIndexBits) & ((1u << kBufferBits) - 1);
+}
+
+void DrawList::Reserve(const GLTFModel& model) {
+  const auto& scene = model.GetFlattenedScene();
+
+  size_t draw_count = 0;
+  for (int32_t mesh_index : scene.mesh_indices) {
+    if (mesh_index >= 0) {
+      draw_count += model.GetMesh(uint32_t(mesh_index)).primitives.size();
+    }
+  }
+  m_items.reserve(m_items.size() + draw_count);
+}
+
+void DrawList::Clear() {
+  m_items.clear();
+
+  m_statistics.record_time_ms = m_frame_record_time_ms;
+  m_statistics.recorded_draw_count = m_frame_recorded_draw_count;
+  m_frame_record_time_ms = 0.0;
+  m_frame_recorded_draw_count = 0;
+}
+
+void DrawList::AddModel(const GLTFModel& model, uint32_t buffer_index,
+                        const uint8_t* p_visible, const uint8_t* p_levels) {
+  const auto& scene = model.GetFlattenedScene();
+  const uint32_t material_count = model.GetMaterialCount();
+  VKEX_ASSERT(material_count > 0);
+
+  size_t primitive_visit_index = 0;
+  const size_t instance_count = scene.mesh_indices.size();
+  for (size_t instance = 0; instance < instance_count; instance++) {
+    const int32_t mesh_index = scene.mesh_indices[instance];
+    if (mesh_index < 0) {
+      continue;
+    }
+
+    const auto& primitives = model.GetMesh(uint32_t(mesh_index)).primitives;
+    for (size_t primitive_index = 0; primitive_index < primitives.size();
+         primitive_index++) {
+      const size_t visit_index = primitive_visit_index++;
+      if ((p_visible != nullptr) && (p_visible[visit_index] == 0)) {
+        continue;
+      }
+
+      const auto& primitive = primitives[primitive_index];
+      const uint32_t lod = (p_levels != nullptr) ? p_levels[visit_index] : 0;
+      uint32_t first_index = primitive.first_index;
+      uint32_t index_count = primitive.index_count;
+      if (lod > 0) {
+        first_index = primitive.lods[lod].first_index;
+        index_count = primitive.lods[lod].index_count;
+      }
+
+      // Primitives without a material use the first one
+      const uint32_t material_index =
+          (primitive.materialIndex < material_count) ? primitive.materialIndex
+                                                     : 0;
+
+      DrawItem item = {};
+      item.sort_key = MakeSortKey(material_index, buffer_index, first_index);
+      item.instance_index = uint32_t(instance);
+      item.primitive_index = uint32_t(primitive_index);
+      item.material_index = material_index;
+      item.lod = lod;
+      item.index_count = index_count;
+      item.first_index = first_index;
+      item.vertex_offset = primitive.vertex_offset;
+      m_items.push_back(item);
+    }
+  }
+}
+
+void DrawList::Sort() {
+  std::sort(m_items.begin(), m_items.end(),
+            [](const DrawItem& a, const DrawItem& b) {
+              return a.sort_key < b.sort_key;
+            });
+
+  m_statistics.draw_count = uint32_t(m_items.size());
+  m_statistics.material_switch_count = 0;
+  m_statistics.buffer_switch_count = 0;
+  m_statistics.index_count = 0;
+
+  uint32_t prev_material_index = UINT32_MAX;
+  uint32_t prev_buffer_index = UINT32_MAX;
+  for (const auto& item : m_items) {
+    const uint32_t buffer_index = GetBufferIndex(item.sort_key);
+    if (item.material_index != prev_material_index) {
+      ++m_statistics.material_switch_count;
+    }
+    if (buffer_index != prev_buffer_index) {
+      ++m_statistics.buffer_switch_count;
+    }
+    prev_material_index = item.material_index;
+    prev_buffer_index = buffer_index;
+    m_statistics.index_count += item.index_count;
+  }
+}
+
+void DrawList::AddRecordTime(double record_time_ms, uint32_t draw_count) {
+  m_frame_record_time_ms += record_time_ms;
+  m_frame_recorded_draw_count += draw_count;
+}
+
+void DrawList::GetStatistics(DrawListStatistics* p_statistics) const {
+  *p_statistics = m_statistics;
+}
@@ -0,0 +1,107 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __DRAW_LIST_H__
+#define __DRAW_LIST_H__
+
+#include "GLTFModel.h"
+
+// One primitive of one mesh instance, with everything needed to record it
+struct DrawItem {
+  uint64_t sort_key;
+  uint32_t instance_index;
+  // Index into the instance's mesh primitives
+  uint32_t primitive_index;
+  uint32_t material_index;
+  // Level of detail the index range belongs to
+  uint32_t lod;
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  // Dynamic offset of the draw's per object constants for the current frame
+  uint32_t constants_offset;
+};
+
+struct DrawListStatistics {
+  uint32_t draw_count;
+  uint32_t material_switch_count;
+  uint32_t buffer_switch_count;
+  // Indices drawn for a single instance of the list
+  uint64_t index_count;
+
+  // CPU time spent recording the frame's draws, summed over every pass that
+  // drew the list
+  double record_time_ms;
+  uint32_t recorded_draw_count;
+};
+
+// Per frame list of draws, rebuilt from a model's flattened scene and sorted
+// so consecutive draws share as much state as possible. The sort key orders
+// by material (descriptor set), then geometry buffer, then first index so
+// draws from one buffer walk it front to back. Every material is drawn with
+// the pass's one pipeline, so there is no pipeline state to sort by.
+//
+// Storage is reserved when the model is loaded and reused every frame, so
+// building and sorting the list does not allocate.
+class DrawList {
+ public:
+  DrawList() {}
+  virtual ~DrawList() {}
+
+  // Sort key layout, most significant field first
+  enum DrawListConstants {
+    kMaterialBits = 16,
+    kBufferBits = 8,
+    kFirstIndexBits = 32,
+  };
+
+  static uint64_t MakeSortKey(uint32_t material_index, uint32_t buffer_index,
+                              uint32_t first_index);
+  static uint32_t GetBufferIndex(uint64_t sort_key);
+
+  void Reserve(const GLTFModel& model);
+  void Clear();
+  // Appends a draw for every primitive of every mesh instance in the model's
+  // flattened scene. 'buffer_index' identifies the model's geometry buffer.
+  // 'p_visible', if given, holds a byte per primitive in the same order (see
+  // FrustumCuller::AddModel) and primitives marked zero are skipped.
+  // 'p_levels', if given, holds the LOD to draw for each primitive in the
+  // same order (see LodSelector::Select), otherwise LOD 0 is drawn.
+  void AddModel(const GLTFModel& model, uint32_t buffer_index,
+                const uint8_t* p_visible = nullptr,
+                const uint8_t* p_levels = nullptr);
+  void Sort();
+
+  vkex::Span<DrawItem> GetItems() {
+    return vkex::Span<DrawItem>(m_items.data(), m_items.size());
+  }
+  size_t GetSize() const { return m_items.size(); }
+  size_t GetCapacity() const { return m_items.capacity(); }
+
+  // Record time is accumulated by the caller and reset by Clear()
+  void AddRecordTime(double record_time_ms, uint32_t draw_count);
+  void GetStatistics(DrawListStatistics* p_statistics) const;
+
+ private:
+  std::vector<DrawItem> m_items;
+
+  DrawListStatistics m_statistics = {};
+  // Record time of the last completed frame, the current one is still going
+  double m_frame_record_time_ms = 0.0;
+  uint32_t m_frame_recorded_draw_count = 0;
+};
+
+#endif  // __DRAW_LIST_H__
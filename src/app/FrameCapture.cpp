@@ -0,0 +1,379 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+static size_t GetYCbCr420Size(uint32_t width, uint32_t height) {
+  const size_t chroma_size =
+      static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+  return (static_cast<size_t>(width) * height) + (2 * chroma_size);
+}
+
+// RGBA8 to planar Y, Cb, Cr with BT.709 limited range coefficients in 8.8
+// fixed point. Chroma is the average of each 2x2 block, centered like
+// Y4M's C420jpeg.
+static void ConvertToYCbCr420(const uint8_t* p_rgba, uint32_t row_stride,
+                              uint32_t width, uint32_t height,
+                              uint8_t* p_dst) {
+  const uint32_t chroma_width = (width + 1) / 2;
+  const uint32_t chroma_height = (height + 1) / 2;
+  uint8_t* p_y = p_dst;
+  uint8_t* p_cb = p_y + (static_cast<size_t>(width) * height);
+  uint8_t* p_cr = p_cb + (static_cast<size_t>(chroma_width) * chroma_height);
+
+  for (uint32_t y = 0; y < height; y += 2) {
+    // Odd heights repeat the last row into the chroma average
+    const uint32_t y1 = std::min(y + 1, height - 1);
+    const uint8_t* p_row0 = p_rgba + (static_cast<size_t>(y) * row_stride);
+    const uint8_t* p_row1 = p_rgba + (static_cast<size_t>(y1) * row_stride);
+    uint8_t* p_luma0 = p_y + (static_cast<size_t>(y) * width);
+    uint8_t* p_luma1 = p_y + (static_cast<size_t>(y1) * width);
+    const size_t chroma_row = static_cast<size_t>(y / 2) * chroma_width;
+
+    for (uint32_t x = 0; x < width; x += 2) {
+      const uint32_t x1 = std::min(x + 1, width - 1);
+      const uint8_t* p_block[4] = {p_row0 + (x * 4), p_row0 + (x1 * 4),
+                                   p_row1 + (x * 4), p_row1 + (x1 * 4)};
+      uint8_t* p_luma[4] = {p_luma0 + x, p_luma0 + x1, p_luma1 + x,
+                            p_luma1 + x1};
+
+      int32_t sum_r = 0;
+      int32_t sum_g = 0;
+      int32_t sum_b = 0;
+      for (uint32_t i = 0; i < 4; ++i) {
+        const int32_t r = p_block[i][0];
+        const int32_t g = p_block[i][1];
+        const int32_t b = p_block[i][2];
+        *p_luma[i] =
+            static_cast<uint8_t>(((47 * r + 157 * g + 16 * b + 128) >> 8) + 16);
+        sum_r += r;
+        sum_g += g;
+        sum_b += b;
+      }
+
+      // The sums carry two more bits, the 128 bias keeps the shift positive
+      const int32_t cb =
+          (-26 * sum_r - 86 * sum_g + 112 * sum_b + (128 << 10) + 512) >> 10;
+      const int32_t cr =
+          (112 * sum_r - 102 * sum_g - 10 * sum_b + (128 << 10) + 512) >> 10;
+      p_cb[chroma_row + (x / 2)] = static_cast<uint8_t>(cb);
+      p_cr[chroma_row + (x / 2)] = static_cast<uint8_t>(cr);
+    }
+  }
+}
+
+bool FrameCapture::Initialize(
+    vkex::Device device, const std::string& path_prefix,
+    const std::vector<FrameCaptureStreamInfo>& streams, VkExtent2D max_extent,
+    uint32_t frame_rate) {
+  VKEX_ASSERT(!IsActive());
+  VKEX_ASSERT(!streams.empty());
+
+  for (const auto& info : streams) {
+    auto stream = std::make_unique<Stream>();
+    stream->info = info;
+
+    const bool y4m = (info.container == FrameCaptureContainer::kY4M);
+    const std::string path =
+        path_prefix + "_" + info.name + (y4m ? ".y4m" : ".raw");
+    const std::string index_path = path_prefix + "_" + info.name + ".csv";
+    stream->file.open(path, std::ios::binary | std::ios::trunc);
+    stream->index.open(index_path, std::ios::trunc);
+    if (!stream->file.is_open() || !stream->index.is_open()) {
+      VKEX_LOG_WARN("Couldn't open " << path << " and " << index_path
+                                     << " for frame capture");
+      m_streams.clear();
+      return false;
+    }
+
+    if (y4m) {
+      std::stringstream header;
+      header << "YUV4MPEG2 W" << info.extent.width << " H"
+             << info.extent.height << " F" << std::max(frame_rate, 1u)
+             << ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+      const std::string text = header.str();
+      stream->file.write(text.data(), text.size());
+      stream->file_offset = text.size();
+    }
+    // Offsets are where the pixels start, past Y4M's per frame marker
+    stream->index << "frame,app_frame,offset,width,height,bytes\n";
+
+    m_streams.push_back(std::move(stream));
+  }
+
+  for (uint32_t stream_index = 0; stream_index < m_streams.size();
+       ++stream_index) {
+    vkex::ImageReadbackCreateInfo create_info = {};
+    create_info.slot_count = kSlotsPerStream;
+    create_info.max_width = max_extent.width;
+    create_info.max_height = max_extent.height;
+    create_info.thread_count = 2;
+    create_info.callback = [this,
+                            stream_index](const vkex::ImageReadbackData& data) {
+      ConvertFrame(stream_index, data);
+    };
+
+    auto& readback = m_streams[stream_index]->readback;
+    readback = std::make_unique<vkex::ImageReadback>();
+    vkex::Result result = readback->Initialize(device, create_info);
+    if (!result) {
+      VKEX_LOG_WARN("Couldn't create the readback ring for capture stream "
+                    << m_streams[stream_index]->info.name);
+      Destroy();
+      return false;
+    }
+  }
+
+  m_stop = false;
+  m_io_thread = std::thread(&FrameCapture::IoThreadMain, this);
+
+  VKEX_LOG_INFO("Capturing " << m_streams.size() << " streams to "
+                             << path_prefix << "_*");
+  return true;
+}
+
+void FrameCapture::Destroy() {
+  if (!IsActive()) {
+    return;
+  }
+
+  // Every copy in flight is converted before the readbacks are gone, so the
+  // I/O thread has all it's waiting for when it's told to stop
+  for (auto& stream : m_streams) {
+    if (stream->readback) {
+      stream->readback->Destroy();
+    }
+  }
+
+  if (m_io_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_condition.notify_all();
+    m_io_thread.join();
+  }
+
+  for (const auto& stream : m_streams) {
+    VKEX_LOG_INFO("Capture stream " << stream->info.name << ": "
+                                    << stream->written_count
+                                    << " frames written");
+  }
+  VKEX_LOG_INFO("Capture dropped "
+                << m_dropped_slot_count << " stream frames waiting for "
+                << "readback slots, " << m_dropped_queue_count
+                << " waiting for the disk and " << m_dropped_extent_count
+                << " for a changed extent");
+
+  m_streams.clear();
+  m_free_buffers.clear();
+  m_queued_bytes = 0;
+  m_stop = false;
+}
+
+void FrameCapture::Poll() {
+  for (auto& stream : m_streams) {
+    stream->readback->Poll();
+  }
+}
+
+vkex::Result FrameCapture::Capture(
+    vkex::Queue queue, const std::vector<FrameCaptureSource>& sources,
+    uint64_t frame_number) {
+  VKEX_ASSERT(sources.size() == m_streams.size());
+
+  // All or none, so every stream of a written frame shows the same frame
+  uint32_t source_count = 0;
+  bool slots_free = true;
+  for (uint32_t i = 0; i < m_streams.size(); ++i) {
+    if (sources[i].image == nullptr) {
+      continue;
+    }
+    ++source_count;
+    slots_free = slots_free && m_streams[i]->readback->HasFreeSlot();
+  }
+  if (source_count == 0) {
+    return vkex::Result::Success;
+  }
+  if (!slots_free) {
+    m_dropped_slot_count += source_count;
+    return vkex::Result::Success;
+  }
+
+  m_command_buffers.clear();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < m_streams.size(); ++i) {
+      const auto& source = sources[i];
+      if (source.image == nullptr) {
+        continue;
+      }
+      VkCommandBuffer command_buffer = m_streams[i]->readback->RecordCopy(
+          source.image, source.layout, source.extent, frame_number);
+      VKEX_ASSERT(command_buffer != VK_NULL_HANDLE);
+      m_command_buffers.push_back(command_buffer);
+      m_streams[i]->expected.push_back(frame_number);
+    }
+  }
+
+  VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  submit_info.commandBufferCount =
+      static_cast<uint32_t>(m_command_buffers.size());
+  submit_info.pCommandBuffers = m_command_buffers.data();
+  VkResult vk_result =
+      vkex::QueueSubmit(*queue, 1, &submit_info, VK_NULL_HANDLE);
+
+  // The fences go in even when the copies didn't, so the slots come back
+  for (uint32_t i = 0; i < m_streams.size(); ++i) {
+    if (sources[i].image == nullptr) {
+      continue;
+    }
+    vkex::Result result = m_streams[i]->readback->SubmitFence(queue);
+    if (!result) {
+      // Its callback will never run, don't hold the stream's later frames
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_streams[i]->expected.pop_back();
+    }
+  }
+
+  if (vk_result != VK_SUCCESS) {
+    return vkex::Result(vk_result);
+  }
+  return vkex::Result::Success;
+}
+
+void FrameCapture::ConvertFrame(uint32_t stream_index,
+                                const vkex::ImageReadbackData& data) {
+  Stream& stream = *m_streams[stream_index];
+  const bool y4m = (stream.info.container == FrameCaptureContainer::kY4M);
+
+  CapturedFrame frame;
+  frame.frame_number = data.tag;
+  frame.extent = {data.width, data.height};
+
+  bool keep = true;
+  if (y4m && ((data.width != stream.info.extent.width) ||
+              (data.height != stream.info.extent.height))) {
+    ++m_dropped_extent_count;
+    keep = false;
+  }
+
+  const size_t size = y4m ? GetYCbCr420Size(data.width, data.height)
+                          : static_cast<size_t>(data.row_stride) * data.height;
+  if (keep) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if ((m_queued_bytes + size) > kMaxQueuedBytes) {
+      ++m_dropped_queue_count;
+      keep = false;
+    } else {
+      m_queued_bytes += size;
+      if (!m_free_buffers.empty()) {
+        frame.data = std::move(m_free_buffers.back());
+        m_free_buffers.pop_back();
+      }
+    }
+  }
+
+  if (keep) {
+    frame.data.resize(size);
+    if (y4m) {
+      ConvertToYCbCr420(data.p_pixels, data.row_stride, data.width,
+                        data.height, frame.data.data());
+    } else {
+      memcpy(frame.data.data(), data.p_pixels, size);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stream.arrived[frame.frame_number] = std::move(frame);
+  }
+  m_condition.notify_one();
+}
+
+void FrameCapture::WriteFrame(Stream& stream, const CapturedFrame& frame) {
+  if (frame.data.empty()) {
+    return;
+  }
+
+  if (stream.info.container == FrameCaptureContainer::kY4M) {
+    static const char kFrameMarker[] = "FRAME\n";
+    stream.file.write(kFrameMarker, sizeof(kFrameMarker) - 1);
+    stream.file_offset += sizeof(kFrameMarker) - 1;
+  }
+
+  stream.index << stream.written_count << "," << frame.frame_number << ","
+               << stream.file_offset << "," << frame.extent.width << ","
+               << frame.extent.height << "," << frame.data.size() << "\n";
+  stream.file.write(reinterpret_cast<const char*>(frame.data.data()),
+                    frame.data.size());
+  stream.file_offset += frame.data.size();
+
+  ++stream.written_count;
+  ++m_written_count;
+}
+
+void FrameCapture::IoThreadMain() {
+  std::vector<std::pair<Stream*, CapturedFrame>> ready;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (true) {
+        // Each stream is written in the order its frames were copied, the
+        // converters may finish them out of order
+        for (auto& stream : m_streams) {
+          while (!stream->expected.empty()) {
+            auto it = stream->arrived.find(stream->expected.front());
+            if (it == stream->arrived.end()) {
+              break;
+            }
+            ready.emplace_back(stream.get(), std::move(it->second));
+            stream->arrived.erase(it);
+            stream->expected.pop_front();
+          }
+        }
+        if (!ready.empty()) {
+          break;
+        }
+        if (m_stop) {
+          return;
+        }
+        m_condition.wait(lock);
+      }
+    }
+
+    // Large sequential writes, outside the lock so the converters keep going
+    for (auto& entry : ready) {
+      WriteFrame(*entry.first, entry.second);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (auto& entry : ready) {
+        if (!entry.second.data.empty()) {
+          m_queued_bytes -= entry.second.data.size();
+          m_free_buffers.push_back(std::move(entry.second.data));
+        }
+      }
+    }
+    ready.clear();
+  }
+}
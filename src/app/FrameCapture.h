@@ -0,0 +1,145 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __FRAME_CAPTURE_H__
+#define __FRAME_CAPTURE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "vkex/Application.h"
+#include "vkex/ImageReadback.h"
+
+enum class FrameCaptureContainer {
+  // 8 bit color as YCbCr 4:2:0, BT.709 limited range, which VMAF and ffmpeg
+  // read directly. Every frame has the extent of the first
+  kY4M,
+  // The image's own bytes, any extent
+  kRaw,
+};
+
+struct FrameCaptureStreamInfo {
+  std::string name;
+  FrameCaptureContainer container;
+  // Y4M frames of any other extent are dropped
+  VkExtent2D extent;
+};
+
+// One stream's image for the frame being captured, a null image skips the
+// stream for this frame
+struct FrameCaptureSource {
+  vkex::Image image;
+  VkImageLayout layout;
+  VkExtent2D extent;
+};
+
+// Streams every frame of a few images to disk for offline quality analysis.
+// Each stream goes to <prefix>_<name>.y4m or .raw, with <prefix>_<name>.csv
+// indexing every written frame by its app frame number, byte offset and
+// extent. Frames dropped on the way leave gaps in the app frame numbers, so
+// tools pair the streams of a frame through the index, not the position.
+//
+// The copies go through an ImageReadback ring per stream. Its workers
+// convert the pixels and queue them for a single I/O thread, which writes
+// each stream in frame order with large sequential writes. Nothing on the
+// render thread waits for the disk: a frame is dropped when any stream is
+// out of readback slots, and converted frames are dropped once
+// kMaxQueuedBytes are waiting to be written.
+class FrameCapture {
+ public:
+  static const uint32_t kSlotsPerStream = 3;
+  static const uint64_t kMaxQueuedBytes = 512ull << 20;
+
+  FrameCapture() {}
+  virtual ~FrameCapture() { Destroy(); }
+
+  // 'max_extent' is the largest image any stream will copy, 'frame_rate' goes
+  // into the Y4M headers
+  bool Initialize(vkex::Device device, const std::string& path_prefix,
+                  const std::vector<FrameCaptureStreamInfo>& streams,
+                  VkExtent2D max_extent, uint32_t frame_rate);
+  // Writes out everything in flight, closes the files and logs the counts
+  void Destroy();
+  bool IsActive() const { return !m_streams.empty(); }
+
+  // Hands finished copies to the converters, call once a frame
+  void Poll();
+
+  // Copies 'sources', one per stream in Initialize order, after everything
+  // already submitted to 'queue' that writes them. The images are back in
+  // their layouts when the copies finish.
+  vkex::Result Capture(vkex::Queue queue,
+                       const std::vector<FrameCaptureSource>& sources,
+                       uint64_t frame_number);
+
+  uint64_t GetWrittenCount() const { return m_written_count; }
+  uint64_t GetDroppedCount() const {
+    return m_dropped_slot_count + m_dropped_queue_count +
+           m_dropped_extent_count;
+  }
+
+ private:
+  struct CapturedFrame {
+    uint64_t frame_number = 0;
+    VkExtent2D extent = {};
+    // Empty when the frame was dropped after the copy
+    std::vector<uint8_t> data;
+  };
+
+  struct Stream {
+    FrameCaptureStreamInfo info;
+    std::unique_ptr<vkex::ImageReadback> readback;
+    // Written by the I/O thread only
+    std::ofstream file;
+    std::ofstream index;
+    uint64_t file_offset = 0;
+    uint64_t written_count = 0;
+    // Guarded by m_mutex. Frame numbers in the order they were copied, and
+    // the converted frames waiting for their turn
+    std::deque<uint64_t> expected;
+    std::map<uint64_t, CapturedFrame> arrived;
+  };
+
+  void ConvertFrame(uint32_t stream_index, const vkex::ImageReadbackData& data);
+  void WriteFrame(Stream& stream, const CapturedFrame& frame);
+  void IoThreadMain();
+
+ private:
+  std::vector<std::unique_ptr<Stream>> m_streams;
+  std::vector<VkCommandBuffer> m_command_buffers;
+  std::thread m_io_thread;
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stop = false;
+  uint64_t m_queued_bytes = 0;
+  // Buffers handed back by the I/O thread, so steady state capture doesn't
+  // allocate
+  std::vector<std::vector<uint8_t>> m_free_buffers;
+
+  std::atomic<uint64_t> m_written_count{0};
+  uint64_t m_dropped_slot_count = 0;
+  std::atomic<uint64_t> m_dropped_queue_count{0};
+  std::atomic<uint64_t> m_dropped_extent_count{0};
+};
+
+#endif  // __FRAME_CAPTURE_H__
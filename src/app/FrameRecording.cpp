@@ -0,0 +1,143 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "FrameRecording.h"
+
+#include <cstring>
+
+struct RecordingHeader {
+  char magic[4];
+  uint32_t version;
+};
+
+static const char kRecordingMagic[4] = {'P', 'Q', 'F', 'R'};
+static const uint32_t kRecordingVersion = 1;
+
+enum RecordFlags : uint8_t {
+  kAnimationEnabled = 0x1,
+  // The record carries eye, center and up, otherwise the camera didn't move
+  kCameraFollows = 0x2,
+};
+
+bool FrameRecorder::Open(const std::string& path) {
+  m_file.open(path, std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open()) {
+    VKEX_LOG_WARN("Couldn't open " << path << " for recording");
+    return false;
+  }
+
+  RecordingHeader header = {};
+  memcpy(header.magic, kRecordingMagic, sizeof(header.magic));
+  header.version = kRecordingVersion;
+  m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  m_frame_count = 0;
+  return true;
+}
+
+void FrameRecorder::Write(const RecordedFrameState& state) {
+  if (!IsOpen()) {
+    return;
+  }
+
+  const bool camera_moved = (m_frame_count == 0) ||
+                            (state.eye != m_previous_state.eye) ||
+                            (state.center != m_previous_state.center) ||
+                            (state.up != m_previous_state.up);
+
+  uint8_t flags = 0;
+  flags |= state.animation_enabled ? kAnimationEnabled : 0;
+  flags |= camera_moved ? kCameraFollows : 0;
+
+  m_file.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  m_file.write(reinterpret_cast<const char*>(&state.animation_progress),
+               sizeof(state.animation_progress));
+  if (camera_moved) {
+    const float camera[9] = {state.eye.x,    state.eye.y,    state.eye.z,
+                             state.center.x, state.center.y, state.center.z,
+                             state.up.x,     state.up.y,     state.up.z};
+    m_file.write(reinterpret_cast<const char*>(camera), sizeof(camera));
+  }
+
+  m_previous_state = state;
+  ++m_frame_count;
+}
+
+bool FramePlayer::Load(const std::string& path) {
+  m_frames.clear();
+  m_next_frame = 0;
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    VKEX_LOG_WARN("Couldn't open recording " << path);
+    return false;
+  }
+
+  RecordingHeader header = {};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || (memcmp(header.magic, kRecordingMagic, sizeof(header.magic)) !=
+                0)) {
+    VKEX_LOG_WARN(path << " isn't a frame recording");
+    return false;
+  }
+  if (header.version != kRecordingVersion) {
+    VKEX_LOG_WARN(path << " is recording version " << header.version
+                       << ", expected " << kRecordingVersion);
+    return false;
+  }
+
+  RecordedFrameState state = {};
+  while (true) {
+    uint8_t flags = 0;
+    float animation_progress = 0.0f;
+    file.read(reinterpret_cast<char*>(&flags), sizeof(flags));
+    file.read(reinterpret_cast<char*>(&animation_progress),
+              sizeof(animation_progress));
+    if (!file) {
+      break;
+    }
+
+    if (flags & kCameraFollows) {
+      float camera[9] = {};
+      file.read(reinterpret_cast<char*>(camera), sizeof(camera));
+      if (!file) {
+        break;
+      }
+      state.eye = vkex::float3(camera[0], camera[1], camera[2]);
+      state.center = vkex::float3(camera[3], camera[4], camera[5]);
+      state.up = vkex::float3(camera[6], camera[7], camera[8]);
+    } else if (m_frames.empty()) {
+      VKEX_LOG_WARN(path << " doesn't start with a camera");
+      return false;
+    }
+
+    state.animation_progress = animation_progress;
+    state.animation_enabled = (flags & kAnimationEnabled) != 0;
+    m_frames.push_back(state);
+  }
+
+  VKEX_LOG_INFO("Loaded " << m_frames.size() << " recorded frames from "
+                          << path);
+  return IsLoaded();
+}
+
+bool FramePlayer::Read(RecordedFrameState* p_state) {
+  if (m_next_frame >= m_frames.size()) {
+    return false;
+  }
+  *p_state = m_frames[m_next_frame++];
+  return true;
+}
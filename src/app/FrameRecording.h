@@ -0,0 +1,79 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __FRAME_RECORDING_H__
+#define __FRAME_RECORDING_H__
+
+#include <fstream>
+
+#include "vkex/Application.h"
+
+// The state that changes from frame to frame, everything else the frames
+// render is fixed at startup by the command line
+struct RecordedFrameState {
+  float animation_progress;
+  bool animation_enabled;
+  vkex::float3 eye;
+  vkex::float3 center;
+  vkex::float3 up;
+};
+
+// Recordings are a small header followed by one record per frame: a flags
+// byte and the animation progress, plus the camera on frames where it
+// moved. A run of 60 fps without camera movement is about 300 bytes a
+// second. Values are stored in the host's byte order, little endian on
+// every platform the app runs on.
+//
+// Frames are written as they're rendered, so a recording cut short by a
+// crash still plays back up to its last complete frame.
+class FrameRecorder {
+ public:
+  FrameRecorder() {}
+  virtual ~FrameRecorder() {}
+
+  bool Open(const std::string& path);
+  bool IsOpen() const { return m_file.is_open(); }
+
+  void Write(const RecordedFrameState& state);
+  uint32_t GetFrameCount() const { return m_frame_count; }
+
+ private:
+  std::ofstream m_file;
+  RecordedFrameState m_previous_state = {};
+  uint32_t m_frame_count = 0;
+};
+
+// Plays a FrameRecorder file back one frame per call
+class FramePlayer {
+ public:
+  FramePlayer() {}
+  virtual ~FramePlayer() {}
+
+  bool Load(const std::string& path);
+  bool IsLoaded() const { return !m_frames.empty(); }
+
+  // False once every frame has been played
+  bool Read(RecordedFrameState* p_state);
+
+  uint32_t GetFrameIndex() const { return m_next_frame; }
+  uint32_t GetFrameCount() const { return uint32_t(m_frames.size()); }
+
+ private:
+  std::vector<RecordedFrameState> m_frames;
+  uint32_t m_next_frame = 0;
+};
+
+#endif  // __FRAME_RECORDING_H__
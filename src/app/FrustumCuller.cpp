@@ -0,0 +1,349 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "FrustumCuller.h"
+
+#include <cfloat>
+
+#if defined(__AVX__)
+#define FRUSTUM_CULLER_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FRUSTUM_CULLER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Plane coefficients, each broadcast across a batch. A box is outside when
+// its center is further than its projected extent behind any plane.
+struct FrustumPlanes {
+  float nx[FrustumCuller::kPlaneCount];
+  float ny[FrustumCuller::kPlaneCount];
+  float nz[FrustumCuller::kPlaneCount];
+  float d[FrustumCuller::kPlaneCount];
+  // Absolute normals, for projecting the box extent onto the plane
+  float abs_nx[FrustumCuller::kPlaneCount];
+  float abs_ny[FrustumCuller::kPlaneCount];
+  float abs_nz[FrustumCuller::kPlaneCount];
+};
+
+// Gribb/Hartmann plane extraction. vkex configures glm for [0, 1] depth, so
+// the near plane is the third row alone. The planes face inward and don't
+// need normalizing for a sign test.
+FrustumPlanes ExtractFrustumPlanes(const vkex::float4x4& view_projection) {
+  vkex::float4 rows[4];
+  for (int row = 0; row < 4; row++) {
+    rows[row] = vkex::float4(view_projection[0][row], view_projection[1][row],
+                             view_projection[2][row], view_projection[3][row]);
+  }
+
+  const vkex::float4 planes[FrustumCuller::kPlaneCount] = {
+      rows[3] + rows[0],  // left
+      rows[3] - rows[0],  // right
+      rows[3] + rows[1],  // bottom
+      rows[3] - rows[1],  // top
+      rows[2],            // near
+      rows[3] - rows[2],  // far
+  };
+
+  FrustumPlanes result = {};
+  for (int plane = 0; plane < FrustumCuller::kPlaneCount; plane++) {
+    result.nx[plane] = planes[plane].x;
+    result.ny[plane] = planes[plane].y;
+    result.nz[plane] = planes[plane].z;
+    result.d[plane] = planes[plane].w;
+    result.abs_nx[plane] = fabsf(planes[plane].x);
+    result.abs_ny[plane] = fabsf(planes[plane].y);
+    result.abs_nz[plane] = fabsf(planes[plane].z);
+  }
+  return result;
+}
+
+struct BoxArrays {
+  const float* p_center_x;
+  const float* p_center_y;
+  const float* p_center_z;
+  const float* p_extent_x;
+  const float* p_extent_y;
+  const float* p_extent_z;
+};
+
+// Writes a visibility byte per box and returns the number visible
+uint32_t StoreVisibility(uint32_t lane_mask, uint8_t* p_visible) {
+  for (uint32_t lane = 0; lane < FrustumCuller::kBatchSize; lane++) {
+    p_visible[lane] = uint8_t((lane_mask >> lane) & 1);
+  }
+
+  uint32_t visible_count = 0;
+  for (; lane_mask != 0; lane_mask &= (lane_mask - 1)) {
+    ++visible_count;
+  }
+  return visible_count;
+}
+
+#if defined(FRUSTUM_CULLER_AVX)
+
+uint32_t CullBatches(const FrustumPlanes& planes, const BoxArrays& boxes,
+                     size_t batch_count, uint8_t* p_visible) {
+  const __m256 zero = _mm256_setzero_ps();
+
+  uint32_t visible_count = 0;
+  for (size_t batch = 0; batch < batch_count; batch++) {
+    const size_t base = batch * FrustumCuller::kBatchSize;
+    const __m256 cx = _mm256_loadu_ps(boxes.p_center_x + base);
+    const __m256 cy = _mm256_loadu_ps(boxes.p_center_y + base);
+    const __m256 cz = _mm256_loadu_ps(boxes.p_center_z + base);
+    const __m256 ex = _mm256_loadu_ps(boxes.p_extent_x + base);
+    const __m256 ey = _mm256_loadu_ps(boxes.p_extent_y + base);
+    const __m256 ez = _mm256_loadu_ps(boxes.p_extent_z + base);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int plane = 0; plane < FrustumCuller::kPlaneCount; plane++) {
+      __m256 distance = _mm256_set1_ps(planes.d[plane]);
+      distance = _mm256_add_ps(
+          distance, _mm256_mul_ps(_mm256_set1_ps(planes.nx[plane]), cx));
+      distance = _mm256_add_ps(
+          distance, _mm256_mul_ps(_mm256_set1_ps(planes.ny[plane]), cy));
+      distance = _mm256_add_ps(
+          distance, _mm256_mul_ps(_mm256_set1_ps(planes.nz[plane]), cz));
+      distance = _mm256_add_ps(
+          distance, _mm256_mul_ps(_mm256_set1_ps(planes.abs_nx[plane]), ex));
+      distance = _mm256_add_ps(
+          distance, _mm256_mul_ps(_mm256_set1_ps(planes.abs_ny[plane]), ey));
+      distance = _mm256_add_ps(
+          distance, _mm256_mul_ps(_mm256_set1_ps(planes.abs_nz[plane]), ez));
+      inside =
+          _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+    }
+
+    visible_count += StoreVisibility(uint32_t(_mm256_movemask_ps(inside)),
+                                     p_visible + base);
+  }
+  return visible_count;
+}
+
+#elif defined(FRUSTUM_CULLER_SSE)
+
+__m128 TestHalfBatch(const FrustumPlanes& planes, const BoxArrays& boxes,
+                     size_t base) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 cx = _mm_loadu_ps(boxes.p_center_x + base);
+  const __m128 cy = _mm_loadu_ps(boxes.p_center_y + base);
+  const __m128 cz = _mm_loadu_ps(boxes.p_center_z + base);
+  const __m128 ex = _mm_loadu_ps(boxes.p_extent_x + base);
+  const __m128 ey = _mm_loadu_ps(boxes.p_extent_y + base);
+  const __m128 ez = _mm_loadu_ps(boxes.p_extent_z + base);
+
+  __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+  for (int plane = 0; plane < FrustumCuller::kPlaneCount; plane++) {
+    __m128 distance = _mm_set1_ps(planes.d[plane]);
+    distance =
+        _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.nx[plane]), cx));
+    distance =
+        _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.ny[plane]), cy));
+    distance =
+        _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.nz[plane]), cz));
+    distance = _mm_add_ps(distance,
+                          _mm_mul_ps(_mm_set1_ps(planes.abs_nx[plane]), ex));
+    distance = _mm_add_ps(distance,
+                          _mm_mul_ps(_mm_set1_ps(planes.abs_ny[plane]), ey));
+    distance = _mm_add_ps(distance,
+                          _mm_mul_ps(_mm_set1_ps(planes.abs_nz[plane]), ez));
+    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+  }
+  return inside;
+}
+
+uint32_t CullBatches(const FrustumPlanes& planes, const BoxArrays& boxes,
+                     size_t batch_count, uint8_t* p_visible) {
+  uint32_t visible_count = 0;
+  for (size_t batch = 0; batch < batch_count; batch++) {
+    const size_t base = batch * FrustumCuller::kBatchSize;
+    const uint32_t low_mask =
+        uint32_t(_mm_movemask_ps(TestHalfBatch(planes, boxes, base)));
+    const uint32_t high_mask =
+        uint32_t(_mm_movemask_ps(TestHalfBatch(planes, boxes, base + 4)));
+    visible_count +=
+        StoreVisibility(low_mask | (high_mask << 4), p_visible + base);
+  }
+  return visible_count;
+}
+
+#else
+
+uint32_t CullBatches(const FrustumPlanes& planes, const BoxArrays& boxes,
+                     size_t batch_count, uint8_t* p_visible) {
+  uint32_t visible_count = 0;
+  for (size_t batch = 0; batch < batch_count; batch++) {
+    const size_t base = batch * FrustumCuller::kBatchSize;
+    uint32_t lane_mask = 0;
+    for (uint32_t lane = 0; lane < FrustumCuller::kBatchSize; lane++) {
+      const size_t box = base + lane;
+      bool inside = true;
+      for (int plane = 0; plane < FrustumCuller::kPlaneCount; plane++) {
+        const float distance = planes.d[plane] +
+                               planes.nx[plane] * boxes.p_center_x[box] +
+                               planes.ny[plane] * boxes.p_center_y[box] +
+                               planes.nz[plane] * boxes.p_center_z[box] +
+                               planes.abs_nx[plane] * boxes.p_extent_x[box] +
+                               planes.abs_ny[plane] * boxes.p_extent_y[box] +
+                               planes.abs_nz[plane] * boxes.p_extent_z[box];
+        inside = inside && (distance >= 0.0f);
+      }
+      lane_mask |= (inside ? 1u : 0u) << lane;
+    }
+    visible_count += StoreVisibility(lane_mask, p_visible + base);
+  }
+  return visible_count;
+}
+
+#endif
+
+}  // namespace
+
+const char* FrustumCuller::GetKernelName() {
+#if defined(FRUSTUM_CULLER_AVX)
+  return "AVX";
+#elif defined(FRUSTUM_CULLER_SSE)
+  return "SSE";
+#else
+  return "Scalar";
+#endif
+}
+
+void FrustumCuller::Reserve(size_t box_count) {
+  const size_t padded_count =
+      ((box_count + kBatchSize - 1) / kBatchSize) * kBatchSize;
+  m_center_x.reserve(padded_count);
+  m_center_y.reserve(padded_count);
+  m_center_z.reserve(padded_count);
+  m_extent_x.reserve(padded_count);
+  m_extent_y.reserve(padded_count);
+  m_extent_z.reserve(padded_count);
+  m_visible.reserve(padded_count);
+}
+
+void FrustumCuller::Clear() {
+  m_cull_timer.Start();
+
+  m_center_x.clear();
+  m_center_y.clear();
+  m_center_z.clear();
+  m_extent_x.clear();
+  m_extent_y.clear();
+  m_extent_z.clear();
+  m_box_count = 0;
+}
+
+void FrustumCuller::AddWorldBox(const vkex::float3& center,
+                                const vkex::float3& extent) {
+  m_center_x.push_back(center.x);
+  m_center_y.push_back(center.y);
+  m_center_z.push_back(center.z);
+  m_extent_x.push_back(extent.x);
+  m_extent_y.push_back(extent.y);
+  m_extent_z.push_back(extent.z);
+  ++m_box_count;
+}
+
+void FrustumCuller::AddBox(const vkex::float3& bounds_min,
+                           const vkex::float3& bounds_max,
+                           const vkex::float4x4& world_matrix) {
+  const vkex::float3 center = (bounds_min + bounds_max) * 0.5f;
+  const vkex::float3 extent = (bounds_max - bounds_min) * 0.5f;
+
+  // The world space box around the transformed box (Arvo): the extent is
+  // projected onto each axis through the absolute linear part.
+  const vkex::float3 world_center =
+      vkex::float3(world_matrix * vkex::float4(center, 1.0f));
+  vkex::float3 world_extent;
+  for (int axis = 0; axis < 3; axis++) {
+    world_extent[axis] = fabsf(world_matrix[0][axis]) * extent.x +
+                         fabsf(world_matrix[1][axis]) * extent.y +
+                         fabsf(world_matrix[2][axis]) * extent.z;
+  }
+
+  AddWorldBox(world_center, world_extent);
+}
+
+void FrustumCuller::AddModel(const GLTFModel& model) {
+  const auto& scene = model.GetFlattenedScene();
+
+  const size_t instance_count = scene.mesh_indices.size();
+  for (size_t instance = 0; instance < instance_count; instance++) {
+    const int32_t mesh_index = scene.mesh_indices[instance];
+    if (mesh_index < 0) {
+      continue;
+    }
+
+    const auto& world_matrix =
+        scene.transforms.GetWorldMatrix(uint32_t(instance));
+    for (const auto& primitive :
+         model.GetMesh(uint32_t(mesh_index)).primitives) {
+      if (primitive.has_bounds) {
+        AddBox(primitive.bounds_min, primitive.bounds_max, world_matrix);
+      } else {
+        // Large enough to reach inside every plane
+        AddWorldBox(vkex::float3(0.0f), vkex::float3(FLT_MAX));
+      }
+    }
+  }
+}
+
+void FrustumCuller::Cull(const vkex::Camera& camera) {
+  // Pad out the last batch. The padding boxes' results are never read.
+  const size_t padded_count =
+      ((m_box_count + kBatchSize - 1) / kBatchSize) * kBatchSize;
+  m_center_x.resize(padded_count, 0.0f);
+  m_center_y.resize(padded_count, 0.0f);
+  m_center_z.resize(padded_count, 0.0f);
+  m_extent_x.resize(padded_count, 0.0f);
+  m_extent_y.resize(padded_count, 0.0f);
+  m_extent_z.resize(padded_count, 0.0f);
+  m_visible.resize(padded_count);
+
+  vkex::Timer kernel_timer;
+  kernel_timer.Start();
+
+  // vkex::Camera doesn't keep its view projection matrix up to date
+  const FrustumPlanes planes = ExtractFrustumPlanes(
+      camera.GetProjectionMatrix() * camera.GetViewMatrix());
+
+  const BoxArrays boxes = {m_center_x.data(), m_center_y.data(),
+                           m_center_z.data(), m_extent_x.data(),
+                           m_extent_y.data(), m_extent_z.data()};
+  uint32_t visible_count = CullBatches(planes, boxes, padded_count / kBatchSize,
+                                       m_visible.data());
+
+  kernel_timer.Stop();
+  m_cull_timer.Stop();
+
+  // Padding boxes sit at the origin and may have passed
+  for (size_t box = m_box_count; box < padded_count; box++) {
+    visible_count -= m_visible[box];
+  }
+
+  m_statistics.tested_count = uint32_t(m_box_count);
+  m_statistics.visible_count = visible_count;
+  m_statistics.cull_time_ms = m_cull_timer.Millis();
+  m_statistics.kernel_time_ms = kernel_timer.Millis();
+}
+
+void FrustumCuller::GetStatistics(FrustumCullStatistics* p_statistics) const {
+  *p_statistics = m_statistics;
+}
@@ -0,0 +1,88 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __FRUSTUM_CULLER_H__
+#define __FRUSTUM_CULLER_H__
+
+#include "GLTFModel.h"
+
+struct FrustumCullStatistics {
+  uint32_t tested_count;
+  uint32_t visible_count;
+  // Clear() to the end of Cull(): building the world space boxes plus the
+  // frustum test
+  double cull_time_ms;
+  // Frustum test alone
+  double kernel_time_ms;
+};
+
+// Culls world space bounding boxes against a camera frustum. Boxes are kept
+// in structure of arrays form, padded to whole batches of kBatchSize, so the
+// frustum test runs over eight boxes at a time with AVX (or two halves with
+// SSE) and never needs a scalar tail.
+//
+// The kernel is picked at compile time from the target's instruction set.
+// Builds without AVX enabled use the SSE kernel.
+class FrustumCuller {
+ public:
+  FrustumCuller() {}
+  virtual ~FrustumCuller() {}
+
+  enum FrustumCullerConstants {
+    kBatchSize = 8,
+    kPlaneCount = 6,
+  };
+
+  void Reserve(size_t box_count);
+  void Clear();
+
+  // Appends the world space bounds of an object space box
+  void AddBox(const vkex::float3& bounds_min, const vkex::float3& bounds_max,
+              const vkex::float4x4& world_matrix);
+  // Appends a box for every primitive of every mesh instance in the model's
+  // flattened scene, in the order DrawList::AddModel visits them.
+  // Primitives without bounds are always visible.
+  void AddModel(const GLTFModel& model);
+
+  void Cull(const vkex::Camera& camera);
+
+  // Per box visibility from the last Cull(), one byte per box
+  const uint8_t* GetVisibility() const { return m_visible.data(); }
+  bool IsVisible(size_t box_index) const { return m_visible[box_index] != 0; }
+  size_t GetBoxCount() const { return m_box_count; }
+
+  void GetStatistics(FrustumCullStatistics* p_statistics) const;
+  static const char* GetKernelName();
+
+ private:
+  void AddWorldBox(const vkex::float3& center, const vkex::float3& extent);
+
+ private:
+  std::vector<float> m_center_x;
+  std::vector<float> m_center_y;
+  std::vector<float> m_center_z;
+  std::vector<float> m_extent_x;
+  std::vector<float> m_extent_y;
+  std::vector<float> m_extent_z;
+  std::vector<uint8_t> m_visible;
+  size_t m_box_count = 0;
+
+  vkex::Timer m_cull_timer;
+
+  FrustumCullStatistics m_statistics = {};
+};
+
+#endif  // __FRUSTUM_CULLER_H__
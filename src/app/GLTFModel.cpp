@@ -23,27 +23,13 @@
 #include "GLTFModel.h"
 
 #include "AssetUtil.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 // TODO: There's going to be a lot of work to populate a more fully-features
 // GLTF loader
 //       But we'll build it out as needed :p
 
-VkIndexType GetIndexTypeFromAccessor(const tinygltf::Accessor& accessor) {
-  VkIndexType indexType = VkIndexType::VK_INDEX_TYPE_MAX_ENUM;
-
-  auto index_byte_count =
-      tinygltf::GetComponentSizeInBytes(accessor.componentType);
-  if (index_byte_count == 2) {
-    indexType = VK_INDEX_TYPE_UINT16;
-  } else if (index_byte_count == 4) {
-    indexType = VK_INDEX_TYPE_UINT32;
-  } else {
-    VKEX_ASSERT(!"Unknown index type");
-  }
-
-  return indexType;
-}
-
 VkFormat GetBufferFormatFromAccessor(const tinygltf::Accessor& accessor) {
   VkFormat bufferFormat = VK_FORMAT_UNDEFINED;
 
@@ -230,35 +216,421 @@ vkex::Sampler BuildVkexSamplerFromGLTFSampler(
   return sampler;
 }
 
+GLTFModel::BufferType GetBufferTypeFromAttributeName(const std::string& name) {
+  GLTFModel::BufferType bufferType = GLTFModel::BufferType::BufferTypeCount;
+  if (name.compare("POSITION") == 0) {
+    bufferType = GLTFModel::BufferType::Position;
+  } else if (name.compare("NORMAL") == 0) {
+    bufferType = GLTFModel::BufferType::Normal;
+  } else if (name.compare("TEXCOORD_0") == 0) {
+    bufferType = GLTFModel::BufferType::TexCoord0;
+  }
+  return bufferType;
+}
+
+size_t GetElementSizeFromAccessor(const tinygltf::Accessor& accessor) {
+  return size_t(tinygltf::GetComponentSizeInBytes(accessor.componentType) *
+                tinygltf::GetNumComponentsInType(accessor.type));
+}
+
+// Resolves the accessor's first element in 'buffer_data', which holds each
+// buffer's bytes by buffer index. The accessor's last element must lie inside
+// its bufferView and the bufferView inside its buffer, so only the metadata
+// and the buffer sizes are needed to validate it.
+const uint8_t* GetAccessorData(
+    const tinygltf::Model& model,
+    const GLTFModel::BufferDataList& buffer_data,
+    const tinygltf::Accessor& accessor, size_t element_size,
+    size_t* p_stride) {
+  if ((accessor.bufferView < 0) ||
+      (size_t(accessor.bufferView) >= model.bufferViews.size()) ||
+      (accessor.count == 0)) {
+    return nullptr;
+  }
+
+  const auto& bufferView = model.bufferViews[accessor.bufferView];
+  if ((bufferView.buffer < 0) ||
+      (size_t(bufferView.buffer) >= buffer_data.size())) {
+    return nullptr;
+  }
+
+  const auto& buffer = buffer_data[bufferView.buffer];
+  if ((bufferView.byteOffset > buffer.size()) ||
+      (bufferView.byteLength > (buffer.size() - bufferView.byteOffset))) {
+    return nullptr;
+  }
+
+  // A zero byteStride means tightly packed
+  *p_stride = (bufferView.byteStride != 0) ? size_t(bufferView.byteStride)
+                                           : element_size;
+  const size_t accessor_end = accessor.byteOffset +
+                              ((accessor.count - 1) * (*p_stride)) +
+                              element_size;
+  if (accessor_end > bufferView.byteLength) {
+    return nullptr;
+  }
+
+  return buffer.data() + bufferView.byteOffset + accessor.byteOffset;
+}
+
+// Copies the accessor's elements tightly packed into 'p_dst'. Accessors
+// without a bufferView are all zeros, which the destination already is.
+void CopyAccessorData(const tinygltf::Model& model,
+                      const GLTFModel::BufferDataList& buffer_data,
+                      const tinygltf::Accessor& accessor, size_t element_size,
+                      uint8_t* p_dst) {
+  if (accessor.bufferView < 0) {
+    return;
+  }
+
+  size_t stride = 0;
+  const uint8_t* p_src =
+      GetAccessorData(model, buffer_data, accessor, element_size, &stride);
+  if (p_src == nullptr) {
+    VKEX_LOG_WARN("Skipping out of bounds accessor on bufferView "
+                  << accessor.bufferView);
+    return;
+  }
+
+  if (stride == element_size) {
+    std::memcpy(p_dst, p_src, element_size * accessor.count);
+    return;
+  }
+
+  for (size_t element = 0; element < accessor.count; element++) {
+    std::memcpy(p_dst + (element * element_size), p_src + (element * stride),
+                element_size);
+  }
+}
+
+// Copies indices of any glTF index type into a uint16 or uint32 stream
+void CopyIndexData(const tinygltf::Model& model,
+                   const GLTFModel::BufferDataList& buffer_data,
+                   const tinygltf::Accessor& accessor, VkIndexType index_type,
+                   uint8_t* p_dst) {
+  if (accessor.bufferView < 0) {
+    return;
+  }
+
+  const size_t src_size =
+      size_t(tinygltf::GetComponentSizeInBytes(accessor.componentType));
+  const size_t dst_size = (index_type == VK_INDEX_TYPE_UINT16) ? 2 : 4;
+
+  size_t stride = 0;
+  const uint8_t* p_src =
+      GetAccessorData(model, buffer_data, accessor, src_size, &stride);
+  if (p_src == nullptr) {
+    VKEX_LOG_WARN("Skipping out of bounds indices on bufferView "
+                  << accessor.bufferView);
+    return;
+  }
+
+  if ((src_size == dst_size) && (stride == src_size)) {
+    std::memcpy(p_dst, p_src, dst_size * accessor.count);
+    return;
+  }
+
+  for (size_t element = 0; element < accessor.count; element++) {
+    const uint8_t* p_index = p_src + (element * stride);
+    uint32_t index = 0;
+    switch (src_size) {
+      case 1:
+        index = *p_index;
+        break;
+      case 2:
+        index = *reinterpret_cast<const uint16_t*>(p_index);
+        break;
+      default:
+        index = *reinterpret_cast<const uint32_t*>(p_index);
+        break;
+    }
+
+    if (dst_size == 2) {
+      reinterpret_cast<uint16_t*>(p_dst)[element] = uint16_t(index);
+    } else {
+      reinterpret_cast<uint32_t*>(p_dst)[element] = index;
+    }
+  }
+}
+
+// Simplifies the primitive into up to 'lod_count' - 1 more levels, each
+// aiming for half the triangles of the one before. Their indices are
+// appended to 'p_lod_indices' back to back and their ranges to the
+// primitive's LODs, with first indices relative to 'p_lod_indices'.
+void GenerateLods(const tinygltf::Model& model,
+                  const GLTFModel::BufferDataList& buffer_data,
+                  uint32_t lod_count, GLTFModel::Primitive* p_primitive,
+                  std::vector<uint32_t>* p_lod_indices) {
+  // Beyond this, relative to the primitive's size, a level is no longer a
+  // stand in for the original
+  const float kMaxRelativeError = 0.1f;
+
+  const size_t vertex_count = p_primitive->vertex_count;
+  std::vector<uint32_t> indices(p_primitive->index_count, 0);
+  CopyIndexData(model, buffer_data,
+                model.accessors[p_primitive->indexBufferAccessorIndex],
+                VK_INDEX_TYPE_UINT32,
+                reinterpret_cast<uint8_t*>(indices.data()));
+  if (((indices.size() % 3) != 0) || (vertex_count == 0)) {
+    return;
+  }
+  for (uint32_t index : indices) {
+    if (index >= vertex_count) {
+      return;
+    }
+  }
+
+  // Attributes that aren't float can't be compared, and are left out
+  const VkFormat float_formats[GLTFModel::BufferType::BufferTypeCount] = {
+      VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT,
+      VK_FORMAT_R32G32_SFLOAT};
+  const size_t float_counts[GLTFModel::BufferType::BufferTypeCount] = {
+      3, 3, 2};
+  std::vector<float> streams[GLTFModel::BufferType::BufferTypeCount];
+  for (const auto& attribute : p_primitive->attributes) {
+    GLTFModel::BufferType bufferType =
+        GetBufferTypeFromAttributeName(attribute.name);
+    if (bufferType == GLTFModel::BufferType::BufferTypeCount) {
+      continue;
+    }
+
+    const auto& accessor = model.accessors[attribute.accessorIndex];
+    if ((GetBufferFormatFromAccessor(accessor) != float_formats[bufferType]) ||
+        (accessor.count != vertex_count)) {
+      continue;
+    }
+    streams[bufferType].resize(float_counts[bufferType] * vertex_count, 0.0f);
+    CopyAccessorData(model, buffer_data, accessor,
+                     float_counts[bufferType] * sizeof(float),
+                     reinterpret_cast<uint8_t*>(streams[bufferType].data()));
+  }
+  if (streams[GLTFModel::BufferType::Position].empty()) {
+    return;
+  }
+
+  mesh_simplifier::SimplifyInput input = {};
+  input.p_indices = indices.data();
+  input.index_count = indices.size();
+  input.p_positions = streams[GLTFModel::BufferType::Position].data();
+  if (!streams[GLTFModel::BufferType::Normal].empty()) {
+    input.p_normals = streams[GLTFModel::BufferType::Normal].data();
+  }
+  if (!streams[GLTFModel::BufferType::TexCoord0].empty()) {
+    input.p_texcoords = streams[GLTFModel::BufferType::TexCoord0].data();
+  }
+  input.vertex_count = vertex_count;
+  const float position_scale =
+      mesh_simplifier::GetPositionScale(input.p_positions, vertex_count);
+
+  // Every level starts over from full detail, so errors don't compound
+  std::vector<uint32_t> simplified(indices.size());
+  size_t previous_count = indices.size();
+  for (uint32_t level = 1; level < lod_count; level++) {
+    const size_t target_count = ((indices.size() >> level) / 3) * 3;
+    float relative_error = 0.0f;
+    const size_t count =
+        mesh_simplifier::Simplify(input, target_count, kMaxRelativeError,
+                                  simplified.data(), &relative_error);
+    // Levels that barely simplify aren't worth their indices
+    if ((count == 0) || ((count * 4) > (previous_count * 3))) {
+      break;
+    }
+
+    GLTFModel::Lod lod = {};
+    lod.first_index = uint32_t(p_lod_indices->size());
+    lod.index_count = uint32_t(count);
+    lod.error = relative_error * position_scale;
+    p_primitive->lods.push_back(lod);
+    p_lod_indices->insert(p_lod_indices->end(), simplified.begin(),
+                          simplified.begin() + count);
+    previous_count = count;
+  }
+}
+
+// Validates the GLB container (glTF 2.0 spec, "Binary glTF Layout"): a 12
+// byte header followed by a JSON chunk and an optional BIN chunk, each chunk
+// preceded by its length and type. Returns the BIN chunk in 'p_bin_chunk'.
+bool ParseGLBContainer(const uint8_t* p_data, size_t size,
+                       vkex::Span<const uint8_t>* p_bin_chunk) {
+  const uint32_t kGLBMagic = 0x46546C67;       // "glTF"
+  const uint32_t kGLBChunkJSON = 0x4E4F534A;  // "JSON"
+  const uint32_t kGLBChunkBIN = 0x004E4942;   // "BIN\0"
+  const size_t kHeaderSize = 12;
+  const size_t kChunkHeaderSize = 8;
+
+  *p_bin_chunk = vkex::Span<const uint8_t>();
+  if (size < (kHeaderSize + kChunkHeaderSize)) {
+    VKEX_LOG_ERROR("GLB file is too small: " << size << " bytes");
+    return false;
+  }
+
+  uint32_t header[3] = {};
+  std::memcpy(header, p_data, kHeaderSize);
+  if ((header[0] != kGLBMagic) || (header[1] != 2) || (header[2] > size)) {
+    VKEX_LOG_ERROR("Invalid GLB header (version " << header[1] << ", length "
+                                                  << header[2] << ")");
+    return false;
+  }
+
+  const size_t length = header[2];
+  size_t offset = kHeaderSize;
+  bool has_json = false;
+  while ((offset + kChunkHeaderSize) <= length) {
+    uint32_t chunk_header[2] = {};
+    std::memcpy(chunk_header, p_data + offset, kChunkHeaderSize);
+    offset += kChunkHeaderSize;
+
+    const size_t chunk_length = chunk_header[0];
+    if (chunk_length > (length - offset)) {
+      VKEX_LOG_ERROR("GLB chunk overruns the file");
+      return false;
+    }
+
+    // JSON must come first, only the first BIN chunk is addressable
+    if (offset == (kHeaderSize + kChunkHeaderSize)) {
+      has_json = (chunk_header[1] == kGLBChunkJSON);
+    } else if ((chunk_header[1] == kGLBChunkBIN) && p_bin_chunk->empty()) {
+      *p_bin_chunk = vkex::Span<const uint8_t>(p_data + offset, chunk_length);
+    }
+    offset += chunk_length;
+  }
+
+  if (!has_json) {
+    VKEX_LOG_ERROR("GLB file does not start with a JSON chunk");
+  }
+  return has_json;
+}
+
+// Peak resident set size of the process, 0 where it isn't available
+uint64_t GetPeakResidentBytes() {
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoull(line.substr(6)) * 1024;
+    }
+  }
+#endif
+  return 0;
+}
+
+// glTF matrices are column major like ours. Nodes carry either a matrix or
+// translation/rotation/scale, which compose as T * R * S.
+vkex::float4x4 GetLocalMatrixFromNode(const tinygltf::Node& node) {
+  vkex::float4x4 local_matrix(1.0f);
+  if (node.matrix.size() == 16) {
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        local_matrix[column][row] = float(node.matrix[(column * 4) + row]);
+      }
+    }
+    return local_matrix;
+  }
+
+  if (node.translation.size() == 3) {
+    local_matrix = glm::translate(vkex::float3(float(node.translation[0]),
+                                               float(node.translation[1]),
+                                               float(node.translation[2])));
+  }
+  if (node.rotation.size() == 4) {
+    // glTF stores x, y, z, w; glm::quat takes w first
+    vkex::quat rotation(float(node.rotation[3]), float(node.rotation[0]),
+                        float(node.rotation[1]), float(node.rotation[2]));
+    local_matrix = local_matrix * glm::toMat4(rotation);
+  }
+  if (node.scale.size() == 3) {
+    local_matrix = local_matrix * glm::scale(vkex::float3(float(node.scale[0]),
+                                                          float(node.scale[1]),
+                                                          float(node.scale[2])));
+  }
+  return local_matrix;
+}
+
+GLTFModel::AlphaMode GetAlphaModeFromMaterial(
+    const tinygltf::Material& material) {
+  GLTFModel::AlphaMode alphaMode = GLTFModel::AlphaMode::Opaque;
+  if (material.alphaMode.compare("MASK") == 0) {
+    alphaMode = GLTFModel::AlphaMode::Mask;
+  } else if (material.alphaMode.compare("BLEND") == 0) {
+    alphaMode = GLTFModel::AlphaMode::Blend;
+  }
+  return alphaMode;
+}
+
 void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
                                   vkex::Queue queue) {
+  vkex::Timer load_timer;
+  load_timer.Start();
+  vkex::Timer parse_timer;
+  parse_timer.Start();
+  const uint64_t peak_resident_bytes = GetPeakResidentBytes();
+
+  m_load_statistics = {};
+  m_load_statistics.binary = (model_path.extension().str() == ".glb");
+
   tinygltf::Model model;
+  // .glb files stay mapped until the geometry has been uploaded from them
+  vkex::fs::mapped_file glb_file;
+  BufferDataList buffer_data;
   {
     tinygltf::TinyGLTF loader;
     std::string err;
     std::string warn;
 
-    bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, model_path.str());
-  }
-
-  // TODO: accessors could be sparse, gotta check for it
-
-  m_buffers.resize(model.bufferViews.size());
-
-  // Populate VkBuffers based on bufferViews
-  for (size_t bufferViewIndex = 0; bufferViewIndex < model.bufferViews.size();
-       bufferViewIndex++) {
-    const auto& bufferView = model.bufferViews[bufferViewIndex];
-    const auto& buffer = model.buffers[bufferView.buffer];
+    bool ret = false;
+    vkex::Span<const uint8_t> bin_chunk;
+    if (m_load_statistics.binary) {
+      ret = glb_file.open(model_path) &&
+            ParseGLBContainer(glb_file.data(), glb_file.size(), &bin_chunk);
+      if (ret) {
+        m_load_statistics.mapped = glb_file.is_mapped();
+        m_load_statistics.file_bytes = glb_file.size();
+        ret = loader.LoadBinaryFromMemory(
+            &model, &err, &warn, glb_file.data(),
+            static_cast<unsigned int>(glb_file.size()),
+            model_path.parent().str());
+      }
+    } else {
+      ret = loader.LoadASCIIFromFile(&model, &err, &warn, model_path.str());
+    }
 
-    VKEX_LOG_INFO("Buffer View " << bufferViewIndex);
-    VKEX_LOG_INFO("  Size in bytes: " << bufferView.byteLength);
-    VKEX_LOG_INFO("  Offset in bytes: " << bufferView.byteOffset);
+    if (!warn.empty()) {
+      VKEX_LOG_WARN(warn);
+    }
+    if (!err.empty()) {
+      VKEX_LOG_ERROR(err);
+    }
+    VKEX_ASSERT_MSG(ret, "Failed to load glTF model");
+    if (!ret) {
+      VKEX_LOG_ERROR("Failed to load " << model_path.str());
+      return;
+    }
 
-    VKEX_CALL(asset_util::CreateGeometryBuffer(
-        bufferView.byteLength, (&buffer.data.at(0) + bufferView.byteOffset),
-        queue, asset_util::MEMORY_USAGE_GPU_ONLY, &m_buffers[bufferViewIndex]));
+    // tinygltf copies the BIN chunk into buffers[0] to decode embedded
+    // images, which is done by now. Geometry is read from the mapping
+    // instead, so that copy can go before anything else is allocated.
+    buffer_data.resize(model.buffers.size());
+    for (size_t bufferIndex = 0; bufferIndex < model.buffers.size();
+         bufferIndex++) {
+      auto& buffer = model.buffers[bufferIndex];
+      if (m_load_statistics.binary && (bufferIndex == 0) &&
+          buffer.uri.empty()) {
+        buffer_data[bufferIndex] = bin_chunk;
+        std::vector<unsigned char>().swap(buffer.data);
+      } else {
+        buffer_data[bufferIndex] =
+            vkex::Span<const uint8_t>(buffer.data.data(), buffer.data.size());
+        if (!m_load_statistics.binary) {
+          m_load_statistics.file_bytes += buffer.data.size();
+        }
+      }
+    }
   }
+  parse_timer.Stop();
+  m_load_statistics.parse_time_ms = parse_timer.Millis();
+
+  // TODO: accessors could be sparse, gotta check for it
 
   // Mirror glTF file data into local structs
   {
@@ -281,7 +653,13 @@ void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
     m_nodes.resize(nodeCount);
 
     for (size_t nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
-      m_nodes[nodeIndex].meshIndex = model.nodes[nodeIndex].mesh;
+      const auto& sourceNode = model.nodes[nodeIndex];
+      auto& destNode = m_nodes[nodeIndex];
+
+      destNode.meshIndex = sourceNode.mesh;
+      destNode.children.assign(sourceNode.children.begin(),
+                               sourceNode.children.end());
+      destNode.localMatrix = GetLocalMatrixFromNode(sourceNode);
     }
   }
   {
@@ -331,14 +709,10 @@ void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
               model.accessors[destPrimitive.indexBufferAccessorIndex];
           VKEX_ASSERT(index_accessor.count > 0);
 
-          destPrimitive.index_buffer = m_buffers[index_accessor.bufferView];
           destPrimitive.index_count = uint32_t(index_accessor.count);
-
-          destPrimitive.index_type = GetIndexTypeFromAccessor(index_accessor);
         }
 
         {
-          destPrimitive.vertex_buffers.resize(BufferType::BufferTypeCount);
           destPrimitive.vertex_binding_descriptions.resize(
               BufferType::BufferTypeCount);
           destPrimitive.vertex_buffer_formats.resize(
@@ -351,17 +725,34 @@ void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
             VkFormat buffer_format =
                 GetBufferFormatFromAccessor(buffer_accessor);
 
-            BufferType bufferTypeIndex = BufferType::BufferTypeCount;
-            if (attribute.name.compare("POSITION") == 0) {
-              bufferTypeIndex = BufferType::Position;
-            } else if (attribute.name.compare("NORMAL") == 0) {
-              bufferTypeIndex = BufferType::Normal;
-            } else if (attribute.name.compare("TEXCOORD_0") == 0) {
-              bufferTypeIndex = BufferType::TexCoord0;
+            BufferType bufferTypeIndex =
+                GetBufferTypeFromAttributeName(attribute.name);
+            if (bufferTypeIndex == BufferType::BufferTypeCount) {
+              continue;
             }
 
-            destPrimitive.vertex_buffers[bufferTypeIndex] =
-                m_buffers[buffer_accessor.bufferView];
+            if (bufferTypeIndex == BufferType::Position) {
+              destPrimitive.vertex_count = uint32_t(buffer_accessor.count);
+
+              // glTF requires min/max on POSITION accessors
+              if ((buffer_accessor.minValues.size() >= 3) &&
+                  (buffer_accessor.maxValues.size() >= 3)) {
+                destPrimitive.bounds_min =
+                    vkex::float3(float(buffer_accessor.minValues[0]),
+                                 float(buffer_accessor.minValues[1]),
+                                 float(buffer_accessor.minValues[2]));
+                destPrimitive.bounds_max =
+                    vkex::float3(float(buffer_accessor.maxValues[0]),
+                                 float(buffer_accessor.maxValues[1]),
+                                 float(buffer_accessor.maxValues[2]));
+                destPrimitive.has_bounds = true;
+              } else {
+                VKEX_LOG_WARN("POSITION accessor " << attribute.accessorIndex
+                                                   << " has no min/max, the "
+                                                      "primitive won't be "
+                                                      "culled");
+              }
+            }
 
             vkex::VertexBindingDescription desc(bufferTypeIndex,
                                                 VK_VERTEX_INPUT_RATE_VERTEX);
@@ -376,6 +767,11 @@ void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
     }
   }
 
+  BuildGeometryBuffer(model, buffer_data, queue);
+  glb_file.close();
+
+  FlattenScene(model);
+
   {
     size_t samplerCount = model.samplers.size();
     m_samplers.resize(samplerCount);
@@ -396,6 +792,10 @@ void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
     for (size_t matIndex = 0; matIndex < matCount; matIndex++) {
       auto& source_material = model.materials[matIndex];
 
+      m_materials[matIndex].alphaMode =
+          GetAlphaModeFromMaterial(source_material);
+      m_materials[matIndex].doubleSided = source_material.doubleSided;
+
       VKEX_ASSERT(source_material.pbrMetallicRoughness.baseColorTexture.index >=
                   0);
       m_materials[matIndex].textureIndices[MaterialTextureType::BaseColor] =
@@ -476,6 +876,496 @@ void GLTFModel::PopulateFromModel(vkex::fs::path model_path,
                                 &(m_images[imageIndex].gpuTexture));
     }
   }
+
+  load_timer.Stop();
+  m_load_statistics.total_time_ms = load_timer.Millis();
+  m_load_statistics.peak_resident_growth_bytes =
+      GetPeakResidentBytes() - peak_resident_bytes;
+
+  VKEX_LOG_INFO("Loaded " << model_path.str() << " ("
+                          << (m_load_statistics.binary ? "glb" : "gltf")
+                          << (m_load_statistics.mapped ? ", mapped" : "")
+                          << ") in " << m_load_statistics.total_time_ms
+                          << " ms, parse "
+                          << m_load_statistics.parse_time_ms << " ms");
+  VKEX_LOG_INFO("  " << (m_load_statistics.file_bytes / 1024)
+                     << " KiB buffer data, peak RSS grew by "
+                     << (m_load_statistics.peak_resident_growth_bytes >> 20)
+                     << " MiB");
+}
+
+void GLTFModel::BuildGeometryBuffer(const tinygltf::Model& model,
+                                    const BufferDataList& buffer_data,
+                                    vkex::Queue queue) {
+  vkex::Timer timer;
+  timer.Start();
+
+  // Each attribute becomes one stream shared by all primitives, so a
+  // primitive's vertices are addressed by vertex offset alone. Streams with
+  // no data in the model still get a default element size and are zeroed.
+  size_t element_sizes[BufferType::BufferTypeCount] = {0, 0, 0};
+  const size_t default_element_sizes[BufferType::BufferTypeCount] = {
+      3 * sizeof(float), 3 * sizeof(float), 2 * sizeof(float)};
+
+  uint32_t total_vertex_count = 0;
+  uint32_t total_index_count = 0;
+  uint32_t primitive_count = 0;
+  m_index_type = VK_INDEX_TYPE_UINT16;
+
+  for (auto& mesh : m_meshes) {
+    for (auto& primitive : mesh.primitives) {
+      primitive.vertex_offset = int32_t(total_vertex_count);
+      primitive.first_index = total_index_count;
+      total_vertex_count += primitive.vertex_count;
+      total_index_count += primitive.index_count;
+      primitive_count++;
+
+      // uint8 and uint16 indices share a uint16 stream, any uint32 primitive
+      // widens the whole model
+      const auto& index_accessor =
+          model.accessors[primitive.indexBufferAccessorIndex];
+      if (tinygltf::GetComponentSizeInBytes(index_accessor.componentType) ==
+          4) {
+        m_index_type = VK_INDEX_TYPE_UINT32;
+      }
+
+      for (const auto& attribute : primitive.attributes) {
+        BufferType bufferType = GetBufferTypeFromAttributeName(attribute.name);
+        if (bufferType == BufferType::BufferTypeCount) {
+          continue;
+        }
+
+        const auto& accessor = model.accessors[attribute.accessorIndex];
+        size_t element_size = GetElementSizeFromAccessor(accessor);
+        VKEX_ASSERT_MSG((element_sizes[bufferType] == 0) ||
+                            (element_sizes[bufferType] == element_size),
+                        "Mixed vertex formats within one attribute stream");
+        element_sizes[bufferType] = element_size;
+        m_stream_formats[bufferType] = GetBufferFormatFromAccessor(accessor);
+      }
+    }
+  }
+
+  const VkFormat default_formats[BufferType::BufferTypeCount] = {
+      VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT,
+      VK_FORMAT_R32G32_SFLOAT};
+  for (uint32_t stream = 0; stream < BufferType::BufferTypeCount; stream++) {
+    if (element_sizes[stream] == 0) {
+      element_sizes[stream] = default_element_sizes[stream];
+      m_stream_formats[stream] = default_formats[stream];
+    }
+  }
+
+  // Levels of detail are simplified from the source data up front, so their
+  // index ranges can be laid out after every full detail index
+  vkex::Timer lod_timer;
+  lod_timer.Start();
+  const uint32_t lod_count =
+      std::min<uint32_t>(m_geometry_options.lod_count, LOD_MAX_COUNT);
+  // Per primitive in visit order, the simplified levels back to back
+  std::vector<std::vector<uint32_t>> lod_indices;
+  uint32_t lod_index_count = 0;
+  uint32_t lod_primitive_count = 0;
+  for (auto& mesh : m_meshes) {
+    for (auto& primitive : mesh.primitives) {
+      Lod full_detail = {};
+      full_detail.first_index = primitive.first_index;
+      full_detail.index_count = primitive.index_count;
+      primitive.lods.assign(1, full_detail);
+
+      lod_indices.emplace_back();
+      if (lod_count > 1) {
+        GenerateLods(model, buffer_data, lod_count, &primitive,
+                     &lod_indices.back());
+      }
+      for (size_t level = 1; level < primitive.lods.size(); level++) {
+        primitive.lods[level].first_index +=
+            total_index_count + lod_index_count;
+      }
+      lod_index_count += uint32_t(lod_indices.back().size());
+      lod_primitive_count += (primitive.lods.size() > 1) ? 1 : 0;
+    }
+  }
+  lod_timer.Stop();
+
+  // Quantization swaps the float streams for smaller ones model wide, so
+  // every pipeline keeps one vertex layout
+  bool quantize = m_geometry_options.quantize;
+  for (uint32_t stream = 0; quantize && (stream < BufferType::BufferTypeCount);
+       stream++) {
+    if (m_stream_formats[stream] != default_formats[stream]) {
+      VKEX_LOG_WARN("Vertex stream " << stream
+                                     << " isn't float, skipping quantization");
+      quantize = false;
+    }
+  }
+  const bool optimize = m_geometry_options.optimize;
+  const bool positions_are_float3 =
+      (m_stream_formats[BufferType::Position] == VK_FORMAT_R32G32B32_SFLOAT);
+
+  size_t source_element_sizes[BufferType::BufferTypeCount];
+  std::copy(element_sizes, element_sizes + BufferType::BufferTypeCount,
+            source_element_sizes);
+  if (quantize) {
+    const VkFormat quantized_formats[BufferType::BufferTypeCount] = {
+        VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16_SNORM,
+        VK_FORMAT_R16G16_SFLOAT};
+    const size_t quantized_element_sizes[BufferType::BufferTypeCount] = {
+        4 * sizeof(uint16_t), 2 * sizeof(int16_t), 2 * sizeof(uint16_t)};
+    for (uint32_t stream = 0; stream < BufferType::BufferTypeCount; stream++) {
+      element_sizes[stream] = quantized_element_sizes[stream];
+      m_stream_formats[stream] = quantized_formats[stream];
+    }
+    for (auto& mesh : m_meshes) {
+      for (auto& primitive : mesh.primitives) {
+        for (uint32_t stream = 0; stream < BufferType::BufferTypeCount;
+             stream++) {
+          if (primitive.vertex_buffer_formats[stream] != VK_FORMAT_UNDEFINED) {
+            primitive.vertex_buffer_formats[stream] = quantized_formats[stream];
+          }
+        }
+      }
+    }
+  }
+
+  // Layout: one stream per attribute, then indices
+  const VkDeviceSize kStreamAlignment = 16;
+  VkDeviceSize buffer_size = 0;
+  for (uint32_t stream = 0; stream < BufferType::BufferTypeCount; stream++) {
+    m_stream_offsets[stream] = buffer_size;
+    buffer_size = vkex::RoundUp<VkDeviceSize>(
+        buffer_size + (element_sizes[stream] * total_vertex_count),
+        kStreamAlignment);
+  }
+  const size_t index_size = (m_index_type == VK_INDEX_TYPE_UINT16) ? 2 : 4;
+  m_index_offset = buffer_size;
+  buffer_size += index_size * (total_index_count + lod_index_count);
+
+  // Cache and fetch statistics only cover primitives with valid triangle
+  // lists
+  uint64_t measured_triangle_count = 0;
+  uint64_t cache_misses_before = 0;
+  uint64_t cache_misses_after = 0;
+  uint64_t fetch_bytes_before = 0;
+  uint64_t fetch_bytes_after = 0;
+  auto count_fetch_bytes = [](const std::vector<uint32_t>& indices,
+                              size_t vertex_count,
+                              const size_t* p_element_sizes) {
+    uint64_t fetch_bytes = 0;
+    for (uint32_t stream = 0; stream < BufferType::BufferTypeCount; stream++) {
+      fetch_bytes += mesh_optimizer::CountVertexFetchBytes(
+          indices.data(), indices.size(), vertex_count,
+          p_element_sizes[stream]);
+    }
+    return fetch_bytes;
+  };
+
+  // Streams are written straight into the upload memory (the staging buffer,
+  // or the geometry buffer itself with direct upload)
+  auto write_geometry = [&](void* p_dst) {
+    uint8_t* p_geometry = static_cast<uint8_t*>(p_dst);
+    std::memset(p_geometry, 0, size_t(buffer_size));
+
+    auto write_indices = [&](const std::vector<uint32_t>& indices,
+                             uint32_t first_index) {
+      uint8_t* p_indices = p_geometry + size_t(m_index_offset) +
+                           (size_t(first_index) * index_size);
+      for (size_t i = 0; i < indices.size(); i++) {
+        if (m_index_type == VK_INDEX_TYPE_UINT16) {
+          reinterpret_cast<uint16_t*>(p_indices)[i] = uint16_t(indices[i]);
+        } else {
+          reinterpret_cast<uint32_t*>(p_indices)[i] = indices[i];
+        }
+      }
+    };
+
+    size_t primitive_visit_index = 0;
+    for (auto& mesh : m_meshes) {
+      for (auto& primitive : mesh.primitives) {
+        const auto& index_accessor =
+            model.accessors[primitive.indexBufferAccessorIndex];
+        const size_t vertex_count = primitive.vertex_count;
+
+        std::vector<uint32_t> indices(primitive.index_count, 0);
+        CopyIndexData(model, buffer_data, index_accessor, VK_INDEX_TYPE_UINT32,
+                      reinterpret_cast<uint8_t*>(indices.data()));
+
+        bool valid_triangles =
+            ((indices.size() % 3) == 0) && (vertex_count > 0);
+        for (size_t i = 0; valid_triangles && (i < indices.size()); i++) {
+          valid_triangles = (indices[i] < vertex_count);
+        }
+        if (valid_triangles) {
+          measured_triangle_count += indices.size() / 3;
+          cache_misses_before += mesh_optimizer::CountVertexCacheMisses(
+              indices.data(), indices.size(), vertex_count);
+          fetch_bytes_before +=
+              count_fetch_bytes(indices, vertex_count, source_element_sizes);
+        }
+
+        uint8_t* p_streams[BufferType::BufferTypeCount];
+        for (uint32_t stream = 0; stream < BufferType::BufferTypeCount;
+             stream++) {
+          p_streams[stream] =
+              p_geometry + size_t(m_stream_offsets[stream]) +
+              (size_t(primitive.vertex_offset) * element_sizes[stream]);
+        }
+
+        const bool reorder = optimize && valid_triangles;
+        // Old vertex to new, when reordered
+        std::vector<uint32_t> remap;
+        if (!reorder && !quantize) {
+          for (const auto& attribute : primitive.attributes) {
+            BufferType bufferType =
+                GetBufferTypeFromAttributeName(attribute.name);
+            if (bufferType == BufferType::BufferTypeCount) {
+              continue;
+            }
+
+            const auto& accessor = model.accessors[attribute.accessorIndex];
+            VKEX_ASSERT(accessor.count == primitive.vertex_count);
+            CopyAccessorData(model, buffer_data, accessor,
+                             element_sizes[bufferType], p_streams[bufferType]);
+          }
+        } else {
+          // Gather the source streams so they can be reordered and encoded
+          std::vector<uint8_t> sources[BufferType::BufferTypeCount];
+          for (uint32_t stream = 0; stream < BufferType::BufferTypeCount;
+               stream++) {
+            sources[stream].resize(source_element_sizes[stream] * vertex_count,
+                                   0);
+          }
+          for (const auto& attribute : primitive.attributes) {
+            BufferType bufferType =
+                GetBufferTypeFromAttributeName(attribute.name);
+            if (bufferType == BufferType::BufferTypeCount) {
+              continue;
+            }
+
+            const auto& accessor = model.accessors[attribute.accessorIndex];
+            VKEX_ASSERT(accessor.count == primitive.vertex_count);
+            CopyAccessorData(model, buffer_data, accessor,
+                             source_element_sizes[bufferType],
+                             sources[bufferType].data());
+          }
+
+          if (reorder) {
+            std::vector<uint32_t> clusters;
+            mesh_optimizer::OptimizeVertexCache(indices.data(), indices.size(),
+                                                vertex_count, &clusters);
+            if (positions_are_float3) {
+              mesh_optimizer::OptimizeOverdraw(
+                  indices.data(), indices.size(),
+                  reinterpret_cast<const float*>(
+                      sources[BufferType::Position].data()),
+                  vertex_count, clusters, mesh_optimizer::kOverdrawThreshold);
+            }
+
+            mesh_optimizer::OptimizeVertexFetch(indices.data(), indices.size(),
+                                                vertex_count, &remap);
+            for (uint32_t stream = 0; stream < BufferType::BufferTypeCount;
+                 stream++) {
+              const size_t element_size = source_element_sizes[stream];
+              std::vector<uint8_t> remapped(sources[stream].size());
+              for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+                std::memcpy(remapped.data() + (remap[vertex] * element_size),
+                            sources[stream].data() + (vertex * element_size),
+                            element_size);
+              }
+              sources[stream].swap(remapped);
+            }
+          }
+
+          if (!quantize) {
+            for (uint32_t stream = 0; stream < BufferType::BufferTypeCount;
+                 stream++) {
+              std::memcpy(p_streams[stream], sources[stream].data(),
+                          sources[stream].size());
+            }
+          } else {
+            const float* p_positions = reinterpret_cast<const float*>(
+                sources[BufferType::Position].data());
+            const float* p_normals = reinterpret_cast<const float*>(
+                sources[BufferType::Normal].data());
+            const float* p_texcoords = reinterpret_cast<const float*>(
+                sources[BufferType::TexCoord0].data());
+
+            // Positions quantize within the bounds of the data itself, the
+            // accessor's min/max are allowed to be loose
+            float position_min[3] = {0.0f, 0.0f, 0.0f};
+            float position_max[3] = {0.0f, 0.0f, 0.0f};
+            for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+              for (uint32_t axis = 0; axis < 3; axis++) {
+                const float value = p_positions[(vertex * 3) + axis];
+                position_min[axis] = (vertex == 0)
+                                         ? value
+                                         : std::min(position_min[axis], value);
+                position_max[axis] = (vertex == 0)
+                                         ? value
+                                         : std::max(position_max[axis], value);
+              }
+            }
+            const float position_extent[3] = {
+                position_max[0] - position_min[0],
+                position_max[1] - position_min[1],
+                position_max[2] - position_min[2]};
+            primitive.position_dequant_matrix =
+                glm::translate(vkex::float3(position_min[0], position_min[1],
+                                            position_min[2])) *
+                glm::scale(vkex::float3(position_extent[0], position_extent[1],
+                                        position_extent[2]));
+
+            for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+              mesh_optimizer::QuantizePosition(
+                  p_positions + (vertex * 3), position_min, position_extent,
+                  reinterpret_cast<uint16_t*>(p_streams[BufferType::Position]) +
+                      (vertex * 4));
+              mesh_optimizer::EncodeOctahedralNormal(
+                  p_normals + (vertex * 3),
+                  reinterpret_cast<int16_t*>(p_streams[BufferType::Normal]) +
+                      (vertex * 2));
+
+              uint16_t* p_texcoord = reinterpret_cast<uint16_t*>(
+                                         p_streams[BufferType::TexCoord0]) +
+                                     (vertex * 2);
+              p_texcoord[0] =
+                  mesh_optimizer::QuantizeHalf(p_texcoords[(vertex * 2) + 0]);
+              p_texcoord[1] =
+                  mesh_optimizer::QuantizeHalf(p_texcoords[(vertex * 2) + 1]);
+            }
+          }
+        }
+
+        if (valid_triangles) {
+          cache_misses_after += mesh_optimizer::CountVertexCacheMisses(
+              indices.data(), indices.size(), vertex_count);
+          fetch_bytes_after +=
+              count_fetch_bytes(indices, vertex_count, element_sizes);
+        }
+
+        write_indices(indices, primitive.first_index);
+
+        // Simplified levels follow the full detail vertex order, and get a
+        // triangle order of their own
+        const auto& levels = lod_indices[primitive_visit_index++];
+        size_t level_offset = 0;
+        for (size_t level = 1; level < primitive.lods.size(); level++) {
+          const auto& lod = primitive.lods[level];
+          std::vector<uint32_t> level_indices(
+              levels.begin() + level_offset,
+              levels.begin() + level_offset + lod.index_count);
+          level_offset += lod.index_count;
+
+          if (reorder) {
+            for (auto& index : level_indices) {
+              index = remap[index];
+            }
+            std::vector<uint32_t> clusters;
+            mesh_optimizer::OptimizeVertexCache(level_indices.data(),
+                                                level_indices.size(),
+                                                vertex_count, &clusters);
+          }
+          write_indices(level_indices, lod.first_index);
+        }
+      }
+    }
+  };
+
+  VKEX_CALL(asset_util::CreateGeometryBuffer(
+      size_t(buffer_size), write_geometry, queue,
+      asset_util::MEMORY_USAGE_GPU_ONLY, &m_geometry_buffer));
+
+  timer.Stop();
+
+  m_geometry_statistics.primitive_count = primitive_count;
+  m_geometry_statistics.vertex_count = total_vertex_count;
+  m_geometry_statistics.index_count = total_index_count;
+  m_geometry_statistics.buffer_bytes = buffer_size;
+  m_geometry_statistics.allocation_count = 1;
+  m_geometry_statistics.buffer_view_count = uint32_t(model.bufferViews.size());
+  m_geometry_statistics.load_time_ms = timer.Millis();
+  if (measured_triangle_count > 0) {
+    m_geometry_statistics.acmr_before =
+        float(double(cache_misses_before) / double(measured_triangle_count));
+    m_geometry_statistics.acmr_after =
+        float(double(cache_misses_after) / double(measured_triangle_count));
+  }
+  m_geometry_statistics.fetch_bytes_before = fetch_bytes_before;
+  m_geometry_statistics.fetch_bytes_after = fetch_bytes_after;
+  m_geometry_statistics.optimized = optimize;
+  m_geometry_statistics.quantized = quantize;
+  m_geometry_statistics.lod_primitive_count = lod_primitive_count;
+  m_geometry_statistics.lod_index_count = lod_index_count;
+  m_geometry_statistics.lod_time_ms = lod_timer.Millis();
+
+  VKEX_LOG_INFO("Geometry: " << primitive_count << " primitives, "
+                             << total_vertex_count << " vertices, "
+                             << total_index_count << " indices in "
+                             << (buffer_size / 1024) << " KiB");
+  VKEX_LOG_INFO("  " << m_geometry_statistics.allocation_count
+                     << " buffer allocation (was one per bufferView: "
+                     << m_geometry_statistics.buffer_view_count << "), "
+                     << m_geometry_statistics.load_time_ms << " ms");
+  VKEX_LOG_INFO("  ACMR " << m_geometry_statistics.acmr_before << " -> "
+                          << m_geometry_statistics.acmr_after
+                          << ", vertex fetch "
+                          << (fetch_bytes_before / 1024) << " -> "
+                          << (fetch_bytes_after / 1024)
+                          << " KiB per draw of every primitive"
+                          << (quantize ? " (quantized)" : ""));
+  VKEX_LOG_INFO("  LODs for " << lod_primitive_count << " of "
+                              << primitive_count << " primitives, "
+                              << lod_index_count << " extra indices, "
+                              << m_geometry_statistics.lod_time_ms << " ms");
+}
+
+void GLTFModel::FlattenScene(const tinygltf::Model& model) {
+  auto& scene = m_flattened_scene;
+  scene = {};
+
+  if (m_scenes.empty()) {
+    return;
+  }
+  const size_t scene_index =
+      (model.defaultScene >= 0) ? size_t(model.defaultScene) : 0;
+  VKEX_ASSERT(scene_index < m_scenes.size());
+
+  // Depth first with an explicit stack, each entry is a node and the instance
+  // of its parent. Pushing children in reverse keeps them in file order.
+  std::vector<std::pair<uint32_t, int32_t>> pending;
+  const auto& root_nodes = m_scenes[scene_index].nodeIndices;
+  for (auto it = root_nodes.rbegin(); it != root_nodes.rend(); ++it) {
+    pending.push_back(std::make_pair(*it, -1));
+  }
+
+  while (!pending.empty()) {
+    const uint32_t node_index = pending.back().first;
+    const int32_t parent_instance = pending.back().second;
+    pending.pop_back();
+
+    const auto& node = m_nodes[node_index];
+    const int32_t instance =
+        int32_t(scene.transforms.AddNode(parent_instance));
+    scene.transforms.SetLocalMatrix(uint32_t(instance), node.localMatrix);
+    scene.node_indices.push_back(node_index);
+    scene.mesh_indices.push_back(node.meshIndex);
+
+    for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+      pending.push_back(std::make_pair(*it, instance));
+    }
+  }
+
+  UpdateWorldMatrices(vkex::float4x4(1.0f));
+  scene.transforms.ResetPrevWorldMatrices();
+
+  VKEX_LOG_INFO("Scene: " << scene.node_indices.size() << " node instances, "
+                          << m_materials.size() << " materials");
+}
+
+void GLTFModel::UpdateWorldMatrices(const vkex::float4x4& root_matrix) {
+  auto& transforms = m_flattened_scene.transforms;
+  transforms.SetRootMatrix(root_matrix);
+  transforms.Update();
 }
 
 bool GLTFModel::IsImageSRGB(const uint32_t image_index) {
@@ -523,6 +1413,21 @@ std::vector<VkFormat> GLTFModel::GetVertexBufferFormats(
   return prim.vertex_buffer_formats;
 }
 
+std::vector<vkex::VertexBindingDescription>
+GLTFModel::GetVertexBindingDescriptions() {
+  std::vector<vkex::VertexBindingDescription> descriptions;
+  for (uint32_t stream = 0; stream < BufferType::BufferTypeCount; stream++) {
+    descriptions.push_back(
+        vkex::VertexBindingDescription(stream, VK_VERTEX_INPUT_RATE_VERTEX));
+  }
+  return descriptions;
+}
+
+std::vector<VkFormat> GLTFModel::GetVertexBufferFormats() {
+  return std::vector<VkFormat>(
+      m_stream_formats, m_stream_formats + BufferType::BufferTypeCount);
+}
+
 // const std::vector<uint32_t>& GLTFModel::GetMaterialTextureIndices(
 //    uint32_t node_index, uint32_t primitive_index) {
 //  const auto& prim = GetPrimitive(node_index, primitive_index);
@@ -564,14 +1469,26 @@ vkex::Sampler GLTFModel::GetVkSampler(uint32_t sampler_index) {
 
 vkex::Sampler GLTFModel::GetVkSamplerFromMaterialComponent(
     uint32_t node_index, uint32_t primitive_index, MaterialTextureType type) {
-  const auto& mat = GetMaterialInfo(node_index, primitive_index);
-  const auto& texture_info = GetTextureInfo(mat.textureIndices[type]);
-  return GetVkSampler(texture_info.samplerIndex);
+  const auto& prim = GetPrimitive(node_index, primitive_index);
+  return GetVkSamplerFromMaterial(prim.materialIndex, type);
 }
 
 vkex::Texture GLTFModel::GetVkTextureFromMaterialComponent(
     uint32_t node_index, uint32_t primitive_index, MaterialTextureType type) {
-  const auto& mat = GetMaterialInfo(node_index, primitive_index);
+  const auto& prim = GetPrimitive(node_index, primitive_index);
+  return GetVkTextureFromMaterial(prim.materialIndex, type);
+}
+
+vkex::Sampler GLTFModel::GetVkSamplerFromMaterial(uint32_t material_index,
+                                                  MaterialTextureType type) {
+  const auto& mat = m_materials[material_index];
+  const auto& texture_info = GetTextureInfo(mat.textureIndices[type]);
+  return GetVkSampler(texture_info.samplerIndex);
+}
+
+vkex::Texture GLTFModel::GetVkTextureFromMaterial(uint32_t material_index,
+                                                  MaterialTextureType type) {
+  const auto& mat = m_materials[material_index];
   const auto& texture_info = GetTextureInfo(mat.textureIndices[type]);
   const auto& image_info = GetImageInfo(texture_info.imageIndex);
   return image_info.gpuTexture;
@@ -645,37 +1562,40 @@ void GLTFModel::GetDebugRoughnessFactor(uint32_t node_index,
   *out_roughness = &material.roughnessFactor;
 }
 
-vkex::Buffer GLTFModel::GetIndexBuffer(uint32_t node_index,
-                                       uint32_t primitive_index) {
-  const auto& prim = GetPrimitive(node_index, primitive_index);
+vkex::Buffer GLTFModel::GetIndexBuffer() { return m_geometry_buffer; }
+
+VkDeviceSize GLTFModel::GetIndexBufferOffset() { return m_index_offset; }
 
-  return prim.index_buffer;
+VkIndexType GLTFModel::GetIndexType() { return m_index_type; }
+
+void GLTFModel::GetVertexBuffers(vkex::Span<VkBuffer> vertex_buffers,
+                                 vkex::Span<VkDeviceSize> offsets) {
+  VKEX_ASSERT(vertex_buffers.size() >= BufferType::BufferTypeCount);
+  VKEX_ASSERT(offsets.size() >= BufferType::BufferTypeCount);
+
+  for (uint32_t stream = 0; stream < BufferType::BufferTypeCount; stream++) {
+    vertex_buffers[stream] = *m_geometry_buffer;
+    offsets[stream] = m_stream_offsets[stream];
+  }
 }
 
-VkIndexType GLTFModel::GetIndexType(uint32_t node_index,
-                                    uint32_t primitive_index) {
+uint32_t GLTFModel::GetIndexCount(uint32_t node_index,
+                                  uint32_t primitive_index) {
   const auto& prim = GetPrimitive(node_index, primitive_index);
 
-  return prim.index_type;
+  return prim.index_count;
 }
 
-void GLTFModel::GetVertexBuffers(uint32_t node_index, uint32_t primitive_index,
-                                 std::vector<VkBuffer>& vertex_buffers) {
+uint32_t GLTFModel::GetFirstIndex(uint32_t node_index,
+                                  uint32_t primitive_index) {
   const auto& prim = GetPrimitive(node_index, primitive_index);
 
-  vertex_buffers.resize(BufferType::BufferTypeCount);
-
-  vertex_buffers[BufferType::Position] =
-      *(prim.vertex_buffers[BufferType::Position]);
-  vertex_buffers[BufferType::Normal] =
-      *(prim.vertex_buffers[BufferType::Normal]);
-  vertex_buffers[BufferType::TexCoord0] =
-      *(prim.vertex_buffers[BufferType::TexCoord0]);
+  return prim.first_index;
 }
 
-uint32_t GLTFModel::GetIndexCount(uint32_t node_index,
-                                  uint32_t primitive_index) {
+int32_t GLTFModel::GetVertexOffset(uint32_t node_index,
+                                   uint32_t primitive_index) {
   const auto& prim = GetPrimitive(node_index, primitive_index);
 
-  return prim.index_count;
+  return prim.vertex_offset;
 }
\ No newline at end of file
@@ -21,6 +21,9 @@
 
 #include "vkex/Application.h"
 
+#include "SharedShaderConstants.h"
+#include "TransformHierarchy.h"
+
 class GLTFModel {
  public:
   GLTFModel() {}
@@ -47,7 +50,10 @@ class GLTFModel {
   };
 
   struct Node {
-    uint32_t meshIndex;
+    int32_t meshIndex = -1;
+    std::vector<uint32_t> children;
+    // From the node's matrix, or its translation/rotation/scale
+    vkex::float4x4 localMatrix = vkex::float4x4(1.0f);
   };
 
   struct Attribute {
@@ -55,18 +61,42 @@ class GLTFModel {
     uint32_t accessorIndex;
   };
 
+  // One level of detail of a primitive, an index range over the same
+  // vertices as the full detail one
+  struct Lod {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    // Largest distance the simplified surface strays from the original, in
+    // object space
+    float error = 0.0f;
+  };
+
   struct Primitive {
     uint32_t materialIndex;
 
     uint32_t indexBufferAccessorIndex;
     std::vector<Attribute> attributes;
 
-    // Derived state
-    vkex::Buffer index_buffer;
-    VkIndexType index_type = VK_INDEX_TYPE_MAX_ENUM;
+    // Derived state, indices and vertices live in the model's shared
+    // geometry buffer
     uint32_t index_count = UINT32_MAX;
+    uint32_t first_index = 0;
+    uint32_t vertex_count = 0;
+    int32_t vertex_offset = 0;
+
+    // Object space bounds from the POSITION accessor's min/max
+    vkex::float3 bounds_min = vkex::float3(0.0f);
+    vkex::float3 bounds_max = vkex::float3(0.0f);
+    bool has_bounds = false;
+
+    // Maps the POSITION stream to object space, identity unless positions
+    // were quantized
+    vkex::float4x4 position_dequant_matrix = vkex::float4x4(1.0f);
+
+    // Levels of detail from full detail down, lods[0] matches index_count
+    // and first_index
+    std::vector<Lod> lods;
 
-    std::vector<vkex::Buffer> vertex_buffers;
     std::vector<vkex::VertexBindingDescription> vertex_binding_descriptions;
     std::vector<VkFormat> vertex_buffer_formats;
   };
@@ -86,7 +116,16 @@ class GLTFModel {
     VkSamplerAddressMode wrapR = VK_SAMPLER_ADDRESS_MODE_REPEAT;
   };
 
+  enum AlphaMode {
+    Opaque = 0,
+    Mask = 1,
+    Blend = 2,
+  };
+
   struct Material {
+    AlphaMode alphaMode = AlphaMode::Opaque;
+    bool doubleSided = false;
+
     float baseColorFactor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
     float emissiveFactor[3] = {1.0f, 1.0f, 1.0f};
     float metallicFactor = 1.0f;
@@ -105,6 +144,73 @@ class GLTFModel {
     vkex::Texture gpuTexture;
   };
 
+  struct GeometryStatistics {
+    uint32_t primitive_count = 0;
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+    uint64_t buffer_bytes = 0;
+    // Buffers created for geometry, against one per glTF bufferView
+    uint32_t allocation_count = 0;
+    uint32_t buffer_view_count = 0;
+    double load_time_ms = 0.0;
+    // Post-transform cache miss ratio and bytes of vertex fetch, for one
+    // draw of every primitive, as loaded and as stored
+    float acmr_before = 0.0f;
+    float acmr_after = 0.0f;
+    uint64_t fetch_bytes_before = 0;
+    uint64_t fetch_bytes_after = 0;
+    bool optimized = false;
+    bool quantized = false;
+    // Primitives with at least one simplified level, and the indices spent
+    // on those levels
+    uint32_t lod_primitive_count = 0;
+    uint32_t lod_index_count = 0;
+    double lod_time_ms = 0.0;
+  };
+
+  // How geometry is processed at load. Reordering needs triangle lists with
+  // valid indices, primitives without them are stored as loaded.
+  struct GeometryOptions {
+    // Triangle order for the post-transform cache and overdraw, and vertex
+    // order for fetch
+    bool optimize = true;
+    // 16-bit positions, octahedral normals and half texcoords. Needs float
+    // POSITION, NORMAL and TEXCOORD_0, and shaders built for it.
+    bool quantize = false;
+    // Levels of detail per primitive including the full detail one, up to
+    // LOD_MAX_COUNT. Each simplified level targets half the triangles of the
+    // one before.
+    uint32_t lod_count = LOD_MAX_COUNT;
+  };
+
+  struct LoadStatistics {
+    bool binary = false;
+    // The .glb file was memory mapped rather than read into memory
+    bool mapped = false;
+    uint64_t file_bytes = 0;
+    double parse_time_ms = 0.0;
+    double total_time_ms = 0.0;
+    // How far the load pushed the process' peak resident set size
+    uint64_t peak_resident_growth_bytes = 0;
+  };
+
+  // Every node reachable from the default scene, flattened depth first so
+  // that parents come before their children. Each array is indexed by
+  // instance, as are the transform hierarchy's nodes.
+  struct FlattenedScene {
+    std::vector<uint32_t> node_indices;
+    std::vector<int32_t> mesh_indices;
+    TransformHierarchy transforms;
+  };
+
+  // Each buffer's bytes by buffer index. For .glb files the embedded buffer
+  // points into the mapped file rather than tinygltf's copy of it.
+  using BufferDataList = std::vector<vkex::Span<const uint8_t>>;
+
+  // Applies to the next PopulateFromModel
+  void SetGeometryOptions(const GeometryOptions& options) {
+    m_geometry_options = options;
+  }
   void PopulateFromModel(vkex::fs::path model_path, vkex::Queue queue);
 
   // For building pipeline binding descriptions/attributes
@@ -112,6 +218,19 @@ class GLTFModel {
       uint32_t node_index, uint32_t primitive_index);
   std::vector<VkFormat> GetVertexBufferFormats(uint32_t node_index,
                                                uint32_t primitive_index);
+  // Layout of the shared geometry streams, valid for every primitive
+  std::vector<vkex::VertexBindingDescription> GetVertexBindingDescriptions();
+  std::vector<VkFormat> GetVertexBufferFormats();
+
+  // Scene traversal
+  const FlattenedScene& GetFlattenedScene() const { return m_flattened_scene; }
+  const Mesh& GetMesh(uint32_t mesh_index) const {
+    return m_meshes[mesh_index];
+  }
+  // Resolves the world matrix of every instance whose transform changed,
+  // with 'root_matrix' applied above the scene's root nodes. The previous
+  // world matrices are kept for motion vectors.
+  void UpdateWorldMatrices(const vkex::float4x4& root_matrix);
 
   // For descriptor sets
   const Material& GetMaterialInfo(uint32_t node_index,
@@ -127,6 +246,14 @@ class GLTFModel {
   vkex::Texture GetVkTextureFromMaterialComponent(uint32_t node_index,
                                                   uint32_t primitive_index,
                                                   MaterialTextureType type);
+  uint32_t GetMaterialCount() const { return uint32_t(m_materials.size()); }
+  const Material& GetMaterial(uint32_t material_index) const {
+    return m_materials[material_index];
+  }
+  vkex::Sampler GetVkSamplerFromMaterial(uint32_t material_index,
+                                         MaterialTextureType type);
+  vkex::Texture GetVkTextureFromMaterial(uint32_t material_index,
+                                         MaterialTextureType type);
 
   // For constant buffers
   const float* GetBaseColorFactor(uint32_t node_index,
@@ -136,11 +263,24 @@ class GLTFModel {
   float GetRoughnessFactor(uint32_t node_index, uint32_t primitive_index);
 
   // For draws
-  vkex::Buffer GetIndexBuffer(uint32_t node_index, uint32_t primitive_index);
-  VkIndexType GetIndexType(uint32_t node_index, uint32_t primitive_index);
-  void GetVertexBuffers(uint32_t node_index, uint32_t primitive_index,
-                        std::vector<VkBuffer>& vertex_buffers);
+  // All primitives share one geometry buffer. Bind the index and vertex
+  // streams once per model, then draw each primitive with its first index
+  // and vertex offset.
+  vkex::Buffer GetIndexBuffer();
+  VkDeviceSize GetIndexBufferOffset();
+  VkIndexType GetIndexType();
+  // 'vertex_buffers' and 'offsets' must hold BufferType::BufferTypeCount
+  // elements
+  void GetVertexBuffers(vkex::Span<VkBuffer> vertex_buffers,
+                        vkex::Span<VkDeviceSize> offsets);
   uint32_t GetIndexCount(uint32_t node_index, uint32_t primitive_index);
+  uint32_t GetFirstIndex(uint32_t node_index, uint32_t primitive_index);
+  int32_t GetVertexOffset(uint32_t node_index, uint32_t primitive_index);
+
+  const GeometryStatistics& GetGeometryStatistics() const {
+    return m_geometry_statistics;
+  }
+  const LoadStatistics& GetLoadStatistics() const { return m_load_statistics; }
 
   // Debug UI functionality
   // These APIs are intentionally obtuse to prevent accidental easy use!
@@ -154,15 +294,28 @@ class GLTFModel {
                                float** out_roughness);
 
  protected:
+  void BuildGeometryBuffer(const tinygltf::Model& model,
+                           const BufferDataList& buffer_data,
+                           vkex::Queue queue);
+  void FlattenScene(const tinygltf::Model& model);
   bool IsImageSRGB(const uint32_t image_index);
   const Primitive& GetPrimitive(uint32_t node_index, uint32_t primitive_index);
 
  private:
-  std::vector<vkex::Buffer> m_buffers;  // derived from bufferViews
+  // Vertex streams and indices for every primitive, packed back to back
+  vkex::Buffer m_geometry_buffer = nullptr;
+  VkDeviceSize m_stream_offsets[BufferType::BufferTypeCount] = {};
+  VkDeviceSize m_index_offset = 0;
+  VkIndexType m_index_type = VK_INDEX_TYPE_UINT16;
+  VkFormat m_stream_formats[BufferType::BufferTypeCount] = {};
+  GeometryOptions m_geometry_options;
+  GeometryStatistics m_geometry_statistics;
+  LoadStatistics m_load_statistics;
 
   std::vector<Scene> m_scenes;
   std::vector<Node> m_nodes;
   std::vector<Mesh> m_meshes;
+  FlattenedScene m_flattened_scene;
 
   std::vector<Material> m_materials;
   std::vector<Sampler> m_samplers;
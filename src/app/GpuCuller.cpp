@@ -0,0 +1,543 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "GpuCuller.h"
+
+#include "AppCore.h"
+#include "AssetUtil.h"
+#include "LodSelector.h"
+
+using GpuCullConstants = vkex::ConstantBufferData<GpuCullData>;
+using HiZDimensionsConstants =
+    vkex::ConstantBufferData<ScaledTexCopyDimensionsData>;
+
+static const VkFormat kHiZFormat = VK_FORMAT_R32_SFLOAT;
+// Matches numthreads in the Hi-Z shaders
+static const uint32_t kHiZGroupSize = 16;
+
+// Shader bindings
+static const uint32_t kHiZConstantsSlot = 0;
+static const uint32_t kHiZBuildDepthSlot = 1;
+static const uint32_t kHiZBuildLevel0Slot = 2;
+static const uint32_t kHiZDownsampleSourceSlot = 1;
+static const uint32_t kHiZDownsampleDestinationSlot = 2;
+static const uint32_t kCullConstantsSlot = 0;
+static const uint32_t kCullInstancesSlot = 1;
+static const uint32_t kCullDrawsSlot = 2;
+static const uint32_t kCullHiZSlot = 3;
+static const uint32_t kCullCommandsSlot = 4;
+static const uint32_t kCullCountersSlot = 5;
+
+static void ImageBarrier(vkex::CommandBuffer cmd, vkex::Texture texture,
+                         VkImageLayout old_layout, VkImageLayout new_layout,
+                         VkPipelineStageFlags src_stage,
+                         VkAccessFlags src_access,
+                         VkPipelineStageFlags dst_stage,
+                         VkAccessFlags dst_access) {
+  VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = texture->GetImage()->GetVkObject();
+  barrier.subresourceRange = vkex::ImageSubresourceRange(
+      texture->GetAspectFlags(), 0, texture->GetMipLevels());
+  cmd->CmdPipelineBarrier(src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1,
+                          &barrier);
+}
+
+static void GlobalBarrier(vkex::CommandBuffer cmd,
+                          VkPipelineStageFlags src_stage,
+                          VkAccessFlags src_access,
+                          VkPipelineStageFlags dst_stage,
+                          VkAccessFlags dst_access) {
+  VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  cmd->CmdPipelineBarrier(src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0,
+                          nullptr);
+}
+
+// Arvo's method, as in FrustumCuller
+static void TransformBounds(const float3& bounds_min, const float3& bounds_max,
+                            const float4x4& world_matrix, float3* p_center,
+                            float3* p_extent) {
+  const float3 center = (bounds_min + bounds_max) * 0.5f;
+  const float3 extent = (bounds_max - bounds_min) * 0.5f;
+
+  *p_center = float3(world_matrix * float4(center, 1.0f));
+  for (int row = 0; row < 3; row++) {
+    (*p_extent)[row] = (fabsf(world_matrix[0][row]) * extent.x) +
+                       (fabsf(world_matrix[1][row]) * extent.y) +
+                       (fabsf(world_matrix[2][row]) * extent.z);
+  }
+}
+
+static VkExtent2D HalveExtent(VkExtent2D extent) {
+  return {std::max((extent.width + 1) / 2, 1u),
+          std::max((extent.height + 1) / 2, 1u)};
+}
+
+vkex::Result GpuCuller::Initialize(vkex::Queue queue, uint32_t frame_count,
+                                   const GpuCullShaders& shaders,
+                                   uint32_t max_draw_count,
+                                   uint32_t max_instance_count,
+                                   VkExtent2D max_depth_extent,
+                                   vkex::Buffer instance_buffer) {
+  VKEX_ASSERT((max_draw_count > 0) && (max_instance_count > 0));
+
+  m_shaders = shaders;
+  m_max_draw_count = max_draw_count;
+  m_max_instance_count = max_instance_count;
+
+  vkex::Device device = queue->GetDevice();
+
+  // Hi-Z pyramid, with a full chain down to 1x1 from half the largest depth
+  // buffer it will be built from
+  {
+    const VkExtent2D level0_extent = HalveExtent(max_depth_extent);
+    uint32_t mip_count = 1;
+    for (uint32_t size = std::max(level0_extent.width, level0_extent.height);
+         size > 1; size /= 2) {
+      ++mip_count;
+    }
+
+    vkex::TextureCreateInfo create_info = {};
+    create_info.image.image_type = VK_IMAGE_TYPE_2D;
+    create_info.image.format = kHiZFormat;
+    create_info.image.extent = {level0_extent.width, level0_extent.height, 1};
+    create_info.image.mip_levels = mip_count;
+    create_info.image.array_layers = 1;
+    create_info.image.samples = VK_SAMPLE_COUNT_1_BIT;
+    create_info.image.tiling = VK_IMAGE_TILING_OPTIMAL;
+    create_info.image.usage_flags.bits.sampled = true;
+    create_info.image.usage_flags.bits.storage = true;
+    create_info.image.sharing_mode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.image.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    create_info.image.committed = true;
+    create_info.image.host_visible = false;
+    create_info.image.device_local = true;
+    create_info.view.derive_from_image = true;
+    vkex::Result result = device->CreateTexture(create_info, &m_hiz_texture);
+    if (!result) {
+      return result;
+    }
+
+    m_hiz_mip_textures.resize(mip_count);
+    for (uint32_t mip = 0; mip < mip_count; mip++) {
+      vkex::TextureCreateInfo mip_create_info = {};
+      mip_create_info.existing_image = m_hiz_texture->GetImage();
+      mip_create_info.view.derive_from_image = false;
+      mip_create_info.view.view_type = VK_IMAGE_VIEW_TYPE_2D;
+      mip_create_info.view.format = kHiZFormat;
+      mip_create_info.view.samples = VK_SAMPLE_COUNT_1_BIT;
+      mip_create_info.view.components = vkex::ComponentMappingRGBA();
+      mip_create_info.view.subresource_range =
+          vkex::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT, mip, 1);
+      result = device->CreateTexture(mip_create_info, &m_hiz_mip_textures[mip]);
+      if (!result) {
+        return result;
+      }
+    }
+
+    // The cull pass reads the pyramid even before there's depth to build it
+    // from, so it rests in the read only layout between builds
+    result = vkex::TransitionImageLayout(
+        queue, m_hiz_texture, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (!result) {
+      return result;
+    }
+  }
+
+  // Per frame buffers. Draws are rewritten by the CPU every frame, commands
+  // and counters only ever touched by the GPU.
+  m_frames.resize(frame_count);
+  for (auto& frame : m_frames) {
+    vkex::Result result = asset_util::CreateStorageBuffer(
+        max_draw_count * sizeof(CullDrawData), nullptr, queue,
+        asset_util::MEMORY_USAGE_CPU_TO_GPU, &frame.draw_buffer);
+    if (!result) {
+      return result;
+    }
+
+    result = asset_util::CreateIndirectBuffer(
+        size_t(max_draw_count) * max_instance_count * kCommandStride, nullptr,
+        queue, asset_util::MEMORY_USAGE_GPU_ONLY, &frame.command_buffer);
+    if (!result) {
+      return result;
+    }
+
+    result = asset_util::CreateIndirectBuffer(
+        (GPU_CULL_COUNTER_COUNT + max_draw_count) * sizeof(uint32_t), nullptr,
+        queue, asset_util::MEMORY_USAGE_GPU_ONLY, &frame.counter_buffer);
+    if (!result) {
+      return result;
+    }
+
+    result = asset_util::CreateStorageBuffer(
+        GPU_CULL_COUNTER_COUNT * sizeof(uint32_t), nullptr, queue,
+        asset_util::MEMORY_USAGE_CPU_ONLY, &frame.readback_buffer);
+    if (!result) {
+      return result;
+    }
+
+    VkResult vk_result;
+    void* p_mapped = nullptr;
+    VKEX_VULKAN_RESULT_CALL(vk_result, frame.draw_buffer->MapMemory(&p_mapped));
+    frame.p_draws = static_cast<CullDrawData*>(p_mapped);
+
+    VKEX_VULKAN_RESULT_CALL(vk_result,
+                            frame.readback_buffer->MapMemory(&p_mapped));
+    frame.p_readback = static_cast<const uint32_t*>(p_mapped);
+  }
+
+  // Downsample sets come from their own pool since there's one per level
+  const uint32_t downsample_count = GetHiZMipCount() - 1;
+  if (downsample_count > 0) {
+    const auto& downsample = *m_shaders.p_hiz_downsample;
+
+    vkex::DescriptorPoolCreateInfo create_info = {};
+    create_info.pool_sizes =
+        downsample.program->GetInterface().GetDescriptorPoolSizes();
+    // Uniform buffers are bound as dynamic, see ConfigureDynamicUbos
+    create_info.pool_sizes.uniform_buffer_dynamic +=
+        create_info.pool_sizes.uniform_buffer;
+    create_info.pool_sizes.uniform_buffer = 0;
+    create_info.pool_sizes *= (frame_count * downsample_count);
+    vkex::Result result = device->CreateDescriptorPool(
+        create_info, &m_downsample_descriptor_pool);
+    if (!result) {
+      return result;
+    }
+
+    vkex::DescriptorSetAllocateInfo allocate_info = {};
+    allocate_info.layouts.push_back(downsample.descriptor_set_layout);
+
+    m_downsample_descriptor_sets.resize(frame_count * downsample_count);
+    for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
+      for (uint32_t mip = 1; mip <= downsample_count; mip++) {
+        auto& descriptor_set =
+            m_downsample_descriptor_sets[(frame_index * downsample_count) +
+                                         mip - 1];
+        result = m_downsample_descriptor_pool->AllocateDescriptorSets(
+            allocate_info, &descriptor_set);
+        if (!result) {
+          return result;
+        }
+        descriptor_set->UpdateDescriptor(kHiZDownsampleSourceSlot,
+                                         m_hiz_mip_textures[mip - 1]);
+        descriptor_set->UpdateDescriptor(kHiZDownsampleDestinationSlot,
+                                         m_hiz_mip_textures[mip]);
+      }
+    }
+  }
+
+  for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
+    const auto& frame = m_frames[frame_index];
+
+    // The depth source changes with the upscaling technique, so it's bound
+    // when the pyramid is built
+    m_shaders.p_hiz_build->descriptor_sets[frame_index]->UpdateDescriptor(
+        kHiZBuildLevel0Slot, m_hiz_mip_textures[0]);
+    m_shaders.p_hiz_build_ms->descriptor_sets[frame_index]->UpdateDescriptor(
+        kHiZBuildLevel0Slot, m_hiz_mip_textures[0]);
+
+    auto cull_set = m_shaders.p_cull->descriptor_sets[frame_index];
+    cull_set->UpdateDescriptor(kCullInstancesSlot, instance_buffer);
+    cull_set->UpdateDescriptor(kCullDrawsSlot, frame.draw_buffer);
+    cull_set->UpdateDescriptor(kCullHiZSlot, m_hiz_texture);
+    cull_set->UpdateDescriptor(kCullCommandsSlot, frame.command_buffer);
+    cull_set->UpdateDescriptor(kCullCountersSlot, frame.counter_buffer);
+  }
+
+  VKEX_LOG_INFO("GPU culling: " << max_draw_count << " draws x "
+                                << max_instance_count << " instances, "
+                                << GetHiZMipCount() << " Hi-Z levels");
+
+  return vkex::Result::Success;
+}
+
+void GpuCuller::UpdateConstantBufferDescriptors(uint32_t frame_index,
+                                                vkex::Buffer constant_buffer) {
+  m_shaders.p_hiz_build->descriptor_sets[frame_index]->UpdateDescriptor(
+      kHiZConstantsSlot, constant_buffer, HiZDimensionsConstants::size);
+  m_shaders.p_hiz_build_ms->descriptor_sets[frame_index]->UpdateDescriptor(
+      kHiZConstantsSlot, constant_buffer, HiZDimensionsConstants::size);
+  m_shaders.p_cull->descriptor_sets[frame_index]->UpdateDescriptor(
+      kCullConstantsSlot, constant_buffer, GpuCullConstants::size);
+
+  const uint32_t downsample_count = GetHiZMipCount() - 1;
+  for (uint32_t mip = 1; mip <= downsample_count; mip++) {
+    m_downsample_descriptor_sets[(frame_index * downsample_count) + mip - 1]
+        ->UpdateDescriptor(kHiZConstantsSlot, constant_buffer,
+                           HiZDimensionsConstants::size);
+  }
+}
+
+void GpuCuller::UpdateDraws(uint32_t frame_index, const GLTFModel& model,
+                            vkex::Span<DrawItem> items) {
+  VKEX_ASSERT(items.size() <= m_max_draw_count);
+
+  auto& frame = m_frames[frame_index];
+  const auto& scene = model.GetFlattenedScene();
+
+  for (size_t draw_index = 0; draw_index < items.size(); draw_index++) {
+    const auto& item = items[draw_index];
+    const auto& primitive =
+        model.GetMesh(uint32_t(scene.mesh_indices[item.instance_index]))
+            .primitives[item.primitive_index];
+
+    CullDrawData draw = {};
+    draw.vertexOffset = item.vertex_offset;
+
+    const auto& world_matrix =
+        scene.transforms.GetWorldMatrix(item.instance_index);
+    const auto& prev_world_matrix =
+        scene.transforms.GetPrevWorldMatrix(item.instance_index);
+
+    // The item's own range is LOD 0, coarser levels come from the primitive
+    const float world_scale = LodSelector::GetMaxScale(world_matrix);
+    draw.lodCount = 1;
+    draw.lodFirstIndex[0] = item.first_index;
+    draw.lodIndexCount[0] = item.index_count;
+    for (size_t level = 1; level < primitive.lods.size(); level++) {
+      draw.lodFirstIndex[draw.lodCount] = primitive.lods[level].first_index;
+      draw.lodIndexCount[draw.lodCount] = primitive.lods[level].index_count;
+      draw.lodError[draw.lodCount] = primitive.lods[level].error * world_scale;
+      ++draw.lodCount;
+    }
+    if (primitive.has_bounds) {
+      TransformBounds(primitive.bounds_min, primitive.bounds_max,
+                      world_matrix, &draw.boundsCenter, &draw.boundsExtent);
+      TransformBounds(primitive.bounds_min, primitive.bounds_max,
+                      prev_world_matrix, &draw.prevBoundsCenter,
+                      &draw.prevBoundsExtent);
+    } else {
+      draw.flags = GPU_CULL_FLAG_UNBOUNDED;
+    }
+
+    // Written whole, the buffer may be write combined
+    frame.p_draws[draw_index] = draw;
+  }
+
+  frame.draw_count = uint32_t(items.size());
+}
+
+void GpuCuller::ReadbackStatistics(uint32_t frame_index) {
+  auto& frame = m_frames[frame_index];
+  if (!frame.readback_pending) {
+    return;
+  }
+  frame.readback_pending = false;
+
+  m_statistics.tested_count = frame.tested_count;
+  m_statistics.frustum_culled_count =
+      frame.p_readback[GPU_CULL_COUNTER_FRUSTUM_CULLED];
+  m_statistics.occlusion_culled_count =
+      frame.p_readback[GPU_CULL_COUNTER_OCCLUSION_CULLED];
+  m_statistics.drawn_count = frame.p_readback[GPU_CULL_COUNTER_DRAWN];
+  for (uint32_t level = 0; level < LOD_MAX_COUNT; level++) {
+    m_statistics.lod_drawn_counts[level] =
+        frame.p_readback[GPU_CULL_COUNTER_LOD_DRAWN + level];
+  }
+  m_statistics.occlusion_tested = frame.occlusion_tested;
+}
+
+void GpuCuller::BuildHiZ(vkex::CommandBuffer cmd, uint32_t frame_index,
+                         ConstantBufferManager& constant_buffer_manager) {
+  const auto& history = m_depth_history;
+
+  ImageBarrier(cmd, history.texture,
+               VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+  // Every level that's read gets rewritten, so the old contents are dropped
+  ImageBarrier(cmd, m_hiz_texture, VK_IMAGE_LAYOUT_UNDEFINED,
+               VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+  HiZDimensionsConstants dims = {};
+  VkExtent2D src_extent = history.extent;
+  VkExtent2D dst_extent = HalveExtent(src_extent);
+
+  // First level straight from depth
+  {
+    const auto& build = history.multisampled ? *m_shaders.p_hiz_build_ms
+                                             : *m_shaders.p_hiz_build;
+    auto descriptor_set = build.descriptor_sets[frame_index];
+    descriptor_set->UpdateDescriptor(kHiZBuildDepthSlot, history.texture);
+
+    dims.data.srcWidth = src_extent.width;
+    dims.data.srcHeight = src_extent.height;
+    dims.data.dstWidth = dst_extent.width;
+    dims.data.dstHeight = dst_extent.height;
+    const uint32_t dynamic_offsets[] = {
+        constant_buffer_manager.UploadConstantsToDynamicBuffer(dims)};
+
+    cmd->CmdBindPipeline(build.compute_pipeline);
+    cmd->CmdBindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE,
+                               *(build.pipeline_layout), 0,
+                               {*(descriptor_set)}, dynamic_offsets);
+    cmd->CmdDispatch((dst_extent.width + kHiZGroupSize - 1) / kHiZGroupSize,
+                     (dst_extent.height + kHiZGroupSize - 1) / kHiZGroupSize,
+                     1);
+  }
+
+  // Then each level from the one above
+  const uint32_t downsample_count = GetHiZMipCount() - 1;
+  if (downsample_count > 0) {
+    const auto& downsample = *m_shaders.p_hiz_downsample;
+    cmd->CmdBindPipeline(downsample.compute_pipeline);
+
+    for (uint32_t mip = 1; mip <= downsample_count; mip++) {
+      GlobalBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT);
+
+      src_extent = dst_extent;
+      dst_extent = HalveExtent(src_extent);
+
+      dims.data.srcWidth = src_extent.width;
+      dims.data.srcHeight = src_extent.height;
+      dims.data.dstWidth = dst_extent.width;
+      dims.data.dstHeight = dst_extent.height;
+      const uint32_t dynamic_offsets[] = {
+          constant_buffer_manager.UploadConstantsToDynamicBuffer(dims)};
+
+      auto descriptor_set =
+          m_downsample_descriptor_sets[(frame_index * downsample_count) + mip -
+                                       1];
+      cmd->CmdBindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE,
+                                 *(downsample.pipeline_layout), 0,
+                                 {*(descriptor_set)}, dynamic_offsets);
+      cmd->CmdDispatch((dst_extent.width + kHiZGroupSize - 1) / kHiZGroupSize,
+                       (dst_extent.height + kHiZGroupSize - 1) / kHiZGroupSize,
+                       1);
+    }
+  }
+
+  ImageBarrier(cmd, m_hiz_texture, VK_IMAGE_LAYOUT_GENERAL,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+  ImageBarrier(cmd, history.texture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+}
+
+void GpuCuller::Record(vkex::CommandBuffer cmd, uint32_t frame_index,
+                       ConstantBufferManager& constant_buffer_manager,
+                       const vkex::float4x4& view_projection,
+                       const vkex::float3& eye_position, float lod_pixel_scale,
+                       uint32_t instance_count, bool occlusion_enabled) {
+  VKEX_ASSERT(instance_count <= m_max_instance_count);
+
+  auto& frame = m_frames[frame_index];
+  const bool occlusion = occlusion_enabled && m_depth_history_valid;
+
+  if (occlusion) {
+    BuildHiZ(cmd, frame_index, constant_buffer_manager);
+  }
+
+  cmd->CmdFillBuffer(*(frame.counter_buffer), 0, VK_WHOLE_SIZE, 0);
+  GlobalBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+  if ((frame.draw_count > 0) && (instance_count > 0)) {
+    GpuCullConstants constants = {};
+    constants.data.viewProjectionMatrix = view_projection;
+    constants.data.hizViewProjectionMatrix = m_depth_history.view_projection;
+    constants.data.instanceCount = instance_count;
+    constants.data.drawCount = frame.draw_count;
+    constants.data.maxInstanceCount = m_max_instance_count;
+    constants.data.occlusionEnabled = occlusion ? 1 : 0;
+    constants.data.depthWidth = m_depth_history.extent.width;
+    constants.data.depthHeight = m_depth_history.extent.height;
+    constants.data.hizMipCount = GetHiZMipCount();
+    constants.data.lodPixelScale = lod_pixel_scale;
+    constants.data.eyePosition = eye_position;
+    const uint32_t dynamic_offsets[] = {
+        constant_buffer_manager.UploadConstantsToDynamicBuffer(constants)};
+
+    const auto& cull = *m_shaders.p_cull;
+    cmd->CmdBindPipeline(cull.compute_pipeline);
+    cmd->CmdBindDescriptorSets(
+        VK_PIPELINE_BIND_POINT_COMPUTE, *(cull.pipeline_layout), 0,
+        {*(cull.descriptor_sets[frame_index])}, dynamic_offsets);
+
+    // One row of groups per draw list item
+    cmd->CmdDispatch(
+        (instance_count + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE,
+        frame.draw_count, 1);
+  }
+
+  GlobalBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                    VK_ACCESS_TRANSFER_READ_BIT);
+
+  VkBufferCopy region = {};
+  region.size = GPU_CULL_COUNTER_COUNT * sizeof(uint32_t);
+  cmd->CmdCopyBuffer(*(frame.counter_buffer), *(frame.readback_buffer), 1,
+                     &region);
+  GlobalBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                VK_ACCESS_HOST_READ_BIT);
+
+  frame.tested_count = frame.draw_count * instance_count;
+  frame.occlusion_tested = occlusion;
+  frame.readback_pending = true;
+}
+
+void GpuCuller::SetDepthHistory(vkex::Texture depth_texture, VkExtent2D extent,
+                                bool multisampled,
+                                const vkex::float4x4& view_projection) {
+  m_depth_history.texture = depth_texture;
+  m_depth_history.extent = extent;
+  m_depth_history.multisampled = multisampled;
+  m_depth_history.view_projection = view_projection;
+  m_depth_history_valid = true;
+}
+
+void GpuCuller::ClearDepthHistory() { m_depth_history_valid = false; }
+
+VkDeviceSize GpuCuller::GetCommandOffset(uint32_t draw_index) const {
+  return VkDeviceSize(draw_index) * m_max_instance_count * kCommandStride;
+}
+
+VkDeviceSize GpuCuller::GetCountOffset(uint32_t draw_index) {
+  return VkDeviceSize(GPU_CULL_COUNTER_COUNT + draw_index) * sizeof(uint32_t);
+}
+
+void GpuCuller::GetStatistics(GpuCullStatistics* p_statistics) const {
+  *p_statistics = m_statistics;
+}
@@ -0,0 +1,167 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __GPU_CULLER_H__
+#define __GPU_CULLER_H__
+
+#include "ConstantBufferManager.h"
+#include "DrawList.h"
+
+// Declared in AppCore.h and ConstantBufferStructs.h, which include this header
+// or rely on AppCore.h's aliases
+struct GeneratedShaderState;
+struct CullDrawData;
+
+struct GpuCullStatistics {
+  // One per instance per draw list item
+  uint32_t tested_count;
+  uint32_t frustum_culled_count;
+  uint32_t occlusion_culled_count;
+  uint32_t drawn_count;
+  // False when there was no previous frame depth to test against
+  bool occlusion_tested;
+  // Drawn instances at each level of detail
+  uint32_t lod_drawn_counts[LOD_MAX_COUNT];
+};
+
+// Compute shaders the culler records, owned by the app's shader list
+struct GpuCullShaders {
+  const GeneratedShaderState* p_hiz_build;
+  const GeneratedShaderState* p_hiz_build_ms;
+  const GeneratedShaderState* p_hiz_downsample;
+  const GeneratedShaderState* p_cull;
+};
+
+// Culls stress scene instances on the GPU and writes the surviving draws as
+// indirect commands, so the scene pass records one
+// vkCmdDrawIndexedIndirectCount per draw list item however many instances
+// there are.
+//
+// Every instance of every item is tested against the frustum, then against a
+// hierarchical-Z pyramid built from the depth the scene pass left behind last
+// frame. The pyramid keeps the farthest depth per texel, which makes the test
+// conservative against the old depth, but anything that comes out from
+// behind an occluder shows up one frame late.
+//
+// Each item owns a run of max_instance_count commands in the frame's command
+// buffer, and a draw count in the frame's counter buffer after the
+// statistics counters.
+class GpuCuller {
+ public:
+  GpuCuller() {}
+  virtual ~GpuCuller() {}
+
+  enum GpuCullerConstants {
+    kCommandStride = sizeof(VkDrawIndexedIndirectCommand),
+  };
+
+  vkex::Result Initialize(vkex::Queue queue, uint32_t frame_count,
+                          const GpuCullShaders& shaders,
+                          uint32_t max_draw_count, uint32_t max_instance_count,
+                          VkExtent2D max_depth_extent,
+                          vkex::Buffer instance_buffer);
+  bool IsInitialized() const { return !m_frames.empty(); }
+
+  void UpdateConstantBufferDescriptors(uint32_t frame_index,
+                                       vkex::Buffer constant_buffer);
+
+  // Writes the bounds and draw arguments of the frame's draw list, in list
+  // order
+  void UpdateDraws(uint32_t frame_index, const GLTFModel& model,
+                   vkex::Span<DrawItem> items);
+
+  // Picks up the counters from the last time the frame index was recorded.
+  // The frame's fence has to have been waited on.
+  void ReadbackStatistics(uint32_t frame_index);
+
+  // Builds the Hi-Z pyramid, when there is depth from the previous frame and
+  // occlusion culling is enabled, then culls. Recorded outside a render pass.
+  // Surviving instances pick their own level of detail, see
+  // LodSelector::GetScaledPixelScale for 'lod_pixel_scale'.
+  void Record(vkex::CommandBuffer cmd, uint32_t frame_index,
+              ConstantBufferManager& constant_buffer_manager,
+              const vkex::float4x4& view_projection,
+              const vkex::float3& eye_position, float lod_pixel_scale,
+              uint32_t instance_count, bool occlusion_enabled);
+
+  // The depth the culled scene pass rendered this frame, with the camera it
+  // used. It becomes the Hi-Z source for the next frame, so the texture has
+  // to be left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL.
+  void SetDepthHistory(vkex::Texture depth_texture, VkExtent2D extent,
+                       bool multisampled, const vkex::float4x4& view_projection);
+  void ClearDepthHistory();
+
+  vkex::Buffer GetCommandBuffer(uint32_t frame_index) const {
+    return m_frames[frame_index].command_buffer;
+  }
+  vkex::Buffer GetCounterBuffer(uint32_t frame_index) const {
+    return m_frames[frame_index].counter_buffer;
+  }
+  VkDeviceSize GetCommandOffset(uint32_t draw_index) const;
+  static VkDeviceSize GetCountOffset(uint32_t draw_index);
+
+  uint32_t GetHiZMipCount() const { return uint32_t(m_hiz_mip_textures.size()); }
+  void GetStatistics(GpuCullStatistics* p_statistics) const;
+
+ private:
+  void BuildHiZ(vkex::CommandBuffer cmd, uint32_t frame_index,
+                ConstantBufferManager& constant_buffer_manager);
+
+ private:
+  struct FrameResources {
+    vkex::Buffer draw_buffer = nullptr;
+    CullDrawData* p_draws = nullptr;
+    vkex::Buffer command_buffer = nullptr;
+    vkex::Buffer counter_buffer = nullptr;
+    // Host copy of the statistics counters
+    vkex::Buffer readback_buffer = nullptr;
+    const uint32_t* p_readback = nullptr;
+
+    uint32_t draw_count = 0;
+    uint32_t tested_count = 0;
+    bool occlusion_tested = false;
+    bool readback_pending = false;
+  };
+
+  struct DepthHistory {
+    vkex::Texture texture = nullptr;
+    VkExtent2D extent = {};
+    bool multisampled = false;
+    vkex::float4x4 view_projection = vkex::float4x4(1.0f);
+  };
+
+  GpuCullShaders m_shaders = {};
+  uint32_t m_max_draw_count = 0;
+  uint32_t m_max_instance_count = 0;
+
+  std::vector<FrameResources> m_frames;
+
+  // Full chain view for the cull pass, plus one storage view per level for
+  // building it
+  vkex::Texture m_hiz_texture = nullptr;
+  std::vector<vkex::Texture> m_hiz_mip_textures;
+  vkex::DescriptorPool m_downsample_descriptor_pool = nullptr;
+  // One set per frame per level after the first, indexed as
+  // (frame_index * (mip_count - 1)) + mip - 1
+  std::vector<vkex::DescriptorSet> m_downsample_descriptor_sets;
+
+  DepthHistory m_depth_history;
+  bool m_depth_history_valid = false;
+
+  GpuCullStatistics m_statistics = {};
+};
+
+#endif  // __GPU_CULLER_H__
@@ -0,0 +1,642 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "ImageMetrics.h"
+
+#include <cmath>
+#include <thread>
+
+#include "AppCore.h"
+#include "AssetUtil.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define IMAGE_METRICS_SSE
+#include <emmintrin.h>
+#endif
+
+using MetricsConstants = vkex::ConstantBufferData<ImageMetricsData>;
+
+// Shader bindings
+static const uint32_t kMetricsConstantsSlot = 0;
+static const uint32_t kTileTestSlot = 1;
+static const uint32_t kTileReferenceSlot = 2;
+static const uint32_t kTilePartialsSlot = 3;
+static const uint32_t kReducePartialsSlot = 1;
+static const uint32_t kReduceResultsSlot = 2;
+
+static void GlobalBarrier(vkex::CommandBuffer cmd,
+                          VkPipelineStageFlags src_stage,
+                          VkAccessFlags src_access,
+                          VkPipelineStageFlags dst_stage,
+                          VkAccessFlags dst_access) {
+  VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  cmd->CmdPipelineBarrier(src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0,
+                          nullptr);
+}
+
+static uint32_t GetTileCount(uint32_t size) {
+  return (size + ImageMetrics::kTileSize - 1) / ImageMetrics::kTileSize;
+}
+
+namespace {
+
+// The constants of image_metrics_core.h
+const float kLumaWeights[3] = {0.2126f, 0.7152f, 0.0722f};
+const double kSsimC1 = 0.01 * 0.01;
+const double kSsimC2 = 0.03 * 0.03;
+const float kWhiteXYZ[3] = {0.95047f, 1.0f, 1.08883f};
+const float kLabEpsilon = 216.0f / 24389.0f;
+const float kLabKappa = 24389.0f / 27.0f;
+const float kMaxHyAB = 308.11f;
+const float kFeatureScale = 0.70710678f;
+const float kRgbToXYZ[3][3] = {
+    {0.4124564f, 0.3575761f, 0.1804375f},
+    {0.2126729f, 0.7151522f, 0.0721750f},
+    {0.0193339f, 0.1191920f, 0.9503041f},
+};
+
+// 8 bit values as the GPU reads them from a UNORM texture, and linearized
+struct ChannelTables {
+  float encoded[256];
+  float linear[256];
+};
+
+const ChannelTables& GetChannelTables() {
+  static const ChannelTables s_tables = []() {
+    ChannelTables tables = {};
+    for (uint32_t value = 0; value < 256; value++) {
+      const float c = float(value) / 255.0f;
+      tables.encoded[value] = c;
+      tables.linear[value] =
+          (c <= 0.04045f) ? (c / 12.92f) : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return tables;
+  }();
+  return s_tables;
+}
+
+// Sums of one SSIM window, matching the first shader pass
+struct WindowSums {
+  float x, y, xx, yy, xy;
+  float squared_error;
+  float perceptual_error;
+  uint32_t pixel_count;
+};
+
+// One thread's working set: a row of both images in planar form, and the
+// luma of every row a window row's gradients touch. Rows are padded to whole
+// SSE batches, padding pixels are identical in both images.
+struct RowScratch {
+  uint32_t padded_width = 0;
+  std::vector<float> test[3];
+  std::vector<float> reference[3];
+  std::vector<float> test_linear[3];
+  std::vector<float> reference_linear[3];
+  // One row above and below the window, each with a clamped pixel on either
+  // side, so pixel x is at x + 1
+  std::vector<float> test_luma[ImageMetrics::kTileSize + 2];
+  std::vector<float> reference_luma[ImageMetrics::kTileSize + 2];
+  std::vector<float> squared_error;
+  // min(HyAB / max HyAB, 1) and one minus the feature error, combined into
+  // the perceptual error with a single pow afterwards
+  std::vector<float> color_ratio;
+  std::vector<float> exponent;
+  std::vector<float> perceptual_error;
+
+  void Resize(uint32_t width) {
+    padded_width = (width + 3) & ~3u;
+    for (uint32_t channel = 0; channel < 3; channel++) {
+      test[channel].assign(padded_width, 0.0f);
+      reference[channel].assign(padded_width, 0.0f);
+      test_linear[channel].assign(padded_width, 0.0f);
+      reference_linear[channel].assign(padded_width, 0.0f);
+    }
+    for (uint32_t row = 0; row < ImageMetrics::kTileSize + 2; row++) {
+      test_luma[row].assign(padded_width + 2, 0.0f);
+      reference_luma[row].assign(padded_width + 2, 0.0f);
+    }
+    squared_error.assign(padded_width, 0.0f);
+    color_ratio.assign(padded_width, 0.0f);
+    exponent.assign(padded_width, 0.0f);
+    perceptual_error.assign(padded_width, 0.0f);
+  }
+};
+
+void UnpackRow(const uint8_t* p_row, uint32_t width,
+               std::vector<float>* p_encoded, std::vector<float>* p_linear) {
+  const auto& tables = GetChannelTables();
+  for (uint32_t x = 0; x < width; x++) {
+    for (uint32_t channel = 0; channel < 3; channel++) {
+      const uint8_t value = p_row[(x * 4) + channel];
+      p_encoded[channel][x] = tables.encoded[value];
+      p_linear[channel][x] = tables.linear[value];
+    }
+  }
+}
+
+void ComputeLumaRow(const uint8_t* p_row, uint32_t width,
+                    std::vector<float>& luma) {
+  const auto& tables = GetChannelTables();
+  for (uint32_t x = 0; x < width; x++) {
+    const uint8_t* p_pixel = p_row + (x * 4);
+    luma[x + 1] = (tables.encoded[p_pixel[0]] * kLumaWeights[0]) +
+                  (tables.encoded[p_pixel[1]] * kLumaWeights[1]) +
+                  (tables.encoded[p_pixel[2]] * kLumaWeights[2]);
+  }
+  luma[0] = luma[1];
+  for (size_t x = width + 1; x < luma.size(); x++) {
+    luma[x] = luma[width];
+  }
+}
+
+#if defined(IMAGE_METRICS_SSE)
+
+__m128 AbsPs(__m128 v) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+// Cube root of positive values: a guess from dividing the exponent bits by
+// three, then Newton
+__m128 CbrtPs(__m128 v) {
+  const __m128 third = _mm_set1_ps(1.0f / 3.0f);
+  const __m128i guess_bits = _mm_add_epi32(
+      _mm_cvttps_epi32(
+          _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(v)), third)),
+      _mm_set1_epi32(709921077));
+  __m128 y = _mm_castsi128_ps(guess_bits);
+  const __m128 two_thirds = _mm_set1_ps(2.0f / 3.0f);
+  for (uint32_t iteration = 0; iteration < 3; iteration++) {
+    y = _mm_add_ps(_mm_mul_ps(two_thirds, y),
+                   _mm_mul_ps(third, _mm_div_ps(v, _mm_mul_ps(y, y))));
+  }
+  return y;
+}
+
+__m128 LabFPs(__m128 t) {
+  const __m128 linear =
+      _mm_div_ps(_mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(kLabKappa)),
+                            _mm_set1_ps(16.0f)),
+                 _mm_set1_ps(116.0f));
+  const __m128 curved = CbrtPs(_mm_max_ps(t, _mm_set1_ps(kLabEpsilon)));
+  const __m128 mask = _mm_cmpgt_ps(t, _mm_set1_ps(kLabEpsilon));
+  return _mm_or_ps(_mm_and_ps(mask, curved), _mm_andnot_ps(mask, linear));
+}
+
+void LinearToLabPs(__m128 r, __m128 g, __m128 b, __m128* p_lab) {
+  __m128 f[3];
+  for (uint32_t row = 0; row < 3; row++) {
+    const __m128 value = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(kRgbToXYZ[row][0])),
+                   _mm_mul_ps(g, _mm_set1_ps(kRgbToXYZ[row][1]))),
+        _mm_mul_ps(b, _mm_set1_ps(kRgbToXYZ[row][2])));
+    f[row] = LabFPs(_mm_div_ps(value, _mm_set1_ps(kWhiteXYZ[row])));
+  }
+  p_lab[0] = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(116.0f), f[1]),
+                        _mm_set1_ps(16.0f));
+  p_lab[1] = _mm_mul_ps(_mm_set1_ps(500.0f), _mm_sub_ps(f[0], f[1]));
+  p_lab[2] = _mm_mul_ps(_mm_set1_ps(200.0f), _mm_sub_ps(f[1], f[2]));
+}
+
+// Sobel magnitude around four pixels, rows of luma with the border pixel
+__m128 GradientMagnitudePs(const float* p_above, const float* p_center,
+                           const float* p_below) {
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 tl = _mm_loadu_ps(p_above);
+  const __m128 t = _mm_loadu_ps(p_above + 1);
+  const __m128 tr = _mm_loadu_ps(p_above + 2);
+  const __m128 l = _mm_loadu_ps(p_center);
+  const __m128 r = _mm_loadu_ps(p_center + 2);
+  const __m128 bl = _mm_loadu_ps(p_below);
+  const __m128 b = _mm_loadu_ps(p_below + 1);
+  const __m128 br = _mm_loadu_ps(p_below + 2);
+
+  const __m128 gx =
+      _mm_sub_ps(_mm_add_ps(_mm_add_ps(tr, _mm_mul_ps(two, r)), br),
+                 _mm_add_ps(_mm_add_ps(tl, _mm_mul_ps(two, l)), bl));
+  const __m128 gy =
+      _mm_sub_ps(_mm_add_ps(_mm_add_ps(bl, _mm_mul_ps(two, b)), br),
+                 _mm_add_ps(_mm_add_ps(tl, _mm_mul_ps(two, t)), tr));
+  return _mm_mul_ps(
+      _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy))),
+      _mm_set1_ps(0.25f));
+}
+
+// Squared error, color ratio and exponent for window row 'row' of the
+// scratch, four pixels at a time
+void EvaluateRow(RowScratch& scratch, uint32_t row) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const float* p_test_luma[3] = {scratch.test_luma[row].data(),
+                                 scratch.test_luma[row + 1].data(),
+                                 scratch.test_luma[row + 2].data()};
+  const float* p_reference_luma[3] = {scratch.reference_luma[row].data(),
+                                      scratch.reference_luma[row + 1].data(),
+                                      scratch.reference_luma[row + 2].data()};
+
+  for (uint32_t x = 0; x < scratch.padded_width; x += 4) {
+    __m128 squared_error = _mm_setzero_ps();
+    __m128 test_linear[3];
+    __m128 reference_linear[3];
+    for (uint32_t channel = 0; channel < 3; channel++) {
+      const __m128 delta =
+          _mm_sub_ps(_mm_loadu_ps(scratch.test[channel].data() + x),
+                     _mm_loadu_ps(scratch.reference[channel].data() + x));
+      squared_error = _mm_add_ps(squared_error, _mm_mul_ps(delta, delta));
+      test_linear[channel] =
+          _mm_loadu_ps(scratch.test_linear[channel].data() + x);
+      reference_linear[channel] =
+          _mm_loadu_ps(scratch.reference_linear[channel].data() + x);
+    }
+
+    __m128 test_lab[3];
+    __m128 reference_lab[3];
+    LinearToLabPs(test_linear[0], test_linear[1], test_linear[2], test_lab);
+    LinearToLabPs(reference_linear[0], reference_linear[1],
+                  reference_linear[2], reference_lab);
+    const __m128 delta_a = _mm_sub_ps(test_lab[1], reference_lab[1]);
+    const __m128 delta_b = _mm_sub_ps(test_lab[2], reference_lab[2]);
+    const __m128 hyab = _mm_add_ps(
+        AbsPs(_mm_sub_ps(test_lab[0], reference_lab[0])),
+        _mm_sqrt_ps(
+            _mm_add_ps(_mm_mul_ps(delta_a, delta_a),
+                       _mm_mul_ps(delta_b, delta_b))));
+    const __m128 color_ratio =
+        _mm_min_ps(_mm_div_ps(hyab, _mm_set1_ps(kMaxHyAB)), one);
+
+    const __m128 test_gradient = GradientMagnitudePs(
+        p_test_luma[0] + x, p_test_luma[1] + x, p_test_luma[2] + x);
+    const __m128 reference_gradient =
+        GradientMagnitudePs(p_reference_luma[0] + x, p_reference_luma[1] + x,
+                            p_reference_luma[2] + x);
+    const __m128 feature_error = _mm_sqrt_ps(_mm_min_ps(
+        _mm_mul_ps(AbsPs(_mm_sub_ps(test_gradient, reference_gradient)),
+                   _mm_set1_ps(kFeatureScale)),
+        one));
+
+    _mm_storeu_ps(scratch.squared_error.data() + x, squared_error);
+    _mm_storeu_ps(scratch.color_ratio.data() + x, color_ratio);
+    _mm_storeu_ps(scratch.exponent.data() + x, _mm_sub_ps(one, feature_error));
+  }
+}
+
+#else
+
+float LabF(float t) {
+  return (t > kLabEpsilon) ? cbrtf(t) : (((t * kLabKappa) + 16.0f) / 116.0f);
+}
+
+void LinearToLab(float r, float g, float b, float* p_lab) {
+  float f[3];
+  for (uint32_t row = 0; row < 3; row++) {
+    f[row] = LabF(((r * kRgbToXYZ[row][0]) + (g * kRgbToXYZ[row][1]) +
+                   (b * kRgbToXYZ[row][2])) /
+                  kWhiteXYZ[row]);
+  }
+  p_lab[0] = (116.0f * f[1]) - 16.0f;
+  p_lab[1] = 500.0f * (f[0] - f[1]);
+  p_lab[2] = 200.0f * (f[1] - f[2]);
+}
+
+float GradientMagnitude(const float* p_above, const float* p_center,
+                        const float* p_below) {
+  const float gx = (p_above[2] + (2.0f * p_center[2]) + p_below[2]) -
+                   (p_above[0] + (2.0f * p_center[0]) + p_below[0]);
+  const float gy = (p_below[0] + (2.0f * p_below[1]) + p_below[2]) -
+                   (p_above[0] + (2.0f * p_above[1]) + p_above[2]);
+  return sqrtf((gx * gx) + (gy * gy)) * 0.25f;
+}
+
+void EvaluateRow(RowScratch& scratch, uint32_t row) {
+  for (uint32_t x = 0; x < scratch.padded_width; x++) {
+    float squared_error = 0.0f;
+    for (uint32_t channel = 0; channel < 3; channel++) {
+      const float delta =
+          scratch.test[channel][x] - scratch.reference[channel][x];
+      squared_error += delta * delta;
+    }
+
+    float test_lab[3];
+    float reference_lab[3];
+    LinearToLab(scratch.test_linear[0][x], scratch.test_linear[1][x],
+                scratch.test_linear[2][x], test_lab);
+    LinearToLab(scratch.reference_linear[0][x],
+                scratch.reference_linear[1][x],
+                scratch.reference_linear[2][x], reference_lab);
+    const float delta_a = test_lab[1] - reference_lab[1];
+    const float delta_b = test_lab[2] - reference_lab[2];
+    const float hyab = fabsf(test_lab[0] - reference_lab[0]) +
+                       sqrtf((delta_a * delta_a) + (delta_b * delta_b));
+
+    const float test_gradient = GradientMagnitude(
+        scratch.test_luma[row].data() + x,
+        scratch.test_luma[row + 1].data() + x,
+        scratch.test_luma[row + 2].data() + x);
+    const float reference_gradient = GradientMagnitude(
+        scratch.reference_luma[row].data() + x,
+        scratch.reference_luma[row + 1].data() + x,
+        scratch.reference_luma[row + 2].data() + x);
+    const float feature_error = sqrtf(std::min(
+        fabsf(test_gradient - reference_gradient) * kFeatureScale, 1.0f));
+
+    scratch.squared_error[x] = squared_error;
+    scratch.color_ratio[x] = std::min(hyab / kMaxHyAB, 1.0f);
+    scratch.exponent[x] = 1.0f - feature_error;
+  }
+}
+
+#endif  // defined(IMAGE_METRICS_SSE)
+
+// Adds window row 'row' of the scratch into the windows it crosses
+void AccumulateRow(RowScratch& scratch, uint32_t row, uint32_t width,
+                   WindowSums* p_windows) {
+  // The color error's power of 0.7 is folded into the one pow, as in the
+  // shader
+  for (uint32_t x = 0; x < width; x++) {
+    const float exponent = scratch.exponent[x];
+    scratch.perceptual_error[x] =
+        (exponent > 0.0f) ? powf(scratch.color_ratio[x], 0.7f * exponent)
+                          : 1.0f;
+  }
+
+  const float* p_test_luma = scratch.test_luma[row + 1].data() + 1;
+  const float* p_reference_luma = scratch.reference_luma[row + 1].data() + 1;
+  for (uint32_t x = 0; x < width; x++) {
+    auto& window = p_windows[x / ImageMetrics::kTileSize];
+    const float luma_x = p_test_luma[x];
+    const float luma_y = p_reference_luma[x];
+    window.x += luma_x;
+    window.y += luma_y;
+    window.xx += luma_x * luma_x;
+    window.yy += luma_y * luma_y;
+    window.xy += luma_x * luma_y;
+    window.squared_error += scratch.squared_error[x];
+    window.perceptual_error += scratch.perceptual_error[x];
+    ++window.pixel_count;
+  }
+}
+
+double WindowSsim(const WindowSums& window) {
+  const double pixel_count = double(window.pixel_count);
+  const double mean_x = window.x / pixel_count;
+  const double mean_y = window.y / pixel_count;
+  const double variance_x = (window.xx / pixel_count) - (mean_x * mean_x);
+  const double variance_y = (window.yy / pixel_count) - (mean_y * mean_y);
+  const double covariance = (window.xy / pixel_count) - (mean_x * mean_y);
+  return (((2.0 * mean_x * mean_y) + kSsimC1) *
+          ((2.0 * covariance) + kSsimC2)) /
+         (((mean_x * mean_x) + (mean_y * mean_y) + kSsimC1) *
+          (variance_x + variance_y + kSsimC2));
+}
+
+// Window rows [begin, end) of the images into the four image sums
+void CompareWindowRows(const uint8_t* p_test, const uint8_t* p_reference,
+                       uint32_t width, uint32_t height, uint32_t row_stride,
+                       uint32_t begin, uint32_t end, double* p_sums) {
+  RowScratch scratch;
+  scratch.Resize(width);
+  std::vector<WindowSums> windows(GetTileCount(width));
+
+  for (uint32_t window_row = begin; window_row < end; window_row++) {
+    const uint32_t y0 = window_row * ImageMetrics::kTileSize;
+    const uint32_t row_count =
+        std::min<uint32_t>(ImageMetrics::kTileSize, height - y0);
+
+    // Luma from the row above the window to the one below, clamped
+    for (uint32_t luma_row = 0; luma_row < row_count + 2; luma_row++) {
+      const int32_t y = std::min<int32_t>(
+          std::max<int32_t>(int32_t(y0 + luma_row) - 1, 0), height - 1);
+      ComputeLumaRow(p_test + (size_t(y) * row_stride), width,
+                     scratch.test_luma[luma_row]);
+      ComputeLumaRow(p_reference + (size_t(y) * row_stride), width,
+                     scratch.reference_luma[luma_row]);
+    }
+
+    std::fill(windows.begin(), windows.end(), WindowSums{});
+    for (uint32_t row = 0; row < row_count; row++) {
+      const size_t offset = size_t(y0 + row) * row_stride;
+      UnpackRow(p_test + offset, width, scratch.test, scratch.test_linear);
+      UnpackRow(p_reference + offset, width, scratch.reference,
+                scratch.reference_linear);
+      EvaluateRow(scratch, row);
+      AccumulateRow(scratch, row, width, windows.data());
+    }
+
+    for (const auto& window : windows) {
+      p_sums[0] += window.squared_error;
+      p_sums[1] += WindowSsim(window) * window.pixel_count;
+      p_sums[2] += window.perceptual_error;
+      p_sums[3] += window.pixel_count;
+    }
+  }
+}
+
+}  // namespace
+
+vkex::Result ImageMetrics::Initialize(vkex::Queue queue, uint32_t frame_count,
+                                      const ImageMetricsShaders& shaders,
+                                      VkExtent2D max_extent) {
+  m_shaders = shaders;
+  m_max_extent = max_extent;
+
+  const uint32_t tile_count =
+      GetTileCount(max_extent.width) * GetTileCount(max_extent.height);
+
+  m_frames.resize(frame_count);
+  for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
+    auto& frame = m_frames[frame_index];
+
+    vkex::Result result = asset_util::CreateStorageBuffer(
+        size_t(tile_count) * 4 * sizeof(float), nullptr, queue,
+        asset_util::MEMORY_USAGE_GPU_ONLY, &frame.partial_buffer);
+    if (!result) {
+      return result;
+    }
+
+    // Small enough for the second pass to write straight to host memory
+    result = asset_util::CreateStorageBuffer(
+        4 * sizeof(float), nullptr, queue, asset_util::MEMORY_USAGE_CPU_ONLY,
+        &frame.result_buffer);
+    if (!result) {
+      return result;
+    }
+
+    VkResult vk_result;
+    void* p_mapped = nullptr;
+    VKEX_VULKAN_RESULT_CALL(vk_result,
+                            frame.result_buffer->MapMemory(&p_mapped));
+    frame.p_results = static_cast<const float*>(p_mapped);
+
+    m_shaders.p_tile->descriptor_sets[frame_index]->UpdateDescriptor(
+        kTilePartialsSlot, frame.partial_buffer);
+    auto reduce_set = m_shaders.p_reduce->descriptor_sets[frame_index];
+    reduce_set->UpdateDescriptor(kReducePartialsSlot, frame.partial_buffer);
+    reduce_set->UpdateDescriptor(kReduceResultsSlot, frame.result_buffer);
+  }
+
+  return vkex::Result::Success;
+}
+
+void ImageMetrics::UpdateConstantBufferDescriptors(
+    uint32_t frame_index, vkex::Buffer constant_buffer) {
+  m_shaders.p_tile->descriptor_sets[frame_index]->UpdateDescriptor(
+      kMetricsConstantsSlot, constant_buffer, MetricsConstants::size);
+  m_shaders.p_reduce->descriptor_sets[frame_index]->UpdateDescriptor(
+      kMetricsConstantsSlot, constant_buffer, MetricsConstants::size);
+}
+
+void ImageMetrics::ReadbackResults(uint32_t frame_index) {
+  auto& frame = m_frames[frame_index];
+  if (!frame.readback_pending) {
+    return;
+  }
+  frame.readback_pending = false;
+
+  const double sums[4] = {frame.p_results[0], frame.p_results[1],
+                          frame.p_results[2], frame.p_results[3]};
+  ResolveSums(sums, &m_metrics);
+}
+
+void ImageMetrics::Record(vkex::CommandBuffer cmd, uint32_t frame_index,
+                          ConstantBufferManager& constant_buffer_manager,
+                          vkex::Texture test_texture,
+                          vkex::Texture reference_texture, VkExtent2D extent) {
+  VKEX_ASSERT((extent.width <= m_max_extent.width) &&
+              (extent.height <= m_max_extent.height));
+
+  auto& frame = m_frames[frame_index];
+
+  MetricsConstants constants = {};
+  constants.data.width = extent.width;
+  constants.data.height = extent.height;
+  constants.data.tileCountX = GetTileCount(extent.width);
+  constants.data.tileCount =
+      constants.data.tileCountX * GetTileCount(extent.height);
+  const uint32_t dynamic_offsets[] = {
+      constant_buffer_manager.UploadConstantsToDynamicBuffer(constants)};
+
+  // The upscaled image alternates between history textures, so both images
+  // are bound every time
+  {
+    const auto& tile = *m_shaders.p_tile;
+    auto descriptor_set = tile.descriptor_sets[frame_index];
+    descriptor_set->UpdateDescriptor(kTileTestSlot, test_texture);
+    descriptor_set->UpdateDescriptor(kTileReferenceSlot, reference_texture);
+
+    cmd->CmdBindPipeline(tile.compute_pipeline);
+    cmd->CmdBindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE,
+                               *(tile.pipeline_layout), 0, {*(descriptor_set)},
+                               dynamic_offsets);
+    cmd->CmdDispatch(constants.data.tileCountX, GetTileCount(extent.height),
+                     1);
+  }
+
+  GlobalBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT);
+
+  {
+    const auto& reduce = *m_shaders.p_reduce;
+    cmd->CmdBindPipeline(reduce.compute_pipeline);
+    cmd->CmdBindDescriptorSets(
+        VK_PIPELINE_BIND_POINT_COMPUTE, *(reduce.pipeline_layout), 0,
+        {*(reduce.descriptor_sets[frame_index])}, dynamic_offsets);
+    cmd->CmdDispatch(1, 1, 1);
+  }
+
+  GlobalBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                VK_ACCESS_HOST_READ_BIT);
+
+  frame.readback_pending = true;
+}
+
+void ImageMetrics::GetMetrics(ImageQualityMetrics* p_metrics) const {
+  *p_metrics = m_metrics;
+}
+
+void ImageMetrics::Compare(const uint8_t* p_test, const uint8_t* p_reference,
+                           uint32_t width, uint32_t height,
+                           uint32_t row_stride, uint32_t thread_count,
+                           ImageQualityMetrics* p_metrics) {
+  *p_metrics = {};
+  if ((width == 0) || (height == 0)) {
+    return;
+  }
+
+  const uint32_t window_row_count = GetTileCount(height);
+  if (thread_count == 0) {
+    thread_count = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+  }
+  thread_count = std::min(thread_count, window_row_count);
+
+  // Whole window rows per thread, so no window is split between threads
+  std::vector<double> thread_sums(size_t(thread_count) * 4, 0.0);
+  std::vector<std::thread> threads;
+  for (uint32_t thread_index = 1; thread_index < thread_count;
+       thread_index++) {
+    threads.emplace_back([=, &thread_sums]() {
+      CompareWindowRows(
+          p_test, p_reference, width, height, row_stride,
+          (window_row_count * thread_index) / thread_count,
+          (window_row_count * (thread_index + 1)) / thread_count,
+          thread_sums.data() + (size_t(thread_index) * 4));
+    });
+  }
+  CompareWindowRows(p_test, p_reference, width, height, row_stride, 0,
+                    window_row_count / thread_count, thread_sums.data());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  double sums[4] = {};
+  for (uint32_t thread_index = 0; thread_index < thread_count;
+       thread_index++) {
+    for (uint32_t sum = 0; sum < 4; sum++) {
+      sums[sum] += thread_sums[(size_t(thread_index) * 4) + sum];
+    }
+  }
+  ResolveSums(sums, p_metrics);
+}
+
+const char* ImageMetrics::GetKernelName() {
+#if defined(IMAGE_METRICS_SSE)
+  return "SSE2";
+#else
+  return "Scalar";
+#endif
+}
+
+void ImageMetrics::ResolveSums(const double sums[4],
+                               ImageQualityMetrics* p_metrics) {
+  const double pixel_count = sums[3];
+  if (pixel_count < 1.0) {
+    *p_metrics = {};
+    return;
+  }
+
+  const double mean_squared_error = sums[0] / (3.0 * pixel_count);
+  p_metrics->psnr =
+      (mean_squared_error > 0.0)
+          ? std::min(10.0 * log10(1.0 / mean_squared_error), double(kMaxPsnr))
+          : double(kMaxPsnr);
+  p_metrics->ssim = sums[1] / pixel_count;
+  p_metrics->perceptual_error = sums[2] / pixel_count;
+  p_metrics->pixel_count = uint64_t(pixel_count + 0.5);
+  p_metrics->valid = true;
+}
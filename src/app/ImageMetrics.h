@@ -0,0 +1,117 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __IMAGE_METRICS_H__
+#define __IMAGE_METRICS_H__
+
+#include "ConstantBufferManager.h"
+#include "SharedShaderConstants.h"
+
+// Declared in AppCore.h
+struct GeneratedShaderState;
+
+struct ImageQualityMetrics {
+  // Of the RGB error, in dB, capped at ImageMetrics::kMaxPsnr for identical
+  // images
+  double psnr;
+  // Mean luma SSIM over 8x8 windows, 1 for identical images
+  double ssim;
+  // Mean FLIP-style error per pixel, 0 for identical images
+  double perceptual_error;
+  uint64_t pixel_count;
+  // False until a measurement has been read back
+  bool valid;
+};
+
+// Compute shaders the metrics record, owned by the app's shader list
+struct ImageMetricsShaders {
+  const GeneratedShaderState* p_tile;
+  const GeneratedShaderState* p_reduce;
+};
+
+// Measures how far an upscaled image is from the natively rendered
+// reference, as PSNR, SSIM and a FLIP-style perceptual error, so the
+// quality of each upscaling technique is a number next to its cost.
+//
+// The GPU version reduces the two target resolution images in two compute
+// passes, see image_metrics_core.h, into a host visible buffer per frame.
+// The results are picked up when the frame index comes around again, so
+// they trail the frame they measure by the frames in flight.
+//
+// Compare() runs the same math on the CPU, split over threads with SSE2 for
+// the per pixel work, for frames saved to disk.
+class ImageMetrics {
+ public:
+  ImageMetrics() {}
+  virtual ~ImageMetrics() {}
+
+  enum ImageMetricsConstants {
+    kTileSize = IMAGE_METRICS_TILE_SIZE,
+    kMaxPsnr = 100,
+  };
+
+  vkex::Result Initialize(vkex::Queue queue, uint32_t frame_count,
+                          const ImageMetricsShaders& shaders,
+                          VkExtent2D max_extent);
+  bool IsInitialized() const { return !m_frames.empty(); }
+
+  void UpdateConstantBufferDescriptors(uint32_t frame_index,
+                                       vkex::Buffer constant_buffer);
+
+  // Picks up the results from the last time the frame index was recorded.
+  // The frame's fence has to have been waited on.
+  void ReadbackResults(uint32_t frame_index);
+
+  // Measures 'extent' of 'test_texture' against 'reference_texture', both in
+  // SHADER_READ_ONLY_OPTIMAL. Recorded outside a render pass.
+  void Record(vkex::CommandBuffer cmd, uint32_t frame_index,
+              ConstantBufferManager& constant_buffer_manager,
+              vkex::Texture test_texture, vkex::Texture reference_texture,
+              VkExtent2D extent);
+
+  void GetMetrics(ImageQualityMetrics* p_metrics) const;
+
+  // The CPU version, on two RGBA8 images of the same size and row stride in
+  // bytes. Zero threads uses every hardware thread.
+  static void Compare(const uint8_t* p_test, const uint8_t* p_reference,
+                      uint32_t width, uint32_t height, uint32_t row_stride,
+                      uint32_t thread_count, ImageQualityMetrics* p_metrics);
+  static const char* GetKernelName();
+
+ private:
+  // Squared RGB error, SSIM times pixel count, perceptual error and pixel
+  // count, summed over the image
+  static void ResolveSums(const double sums[4], ImageQualityMetrics* p_metrics);
+
+ private:
+  struct FrameResources {
+    // One float4 of sums per window
+    vkex::Buffer partial_buffer = nullptr;
+    // The sums over the whole image, written by the second pass
+    vkex::Buffer result_buffer = nullptr;
+    const float* p_results = nullptr;
+    bool readback_pending = false;
+  };
+
+  ImageMetricsShaders m_shaders = {};
+  VkExtent2D m_max_extent = {};
+
+  std::vector<FrameResources> m_frames;
+
+  ImageQualityMetrics m_metrics = {};
+};
+
+#endif  // __IMAGE_METRICS_H__
@@ -0,0 +1,97 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+float LodSelector::ComputePixelScale(const vkex::float4x4& projection,
+                                     uint32_t render_height) {
+  // The projection's Y scale is 1 / tan(fov / 2), flipped for Vulkan
+  return fabsf(projection[1][1]) * 0.5f * float(render_height);
+}
+
+float LodSelector::GetMaxScale(const vkex::float4x4& matrix) {
+  const float scale_x = glm::length(vkex::float3(matrix[0]));
+  const float scale_y = glm::length(vkex::float3(matrix[1]));
+  const float scale_z = glm::length(vkex::float3(matrix[2]));
+  return std::max(std::max(scale_x, scale_y), scale_z);
+}
+
+float LodSelector::GetScaledPixelScale(float pixel_scale) const {
+  return (m_error_threshold > 0.0f) ? (pixel_scale / m_error_threshold) : 0.0f;
+}
+
+void LodSelector::Select(const GLTFModel& model,
+                         const vkex::float3& eye_position, float pixel_scale) {
+  m_levels.clear();
+  m_statistics = {};
+
+  const float scaled_pixel_scale = GetScaledPixelScale(pixel_scale);
+  const auto& scene = model.GetFlattenedScene();
+  const size_t instance_count = scene.mesh_indices.size();
+  for (size_t instance = 0; instance < instance_count; instance++) {
+    const int32_t mesh_index = scene.mesh_indices[instance];
+    if (mesh_index < 0) {
+      continue;
+    }
+
+    const auto& world_matrix =
+        scene.transforms.GetWorldMatrix(uint32_t(instance));
+    const float world_scale = GetMaxScale(world_matrix);
+    for (const auto& primitive :
+         model.GetMesh(uint32_t(mesh_index)).primitives) {
+      uint32_t level = 0;
+      if ((scaled_pixel_scale > 0.0f) && primitive.has_bounds &&
+          (primitive.lods.size() > 1)) {
+        // Distance to the nearest point of the bounding sphere, inside it
+        // everything is full detail
+        const vkex::float3 center =
+            vkex::float3(world_matrix *
+                         vkex::float4((primitive.bounds_min +
+                                       primitive.bounds_max) *
+                                          0.5f,
+                                      1.0f));
+        const float radius =
+            glm::length(primitive.bounds_max - primitive.bounds_min) * 0.5f *
+            world_scale;
+        const float distance = glm::length(center - eye_position) - radius;
+        if (distance > 0.0f) {
+          for (level = uint32_t(primitive.lods.size()) - 1; level > 0;
+               level--) {
+            const float error_pixels = primitive.lods[level].error *
+                                       world_scale * scaled_pixel_scale;
+            if (error_pixels <= distance) {
+              break;
+            }
+          }
+        }
+      }
+
+      m_levels.push_back(uint8_t(level));
+      ++m_statistics.level_counts[level];
+      m_statistics.index_count += primitive.lods.empty()
+                                      ? primitive.index_count
+                                      : primitive.lods[level].index_count;
+      m_statistics.full_detail_index_count += primitive.index_count;
+    }
+  }
+}
+
+void LodSelector::GetStatistics(LodStatistics* p_statistics) const {
+  *p_statistics = m_statistics;
+}
@@ -0,0 +1,75 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __LOD_SELECTOR_H__
+#define __LOD_SELECTOR_H__
+
+#include "GLTFModel.h"
+
+struct LodStatistics {
+  // Primitives drawn at each level this frame
+  uint32_t level_counts[LOD_MAX_COUNT];
+  // Indices drawn, against drawing everything at full detail
+  uint64_t index_count;
+  uint64_t full_detail_index_count;
+};
+
+// Picks a level of detail per primitive from the screen space size of its
+// simplification error: the coarsest level whose error projects to at most
+// the threshold in pixels is drawn.
+//
+// The projection is measured against the internal render area, not the
+// present resolution, so rendering at a lower internal resolution drops to
+// coarser levels along with it. The gpu_cull shader applies the same test
+// per stress scene instance.
+class LodSelector {
+ public:
+  LodSelector() {}
+  virtual ~LodSelector() {}
+
+  // Pixels covered by one unit at distance one, vertically, when rendering
+  // 'render_height' rows with 'projection'
+  static float ComputePixelScale(const vkex::float4x4& projection,
+                                 uint32_t render_height);
+  // Largest axis scale of the matrix, which scales LOD errors
+  static float GetMaxScale(const vkex::float4x4& matrix);
+
+  // Projected error allowed, in pixels. Zero keeps everything at full
+  // detail.
+  void SetErrorThreshold(float error_pixels) {
+    m_error_threshold = error_pixels;
+  }
+  float GetErrorThreshold() const { return m_error_threshold; }
+
+  // Pixel scale over the error threshold, as the gpu_cull shader takes it.
+  // Zero when LOD selection is off.
+  float GetScaledPixelScale(float pixel_scale) const;
+
+  // Picks a level for every primitive of every mesh instance in the model's
+  // flattened scene, in the order DrawList::AddModel visits them
+  void Select(const GLTFModel& model, const vkex::float3& eye_position,
+              float pixel_scale);
+  const uint8_t* GetLevels() const { return m_levels.data(); }
+
+  void GetStatistics(LodStatistics* p_statistics) const;
+
+ private:
+  float m_error_threshold = 1.0f;
+  std::vector<uint8_t> m_levels;
+  LodStatistics m_statistics = {};
+};
+
+#endif  // __LOD_SELECTOR_H__
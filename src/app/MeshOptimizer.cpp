@@ -0,0 +1,456 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mesh_optimizer {
+
+namespace {
+
+// FIFO cache simulated with timestamps: an entry stays cached until 'size'
+// more misses have been taken after it
+class FifoCache {
+ public:
+  FifoCache(size_t entry_count, uint32_t size)
+      : m_entry_times(entry_count, 0), m_size(size), m_time(size + 1) {}
+
+  // True on a miss, which caches the entry
+  bool Access(size_t entry) {
+    if ((m_time - m_entry_times[entry]) > m_size) {
+      m_entry_times[entry] = m_time++;
+      return true;
+    }
+    return false;
+  }
+
+  // Ages every entry out of the cache
+  void Flush() { m_time += m_size + 1; }
+
+ private:
+  std::vector<uint32_t> m_entry_times;
+  uint32_t m_size;
+  uint32_t m_time;
+};
+
+struct Cluster {
+  uint32_t first_triangle;
+  uint32_t triangle_count;
+  float sort_key;
+};
+
+}  // namespace
+
+uint32_t CountVertexCacheMisses(const uint32_t* p_indices, size_t index_count,
+                                size_t vertex_count) {
+  FifoCache cache(vertex_count, kVertexCacheSize);
+
+  uint32_t miss_count = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    if (cache.Access(p_indices[i])) {
+      ++miss_count;
+    }
+  }
+  return miss_count;
+}
+
+uint64_t CountVertexFetchBytes(const uint32_t* p_indices, size_t index_count,
+                               size_t vertex_count, size_t element_size) {
+  const size_t line_count =
+      ((vertex_count * element_size) + kFetchCacheLineBytes - 1) /
+      kFetchCacheLineBytes;
+  FifoCache vertex_cache(vertex_count, kVertexCacheSize);
+  FifoCache line_cache(line_count, kFetchCacheLineCount);
+
+  uint64_t fetch_bytes = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    const size_t vertex = p_indices[i];
+    if (!vertex_cache.Access(vertex)) {
+      continue;
+    }
+
+    // Elements can straddle two lines
+    const size_t first_line = (vertex * element_size) / kFetchCacheLineBytes;
+    const size_t last_line =
+        ((vertex * element_size) + element_size - 1) / kFetchCacheLineBytes;
+    for (size_t line = first_line; line <= last_line; line++) {
+      if (line_cache.Access(line)) {
+        fetch_bytes += kFetchCacheLineBytes;
+      }
+    }
+  }
+  return fetch_bytes;
+}
+
+void OptimizeVertexCache(uint32_t* p_indices, size_t index_count,
+                         size_t vertex_count,
+                         std::vector<uint32_t>* p_clusters) {
+  p_clusters->clear();
+
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // Triangles using each vertex, and how many of them are still to be
+  // emitted
+  std::vector<uint32_t> live_counts(vertex_count, 0);
+  for (size_t i = 0; i < index_count; i++) {
+    ++live_counts[p_indices[i]];
+  }
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+  for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+    adjacency_offsets[vertex + 1] =
+        adjacency_offsets[vertex] + live_counts[vertex];
+  }
+  std::vector<uint32_t> adjacency(index_count);
+  {
+    std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(),
+                                       adjacency_offsets.end() - 1);
+    for (size_t i = 0; i < index_count; i++) {
+      adjacency[fill_offsets[p_indices[i]]++] = uint32_t(i / 3);
+    }
+  }
+
+  std::vector<uint32_t> cache_times(vertex_count, 0);
+  std::vector<uint8_t> emitted(triangle_count, 0);
+  std::vector<uint32_t> dead_ends;
+  dead_ends.reserve(index_count);
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(index_count);
+
+  uint32_t time = kVertexCacheSize + 1;
+  size_t cursor = 0;
+
+  // Falls back to the most recently used vertex with triangles left, then
+  // to the next one in input order. Either way the cache has gone cold.
+  auto skip_dead_end = [&]() -> int64_t {
+    while (!dead_ends.empty()) {
+      const uint32_t vertex = dead_ends.back();
+      dead_ends.pop_back();
+      if (live_counts[vertex] > 0) {
+        return vertex;
+      }
+    }
+    for (; cursor < vertex_count; cursor++) {
+      if (live_counts[cursor] > 0) {
+        return int64_t(cursor);
+      }
+    }
+    return -1;
+  };
+
+  int64_t fan_vertex = skip_dead_end();
+  p_clusters->push_back(0);
+  while (fan_vertex >= 0) {
+    candidates.clear();
+
+    // Emit every remaining triangle around the fanning vertex
+    for (uint32_t adjacent = adjacency_offsets[fan_vertex];
+         adjacent < adjacency_offsets[fan_vertex + 1]; adjacent++) {
+      const uint32_t triangle = adjacency[adjacent];
+      if (emitted[triangle] != 0) {
+        continue;
+      }
+      emitted[triangle] = 1;
+
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        const uint32_t vertex = p_indices[(triangle * 3) + corner];
+        output.push_back(vertex);
+        dead_ends.push_back(vertex);
+        candidates.push_back(vertex);
+        --live_counts[vertex];
+        if ((time - cache_times[vertex]) > kVertexCacheSize) {
+          cache_times[vertex] = time++;
+        }
+      }
+    }
+
+    // Next fan from the oldest candidate that will still be cached once
+    // all of its triangles are emitted
+    int64_t next_vertex = -1;
+    int64_t best_priority = -1;
+    for (uint32_t vertex : candidates) {
+      if (live_counts[vertex] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if ((time - cache_times[vertex]) + (2 * live_counts[vertex]) <=
+          kVertexCacheSize) {
+        priority = time - cache_times[vertex];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        next_vertex = vertex;
+      }
+    }
+
+    if (next_vertex < 0) {
+      next_vertex = skip_dead_end();
+      if ((next_vertex >= 0) && (output.size() < index_count)) {
+        p_clusters->push_back(uint32_t(output.size() / 3));
+      }
+    }
+    fan_vertex = next_vertex;
+  }
+
+  VKEX_ASSERT(output.size() == triangle_count * 3);
+  std::memcpy(p_indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+void OptimizeOverdraw(uint32_t* p_indices, size_t index_count,
+                      const float* p_positions, size_t vertex_count,
+                      const std::vector<uint32_t>& clusters, float threshold) {
+  const size_t triangle_count = index_count / 3;
+  if ((triangle_count == 0) || clusters.empty()) {
+    return;
+  }
+
+  // Split each cluster wherever the run so far already has a cache miss
+  // ratio within 'threshold' of the cluster as a whole
+  std::vector<Cluster> split_clusters;
+  {
+    FifoCache cache(vertex_count, kVertexCacheSize);
+    for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+      const uint32_t first = clusters[cluster];
+      const uint32_t end = (cluster + 1 < clusters.size())
+                               ? clusters[cluster + 1]
+                               : uint32_t(triangle_count);
+
+      cache.Flush();
+      uint32_t cluster_misses = 0;
+      for (uint32_t i = first * 3; i < end * 3; i++) {
+        cluster_misses += cache.Access(p_indices[i]) ? 1 : 0;
+      }
+      const float split_acmr =
+          threshold * float(cluster_misses) / float(end - first);
+
+      cache.Flush();
+      uint32_t run_first = first;
+      uint32_t run_misses = 0;
+      for (uint32_t triangle = first; triangle < end; triangle++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+          run_misses += cache.Access(p_indices[(triangle * 3) + corner]) ? 1
+                                                                         : 0;
+        }
+        const uint32_t run_count = triangle + 1 - run_first;
+        if ((triangle + 1 == end) ||
+            (float(run_misses) <= split_acmr * float(run_count))) {
+          split_clusters.push_back({run_first, run_count, 0.0f});
+          run_first = triangle + 1;
+          run_misses = 0;
+          cache.Flush();
+        }
+      }
+    }
+  }
+
+  // Area weighted centers and normals
+  auto position = [p_positions](uint32_t vertex, uint32_t axis) {
+    return p_positions[(size_t(vertex) * 3) + axis];
+  };
+  double mesh_center[3] = {0.0, 0.0, 0.0};
+  double mesh_area = 0.0;
+  std::vector<float> cluster_centers(split_clusters.size() * 3);
+  std::vector<float> cluster_normals(split_clusters.size() * 3);
+  for (size_t cluster = 0; cluster < split_clusters.size(); cluster++) {
+    const auto& run = split_clusters[cluster];
+    double center[3] = {0.0, 0.0, 0.0};
+    double normal[3] = {0.0, 0.0, 0.0};
+    double area = 0.0;
+    for (uint32_t triangle = run.first_triangle;
+         triangle < run.first_triangle + run.triangle_count; triangle++) {
+      const uint32_t a = p_indices[(triangle * 3) + 0];
+      const uint32_t b = p_indices[(triangle * 3) + 1];
+      const uint32_t c = p_indices[(triangle * 3) + 2];
+
+      double ab[3];
+      double ac[3];
+      for (uint32_t axis = 0; axis < 3; axis++) {
+        ab[axis] = position(b, axis) - position(a, axis);
+        ac[axis] = position(c, axis) - position(a, axis);
+      }
+      const double cross[3] = {(ab[1] * ac[2]) - (ab[2] * ac[1]),
+                               (ab[2] * ac[0]) - (ab[0] * ac[2]),
+                               (ab[0] * ac[1]) - (ab[1] * ac[0])};
+      const double triangle_area =
+          std::sqrt((cross[0] * cross[0]) + (cross[1] * cross[1]) +
+                    (cross[2] * cross[2]));
+
+      for (uint32_t axis = 0; axis < 3; axis++) {
+        const double triangle_center =
+            (position(a, axis) + position(b, axis) + position(c, axis)) / 3.0;
+        center[axis] += triangle_center * triangle_area;
+        normal[axis] += cross[axis];
+      }
+      area += triangle_area;
+    }
+
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      mesh_center[axis] += center[axis];
+    }
+    mesh_area += area;
+
+    const double normal_length =
+        std::sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) +
+                  (normal[2] * normal[2]));
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      cluster_centers[(cluster * 3) + axis] =
+          (area > 0.0) ? float(center[axis] / area) : 0.0f;
+      cluster_normals[(cluster * 3) + axis] =
+          (normal_length > 0.0) ? float(normal[axis] / normal_length) : 0.0f;
+    }
+  }
+  if (mesh_area > 0.0) {
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      mesh_center[axis] /= mesh_area;
+    }
+  }
+
+  for (size_t cluster = 0; cluster < split_clusters.size(); cluster++) {
+    float sort_key = 0.0f;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      sort_key += (cluster_centers[(cluster * 3) + axis] -
+                   float(mesh_center[axis])) *
+                  cluster_normals[(cluster * 3) + axis];
+    }
+    split_clusters[cluster].sort_key = sort_key;
+  }
+
+  // Stable, so equally placed clusters keep their cache friendly order
+  std::stable_sort(split_clusters.begin(), split_clusters.end(),
+                   [](const Cluster& a, const Cluster& b) {
+                     return a.sort_key > b.sort_key;
+                   });
+
+  std::vector<uint32_t> sorted_indices;
+  sorted_indices.reserve(triangle_count * 3);
+  for (const auto& run : split_clusters) {
+    sorted_indices.insert(sorted_indices.end(),
+                          p_indices + (run.first_triangle * 3),
+                          p_indices + ((run.first_triangle +
+                                        run.triangle_count) * 3));
+  }
+  std::memcpy(p_indices, sorted_indices.data(),
+              sorted_indices.size() * sizeof(uint32_t));
+}
+
+void OptimizeVertexFetch(uint32_t* p_indices, size_t index_count,
+                         size_t vertex_count, std::vector<uint32_t>* p_remap) {
+  p_remap->assign(vertex_count, UINT32_MAX);
+
+  uint32_t next_vertex = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    uint32_t& remapped = (*p_remap)[p_indices[i]];
+    if (remapped == UINT32_MAX) {
+      remapped = next_vertex++;
+    }
+    p_indices[i] = remapped;
+  }
+
+  for (auto& remapped : *p_remap) {
+    if (remapped == UINT32_MAX) {
+      remapped = next_vertex++;
+    }
+  }
+}
+
+void QuantizePosition(const float* p_position, const float* p_min,
+                      const float* p_extent, uint16_t* p_dst) {
+  for (uint32_t axis = 0; axis < 3; axis++) {
+    float normalized = 0.0f;
+    if (p_extent[axis] > 0.0f) {
+      normalized = (p_position[axis] - p_min[axis]) / p_extent[axis];
+    }
+    normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+    p_dst[axis] = uint16_t((normalized * 65535.0f) + 0.5f);
+  }
+  p_dst[3] = 0;
+}
+
+void EncodeOctahedralNormal(const float* p_normal, int16_t* p_dst) {
+  float x = p_normal[0];
+  float y = p_normal[1];
+  const float z = p_normal[2];
+  const float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+  if (length <= 0.0f) {
+    p_dst[0] = 0;
+    p_dst[1] = 0;
+    return;
+  }
+
+  x /= length;
+  y /= length;
+  // The lower hemisphere folds over the diagonals
+  if (z < 0.0f) {
+    const float folded_x = (1.0f - std::fabs(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+    const float folded_y = (1.0f - std::fabs(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+    x = folded_x;
+    y = folded_y;
+  }
+
+  x = std::min(std::max(x, -1.0f), 1.0f);
+  y = std::min(std::max(y, -1.0f), 1.0f);
+  p_dst[0] = int16_t(std::lround(x * 32767.0f));
+  p_dst[1] = int16_t(std::lround(y * 32767.0f));
+}
+
+uint16_t QuantizeHalf(float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t biased_exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+
+  // Infinity and NaN, keeping NaNs quiet
+  if (biased_exponent == 0xFF) {
+    return uint16_t(sign | 0x7C00 | ((mantissa != 0) ? 0x200 : 0));
+  }
+
+  const int32_t exponent = int32_t(biased_exponent) - 127 + 15;
+  if (exponent >= 31) {
+    return uint16_t(sign | 0x7C00);
+  }
+
+  uint32_t half = 0;
+  uint32_t shift = 13;
+  if (exponent <= 0) {
+    // Subnormal, or too small for one
+    if (exponent < -10) {
+      return uint16_t(sign);
+    }
+    mantissa |= 0x800000;
+    shift = uint32_t(14 - exponent);
+    half = mantissa >> shift;
+  } else {
+    half = (uint32_t(exponent) << 10) | (mantissa >> shift);
+  }
+
+  // A carry out of the mantissa correctly bumps the exponent
+  const uint32_t remainder = mantissa & ((1u << shift) - 1);
+  const uint32_t halfway = 1u << (shift - 1);
+  if ((remainder > halfway) || ((remainder == halfway) && ((half & 1) != 0))) {
+    ++half;
+  }
+  return uint16_t(sign | half);
+}
+
+}  // namespace mesh_optimizer
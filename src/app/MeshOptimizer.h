@@ -0,0 +1,91 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __MESH_OPTIMIZER_H__
+#define __MESH_OPTIMIZER_H__
+
+#include "vkex/Application.h"
+
+// Load time index and vertex reordering for indexed triangle lists, plus the
+// attribute encodings used for quantized vertex streams.
+//
+// Every function works on one primitive at a time, with 32-bit indices that
+// address 'vertex_count' vertices starting at zero.
+namespace mesh_optimizer {
+
+enum MeshOptimizerConstants {
+  // FIFO post-transform cache the triangle order targets, and that cache
+  // miss ratios are measured against. Small enough to hold on any GPU.
+  kVertexCacheSize = 16,
+  // Vertex fetch is measured in whole cache lines, through a small cache
+  // per vertex stream
+  kFetchCacheLineBytes = 64,
+  kFetchCacheLineCount = 64,
+};
+
+// Default for OptimizeOverdraw, the ratio of cache misses a cluster may
+// give up to be split into smaller clusters that sort better
+const float kOverdrawThreshold = 1.05f;
+
+// Post-transform cache misses drawing the triangle list. Divided by the
+// triangle count this is the average cache miss ratio (ACMR), 0.5 at best
+// and 3 at worst.
+uint32_t CountVertexCacheMisses(const uint32_t* p_indices, size_t index_count,
+                                size_t vertex_count);
+
+// Bytes read from one vertex stream of 'element_size' byte elements drawing
+// the triangle list. Only post-transform cache misses fetch.
+uint64_t CountVertexFetchBytes(const uint32_t* p_indices, size_t index_count,
+                               size_t vertex_count, size_t element_size);
+
+// Reorders triangles for the post-transform cache with Tipsify (Sander,
+// Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and
+// Reduced Overdraw", 2007). 'p_clusters' receives the first triangle of
+// every run that starts from a cold cache, for OptimizeOverdraw.
+void OptimizeVertexCache(uint32_t* p_indices, size_t index_count,
+                         size_t vertex_count,
+                         std::vector<uint32_t>* p_clusters);
+
+// Sorts the clusters from OptimizeVertexCache so the ones facing out from
+// the mesh's center are drawn first, as they're likely to occlude the rest
+// from any view. Clusters are split further wherever that costs less than
+// 'threshold' times their cache miss ratio. 'p_positions' holds three
+// floats per vertex.
+void OptimizeOverdraw(uint32_t* p_indices, size_t index_count,
+                      const float* p_positions, size_t vertex_count,
+                      const std::vector<uint32_t>& clusters, float threshold);
+
+// Renumbers vertices in the order the indices first use them, so vertex
+// fetch walks the streams forward. 'p_remap' receives the new index of each
+// old vertex; vertices no triangle uses move to the end.
+void OptimizeVertexFetch(uint32_t* p_indices, size_t index_count,
+                         size_t vertex_count, std::vector<uint32_t>* p_remap);
+
+// R16G16B16A16_UNORM position within the box at 'p_min' with 'p_extent',
+// w is zero
+void QuantizePosition(const float* p_position, const float* p_min,
+                      const float* p_extent, uint16_t* p_dst);
+
+// R16G16_SNORM octahedral encoding of a unit normal (Meyer et al., "On
+// Floating-Point Normal Vectors", 2010). Zero length normals encode as +Z.
+void EncodeOctahedralNormal(const float* p_normal, int16_t* p_dst);
+
+// IEEE half, rounded to nearest even
+uint16_t QuantizeHalf(float value);
+
+}  // namespace mesh_optimizer
+
+#endif  // __MESH_OPTIMIZER_H__
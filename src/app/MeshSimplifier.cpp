@@ -0,0 +1,426 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace mesh_simplifier {
+
+namespace {
+
+// Relative weights of the attribute terms against the position quadric.
+// Both are scaled by the squared edge length so they're in the same units.
+const double kNormalWeight = 0.5;
+const double kTexCoordWeight = 0.5;
+
+// Symmetric 4x4 matrix of a sum of squared plane distances
+struct Quadric {
+  double a00, a01, a02, a11, a12, a22;
+  double b0, b1, b2;
+  double c;
+
+  void AddPlane(double nx, double ny, double nz, double d) {
+    a00 += nx * nx;
+    a01 += nx * ny;
+    a02 += nx * nz;
+    a11 += ny * ny;
+    a12 += ny * nz;
+    a22 += nz * nz;
+    b0 += nx * d;
+    b1 += ny * d;
+    b2 += nz * d;
+    c += d * d;
+  }
+
+  void Add(const Quadric& other) {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+  }
+
+  double Evaluate(const double* p) const {
+    const double x = p[0];
+    const double y = p[1];
+    const double z = p[2];
+    const double error = (a00 * x * x) + (2.0 * a01 * x * y) +
+                         (2.0 * a02 * x * z) + (a11 * y * y) +
+                         (2.0 * a12 * y * z) + (a22 * z * z) +
+                         (2.0 * ((b0 * x) + (b1 * y) + (b2 * z))) + c;
+    // Rounding can take it a hair below zero
+    return std::max(error, 0.0);
+  }
+};
+
+struct Collapse {
+  uint32_t source;
+  // Vertex of the edge's triangle the source moves onto. It may be one of
+  // several vertices at the target position.
+  uint32_t target;
+  double cost;
+  double position_error;
+};
+
+struct PositionKey {
+  uint32_t bits[3];
+
+  bool operator==(const PositionKey& other) const {
+    return (bits[0] == other.bits[0]) && (bits[1] == other.bits[1]) &&
+           (bits[2] == other.bits[2]);
+  }
+};
+
+struct PositionKeyHash {
+  size_t operator()(const PositionKey& key) const {
+    // FNV-1a over the three words
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : key.bits) {
+      hash = (hash ^ word) * 1099511628211ull;
+    }
+    return size_t(hash);
+  }
+};
+
+uint64_t MakeEdgeKey(uint32_t a, uint32_t b) {
+  return (uint64_t(a) << 32) | b;
+}
+
+void Cross(const double* a, const double* b, double* p_dst) {
+  p_dst[0] = (a[1] * b[2]) - (a[2] * b[1]);
+  p_dst[1] = (a[2] * b[0]) - (a[0] * b[2]);
+  p_dst[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+double Dot(const double* a, const double* b) {
+  return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+void TriangleNormal(const double* p0, const double* p1, const double* p2,
+                    double* p_dst) {
+  const double e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  const double e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+  Cross(e0, e1, p_dst);
+}
+
+}  // namespace
+
+float GetPositionScale(const float* p_positions, size_t vertex_count) {
+  if (vertex_count == 0) {
+    return 0.0f;
+  }
+
+  float position_min[3];
+  float position_max[3];
+  for (uint32_t axis = 0; axis < 3; axis++) {
+    position_min[axis] = p_positions[axis];
+    position_max[axis] = p_positions[axis];
+  }
+  for (size_t vertex = 1; vertex < vertex_count; vertex++) {
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      const float value = p_positions[(vertex * 3) + axis];
+      position_min[axis] = std::min(position_min[axis], value);
+      position_max[axis] = std::max(position_max[axis], value);
+    }
+  }
+  return std::max(std::max(position_max[0] - position_min[0],
+                           position_max[1] - position_min[1]),
+                  position_max[2] - position_min[2]);
+}
+
+size_t Simplify(const SimplifyInput& input, size_t target_index_count,
+                float target_error, uint32_t* p_dst_indices,
+                float* p_result_error) {
+  const size_t vertex_count = input.vertex_count;
+  size_t index_count = input.index_count;
+  std::memcpy(p_dst_indices, input.p_indices, index_count * sizeof(uint32_t));
+  *p_result_error = 0.0f;
+
+  if ((index_count <= target_index_count) || (vertex_count == 0)) {
+    return index_count;
+  }
+
+  // Positions normalized to the unit cube, so errors come out relative
+  const float position_scale =
+      GetPositionScale(input.p_positions, vertex_count);
+  const double inverse_scale =
+      (position_scale > 0.0f) ? (1.0 / double(position_scale)) : 1.0;
+  std::vector<double> positions(vertex_count * 3);
+  for (size_t i = 0; i < vertex_count * 3; i++) {
+    positions[i] = double(input.p_positions[i]) * inverse_scale;
+  }
+  auto position = [&positions](uint32_t vertex) {
+    return positions.data() + (size_t(vertex) * 3);
+  };
+
+  // Vertices sharing a position are one vertex as far as the surface goes
+  std::vector<uint32_t> canonical(vertex_count);
+  std::vector<uint32_t> wedge_counts(vertex_count, 0);
+  {
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> first_vertices;
+    first_vertices.reserve(vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+      PositionKey key = {};
+      std::memcpy(key.bits, input.p_positions + (vertex * 3),
+                  sizeof(key.bits));
+      auto inserted = first_vertices.insert(
+          std::make_pair(key, uint32_t(vertex)));
+      canonical[vertex] = inserted.first->second;
+      ++wedge_counts[canonical[vertex]];
+    }
+  }
+
+  // Borders are edges with no twin running the other way
+  std::vector<uint8_t> locked(vertex_count, 0);
+  for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+    if (wedge_counts[canonical[vertex]] > 1) {
+      locked[canonical[vertex]] = 1;
+    }
+  }
+  {
+    std::unordered_map<uint64_t, uint32_t> edge_counts;
+    edge_counts.reserve(index_count);
+    for (size_t i = 0; i < index_count; i++) {
+      const uint32_t a = canonical[p_dst_indices[i]];
+      const uint32_t b =
+          canonical[p_dst_indices[(i % 3 == 2) ? (i - 2) : (i + 1)]];
+      ++edge_counts[MakeEdgeKey(a, b)];
+    }
+    for (size_t i = 0; i < index_count; i++) {
+      const uint32_t a = canonical[p_dst_indices[i]];
+      const uint32_t b =
+          canonical[p_dst_indices[(i % 3 == 2) ? (i - 2) : (i + 1)]];
+      if (edge_counts.find(MakeEdgeKey(b, a)) == edge_counts.end()) {
+        locked[a] = 1;
+        locked[b] = 1;
+      }
+    }
+  }
+
+  // Plane of every triangle around each vertex
+  std::vector<Quadric> quadrics(vertex_count, Quadric{});
+  for (size_t triangle = 0; triangle < index_count / 3; triangle++) {
+    const uint32_t v0 = canonical[p_dst_indices[(triangle * 3) + 0]];
+    const uint32_t v1 = canonical[p_dst_indices[(triangle * 3) + 1]];
+    const uint32_t v2 = canonical[p_dst_indices[(triangle * 3) + 2]];
+
+    double normal[3];
+    TriangleNormal(position(v0), position(v1), position(v2), normal);
+    const double length = std::sqrt(Dot(normal, normal));
+    if (length <= 0.0) {
+      continue;
+    }
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      normal[axis] /= length;
+    }
+    const double d = -Dot(normal, position(v0));
+    for (uint32_t vertex : {v0, v1, v2}) {
+      quadrics[vertex].AddPlane(normal[0], normal[1], normal[2], d);
+    }
+  }
+
+  auto attribute_distance = [&input](uint32_t a, uint32_t b) {
+    double distance = 0.0;
+    if (input.p_normals != nullptr) {
+      for (uint32_t axis = 0; axis < 3; axis++) {
+        const double delta = double(input.p_normals[(size_t(a) * 3) + axis]) -
+                             double(input.p_normals[(size_t(b) * 3) + axis]);
+        distance += kNormalWeight * delta * delta;
+      }
+    }
+    if (input.p_texcoords != nullptr) {
+      for (uint32_t axis = 0; axis < 2; axis++) {
+        const double delta =
+            double(input.p_texcoords[(size_t(a) * 2) + axis]) -
+            double(input.p_texcoords[(size_t(b) * 2) + axis]);
+        distance += kTexCoordWeight * delta * delta;
+      }
+    }
+    return distance;
+  };
+
+  const double error_limit = double(target_error) * double(target_error);
+  double result_error = 0.0;
+
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(vertex_count);
+  std::vector<uint8_t> touched(vertex_count);
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+  std::vector<uint32_t> adjacency;
+
+  // Every pass collapses a set of edges far enough apart not to interact,
+  // cheapest first, then rebuilds the index list
+  while (index_count > target_index_count) {
+    const size_t triangle_count = index_count / 3;
+
+    collapses.clear();
+    for (size_t i = 0; i < index_count; i++) {
+      const size_t next = (i % 3 == 2) ? (i - 2) : (i + 1);
+      const uint32_t vertex_a = p_dst_indices[i];
+      const uint32_t vertex_b = p_dst_indices[next];
+      const uint32_t a = canonical[vertex_a];
+      const uint32_t b = canonical[vertex_b];
+      // Each interior edge is seen from both of its triangles, so one
+      // direction per triangle edge covers both
+      if ((a == b) || (locked[a] != 0)) {
+        continue;
+      }
+
+      Quadric quadric = quadrics[a];
+      quadric.Add(quadrics[b]);
+      const double position_error = quadric.Evaluate(position(b));
+
+      double edge[3];
+      for (uint32_t axis = 0; axis < 3; axis++) {
+        edge[axis] = position(b)[axis] - position(a)[axis];
+      }
+      const double cost = position_error + (Dot(edge, edge) *
+                                            attribute_distance(vertex_a,
+                                                               vertex_b));
+      if (cost > error_limit) {
+        continue;
+      }
+      collapses.push_back({a, vertex_b, cost, position_error});
+    }
+    if (collapses.empty()) {
+      break;
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse& x, const Collapse& y) {
+                return x.cost < y.cost;
+              });
+
+    // Triangles around each canonical vertex, for the flip test
+    std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+    for (size_t i = 0; i < index_count; i++) {
+      ++adjacency_offsets[canonical[p_dst_indices[i]] + 1];
+    }
+    for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+      adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+    }
+    adjacency.resize(index_count);
+    {
+      std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(),
+                                         adjacency_offsets.end() - 1);
+      for (size_t i = 0; i < index_count; i++) {
+        adjacency[fill_offsets[canonical[p_dst_indices[i]]]++] =
+            uint32_t(i / 3);
+      }
+    }
+
+    for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+      remap[vertex] = uint32_t(vertex);
+    }
+    std::fill(touched.begin(), touched.end(), 0);
+
+    // Each collapse removes the two triangles on its edge
+    size_t removable_triangles = (index_count - target_index_count) / 3;
+    size_t collapse_count = 0;
+    for (const auto& collapse : collapses) {
+      if (removable_triangles == 0) {
+        break;
+      }
+      const uint32_t source = collapse.source;
+      const uint32_t target = canonical[collapse.target];
+      if ((touched[source] != 0) || (touched[target] != 0)) {
+        continue;
+      }
+
+      // Reject collapses that would turn a remaining triangle over
+      bool flips = false;
+      for (uint32_t adjacent = adjacency_offsets[source];
+           !flips && (adjacent < adjacency_offsets[source + 1]); adjacent++) {
+        const uint32_t triangle = adjacency[adjacent];
+        uint32_t corners[3];
+        bool has_target = false;
+        for (uint32_t corner = 0; corner < 3; corner++) {
+          corners[corner] = canonical[p_dst_indices[(triangle * 3) + corner]];
+          has_target = has_target || (corners[corner] == target);
+        }
+        if (has_target) {
+          continue;
+        }
+
+        double before[3];
+        TriangleNormal(position(corners[0]), position(corners[1]),
+                       position(corners[2]), before);
+        const double* p_moved[3];
+        for (uint32_t corner = 0; corner < 3; corner++) {
+          p_moved[corner] = position(
+              (corners[corner] == source) ? target : corners[corner]);
+        }
+        double after[3];
+        TriangleNormal(p_moved[0], p_moved[1], p_moved[2], after);
+        flips = (Dot(before, after) <= 0.0);
+      }
+      if (flips) {
+        continue;
+      }
+
+      remap[source] = collapse.target;
+      quadrics[target].Add(quadrics[source]);
+      result_error = std::max(result_error, collapse.position_error);
+
+      // Neighbouring collapses wait for the next pass, once the index list
+      // reflects this one
+      for (uint32_t adjacent = adjacency_offsets[source];
+           adjacent < adjacency_offsets[source + 1]; adjacent++) {
+        const uint32_t triangle = adjacency[adjacent];
+        for (uint32_t corner = 0; corner < 3; corner++) {
+          touched[canonical[p_dst_indices[(triangle * 3) + corner]]] = 1;
+        }
+      }
+      removable_triangles -= std::min<size_t>(removable_triangles, 2);
+      ++collapse_count;
+    }
+    if (collapse_count == 0) {
+      break;
+    }
+
+    // Drop triangles that lost their area
+    size_t write_index = 0;
+    for (size_t triangle = 0; triangle < triangle_count; triangle++) {
+      uint32_t corners[3];
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        corners[corner] = remap[p_dst_indices[(triangle * 3) + corner]];
+      }
+      const uint32_t c0 = canonical[corners[0]];
+      const uint32_t c1 = canonical[corners[1]];
+      const uint32_t c2 = canonical[corners[2]];
+      if ((c0 == c1) || (c1 == c2) || (c0 == c2)) {
+        continue;
+      }
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        p_dst_indices[write_index++] = corners[corner];
+      }
+    }
+    index_count = write_index;
+  }
+
+  *p_result_error = float(std::sqrt(result_error));
+  return index_count;
+}
+
+}  // namespace mesh_simplifier
@@ -0,0 +1,64 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __MESH_SIMPLIFIER_H__
+#define __MESH_SIMPLIFIER_H__
+
+#include "vkex/Application.h"
+
+// Edge collapse simplification of indexed triangle lists, for generating
+// LODs at load time. Collapses only ever move a vertex onto one of its
+// neighbours, so every LOD indexes the same vertices as the full detail
+// primitive and only needs an index range of its own.
+namespace mesh_simplifier {
+
+// Attribute streams of the primitive being simplified, three floats per
+// vertex for positions and normals, two for texcoords. Normals and
+// texcoords are optional.
+struct SimplifyInput {
+  const uint32_t* p_indices = nullptr;
+  size_t index_count = 0;
+  const float* p_positions = nullptr;
+  const float* p_normals = nullptr;
+  const float* p_texcoords = nullptr;
+  size_t vertex_count = 0;
+};
+
+// Collapses edges in order of quadric error (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics", 1997) until at most
+// 'target_index_count' indices remain, or the next collapse would exceed
+// 'target_error'. The cost of a collapse also grows with the normal and
+// texcoord difference across the edge, so shading discontinuities that
+// aren't split into separate vertices are kept longer.
+//
+// Vertices on open borders or attribute seams (one position shared by
+// several vertices) are locked, which keeps LODs free of cracks and UV
+// tearing at the expense of how far those areas simplify.
+//
+// Errors are relative to the largest extent of the primitive's bounds.
+// 'p_dst_indices' needs room for 'index_count' indices, and receives the
+// new count. 'p_result_error' receives an estimate of the largest
+// distance any surface point moved.
+size_t Simplify(const SimplifyInput& input, size_t target_index_count,
+                float target_error, uint32_t* p_dst_indices,
+                float* p_result_error);
+
+// Largest extent of the positions' bounds, to scale relative errors by
+float GetPositionScale(const float* p_positions, size_t vertex_count);
+
+}  // namespace mesh_simplifier
+
+#endif  // __MESH_SIMPLIFIER_H__
@@ -0,0 +1,506 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "SettingsSweep.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+static std::string Trim(const std::string& text) {
+  const char* kWhitespace = " \t\r\n";
+  const size_t begin = text.find_first_not_of(kWhitespace);
+  if (begin == std::string::npos) {
+    return "";
+  }
+  const size_t end = text.find_last_not_of(kWhitespace);
+  return text.substr(begin, end - begin + 1);
+}
+
+static std::vector<std::string> SplitList(const std::string& text) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= text.size()) {
+    size_t end = text.find(',', begin);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    const std::string item = Trim(text.substr(begin, end - begin));
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+    begin = end + 1;
+  }
+  return items;
+}
+
+static bool ParseNumber(const std::string& text, double* p_value) {
+  char* p_end = nullptr;
+  *p_value = strtod(text.c_str(), &p_end);
+  return !text.empty() && (*p_end == '\0');
+}
+
+bool SettingsSweep::LoadSpec(const std::string& spec, SweepSpec* p_spec) {
+  *p_spec = {};
+  p_spec->sharpness_values = {0.0f, 0.5f, 1.0f};
+  p_spec->warmup_frames = kDefaultWarmupFrames;
+  p_spec->measured_frames = kDefaultMeasuredFrames;
+  // 240, 120 and 60 Hz
+  p_spec->budgets_ms = {4.17, 8.33, 16.67};
+  p_spec->output_path = "sweep";
+
+  if (spec == "default") {
+    return true;
+  }
+
+  std::ifstream file(spec);
+  if (!file.is_open()) {
+    VKEX_LOG_WARN("Couldn't open sweep spec: " << spec);
+    return false;
+  }
+
+  bool success = true;
+  std::string line;
+  uint32_t line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    line = Trim(line.substr(0, line.find('#')));
+    if (line.empty()) {
+      continue;
+    }
+
+    const size_t separator = line.find('=');
+    if (separator == std::string::npos) {
+      VKEX_LOG_WARN(spec << ":" << line_number << ": expected key = value");
+      success = false;
+      continue;
+    }
+    const std::string key = Trim(line.substr(0, separator));
+    const std::string value = Trim(line.substr(separator + 1));
+
+    bool valid = true;
+    if (key == "techniques") {
+      p_spec->techniques = SplitList(value);
+    } else if ((key == "sharpness") || (key == "budgets_ms")) {
+      std::vector<double> numbers;
+      for (const auto& item : SplitList(value)) {
+        double number = 0.0;
+        valid = valid && ParseNumber(item, &number) && (number >= 0.0);
+        numbers.push_back(number);
+      }
+      if (valid && (key == "sharpness")) {
+        p_spec->sharpness_values.assign(numbers.begin(), numbers.end());
+        for (auto& sharpness : p_spec->sharpness_values) {
+          sharpness = std::min(sharpness, 1.0f);
+        }
+      } else if (valid) {
+        p_spec->budgets_ms = numbers;
+      }
+    } else if ((key == "warmup_frames") || (key == "measured_frames")) {
+      double number = 0.0;
+      valid = ParseNumber(value, &number) && (number >= 0.0);
+      if (valid && (key == "warmup_frames")) {
+        p_spec->warmup_frames = uint32_t(number);
+      } else if (valid) {
+        p_spec->measured_frames = std::max(uint32_t(number), 1u);
+      }
+    } else if (key == "output") {
+      valid = !value.empty();
+      p_spec->output_path = value;
+    } else {
+      VKEX_LOG_WARN(spec << ":" << line_number
+                         << ": unknown sweep key: " << key);
+      success = false;
+      continue;
+    }
+
+    if (!valid) {
+      VKEX_LOG_WARN(spec << ":" << line_number
+                         << ": bad value for " << key << ": " << value);
+      success = false;
+    }
+  }
+
+  // Without any, CAS wouldn't be swept at all
+  if (p_spec->sharpness_values.empty()) {
+    p_spec->sharpness_values.push_back(1.0f);
+  }
+
+  return success;
+}
+
+void SettingsSweep::Start(const SweepSpec& spec,
+                          const std::vector<SweepConfiguration>& configurations,
+                          const std::vector<std::string>& timer_names,
+                          uint32_t cost_timer, uint32_t drain_frames,
+                          double peak_bandwidth_gbps) {
+  VKEX_ASSERT(cost_timer < timer_names.size());
+
+  m_spec = spec;
+  m_configurations = configurations;
+  m_timer_names = timer_names;
+  m_cost_timer = cost_timer;
+  m_peak_bandwidth_gbps = peak_bandwidth_gbps;
+
+  m_results.clear();
+  m_results.resize(m_configurations.size());
+  for (auto& result : m_results) {
+    result.timer_sums_ms.resize(m_timer_names.size(), 0.0);
+    result.timer_sums_bytes.resize(m_timer_names.size(), 0.0);
+  }
+
+  m_active = !m_configurations.empty();
+  m_configuration_index = 0;
+  m_configuration_frame = 0;
+  m_drain_frames = drain_frames;
+
+  VKEX_LOG_INFO("Sweeping " << m_configurations.size() << " configurations, "
+                            << m_spec.warmup_frames << " warm-up and "
+                            << m_spec.measured_frames
+                            << " measured frames each");
+}
+
+const SweepConfiguration* SettingsSweep::NextFrame(uint32_t* p_sample) {
+  *p_sample = kNotMeasured;
+  if (!m_active) {
+    return nullptr;
+  }
+
+  const uint32_t configuration_count = GetConfigurationCount();
+  if (m_configuration_index == configuration_count) {
+    if (m_drain_frames == 0) {
+      m_active = false;
+      return nullptr;
+    }
+    --m_drain_frames;
+    return &m_configurations.back();
+  }
+
+  const uint32_t index = m_configuration_index;
+  if (m_configuration_frame == 0) {
+    // AddSample() appends one cost per measured frame, so it never grows
+    // the vector mid-measurement
+    m_results[index].costs_ms.reserve(m_spec.measured_frames);
+  }
+  if (m_configuration_frame >= m_spec.warmup_frames) {
+    *p_sample = index;
+  }
+
+  ++m_configuration_frame;
+  if (m_configuration_frame ==
+      (m_spec.warmup_frames + m_spec.measured_frames)) {
+    m_configuration_frame = 0;
+    ++m_configuration_index;
+  }
+
+  return &m_configurations[index];
+}
+
+void SettingsSweep::AddSample(uint32_t sample, const double* timer_ms,
+                              const uint64_t* timer_bytes,
+                              const ImageQualityMetrics& metrics) {
+  if (sample >= m_results.size()) {
+    return;
+  }
+
+  auto& result = m_results[sample];
+  for (size_t timer = 0; timer < m_timer_names.size(); timer++) {
+    result.timer_sums_ms[timer] += timer_ms[timer];
+    result.timer_sums_bytes[timer] += double(timer_bytes[timer]);
+  }
+  result.costs_ms.push_back(timer_ms[m_cost_timer]);
+
+  if (metrics.valid) {
+    result.psnr_sum += metrics.psnr;
+    result.ssim_sum += metrics.ssim;
+    result.perceptual_error_sum += metrics.perceptual_error;
+    ++result.metrics_count;
+  }
+}
+
+void SettingsSweep::Summarize(std::vector<Summary>* p_summaries) const {
+  p_summaries->resize(m_results.size());
+  for (size_t index = 0; index < m_results.size(); index++) {
+    const auto& result = m_results[index];
+    auto& summary = (*p_summaries)[index];
+
+    summary = {};
+    summary.sample_count = uint32_t(result.costs_ms.size());
+    summary.timer_means_ms.resize(m_timer_names.size(), 0.0);
+    summary.timer_means_bytes.resize(m_timer_names.size(), 0.0);
+    summary.valid = (summary.sample_count > 0) && (result.metrics_count > 0);
+    if (summary.sample_count == 0) {
+      continue;
+    }
+
+    const double inv_sample_count = 1.0 / double(summary.sample_count);
+    for (size_t timer = 0; timer < m_timer_names.size(); timer++) {
+      summary.timer_means_ms[timer] =
+          result.timer_sums_ms[timer] * inv_sample_count;
+      summary.timer_means_bytes[timer] =
+          result.timer_sums_bytes[timer] * inv_sample_count;
+    }
+    summary.cost_ms = summary.timer_means_ms[m_cost_timer];
+
+    std::vector<double> sorted_costs = result.costs_ms;
+    std::sort(sorted_costs.begin(), sorted_costs.end());
+    const size_t p95_index = std::min(
+        sorted_costs.size() - 1, size_t(double(sorted_costs.size()) * 0.95));
+    summary.cost_p95_ms = sorted_costs[p95_index];
+
+    if (result.metrics_count > 0) {
+      const double inv_metrics_count = 1.0 / double(result.metrics_count);
+      summary.psnr = result.psnr_sum * inv_metrics_count;
+      summary.ssim = result.ssim_sum * inv_metrics_count;
+      summary.perceptual_error =
+          result.perceptual_error_sum * inv_metrics_count;
+    }
+  }
+}
+
+void SettingsSweep::FindParetoFront(const std::vector<Summary>& summaries,
+                                    double budget_ms,
+                                    std::vector<uint32_t>* p_front) {
+  p_front->clear();
+
+  const uint32_t count = uint32_t(summaries.size());
+  for (uint32_t candidate = 0; candidate < count; candidate++) {
+    const auto& c = summaries[candidate];
+    if (!c.valid || (c.cost_ms > budget_ms)) {
+      continue;
+    }
+
+    bool dominated = false;
+    for (uint32_t other = 0; (other < count) && !dominated; other++) {
+      const auto& o = summaries[other];
+      if ((other == candidate) || !o.valid || (o.cost_ms > budget_ms)) {
+        continue;
+      }
+      const bool no_worse = (o.cost_ms <= c.cost_ms) && (o.psnr >= c.psnr) &&
+                            (o.ssim >= c.ssim) &&
+                            (o.perceptual_error <= c.perceptual_error);
+      const bool better = (o.cost_ms < c.cost_ms) || (o.psnr > c.psnr) ||
+                          (o.ssim > c.ssim) ||
+                          (o.perceptual_error < c.perceptual_error);
+      dominated = no_worse && better;
+    }
+
+    if (!dominated) {
+      p_front->push_back(candidate);
+    }
+  }
+}
+
+uint32_t SettingsSweep::FindBest(const std::vector<Summary>& summaries,
+                                 const std::vector<uint32_t>& front) {
+  uint32_t best = UINT32_MAX;
+  for (uint32_t index : front) {
+    if ((best == UINT32_MAX) ||
+        (summaries[index].perceptual_error <
+         summaries[best].perceptual_error) ||
+        ((summaries[index].perceptual_error ==
+          summaries[best].perceptual_error) &&
+         (summaries[index].cost_ms < summaries[best].cost_ms))) {
+      best = index;
+    }
+  }
+  return best;
+}
+
+void SettingsSweep::WriteReports() const {
+  std::vector<Summary> summaries;
+  Summarize(&summaries);
+
+  std::vector<uint32_t> front;
+  FindParetoFront(summaries, std::numeric_limits<double>::max(), &front);
+
+  WriteCsv(summaries, front);
+  WriteJson(summaries, front);
+
+  VKEX_LOG_INFO("Sweep Pareto front, by " << m_timer_names[m_cost_timer]
+                                          << " GPU time:");
+  for (uint32_t index : front) {
+    const auto& configuration = m_configurations[index];
+    const auto& summary = summaries[index];
+    VKEX_LOG_INFO("  " << configuration.technique_name << " "
+                       << configuration.internal_extent.width << " x "
+                       << configuration.internal_extent.height << " -> "
+                       << configuration.target_extent.width << " x "
+                       << configuration.target_extent.height << ", sharpness "
+                       << configuration.sharpness << ": " << summary.cost_ms
+                       << " ms, PSNR " << summary.psnr << " dB, SSIM "
+                       << summary.ssim << ", FLIP-style "
+                       << summary.perceptual_error);
+  }
+
+  std::vector<uint32_t> budget_front;
+  for (double budget_ms : m_spec.budgets_ms) {
+    FindParetoFront(summaries, budget_ms, &budget_front);
+    const uint32_t best = FindBest(summaries, budget_front);
+    if (best == UINT32_MAX) {
+      VKEX_LOG_INFO("  Within " << budget_ms << " ms: nothing fits");
+      continue;
+    }
+    const auto& configuration = m_configurations[best];
+    VKEX_LOG_INFO("  Within " << budget_ms << " ms: "
+                              << configuration.technique_name << " "
+                              << configuration.internal_extent.width << " x "
+                              << configuration.internal_extent.height
+                              << ", sharpness " << configuration.sharpness
+                              << " (" << budget_front.size()
+                              << " on the front)");
+  }
+}
+
+void SettingsSweep::WriteCsv(const std::vector<Summary>& summaries,
+                             const std::vector<uint32_t>& front) const {
+  const std::string path = m_spec.output_path + ".csv";
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    VKEX_LOG_WARN("Couldn't write sweep results to " << path);
+    return;
+  }
+
+  file << "index,technique,internal_width,internal_height,target_width,"
+          "target_height,sharpness,frames";
+  for (const auto& timer_name : m_timer_names) {
+    file << "," << timer_name << "_ms";
+  }
+  file << ",cost_p95_ms,psnr,ssim,perceptual_error,pareto\n";
+
+  file << std::setprecision(6);
+  for (size_t index = 0; index < m_configurations.size(); index++) {
+    const auto& configuration = m_configurations[index];
+    const auto& summary = summaries[index];
+    const bool pareto =
+        std::find(front.begin(), front.end(), uint32_t(index)) != front.end();
+
+    file << index << "," << configuration.technique_name << ","
+         << configuration.internal_extent.width << ","
+         << configuration.internal_extent.height << ","
+         << configuration.target_extent.width << ","
+         << configuration.target_extent.height << ","
+         << configuration.sharpness << "," << summary.sample_count;
+    for (double timer_mean_ms : summary.timer_means_ms) {
+      file << "," << timer_mean_ms;
+    }
+    file << "," << summary.cost_p95_ms << "," << summary.psnr << ","
+         << summary.ssim << "," << summary.perceptual_error << ","
+         << (pareto ? 1 : 0) << "\n";
+  }
+
+  VKEX_LOG_INFO("Sweep results written to " << path);
+}
+
+static void WriteIndexList(std::ostream& stream,
+                           const std::vector<uint32_t>& indices) {
+  stream << "[";
+  for (size_t i = 0; i < indices.size(); i++) {
+    stream << ((i > 0) ? ", " : "") << indices[i];
+  }
+  stream << "]";
+}
+
+void SettingsSweep::WriteJson(const std::vector<Summary>& summaries,
+                              const std::vector<uint32_t>& front) const {
+  const std::string path = m_spec.output_path + ".json";
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    VKEX_LOG_WARN("Couldn't write sweep results to " << path);
+    return;
+  }
+
+  file << std::setprecision(6);
+  file << "{\n";
+  file << "  \"warmup_frames\": " << m_spec.warmup_frames << ",\n";
+  file << "  \"measured_frames\": " << m_spec.measured_frames << ",\n";
+  file << "  \"cost_timer\": \"" << m_timer_names[m_cost_timer] << "\",\n";
+  file << "  \"peak_bandwidth_gbps\": " << m_peak_bandwidth_gbps << ",\n";
+
+  file << "  \"configurations\": [\n";
+  for (size_t index = 0; index < m_configurations.size(); index++) {
+    const auto& configuration = m_configurations[index];
+    const auto& summary = summaries[index];
+
+    file << "    {\"index\": " << index << ", \"technique\": \""
+         << configuration.technique_name << "\", \"internal\": ["
+         << configuration.internal_extent.width << ", "
+         << configuration.internal_extent.height << "], \"target\": ["
+         << configuration.target_extent.width << ", "
+         << configuration.target_extent.height
+         << "], \"sharpness\": " << configuration.sharpness
+         << ", \"frames\": " << summary.sample_count << ", \"timers_ms\": {";
+    for (size_t timer = 0; timer < m_timer_names.size(); timer++) {
+      file << ((timer > 0) ? ", " : "") << "\"" << m_timer_names[timer]
+           << "\": " << summary.timer_means_ms[timer];
+    }
+    // Modeled MB, achieved GB/s and percent of peak, for the timers with
+    // modeled traffic
+    file << "}, \"bandwidth\": {";
+    bool first_bandwidth = true;
+    for (size_t timer = 0; timer < m_timer_names.size(); timer++) {
+      const double bytes = summary.timer_means_bytes[timer];
+      const double ms = summary.timer_means_ms[timer];
+      if ((bytes <= 0.0) || (ms <= 0.0)) {
+        continue;
+      }
+      const double gbps = (bytes / ms) * 1.0e-6;
+      file << (first_bandwidth ? "" : ", ") << "\"" << m_timer_names[timer]
+           << "\": {\"mb\": " << (bytes * 1.0e-6) << ", \"gbps\": " << gbps;
+      if (m_peak_bandwidth_gbps > 0.0) {
+        file << ", \"peak_percent\": "
+             << ((gbps * 100.0) / m_peak_bandwidth_gbps);
+      }
+      file << "}";
+      first_bandwidth = false;
+    }
+    file << "}, \"cost_p95_ms\": " << summary.cost_p95_ms;
+    if (summary.valid) {
+      file << ", \"psnr\": " << summary.psnr << ", \"ssim\": " << summary.ssim
+           << ", \"perceptual_error\": " << summary.perceptual_error;
+    }
+    file << "}" << (((index + 1) < m_configurations.size()) ? "," : "")
+         << "\n";
+  }
+  file << "  ],\n";
+
+  file << "  \"pareto\": ";
+  WriteIndexList(file, front);
+  file << ",\n";
+
+  file << "  \"budgets\": [\n";
+  std::vector<uint32_t> budget_front;
+  for (size_t i = 0; i < m_spec.budgets_ms.size(); i++) {
+    FindParetoFront(summaries, m_spec.budgets_ms[i], &budget_front);
+    const uint32_t best = FindBest(summaries, budget_front);
+
+    file << "    {\"budget_ms\": " << m_spec.budgets_ms[i] << ", \"pareto\": ";
+    WriteIndexList(file, budget_front);
+    file << ", \"best\": ";
+    if (best == UINT32_MAX) {
+      file << "null";
+    } else {
+      file << best;
+    }
+    file << "}" << (((i + 1) < m_spec.budgets_ms.size()) ? "," : "") << "\n";
+  }
+  file << "  ]\n";
+  file << "}\n";
+
+  VKEX_LOG_INFO("Sweep results written to " << path);
+}
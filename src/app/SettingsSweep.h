@@ -0,0 +1,163 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __SETTINGS_SWEEP_H__
+#define __SETTINGS_SWEEP_H__
+
+#include "ImageMetrics.h"
+
+// What to sweep, from SettingsSweep::LoadSpec
+struct SweepSpec {
+  // Short technique names (none, cas, checkerboard), empty sweeps them all
+  std::vector<std::string> techniques;
+  // CAS sharpness values, every CAS configuration runs once per value
+  std::vector<float> sharpness_values;
+  uint32_t warmup_frames;
+  uint32_t measured_frames;
+  // GPU frame budgets the Pareto-optimal configurations are reported for
+  std::vector<double> budgets_ms;
+  // Written to as <output_path>.csv and <output_path>.json
+  std::string output_path;
+};
+
+// One combination of the settings DrawAppInfoGUI exposes, as indices into
+// the app's resolution tables plus what the report prints for it
+struct SweepConfiguration {
+  uint32_t technique_index;
+  uint32_t target_index;
+  // Into the target's internal resolutions, or its checkerboard resolutions
+  uint32_t internal_index;
+  float sharpness;
+
+  std::string technique_name;
+  VkExtent2D internal_extent;
+  VkExtent2D target_extent;
+};
+
+// Walks a list of configurations for a fixed number of warm-up and measured
+// frames each, collects the GPU timers and image quality metrics of the
+// measured frames, and writes them out as CSV and JSON along with the
+// Pareto-optimal configurations under each frame budget.
+//
+// The app applies the configuration NextFrame() returns before it updates
+// its render state, and tags the frame with the sample slot it got back.
+// Timers and metrics are read back frames in flight later, so the tag goes
+// through PerFrameData and comes back in AddSample(). The last configuration
+// keeps running for a few unmeasured frames at the end to drain them.
+//
+// Timers whose passes have modeled traffic (vkex::PassTraffic) also report
+// the bandwidth they achieved, from the mean bytes over the mean time, and
+// its share of the peak given to Start().
+//
+// A configuration's cost is the mean of one of the timers, set at Start().
+// A configuration is Pareto-optimal under a budget when no other
+// configuration within the budget is at least as cheap and as good in PSNR,
+// SSIM and FLIP-style error, and better in one of them.
+class SettingsSweep {
+ public:
+  SettingsSweep() {}
+  virtual ~SettingsSweep() {}
+
+  enum SettingsSweepConstants {
+    kDefaultWarmupFrames = 30,
+    kDefaultMeasuredFrames = 120,
+    kNotMeasured = UINT32_MAX,
+  };
+
+  // 'spec' is either "default" or the path of a file of 'key = value' lines,
+  // '#' starting a comment. Keys are techniques, sharpness, budgets_ms (all
+  // comma separated lists), warmup_frames, measured_frames and output.
+  // Missing keys keep their defaults.
+  static bool LoadSpec(const std::string& spec, SweepSpec* p_spec);
+
+  void Start(const SweepSpec& spec,
+             const std::vector<SweepConfiguration>& configurations,
+             const std::vector<std::string>& timer_names, uint32_t cost_timer,
+             uint32_t drain_frames, double peak_bandwidth_gbps);
+  bool IsActive() const { return m_active; }
+
+  // The configuration to render next, or null once the sweep is done.
+  // 'p_sample' gets the slot to hand back to AddSample() for the frame, or
+  // kNotMeasured.
+  const SweepConfiguration* NextFrame(uint32_t* p_sample);
+
+  // 'timer_ms' and 'timer_bytes' have one entry per timer name, 0 bytes for
+  // passes whose traffic isn't modeled
+  void AddSample(uint32_t sample, const double* timer_ms,
+                 const uint64_t* timer_bytes,
+                 const ImageQualityMetrics& metrics);
+
+  // Logs the Pareto-optimal configurations and writes the CSV and JSON files
+  void WriteReports() const;
+
+  uint32_t GetConfigurationIndex() const { return m_configuration_index; }
+  uint32_t GetConfigurationCount() const {
+    return uint32_t(m_configurations.size());
+  }
+
+ private:
+  struct Result {
+    std::vector<double> timer_sums_ms;
+    std::vector<double> timer_sums_bytes;
+    std::vector<double> costs_ms;
+    double psnr_sum = 0.0;
+    double ssim_sum = 0.0;
+    double perceptual_error_sum = 0.0;
+    uint32_t metrics_count = 0;
+  };
+
+  struct Summary {
+    uint32_t sample_count;
+    std::vector<double> timer_means_ms;
+    std::vector<double> timer_means_bytes;
+    double cost_ms;
+    double cost_p95_ms;
+    double psnr;
+    double ssim;
+    double perceptual_error;
+    bool valid;
+  };
+
+  void Summarize(std::vector<Summary>* p_summaries) const;
+  // Indices of the configurations on the Pareto front among those costing
+  // at most 'budget_ms'
+  static void FindParetoFront(const std::vector<Summary>& summaries,
+                              double budget_ms, std::vector<uint32_t>* p_front);
+  // The lowest FLIP-style error on a front, UINT32_MAX if it's empty
+  static uint32_t FindBest(const std::vector<Summary>& summaries,
+                           const std::vector<uint32_t>& front);
+
+  void WriteCsv(const std::vector<Summary>& summaries,
+                const std::vector<uint32_t>& front) const;
+  void WriteJson(const std::vector<Summary>& summaries,
+                 const std::vector<uint32_t>& front) const;
+
+ private:
+  SweepSpec m_spec = {};
+  std::vector<SweepConfiguration> m_configurations;
+  std::vector<std::string> m_timer_names;
+  uint32_t m_cost_timer = 0;
+  double m_peak_bandwidth_gbps = 0.0;
+
+  std::vector<Result> m_results;
+
+  bool m_active = false;
+  uint32_t m_configuration_index = 0;
+  uint32_t m_configuration_frame = 0;
+  uint32_t m_drain_frames = 0;
+};
+
+#endif  // __SETTINGS_SWEEP_H__
@@ -20,4 +20,25 @@
 #define CB_RESOLVE_PIXELS_PER_THREAD_DIM 2
 #define CB_RESOLVE_DEBUG 0
 
+// Levels per primitive including the full detail one, the GPU cull data
+// holds them in a uint4/float4 each
+#define LOD_MAX_COUNT 4
+
+#define GPU_CULL_GROUP_SIZE 64
+// Statistics counters at the start of the GPU cull counter buffer, followed
+// by one draw count per draw list item
+#define GPU_CULL_COUNTER_FRUSTUM_CULLED 0
+#define GPU_CULL_COUNTER_OCCLUSION_CULLED 1
+#define GPU_CULL_COUNTER_DRAWN 2
+// Drawn instances per LOD, LOD_MAX_COUNT counters
+#define GPU_CULL_COUNTER_LOD_DRAWN 3
+#define GPU_CULL_COUNTER_COUNT (GPU_CULL_COUNTER_LOD_DRAWN + LOD_MAX_COUNT)
+// CullDrawData::flags
+#define GPU_CULL_FLAG_UNBOUNDED 0x1
+
+// Image quality metrics. The first pass reduces one SSIM window per group,
+// the second folds every window's sums in a single group.
+#define IMAGE_METRICS_TILE_SIZE 8
+#define IMAGE_METRICS_REDUCE_GROUP_SIZE 256
+
 #endif  //__SHARED_SHADER_CONSTANTS_H__
\ No newline at end of file
@@ -92,6 +92,8 @@ vkex::Result CreateSimpleMSRenderPass(
     create_info.image.samples = sample_count;
     create_info.image.tiling = VK_IMAGE_TILING_OPTIMAL;
     create_info.image.usage_flags.bits.color_attachment = true;
+    // Frame capture reads it back
+    create_info.image.usage_flags.bits.transfer_src = true;
     create_info.image.usage_flags.bits.sampled = true;
     create_info.image.sharing_mode = VK_SHARING_MODE_EXCLUSIVE;
     create_info.image.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -123,8 +125,12 @@ vkex::Result CreateSimpleMSRenderPass(
       return result;
     }
   }
-  // Depth image
+  // Depth image. GpuCuller builds its Hi-Z pyramid from this texture, both
+  // the single sample and the checkerboard MSAA one, so it is sampled too.
+  // The one view serves the DSV and the shaders, which only read depth.
   {
+    VKEX_ASSERT(!vkex::DetermineAspectMask(depth_format).bits.stencil_bit);
+
     vkex::TextureCreateInfo create_info = {};
     create_info.image.create_flags.flags = extra_depth_create_flags;
     create_info.image.image_type = VK_IMAGE_TYPE_2D;
@@ -135,13 +141,20 @@ vkex::Result CreateSimpleMSRenderPass(
     create_info.image.samples = sample_count;
     create_info.image.tiling = VK_IMAGE_TILING_OPTIMAL;
     create_info.image.usage_flags.bits.depth_stencil_attachment = true;
+    create_info.image.usage_flags.bits.sampled = true;
     create_info.image.usage_flags.bits.transfer_src = true;
     create_info.image.sharing_mode = VK_SHARING_MODE_EXCLUSIVE;
     create_info.image.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
     create_info.image.committed = true;
     create_info.image.host_visible = false;
     create_info.image.device_local = true;
-    create_info.view.derive_from_image = true;
+    create_info.view.derive_from_image = false;
+    create_info.view.view_type = VK_IMAGE_VIEW_TYPE_2D;
+    create_info.view.format = depth_format;
+    create_info.view.samples = sample_count;
+    create_info.view.components = vkex::ComponentMappingRGBA();
+    create_info.view.subresource_range =
+        vkex::ImageSubresourceRange(VK_IMAGE_ASPECT_DEPTH_BIT);
     vkex::Result result =
         device->CreateTexture(create_info, &simple_pass.dsv_texture);
     if (!result) {
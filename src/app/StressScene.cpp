@@ -0,0 +1,142 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "StressScene.h"
+
+#include "AppCore.h"
+#include "AssetUtil.h"
+
+// Instances start this far down the view direction, clear of the model at the
+// origin, and spread further out as the count grows so density stays similar.
+static const float kNearDistance = 4.0f;
+static const float kMinDepthRatio = 2.0f;
+// Fraction of the view width and height the layout covers. Going past 1.0
+// leaves some instances outside the frustum.
+static const float kViewSpread = 1.2f;
+static const float kMinScale = 0.3f;
+static const float kMaxScale = 0.6f;
+static const float kMaxPitch = 0.5f;
+
+// PCG32 (pcg-random.org). The standard library distributions are
+// implementation defined, so a fixed generator keeps a seed's layout the same
+// on every platform.
+class LayoutRandom {
+ public:
+  explicit LayoutRandom(uint64_t seed) {
+    Next();
+    m_state += seed;
+    Next();
+  }
+
+  uint32_t Next() {
+    const uint64_t state = m_state;
+    m_state = state * 6364136223846793005ull + kIncrement;
+    const uint32_t xorshifted = uint32_t(((state >> 18u) ^ state) >> 27u);
+    const uint32_t rotation = uint32_t(state >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+  }
+
+  // [0, 1) with 24 bits of precision
+  float NextFloat() { return float(Next() >> 8) * (1.0f / 16777216.0f); }
+  float NextFloat(float min_value, float max_value) {
+    return min_value + (max_value - min_value) * NextFloat();
+  }
+
+ private:
+  static const uint64_t kIncrement = 1442695040888963407ull;
+  uint64_t m_state = 0;
+};
+
+void StressScene::Configure(uint32_t instance_count, uint32_t seed) {
+  m_max_instance_count = instance_count;
+  m_instance_count = instance_count;
+  m_seed = seed;
+}
+
+vkex::Result StressScene::CreateInstanceBuffer(
+    vkex::Queue queue, const vkex::PerspCamera& camera) {
+  VKEX_ASSERT(IsEnabled());
+
+  std::vector<InstanceData> instances(m_max_instance_count);
+  GenerateLayout(m_seed, camera, m_max_instance_count, instances.data());
+
+  // The layout never changes after this, so it lives in device local memory
+  vkex::Result result = asset_util::CreateStorageBuffer(
+      instances.size() * sizeof(InstanceData), instances.data(), queue,
+      asset_util::MEMORY_USAGE_GPU_ONLY, &m_instance_buffer);
+  if (!result) {
+    return result;
+  }
+
+  VKEX_LOG_INFO("Stress scene: " << m_max_instance_count
+                                 << " instances, seed " << m_seed);
+
+  return vkex::Result::Success;
+}
+
+void StressScene::GenerateLayout(uint32_t seed,
+                                 const vkex::PerspCamera& camera,
+                                 uint32_t instance_count,
+                                 InstanceData* p_instances) {
+  if (instance_count == 0) {
+    return;
+  }
+
+  LayoutRandom random(seed);
+
+  const float tan_half_fov = tanf(glm::radians(camera.GetFovDegrees()) / 2.0f);
+  const float aspect = camera.GetAspect();
+  const float4x4 view_to_world = glm::inverse(camera.GetViewMatrix());
+
+  // Picking the cube of the distance uniformly fills the volume evenly
+  // instead of bunching instances up near the camera
+  const float far_distance =
+      kNearDistance *
+      std::max(kMinDepthRatio, cbrtf(static_cast<float>(instance_count)));
+  const float near_cubed = kNearDistance * kNearDistance * kNearDistance;
+  const float far_cubed = far_distance * far_distance * far_distance;
+
+  p_instances[0].worldMatrix = float4x4(1.0f);
+  for (uint32_t instance = 1; instance < instance_count; instance++) {
+    const float distance = cbrtf(random.NextFloat(near_cubed, far_cubed));
+    const float half_height = kViewSpread * distance * tan_half_fov;
+    const float half_width = half_height * aspect;
+
+    const float3 view_position =
+        float3(random.NextFloat(-half_width, half_width),
+               random.NextFloat(-half_height, half_height), -distance);
+    const float3 world_position =
+        float3(view_to_world * float4(view_position, 1.0f));
+
+    const float yaw = random.NextFloat(0.0f, 2.0f * glm::pi<float>());
+    const float pitch = random.NextFloat(-kMaxPitch, kMaxPitch);
+    const float scale = random.NextFloat(kMinScale, kMaxScale);
+
+    p_instances[instance].worldMatrix =
+        glm::translate(world_position) * glm::rotate(yaw, float3(0, 1, 0)) *
+        glm::rotate(pitch, float3(1, 0, 0)) * glm::scale(float3(scale));
+  }
+}
+
+uint32_t StressScene::GetInstanceCount() const {
+  // Without the scene, the model is drawn once
+  return IsEnabled() ? m_instance_count : 1;
+}
+
+void StressScene::SetInstanceCount(uint32_t instance_count) {
+  m_instance_count =
+      std::min(std::max(instance_count, 1u), m_max_instance_count);
+}
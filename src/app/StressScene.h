@@ -0,0 +1,71 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __STRESS_SCENE_H__
+#define __STRESS_SCENE_H__
+
+#include "vkex/Application.h"
+
+// Declared in ConstantBufferStructs.h, which relies on AppCore.h's aliases
+struct InstanceData;
+
+// Draws the loaded model many times over to load the geometry passes the way
+// a production scene would. Every instance has a static transform, generated
+// once from a seed and stored in a structured buffer read by the instanced
+// scene shaders. The transform is applied on top of the model's own node
+// transforms, so the instances animate along with it.
+//
+// Instance 0 is always the identity, keeping the model in its usual spot for
+// image comparisons. The rest are scattered through the camera's view volume
+// with a little spill past its edges.
+class StressScene {
+ public:
+  StressScene() {}
+  virtual ~StressScene() {}
+
+  enum StressSceneConstants {
+    kDefaultSeed = 1,
+  };
+
+  // A zero instance count leaves the scene disabled
+  void Configure(uint32_t instance_count, uint32_t seed);
+  bool IsEnabled() const { return m_max_instance_count > 0; }
+
+  vkex::Result CreateInstanceBuffer(vkex::Queue queue,
+                                    const vkex::PerspCamera& camera);
+
+  // Same seed, instance count and camera give the same layout everywhere
+  static void GenerateLayout(uint32_t seed, const vkex::PerspCamera& camera,
+                             uint32_t instance_count,
+                             InstanceData* p_instances);
+
+  vkex::Buffer GetInstanceBuffer() const { return m_instance_buffer; }
+  uint32_t GetSeed() const { return m_seed; }
+  uint32_t GetMaxInstanceCount() const { return m_max_instance_count; }
+
+  // Instances drawn this frame, a prefix of the layout. The layout is in
+  // random order, so any prefix covers the whole view volume.
+  uint32_t GetInstanceCount() const;
+  void SetInstanceCount(uint32_t instance_count);
+
+ private:
+  uint32_t m_max_instance_count = 0;
+  uint32_t m_instance_count = 0;
+  uint32_t m_seed = kDefaultSeed;
+  vkex::Buffer m_instance_buffer = nullptr;
+};
+
+#endif  // __STRESS_SCENE_H__
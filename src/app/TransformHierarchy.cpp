@@ -0,0 +1,510 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "TransformHierarchy.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TRANSFORM_HIERARCHY_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+struct TRSArrays {
+  const float* p_translation_x;
+  const float* p_translation_y;
+  const float* p_translation_z;
+  const float* p_rotation_x;
+  const float* p_rotation_y;
+  const float* p_rotation_z;
+  const float* p_rotation_w;
+  const float* p_scale_x;
+  const float* p_scale_y;
+  const float* p_scale_z;
+};
+
+#if defined(TRANSFORM_HIERARCHY_SSE)
+
+// T * R * S for the four nodes starting at 'base', written for the lanes set
+// in 'lane_mask' only. Columns are built across lanes, then transposed so
+// each node's column is a single store.
+void ComposeBatch(const TRSArrays& trs, uint32_t base, uint32_t lane_mask,
+                  vkex::float4x4* p_local_matrices) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 qx = _mm_loadu_ps(trs.p_rotation_x + base);
+  const __m128 qy = _mm_loadu_ps(trs.p_rotation_y + base);
+  const __m128 qz = _mm_loadu_ps(trs.p_rotation_z + base);
+  const __m128 qw = _mm_loadu_ps(trs.p_rotation_w + base);
+  const __m128 sx = _mm_loadu_ps(trs.p_scale_x + base);
+  const __m128 sy = _mm_loadu_ps(trs.p_scale_y + base);
+  const __m128 sz = _mm_loadu_ps(trs.p_scale_z + base);
+
+  const __m128 xx = _mm_mul_ps(qx, qx);
+  const __m128 yy = _mm_mul_ps(qy, qy);
+  const __m128 zz = _mm_mul_ps(qz, qz);
+  const __m128 xy = _mm_mul_ps(qx, qy);
+  const __m128 xz = _mm_mul_ps(qx, qz);
+  const __m128 yz = _mm_mul_ps(qy, qz);
+  const __m128 wx = _mm_mul_ps(qw, qx);
+  const __m128 wy = _mm_mul_ps(qw, qy);
+  const __m128 wz = _mm_mul_ps(qw, qz);
+
+  __m128 columns[4][4] = {
+      {
+          _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))),
+                     sx),
+          _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+          _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+          _mm_setzero_ps(),
+      },
+      {
+          _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+          _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+                     sy),
+          _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+          _mm_setzero_ps(),
+      },
+      {
+          _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+          _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+          _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))),
+                     sz),
+          _mm_setzero_ps(),
+      },
+      {
+          _mm_loadu_ps(trs.p_translation_x + base),
+          _mm_loadu_ps(trs.p_translation_y + base),
+          _mm_loadu_ps(trs.p_translation_z + base),
+          one,
+      },
+  };
+
+  for (uint32_t column = 0; column < 4; column++) {
+    __m128* p_rows = columns[column];
+    _MM_TRANSPOSE4_PS(p_rows[0], p_rows[1], p_rows[2], p_rows[3]);
+    for (uint32_t lane = 0; lane < 4; lane++) {
+      if ((lane_mask & (1u << lane)) != 0) {
+        _mm_storeu_ps(&p_local_matrices[base + lane][column][0],
+                      p_rows[lane]);
+      }
+    }
+  }
+}
+
+void MultiplyMatrix(const vkex::float4x4& a, const vkex::float4x4& b,
+                    vkex::float4x4* p_result) {
+  const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+  const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+  const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+  const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+  for (uint32_t column = 0; column < 4; column++) {
+    const __m128 b_column = _mm_loadu_ps(&b[column][0]);
+    __m128 result = _mm_mul_ps(
+        a0, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(0, 0, 0, 0)));
+    result = _mm_add_ps(
+        result, _mm_mul_ps(a1, _mm_shuffle_ps(b_column, b_column,
+                                              _MM_SHUFFLE(1, 1, 1, 1))));
+    result = _mm_add_ps(
+        result, _mm_mul_ps(a2, _mm_shuffle_ps(b_column, b_column,
+                                              _MM_SHUFFLE(2, 2, 2, 2))));
+    result = _mm_add_ps(
+        result, _mm_mul_ps(a3, _mm_shuffle_ps(b_column, b_column,
+                                              _MM_SHUFFLE(3, 3, 3, 3))));
+    _mm_storeu_ps(&(*p_result)[column][0], result);
+  }
+}
+
+#else
+
+void ComposeBatch(const TRSArrays& trs, uint32_t base, uint32_t lane_mask,
+                  vkex::float4x4* p_local_matrices) {
+  for (uint32_t lane = 0; lane < 4; lane++) {
+    if ((lane_mask & (1u << lane)) == 0) {
+      continue;
+    }
+    const uint32_t node = base + lane;
+    const vkex::quat rotation(trs.p_rotation_w[node], trs.p_rotation_x[node],
+                              trs.p_rotation_y[node], trs.p_rotation_z[node]);
+    vkex::float4x4 local_matrix = glm::toMat4(rotation);
+    local_matrix[0] *= trs.p_scale_x[node];
+    local_matrix[1] *= trs.p_scale_y[node];
+    local_matrix[2] *= trs.p_scale_z[node];
+    local_matrix[3] = vkex::float4(trs.p_translation_x[node],
+                                   trs.p_translation_y[node],
+                                   trs.p_translation_z[node], 1.0f);
+    p_local_matrices[node] = local_matrix;
+  }
+}
+
+void MultiplyMatrix(const vkex::float4x4& a, const vkex::float4x4& b,
+                    vkex::float4x4* p_result) {
+  *p_result = a * b;
+}
+
+#endif  // defined(TRANSFORM_HIERARCHY_SSE)
+
+}  // namespace
+
+// Workers wait for a new generation, resolve their range of whichever
+// hierarchy dispatched it and count themselves done
+struct TransformHierarchy::Workers {
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable start_condition;
+  std::condition_variable done_condition;
+  TransformHierarchy* p_hierarchy = nullptr;
+  uint64_t generation = 0;
+  uint32_t pending_count = 0;
+  bool stop = false;
+
+  ~Workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    start_condition.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  void WorkerMain(uint32_t range) {
+    uint64_t seen_generation = 0;
+    while (true) {
+      TransformHierarchy* p_target = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_condition.wait(lock, [this, seen_generation]() {
+          return stop || (generation != seen_generation);
+        });
+        if (stop) {
+          return;
+        }
+        seen_generation = generation;
+        p_target = p_hierarchy;
+      }
+
+      // Hierarchies with fewer ranges than workers leave the rest idle
+      const size_t range_count = p_target->m_range_begins.size() - 1;
+      if (range < range_count) {
+        p_target->m_range_updated_counts[range] =
+            p_target->UpdateRange(p_target->m_range_begins[range],
+                                  p_target->m_range_begins[range + 1]);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        --pending_count;
+      }
+      done_condition.notify_one();
+    }
+  }
+};
+
+TransformHierarchy::TransformHierarchy() {}
+
+TransformHierarchy::TransformHierarchy(TransformHierarchy&&) = default;
+
+TransformHierarchy& TransformHierarchy::operator=(TransformHierarchy&&) =
+    default;
+
+TransformHierarchy::~TransformHierarchy() {}
+
+void TransformHierarchy::Reserve(size_t node_count) {
+  const size_t padded_count = node_count + kBatchSize - 1;
+  m_parents.reserve(node_count);
+  m_flags.reserve(node_count);
+  for (auto* p_array :
+       {&m_translation_x, &m_translation_y, &m_translation_z, &m_rotation_x,
+        &m_rotation_y, &m_rotation_z, &m_rotation_w, &m_scale_x, &m_scale_y,
+        &m_scale_z}) {
+    p_array->reserve(padded_count);
+  }
+  m_local_matrices.reserve(node_count);
+  m_world_matrices.reserve(node_count);
+  m_prev_world_matrices.reserve(node_count);
+}
+
+void TransformHierarchy::Clear() {
+  m_parents.clear();
+  m_flags.clear();
+  for (auto* p_array :
+       {&m_translation_x, &m_translation_y, &m_translation_z, &m_rotation_x,
+        &m_rotation_y, &m_rotation_z, &m_rotation_w, &m_scale_x, &m_scale_y,
+        &m_scale_z}) {
+    p_array->clear();
+  }
+  m_local_matrices.clear();
+  m_world_matrices.clear();
+  m_prev_world_matrices.clear();
+  m_root_changed = true;
+  m_ranges_dirty = true;
+  m_statistics = {};
+}
+
+uint32_t TransformHierarchy::AddNode(int32_t parent) {
+  const uint32_t node = uint32_t(m_parents.size());
+  VKEX_ASSERT(parent < int32_t(node));
+
+  m_parents.push_back(parent);
+  m_flags.push_back(kNodeFlagComposeLocal | kNodeFlagLocalChanged);
+
+  // The SoA arrays run kBatchSize - 1 past the last node, so a batch can
+  // start at any node
+  const size_t padded_count = size_t(node) + kBatchSize;
+  m_translation_x.resize(padded_count, 0.0f);
+  m_translation_y.resize(padded_count, 0.0f);
+  m_translation_z.resize(padded_count, 0.0f);
+  m_rotation_x.resize(padded_count, 0.0f);
+  m_rotation_y.resize(padded_count, 0.0f);
+  m_rotation_z.resize(padded_count, 0.0f);
+  m_rotation_w.resize(padded_count, 1.0f);
+  m_scale_x.resize(padded_count, 1.0f);
+  m_scale_y.resize(padded_count, 1.0f);
+  m_scale_z.resize(padded_count, 1.0f);
+
+  m_local_matrices.push_back(vkex::float4x4(1.0f));
+  m_world_matrices.push_back(vkex::float4x4(1.0f));
+  m_prev_world_matrices.push_back(vkex::float4x4(1.0f));
+
+  m_ranges_dirty = true;
+  return node;
+}
+
+void TransformHierarchy::MarkLocalDirty(uint32_t node) {
+  m_flags[node] |= (kNodeFlagComposeLocal | kNodeFlagLocalChanged);
+}
+
+void TransformHierarchy::SetTranslation(uint32_t node,
+                                        const vkex::float3& translation) {
+  m_translation_x[node] = translation.x;
+  m_translation_y[node] = translation.y;
+  m_translation_z[node] = translation.z;
+  MarkLocalDirty(node);
+}
+
+void TransformHierarchy::SetRotation(uint32_t node,
+                                     const vkex::quat& rotation) {
+  m_rotation_x[node] = rotation.x;
+  m_rotation_y[node] = rotation.y;
+  m_rotation_z[node] = rotation.z;
+  m_rotation_w[node] = rotation.w;
+  MarkLocalDirty(node);
+}
+
+void TransformHierarchy::SetScale(uint32_t node, const vkex::float3& scale) {
+  m_scale_x[node] = scale.x;
+  m_scale_y[node] = scale.y;
+  m_scale_z[node] = scale.z;
+  MarkLocalDirty(node);
+}
+
+void TransformHierarchy::SetLocalMatrix(uint32_t node,
+                                        const vkex::float4x4& local_matrix) {
+  m_local_matrices[node] = local_matrix;
+  m_flags[node] &= ~kNodeFlagComposeLocal;
+  m_flags[node] |= kNodeFlagLocalChanged;
+}
+
+void TransformHierarchy::SetRootMatrix(const vkex::float4x4& root_matrix) {
+  m_root_matrix = root_matrix;
+  m_root_changed = true;
+}
+
+void TransformHierarchy::UpdateRanges(uint32_t thread_count) {
+  const uint32_t node_count = uint32_t(m_parents.size());
+
+  // Cut at root nodes near every 1 / thread_count of the nodes
+  m_range_begins.clear();
+  m_range_begins.push_back(0);
+  for (uint32_t node = 1;
+       (node < node_count) && (m_range_begins.size() < thread_count);
+       node++) {
+    const uint32_t target =
+        uint32_t((uint64_t(node_count) * m_range_begins.size()) /
+                 thread_count);
+    if ((m_parents[node] < 0) && (node >= target)) {
+      m_range_begins.push_back(node);
+    }
+  }
+  m_range_begins.push_back(node_count);
+
+  // A node added out of depth first order could have its parent in an
+  // earlier range, which would race. Resolve those hierarchies inline.
+  for (size_t range = 1; range + 1 < m_range_begins.size(); range++) {
+    for (uint32_t node = m_range_begins[range];
+         node < m_range_begins[range + 1]; node++) {
+      const int32_t parent = m_parents[node];
+      if ((parent >= 0) && (uint32_t(parent) < m_range_begins[range])) {
+        if (!m_order_warning_logged) {
+          VKEX_LOG_WARN("Transform hierarchy is not in depth first order, "
+                        "updating it on one thread");
+          m_order_warning_logged = true;
+        }
+        m_range_begins = {0, node_count};
+        return;
+      }
+    }
+  }
+}
+
+uint32_t TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end) {
+  // Compose dirty local transforms a batch at a time
+  const TRSArrays trs = {
+      m_translation_x.data(), m_translation_y.data(), m_translation_z.data(),
+      m_rotation_x.data(),    m_rotation_y.data(),    m_rotation_z.data(),
+      m_rotation_w.data(),    m_scale_x.data(),       m_scale_y.data(),
+      m_scale_z.data(),
+  };
+  for (uint32_t base = begin; base < end; base += kBatchSize) {
+    const uint32_t lane_count = std::min<uint32_t>(kBatchSize, end - base);
+    uint32_t lane_mask = 0;
+    for (uint32_t lane = 0; lane < lane_count; lane++) {
+      if ((m_flags[base + lane] & kNodeFlagComposeLocal) != 0) {
+        lane_mask |= (1u << lane);
+      }
+    }
+    if (lane_mask != 0) {
+      ComposeBatch(trs, base, lane_mask, m_local_matrices.data());
+    }
+  }
+
+  // Parents come first, so their flags are already this update's
+  uint32_t updated_count = 0;
+  for (uint32_t node = begin; node < end; node++) {
+    const int32_t parent = m_parents[node];
+    uint8_t flags = m_flags[node];
+
+    const bool parent_changed =
+        (parent >= 0)
+            ? ((m_flags[parent] & kNodeFlagWorldChanged) != 0)
+            : m_root_changed;
+    const bool world_changed =
+        parent_changed || ((flags & kNodeFlagLocalChanged) != 0);
+
+    if (world_changed || ((flags & kNodeFlagMoved) != 0)) {
+      m_prev_world_matrices[node] = m_world_matrices[node];
+    }
+    if (world_changed) {
+      const vkex::float4x4& parent_matrix =
+          (parent >= 0) ? m_world_matrices[parent] : m_root_matrix;
+      MultiplyMatrix(parent_matrix, m_local_matrices[node],
+                     &m_world_matrices[node]);
+      ++updated_count;
+    }
+
+    flags &= ~(kNodeFlagComposeLocal | kNodeFlagLocalChanged |
+               kNodeFlagMoved | kNodeFlagWorldChanged);
+    if (world_changed) {
+      flags |= (kNodeFlagMoved | kNodeFlagWorldChanged);
+    }
+    m_flags[node] = flags;
+  }
+  return updated_count;
+}
+
+void TransformHierarchy::Update() {
+  m_update_timer.Start();
+
+  const uint32_t node_count = uint32_t(m_parents.size());
+  uint32_t thread_count = m_thread_count;
+  if (thread_count == 0) {
+    thread_count = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+  }
+  thread_count = std::max<uint32_t>(
+      1, std::min<uint32_t>(thread_count, node_count / kMinNodesPerThread));
+  if (m_ranges_dirty || (m_ranges_thread_count != thread_count)) {
+    UpdateRanges(thread_count);
+    m_range_updated_counts.assign(m_range_begins.size() - 1, 0);
+    m_ranges_thread_count = thread_count;
+    m_ranges_dirty = false;
+  }
+
+  const uint32_t range_count = uint32_t(m_range_begins.size()) - 1;
+  const uint32_t worker_count = (range_count > 0) ? (range_count - 1) : 0;
+  if (worker_count > 0) {
+    if (!m_workers || (m_workers->threads.size() < worker_count)) {
+      StartWorkers(worker_count);
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_workers->mutex);
+      m_workers->p_hierarchy = this;
+      m_workers->pending_count = uint32_t(m_workers->threads.size());
+      ++m_workers->generation;
+    }
+    m_workers->start_condition.notify_all();
+  }
+  if (range_count > 0) {
+    m_range_updated_counts[0] =
+        UpdateRange(m_range_begins[0], m_range_begins[1]);
+  }
+  if (worker_count > 0) {
+    std::unique_lock<std::mutex> lock(m_workers->mutex);
+    m_workers->done_condition.wait(
+        lock, [this]() { return m_workers->pending_count == 0; });
+  }
+  m_root_changed = false;
+
+  m_update_timer.Stop();
+
+  m_statistics.node_count = node_count;
+  m_statistics.updated_count = 0;
+  for (uint32_t count : m_range_updated_counts) {
+    m_statistics.updated_count += count;
+  }
+  m_statistics.thread_count = range_count;
+  m_statistics.update_time_ms = m_update_timer.Millis();
+}
+
+void TransformHierarchy::StartWorkers(uint32_t worker_count) {
+  // Joins the old workers before the new ones start
+  m_workers.reset();
+  m_workers = std::make_unique<Workers>();
+  m_workers->threads.reserve(worker_count);
+  for (uint32_t worker = 0; worker < worker_count; worker++) {
+    // Range 0 is resolved by the thread calling Update()
+    const uint32_t range = worker + 1;
+    Workers* p_workers = m_workers.get();
+    m_workers->threads.emplace_back(
+        [p_workers, range]() { p_workers->WorkerMain(range); });
+  }
+}
+
+void TransformHierarchy::ResetPrevWorldMatrices() {
+  m_prev_world_matrices = m_world_matrices;
+  for (auto& flags : m_flags) {
+    flags &= ~kNodeFlagMoved;
+  }
+}
+
+void TransformHierarchy::GetStatistics(
+    TransformStatistics* p_statistics) const {
+  *p_statistics = m_statistics;
+}
+
+const char* TransformHierarchy::GetKernelName() {
+#if defined(TRANSFORM_HIERARCHY_SSE)
+  return "SSE2";
+#else
+  return "Scalar";
+#endif
+}
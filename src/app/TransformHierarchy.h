@@ -0,0 +1,161 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __TRANSFORM_HIERARCHY_H__
+#define __TRANSFORM_HIERARCHY_H__
+
+#include "vkex/Application.h"
+
+#include <memory>
+
+struct TransformStatistics {
+  uint32_t node_count;
+  // Nodes whose world matrix changed in the last Update()
+  uint32_t updated_count;
+  uint32_t thread_count;
+  double update_time_ms;
+};
+
+// World matrices for many nodes, resolved in one pass per frame. This is the
+// data oriented counterpart of vkex::Transform: local translation, rotation
+// and scale live in structure of arrays form, next to a parent index per
+// node, and nothing is computed lazily.
+//
+// Nodes are added depth first, so a parent always comes before its children
+// and every subtree is contiguous. Update() then walks the nodes in order:
+// dirty local transforms are composed four at a time with SSE, and world
+// matrices are recomputed only where the node or one of its ancestors
+// changed. Root subtrees are independent, so large hierarchies are split
+// into ranges of whole root subtrees and resolved on worker threads, which
+// are started once and reused by every Update().
+//
+// The world matrix from the previous Update() is kept per node for motion
+// vectors, matching PerObjectConstantData's worldMatrix/prevWorldMatrix.
+class TransformHierarchy {
+ public:
+  TransformHierarchy();
+  TransformHierarchy(TransformHierarchy&&);
+  TransformHierarchy& operator=(TransformHierarchy&&);
+  virtual ~TransformHierarchy();
+
+  enum TransformHierarchyConstants {
+    kBatchSize = 4,
+    // Below this many nodes per thread the hierarchy is resolved inline
+    kMinNodesPerThread = 4096,
+  };
+
+  void Reserve(size_t node_count);
+  void Clear();
+
+  // 'parent' is -1 for root nodes, otherwise a node added earlier whose
+  // subtree this node extends. Returns the new node's index.
+  uint32_t AddNode(int32_t parent);
+
+  void SetTranslation(uint32_t node, const vkex::float3& translation);
+  void SetRotation(uint32_t node, const vkex::quat& rotation);
+  void SetScale(uint32_t node, const vkex::float3& scale);
+  // The node keeps this local matrix until its translation, rotation or
+  // scale are set again
+  void SetLocalMatrix(uint32_t node, const vkex::float4x4& local_matrix);
+  // Applied above every root node
+  void SetRootMatrix(const vkex::float4x4& root_matrix);
+
+  // Zero uses every hardware thread
+  void SetThreadCount(uint32_t thread_count) { m_thread_count = thread_count; }
+
+  // Resolves the world matrices of every changed node and its descendants.
+  // The world matrices from before are kept as the previous ones.
+  void Update();
+  // Makes the previous world matrices match the current ones, for the first
+  // frame or after a cut
+  void ResetPrevWorldMatrices();
+
+  size_t GetNodeCount() const { return m_parents.size(); }
+  int32_t GetParent(uint32_t node) const { return m_parents[node]; }
+  const vkex::float4x4& GetWorldMatrix(uint32_t node) const {
+    return m_world_matrices[node];
+  }
+  const vkex::float4x4& GetPrevWorldMatrix(uint32_t node) const {
+    return m_prev_world_matrices[node];
+  }
+
+  void GetStatistics(TransformStatistics* p_statistics) const;
+  static const char* GetKernelName();
+
+ private:
+  void MarkLocalDirty(uint32_t node);
+  void UpdateRanges(uint32_t thread_count);
+  // Resolves the nodes in [begin, end), which must be whole root subtrees.
+  // Returns the number of world matrices that changed.
+  uint32_t UpdateRange(uint32_t begin, uint32_t end);
+  void StartWorkers(uint32_t worker_count);
+
+ private:
+  struct Workers;
+
+  enum NodeFlags {
+    // Translation, rotation or scale changed since the last compose
+    kNodeFlagComposeLocal = 0x1,
+    // The local matrix changed since the last Update()
+    kNodeFlagLocalChanged = 0x2,
+    // The world matrix changed in the last Update(), so the previous one
+    // needs to catch up on the next
+    kNodeFlagMoved = 0x4,
+    // The world matrix changed in this Update(), for the children
+    kNodeFlagWorldChanged = 0x8,
+  };
+
+  std::vector<int32_t> m_parents;
+  std::vector<uint8_t> m_flags;
+
+  // Local transforms, structure of arrays, padded to whole batches
+  std::vector<float> m_translation_x;
+  std::vector<float> m_translation_y;
+  std::vector<float> m_translation_z;
+  std::vector<float> m_rotation_x;
+  std::vector<float> m_rotation_y;
+  std::vector<float> m_rotation_z;
+  std::vector<float> m_rotation_w;
+  std::vector<float> m_scale_x;
+  std::vector<float> m_scale_y;
+  std::vector<float> m_scale_z;
+
+  std::vector<vkex::float4x4> m_local_matrices;
+  std::vector<vkex::float4x4> m_world_matrices;
+  std::vector<vkex::float4x4> m_prev_world_matrices;
+
+  vkex::float4x4 m_root_matrix = vkex::float4x4(1.0f);
+  bool m_root_changed = true;
+
+  // Ranges of whole root subtrees, one per thread, rebuilt when nodes are
+  // added or the thread count changes. A hierarchy with fewer roots than
+  // threads gets fewer ranges, so the thread count they were cut for is kept
+  // to tell the two apart.
+  std::vector<uint32_t> m_range_begins;
+  std::vector<uint32_t> m_range_updated_counts;
+  bool m_ranges_dirty = true;
+  uint32_t m_ranges_thread_count = 0;
+  uint32_t m_thread_count = 0;
+  bool m_order_warning_logged = false;
+
+  // Resolve every range but the first, which Update() does itself
+  std::unique_ptr<Workers> m_workers;
+
+  vkex::Timer m_update_timer;
+  TransformStatistics m_statistics = {};
+};
+
+#endif  // __TRANSFORM_HIERARCHY_H__
@@ -16,9 +16,110 @@
 
 #include "AppCore.h"
 
+#include "AssetUtil.h"
+
 void VkexInfoApp::AddArgs(vkex::ArgParser& args) {
   args.AddOptionInt("h", "height", "Height of swapchain image (1080, 2160)",
                     1080);
+  args.AddOptionInt("bos", "bench-object-storage",
+                    "Create and destroy N buffers and image views at startup "
+                    "to time device object storage",
+                    0);
+  args.AddOptionInt("bg", "bench-geometry",
+                    "Generate a sphere of about N triangles at startup with "
+                    "TriangleList and GeometryBuilder to time procedural "
+                    "geometry",
+                    0);
+  args.AddOptionInt("bt", "bench-transforms",
+                    "Animate N nodes at startup with vkex::Transform and "
+                    "TransformHierarchy to time world matrix updates",
+                    0);
+  args.AddOptionString("ci", "compare-images",
+                       "Compare two saved frames at startup, upscaled then "
+                       "native, separated by a comma, and log their PSNR, "
+                       "SSIM and FLIP-style error",
+                       "");
+  args.AddOptionString("sw", "sweep",
+                       "Walk every upscaling technique, resolution and CAS "
+                       "sharpness, measure GPU time and quality against the "
+                       "native reference, write CSV and JSON reports and "
+                       "exit. 'default' or a spec file",
+                       "");
+  args.AddOptionInt("ar", "animation-rate",
+                    "The animation advances 1/N seconds every frame, 0 "
+                    "follows the measured frame time",
+                    60);
+  args.AddOptionString("rec", "record",
+                       "Record the camera and animation state of every frame "
+                       "to a file",
+                       "");
+  args.AddOptionString("rep", "replay",
+                       "Replay the camera and animation state of a --record "
+                       "file frame by frame, and exit at its end",
+                       "");
+  args.AddOptionString("shot", "screenshots",
+                       "Screenshots of the presented frames (off, key, "
+                       "every-frame). key captures on print screen",
+                       "off");
+  args.AddOptionString("cap", "capture",
+                       "Stream every frame to <prefix>_<stream>.y4m (or "
+                       ".raw) with a .csv frame index, for offline quality "
+                       "analysis",
+                       "");
+  args.AddOptionString("caps", "capture-streams",
+                       "Comma separated images to --capture (target, "
+                       "reference, internal, velocity, history)",
+                       "target,reference");
+  args.AddOptionString("capf", "capture-format",
+                       "Container of the captured color streams (y4m, raw). "
+                       "velocity is always raw",
+                       "y4m");
+  args.AddOptionString("up", "upload-path",
+                       "How GPU only assets are uploaded (auto, staging). "
+                       "auto writes buffers directly when device local "
+                       "memory is host visible, and textures too on unified "
+                       "memory devices",
+                       "auto");
+  args.AddOptionString("m", "model",
+                       "glTF model to load, relative to the assets directory "
+                       "(.gltf or .glb)",
+                       "models/DamagedHelmet/glTF/DamagedHelmet.gltf");
+  args.AddOptionInt("si", "stress-instances",
+                    "Draw the model N times with instanced draws to load the "
+                    "geometry passes, 0 disables the stress scene",
+                    0);
+  args.AddOptionInt("ss", "stress-seed",
+                    "Seed for the stress scene instance layout",
+                    StressScene::kDefaultSeed);
+  args.AddOptionString("mo", "mesh-optimize",
+                       "Geometry processing at load (none, reorder, "
+                       "quantize). reorder optimizes triangle and vertex "
+                       "order, quantize also packs vertex attributes",
+                       "reorder");
+  args.AddOptionInt("lc", "lod-count",
+                    "Levels of detail generated per primitive at load, "
+                    "including full detail (1 to 4)",
+                    LOD_MAX_COUNT);
+  args.AddOptionFloat("le", "lod-error",
+                      "Screen space error allowed when picking a level of "
+                      "detail, in pixels at the internal resolution. 0 "
+                      "always draws full detail",
+                      1.0f);
+  args.AddOptionFloat("pbw", "peak-bandwidth",
+                      "Peak memory bandwidth in GB/s the achieved bandwidth "
+                      "of each GPU pass is reported against, 0 reports GB/s "
+                      "only",
+                      484.0f);
+  args.AddOptionInt("sli", "stats-log-interval",
+                    "Seconds between log lines with the P50, P95, P99 and "
+                    "max of the frame loop and GPU timer times, 0 turns "
+                    "them off",
+                    60);
+  args.AddOptionFloat("hitch", "hitch-threshold",
+                      "Frames longer than this many milliseconds dump the "
+                      "last few seconds of the flight recorder as Chrome "
+                      "trace JSON next to the executable, 0 turns it off",
+                      100.0f);
 }
 
 void VkexInfoApp::Configure(const vkex::ArgParser& args,
@@ -33,6 +134,7 @@ void VkexInfoApp::Configure(const vkex::ArgParser& args,
   // this format. In the future, we'll support both compute and graphics.
   configuration.swapchain.color_format = VK_FORMAT_B8G8R8A8_UNORM;
   configuration.swapchain.paced_frame_rate = 60;
+  configuration.enable_host_allocator = true;
 
   // INFO: Right now, Application::InitializeVkexSwapchain() creates a
   // renderpass for the swapchain images based on some of the config bits. Right
@@ -49,6 +151,8 @@ void VkexInfoApp::Configure(const vkex::ArgParser& args,
       VK_KHR_16BIT_STORAGE_EXTENSION_NAME);
   configuration.optional_device_extensions.push_back(
       VK_KHR_8BIT_STORAGE_EXTENSION_NAME);
+  configuration.optional_device_extensions.push_back(
+      VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
 
 #if defined(ENABLE_VALIDATION)
   configuration.graphics_debug.enable = true;
@@ -82,9 +186,154 @@ void VkexInfoApp::Configure(const vkex::ArgParser& args,
         "Requested window height is unsupported: " << requested_height);
     VKEX_LOG_WARN("Window dimensions defaulting to 1920 x 1080");
   }
+
+  int32_t benchmark_object_count = 0;
+  args.GetInt("bos", "bench-object-storage", &benchmark_object_count);
+  m_object_storage_benchmark_count =
+      static_cast<uint32_t>(std::max<int32_t>(benchmark_object_count, 0));
+
+  int32_t benchmark_triangle_count = 0;
+  args.GetInt("bg", "bench-geometry", &benchmark_triangle_count);
+  m_geometry_benchmark_triangle_count =
+      static_cast<uint32_t>(std::max<int32_t>(benchmark_triangle_count, 0));
+
+  int32_t benchmark_node_count = 0;
+  args.GetInt("bt", "bench-transforms", &benchmark_node_count);
+  m_transform_benchmark_node_count =
+      static_cast<uint32_t>(std::max<int32_t>(benchmark_node_count, 0));
+
+  std::string compare_images;
+  args.GetString("ci", "compare-images", &compare_images);
+  if (!compare_images.empty()) {
+    const size_t separator = compare_images.find(',');
+    if (separator != std::string::npos) {
+      m_compare_test_path = compare_images.substr(0, separator);
+      m_compare_reference_path = compare_images.substr(separator + 1);
+    } else {
+      VKEX_LOG_WARN("--compare-images takes two paths separated by a comma: "
+                    << compare_images);
+    }
+  }
+
+  args.GetString("sw", "sweep", &m_sweep_spec_path);
+
+  std::string screenshots = "off";
+  args.GetString("shot", "screenshots", &screenshots);
+  if ((screenshots != "off") && (screenshots != "key") &&
+      (screenshots != "every-frame")) {
+    VKEX_LOG_WARN("Unknown screenshot mode: " << screenshots
+                                              << ", defaulting to off");
+    screenshots = "off";
+  }
+  configuration.enable_screen_shot = (screenshots != "off");
+  SetScreenShotEveryFrame(screenshots == "every-frame");
+
+  int32_t animation_rate = 60;
+  args.GetInt("ar", "animation-rate", &animation_rate);
+  m_animation_rate =
+      static_cast<uint32_t>(std::max<int32_t>(animation_rate, 0));
+
+  args.GetString("rec", "record", &m_record_path);
+  args.GetString("rep", "replay", &m_replay_path);
+
+  args.GetString("cap", "capture", &m_capture_path);
+
+  std::string capture_streams = "target,reference";
+  args.GetString("caps", "capture-streams", &capture_streams);
+  std::stringstream capture_stream_list(capture_streams);
+  std::string capture_stream;
+  while (std::getline(capture_stream_list, capture_stream, ',')) {
+    if ((capture_stream != "target") && (capture_stream != "reference") &&
+        (capture_stream != "internal") && (capture_stream != "velocity") &&
+        (capture_stream != "history")) {
+      VKEX_LOG_WARN("Unknown capture stream: " << capture_stream);
+      continue;
+    }
+    m_capture_streams.push_back(capture_stream);
+  }
+  if (m_capture_streams.empty()) {
+    m_capture_streams.push_back("target");
+  }
+
+  std::string capture_format = "y4m";
+  args.GetString("capf", "capture-format", &capture_format);
+  if ((capture_format != "y4m") && (capture_format != "raw")) {
+    VKEX_LOG_WARN("Unknown capture format: " << capture_format
+                                             << ", defaulting to y4m");
+    capture_format = "y4m";
+  }
+  m_capture_raw = (capture_format == "raw");
+
+  std::string upload_path = "auto";
+  args.GetString("up", "upload-path", &upload_path);
+  if ((upload_path != "auto") && (upload_path != "staging")) {
+    VKEX_LOG_WARN("Unknown upload path: " << upload_path
+                                          << ", defaulting to auto");
+    upload_path = "auto";
+  }
+  asset_util::SetDirectUploadEnabled(upload_path == "auto");
+
+  args.GetString("m", "model", &m_model_path);
+
+  int32_t stress_instance_count = 0;
+  int32_t stress_seed = StressScene::kDefaultSeed;
+  args.GetInt("si", "stress-instances", &stress_instance_count);
+  args.GetInt("ss", "stress-seed", &stress_seed);
+  m_stress_scene.Configure(
+      static_cast<uint32_t>(std::max<int32_t>(stress_instance_count, 0)),
+      static_cast<uint32_t>(stress_seed));
+
+  std::string mesh_optimize = "reorder";
+  args.GetString("mo", "mesh-optimize", &mesh_optimize);
+  if ((mesh_optimize != "none") && (mesh_optimize != "reorder") &&
+      (mesh_optimize != "quantize")) {
+    VKEX_LOG_WARN("Unknown mesh optimization: " << mesh_optimize
+                                                << ", defaulting to reorder");
+    mesh_optimize = "reorder";
+  }
+  GLTFModel::GeometryOptions geometry_options = {};
+  geometry_options.optimize = (mesh_optimize != "none");
+  geometry_options.quantize = (mesh_optimize == "quantize");
+
+  int32_t lod_count = LOD_MAX_COUNT;
+  args.GetInt("lc", "lod-count", &lod_count);
+  geometry_options.lod_count = static_cast<uint32_t>(
+      std::min<int32_t>(std::max<int32_t>(lod_count, 1), LOD_MAX_COUNT));
+  m_helmet_model.SetGeometryOptions(geometry_options);
+
+  float lod_error = 1.0f;
+  args.GetFloat("le", "lod-error", &lod_error);
+  m_lod_selector.SetErrorThreshold(std::max(lod_error, 0.0f));
+
+  float peak_bandwidth = 484.0f;
+  args.GetFloat("pbw", "peak-bandwidth", &peak_bandwidth);
+  m_peak_bandwidth_gbps = std::max(double(peak_bandwidth), 0.0);
+
+  int32_t stats_log_interval = 60;
+  args.GetInt("sli", "stats-log-interval", &stats_log_interval);
+  configuration.frame_stats_log_interval =
+      static_cast<uint32_t>(std::max<int32_t>(stats_log_interval, 0));
+
+  float hitch_threshold = 100.0f;
+  args.GetFloat("hitch", "hitch-threshold", &hitch_threshold);
+  configuration.flight_recorder.hitch_threshold_ms =
+      std::max(hitch_threshold, 0.0f);
 }
 
 void VkexInfoApp::Setup() {
+  if (m_object_storage_benchmark_count > 0) {
+    RunObjectStorageBenchmark(m_object_storage_benchmark_count);
+  }
+  if (m_geometry_benchmark_triangle_count > 0) {
+    RunGeometryBuilderBenchmark(m_geometry_benchmark_triangle_count);
+  }
+  if (m_transform_benchmark_node_count > 0) {
+    RunTransformBenchmark(m_transform_benchmark_node_count);
+  }
+  if (!m_compare_test_path.empty()) {
+    RunImageComparison(m_compare_test_path, m_compare_reference_path);
+  }
+
   CheckVulkanFeaturesForPipelines();
 
   {
@@ -94,13 +343,31 @@ void VkexInfoApp::Setup() {
   }
 
   {
-    auto helmet_path =
-        GetAssetPath("models/DamagedHelmet/glTF/DamagedHelmet.gltf");
+    auto helmet_path = GetAssetPath(m_model_path);
     m_helmet_model.PopulateFromModel(helmet_path, GetGraphicsQueue());
+
+    auto physical_device = GetDevice()->GetPhysicalDevice();
+    VKEX_LOG_INFO("Direct upload heap: "
+                  << (physical_device->GetDirectUploadHeapSize() >> 20)
+                  << " MiB, direct upload "
+                  << (asset_util::IsDirectUploadEnabled(GetDevice())
+                          ? "enabled"
+                          : "disabled")
+                  << ", textures "
+                  << ((asset_util::IsDirectUploadEnabled(GetDevice()) &&
+                       physical_device->IsUnifiedMemory())
+                          ? "direct"
+                          : "staged"));
+    asset_util::LogUploadStatistics();
   }
 
   // Render state managed from CPU side
   {
+    float3 eye = float3(0, 0, 2);
+    float3 center = float3(0, 0, 0);
+    float3 up = float3(0, 1, 0);
+    m_camera = vkex::PerspCamera(eye, center, up, 60.0f, GetWindowAspect());
+
     m_animation_enabled = true;
     m_animation_progress = 0.0f;
     m_light_infos.resize(1);  // TODO: Support more than one light?
@@ -110,6 +377,13 @@ void VkexInfoApp::Setup() {
     m_light_infos[0].intensity = 10.f;
   }
 
+  if (!m_replay_path.empty()) {
+    m_frame_player.Load(m_replay_path);
+  }
+  if (!m_record_path.empty()) {
+    m_frame_recorder.Open(m_record_path);
+  }
+
   {
     auto frame_count = GetConfiguration().frame_count;
     m_per_frame_datas.resize(frame_count);
@@ -138,20 +412,26 @@ void VkexInfoApp::Setup() {
 
     std::vector<ShaderProgramInputs> shader_inputs(AppShaderList::NumTypes);
 
+    // Quantized geometry needs the scene shaders that decode it
+    const std::string scene_shader_suffix =
+        m_helmet_model.GetGeometryStatistics().quantized ? "_quantized" : "";
+
     {
       shader_inputs[AppShaderList::Geometry].pipeline_type =
           ShaderPipelineType::Graphics;
 
       shader_inputs[AppShaderList::Geometry].shader_paths.resize(2);
       shader_inputs[AppShaderList::Geometry].shader_paths[0] =
-          GetAssetPath("shaders/draw_standard.vs.spv");
+          GetAssetPath("shaders/draw_standard" + scene_shader_suffix +
+                       ".vs.spv");
       shader_inputs[AppShaderList::Geometry].shader_paths[1] =
-          GetAssetPath("shaders/draw_standard.ps.spv");
+          GetAssetPath("shaders/draw_standard" + scene_shader_suffix +
+                       ".ps.spv");
 
       std::vector<vkex::VertexBindingDescription> vertex_buffer_bindings =
-          m_helmet_model.GetVertexBindingDescriptions(0, 0);
+          m_helmet_model.GetVertexBindingDescriptions();
       std::vector<VkFormat> vertex_buffer_formats =
-          m_helmet_model.GetVertexBufferFormats(0, 0);
+          m_helmet_model.GetVertexBufferFormats();
 
       // TODO: We could have shared constants/defines for the locations?
       vertex_buffer_bindings[GLTFModel::BufferType::Position].AddAttribute(
@@ -242,14 +522,16 @@ void VkexInfoApp::Setup() {
 
       shader_inputs[AppShaderList::GeometryCB].shader_paths.resize(2);
       shader_inputs[AppShaderList::GeometryCB].shader_paths[0] =
-          GetAssetPath("shaders/draw_cb.vs.spv");
+          GetAssetPath("shaders/draw_cb" + scene_shader_suffix +
+                       ".vs.spv");
       shader_inputs[AppShaderList::GeometryCB].shader_paths[1] =
-          GetAssetPath("shaders/draw_cb.ps.spv");
+          GetAssetPath("shaders/draw_cb" + scene_shader_suffix +
+                       ".ps.spv");
 
       std::vector<vkex::VertexBindingDescription> vertex_buffer_bindings =
-          m_helmet_model.GetVertexBindingDescriptions(0, 0);
+          m_helmet_model.GetVertexBindingDescriptions();
       std::vector<VkFormat> vertex_buffer_formats =
-          m_helmet_model.GetVertexBufferFormats(0, 0);
+          m_helmet_model.GetVertexBufferFormats();
 
       // TODO: We could have shared constants/defines for the locations?
       vertex_buffer_bindings[GLTFModel::BufferType::Position].AddAttribute(
@@ -301,6 +583,61 @@ void VkexInfoApp::Setup() {
       shader_inputs[AppShaderList::GeometryCB].graphics_pipeline_create_info =
           create_info;
     }
+    if (m_stress_scene.IsEnabled()) {
+      // Same pipeline state as the scene shaders, only the vertex shader
+      // differs
+      shader_inputs[AppShaderList::GeometryInstanced] =
+          shader_inputs[AppShaderList::Geometry];
+      shader_inputs[AppShaderList::GeometryInstanced].shader_paths[0] =
+          GetAssetPath("shaders/draw_instanced" + scene_shader_suffix +
+                       ".vs.spv");
+      shader_inputs[AppShaderList::GeometryInstanced].shader_paths[1] =
+          GetAssetPath("shaders/draw_instanced" + scene_shader_suffix +
+                       ".ps.spv");
+
+      shader_inputs[AppShaderList::GeometryCBInstanced] =
+          shader_inputs[AppShaderList::GeometryCB];
+      shader_inputs[AppShaderList::GeometryCBInstanced].shader_paths[0] =
+          GetAssetPath("shaders/draw_cb_instanced" + scene_shader_suffix +
+                       ".vs.spv");
+      shader_inputs[AppShaderList::GeometryCBInstanced].shader_paths[1] =
+          GetAssetPath("shaders/draw_cb_instanced" + scene_shader_suffix +
+                       ".ps.spv");
+    }
+    if (m_gpu_culling_available) {
+      const std::pair<AppShaderList, const char*> cull_shaders[] = {
+          {AppShaderList::HiZBuild, "shaders/hiz_build.cs.spv"},
+          {AppShaderList::HiZBuildMS, "shaders/hiz_build_ms.cs.spv"},
+          {AppShaderList::HiZDownsample, "shaders/hiz_downsample.cs.spv"},
+          {AppShaderList::GpuCull, "shaders/gpu_cull.cs.spv"},
+      };
+      for (const auto& cull_shader : cull_shaders) {
+        shader_inputs[cull_shader.first].pipeline_type =
+            ShaderPipelineType::Compute;
+        shader_inputs[cull_shader.first].shader_paths.resize(1);
+        shader_inputs[cull_shader.first].shader_paths[0] =
+            GetAssetPath(cull_shader.second);
+      }
+    }
+
+    {
+      const std::string metrics_shader_suffix =
+          m_image_metrics_wave_ops ? "_wave" : "";
+      const std::pair<AppShaderList, std::string> metrics_shaders[] = {
+          {AppShaderList::ImageMetricsTile,
+           "shaders/image_metrics" + metrics_shader_suffix + ".cs.spv"},
+          {AppShaderList::ImageMetricsReduce,
+           "shaders/image_metrics_reduce" + metrics_shader_suffix +
+               ".cs.spv"},
+      };
+      for (const auto& metrics_shader : metrics_shaders) {
+        shader_inputs[metrics_shader.first].pipeline_type =
+            ShaderPipelineType::Compute;
+        shader_inputs[metrics_shader.first].shader_paths.resize(1);
+        shader_inputs[metrics_shader.first].shader_paths[0] =
+            GetAssetPath(metrics_shader.second);
+      }
+    }
 
     SetupShaders(shader_inputs, m_generated_shader_states);
   }
@@ -314,88 +651,55 @@ void VkexInfoApp::Setup() {
 
   // Scene rendering descriptors
   {
+    if (m_stress_scene.IsEnabled()) {
+      VKEX_CALL(
+          m_stress_scene.CreateInstanceBuffer(GetGraphicsQueue(), m_camera));
+    }
+
     BuildCheckerboardMaterialSampler();
+    SetupMaterialDescriptorSets();
 
-    // The sampler is shared for all textures
-    vkex::Sampler regular_material_sampler =
-        m_helmet_model.GetVkSamplerFromMaterialComponent(
-            0, 0, GLTFModel::MaterialTextureType::BaseColor);
-    vkex::Sampler checkerboard_material_sampler = m_cb_grad_adj_sampler;
-
-    vkex::Texture helmet_textures
-        [GLTFModel::MaterialTextureType::MaterialComponentTypeCount];
-    for (uint32_t mat_tex_index = 0;
-         mat_tex_index <
-         GLTFModel::MaterialTextureType::MaterialComponentTypeCount;
-         mat_tex_index++) {
-      helmet_textures[mat_tex_index] =
-          m_helmet_model.GetVkTextureFromMaterialComponent(
-              0, 0, GLTFModel::MaterialTextureType(mat_tex_index));
-    }
+    m_draw_list.Reserve(m_helmet_model);
+    m_frustum_culler.Reserve(m_draw_list.GetCapacity());
+    // BuildDrawList() uploads per object constants for every item
+    m_constant_buffer_manager.ReserveFrameUploads(
+        m_per_object_constants.size, m_draw_list.GetCapacity());
 
     auto frame_count = GetConfiguration().frame_count;
-    for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
-      auto& per_frame_data = m_per_frame_datas[frame_index];
 
-      m_generated_shader_states[AppShaderList::Geometry]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(0,
-                             m_constant_buffer_manager.GetBuffer(frame_index),
-                             m_per_frame_constants.size);
-      m_generated_shader_states[AppShaderList::Geometry]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(1,
-                             m_constant_buffer_manager.GetBuffer(frame_index),
-                             m_per_object_constants.size);
-
-      // TODO: If models are switching, these updates will have to be per-frame
+    if (m_gpu_culling_available) {
+      GpuCullShaders cull_shaders = {};
+      cull_shaders.p_hiz_build =
+          &m_generated_shader_states[AppShaderList::HiZBuild];
+      cull_shaders.p_hiz_build_ms =
+          &m_generated_shader_states[AppShaderList::HiZBuildMS];
+      cull_shaders.p_hiz_downsample =
+          &m_generated_shader_states[AppShaderList::HiZDownsample];
+      cull_shaders.p_cull = &m_generated_shader_states[AppShaderList::GpuCull];
+
+      // No scene pass renders depth larger than the present resolution
+      VKEX_CALL(m_gpu_culler.Initialize(
+          GetGraphicsQueue(), frame_count, cull_shaders,
+          uint32_t(m_draw_list.GetCapacity()),
+          m_stress_scene.GetMaxInstanceCount(), GetPresentResolutionExtent(),
+          m_stress_scene.GetInstanceBuffer()));
+    }
 
-      m_generated_shader_states[AppShaderList::Geometry]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(2, regular_material_sampler);
-
-      for (uint32_t texture_index = 0;
-           texture_index <
-           GLTFModel::MaterialTextureType::MaterialComponentTypeCount;
-           texture_index++) {
-        const uint32_t kTextureSlotOffset =
-            3;  // TODO: Source from shared header
-        uint32_t binding_slot = texture_index + kTextureSlotOffset;
-
-        m_generated_shader_states[AppShaderList::Geometry]
-            .descriptor_sets[frame_index]
-            ->UpdateDescriptor(binding_slot, helmet_textures[texture_index]);
-      }
+    {
+      ImageMetricsShaders metrics_shaders = {};
+      metrics_shaders.p_tile =
+          &m_generated_shader_states[AppShaderList::ImageMetricsTile];
+      metrics_shaders.p_reduce =
+          &m_generated_shader_states[AppShaderList::ImageMetricsReduce];
+
+      // Measured at the target resolution, which is at most the present one
+      VKEX_CALL(m_image_metrics.Initialize(GetGraphicsQueue(), frame_count,
+                                           metrics_shaders,
+                                           GetPresentResolutionExtent()));
+    }
 
-      {
-        m_generated_shader_states[AppShaderList::GeometryCB]
-            .descriptor_sets[frame_index]
-            ->UpdateDescriptor(0,
-                               m_constant_buffer_manager.GetBuffer(frame_index),
-                               m_per_frame_constants.size);
-        m_generated_shader_states[AppShaderList::GeometryCB]
-            .descriptor_sets[frame_index]
-            ->UpdateDescriptor(1,
-                               m_constant_buffer_manager.GetBuffer(frame_index),
-                               m_per_object_constants.size);
-
-        m_generated_shader_states[AppShaderList::GeometryCB]
-            .descriptor_sets[frame_index]
-            ->UpdateDescriptor(2, checkerboard_material_sampler);
-
-        for (uint32_t texture_index = 0;
-             texture_index <
-             GLTFModel::MaterialTextureType::MaterialComponentTypeCount;
-             texture_index++) {
-          const uint32_t kTextureSlotOffset =
-              3;  // TODO: Source from shared header
-          uint32_t binding_slot = texture_index + kTextureSlotOffset;
-
-          m_generated_shader_states[AppShaderList::GeometryCB]
-              .descriptor_sets[frame_index]
-              ->UpdateDescriptor(binding_slot, helmet_textures[texture_index]);
-        }
-      }
+    for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
+      UpdateConstantBufferDescriptors(frame_index);
     }
   }
 
@@ -410,24 +714,11 @@ void VkexInfoApp::Setup() {
     auto frame_count = GetConfiguration().frame_count;
     for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++) {
       auto& per_frame_data = m_per_frame_datas[frame_index];
-      auto constant_buffer = m_constant_buffer_manager.GetBuffer(frame_index);
 
-      m_generated_shader_states[AppShaderList::InternalToTargetScaledCopy]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(0, constant_buffer,
-                             m_internal_to_target_scaled_copy_constants.size);
       m_generated_shader_states[AppShaderList::InternalToTargetScaledCopy]
           .descriptor_sets[frame_index]
           ->UpdateDescriptor(1, m_internal_draw_simple_render_pass.color_texture);
 
-      m_generated_shader_states[AppShaderList::InternalTargetImageDelta]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(0, constant_buffer,
-                             m_internal_to_target_scaled_copy_constants.size);
-      m_generated_shader_states[AppShaderList::InternalTargetImageDelta]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(1, constant_buffer,
-                             m_image_delta_options_constants.size);
       m_generated_shader_states[AppShaderList::InternalTargetImageDelta]
           .descriptor_sets[frame_index]
           ->UpdateDescriptor(
@@ -436,28 +727,13 @@ void VkexInfoApp::Setup() {
           .descriptor_sets[frame_index]
           ->UpdateDescriptor(4, m_visualization_texture);
 
-      m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(0, constant_buffer,
-                             m_target_to_present_scaled_copy_constants.size);
       m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy]
           .descriptor_sets[frame_index]
           ->UpdateDescriptor(1, m_visualization_texture);
 
-      m_generated_shader_states[AppShaderList::UpscalingCAS]
-          .descriptor_sets[frame_index]
-          ->UpdateDescriptor(0, constant_buffer,
-                             m_cas_upscaling_constants.size);
       m_generated_shader_states[AppShaderList::UpscalingCAS]
           .descriptor_sets[frame_index]
           ->UpdateDescriptor(1, m_internal_draw_simple_render_pass.color_texture);
-
-      {
-        m_generated_shader_states[AppShaderList::CheckerboardUpscale]
-            .descriptor_sets[frame_index]
-            ->UpdateDescriptor(0, constant_buffer,
-                               m_cb_upscaling_constants.size);
-      }
     }
   }
 
@@ -480,10 +756,24 @@ void VkexInfoApp::Setup() {
       }
 
       per_frame_data.issued_gpu_timers.resize(TimerTag::kTimerTagCount);
+      per_frame_data.recorded_pass_traffic.resize(TimerTag::kTimerTagCount);
+      per_frame_data.pass_traffic.resize(TimerTag::kTimerTagCount);
+    }
+
+    // GPU timer percentiles go in the periodic log with the frame loop's
+    BuildTimerTagNameList(m_gpu_timer_names);
+    for (uint32_t tag_index = 0; tag_index < TimerTag::kTimerTagCount;
+         tag_index++) {
+      AddLoggedFrameMetric("gpu " + m_gpu_timer_names[tag_index],
+                           &m_gpu_timer_metrics[tag_index]);
     }
   }
 
   SetupInitialConstantBufferValues();
+
+  if (!m_sweep_spec_path.empty()) {
+    StartSettingsSweep();
+  }
 }
 
 void VkexInfoApp::Update(double frame_elapsed_time) {
@@ -493,35 +783,53 @@ void VkexInfoApp::Update(double frame_elapsed_time) {
 
   // Almost entirely doing CPU-side updates of constant buffers
 
-  float3 eye = float3(0, 0, 2);
-  float3 center = float3(0, 0, 0);
-  float3 up = float3(0, 1, 0);
-  float aspect = GetWindowAspect();
-  vkex::PerspCamera camera(eye, center, up, 60.0f, aspect);
+  if (m_frame_player.IsLoaded()) {
+    RecordedFrameState state = {};
+    if (m_frame_player.Read(&state)) {
+      m_animation_enabled = state.animation_enabled;
+      m_animation_progress = state.animation_progress;
+      m_camera.LookAt(state.eye, state.center, state.up);
+    } else {
+      VKEX_LOG_INFO("Replay finished after "
+                    << m_frame_player.GetFrameCount() << " frames");
+      Quit();
+    }
+  } else if (m_animation_enabled) {
+    m_animation_progress += (m_animation_rate > 0)
+                                ? (1.0f / float(m_animation_rate))
+                                : float(frame_elapsed_time);
+  }
 
-  if (m_animation_enabled) {
-    // TODO: Make the rate configurable?
-    m_animation_progress += (1 / 60.f);
+  if (m_frame_recorder.IsOpen()) {
+    RecordedFrameState state = {};
+    state.animation_progress = m_animation_progress;
+    state.animation_enabled = m_animation_enabled;
+    state.eye = m_camera.GetEyePosition();
+    state.center = m_camera.GetLookAt();
+    state.up = m_camera.GetWorldUp();
+    m_frame_recorder.Write(state);
   }
+
   float4x4 M = glm::translate(float3(0, 0, 0)) *
                glm::rotate(m_animation_progress / 2.0f, float3(0, 1, 0)) *
                glm::rotate(m_animation_progress / 4.0f, float3(1, 0, 0));
-  float4x4 V = camera.GetViewMatrix();
-  float4x4 P = camera.GetProjectionMatrix();
+  float4x4 V = m_camera.GetViewMatrix();
+  float4x4 P = m_camera.GetProjectionMatrix();
 
-  m_per_object_constants.data.prevWorldMatrix =
-      m_per_object_constants.data.worldMatrix;
-  m_per_object_constants.data.worldMatrix = M;
+  m_helmet_model.UpdateWorldMatrices(M);
 
   m_per_frame_constants.data.prevViewProjectionMatrix =
       m_per_frame_constants.data.viewProjectionMatrix;
   m_per_frame_constants.data.viewProjectionMatrix = P * V;
-  m_per_frame_constants.data.cameraPos = eye;
+  m_per_frame_constants.data.cameraPos = m_camera.GetEyePosition();
 
   m_per_frame_constants.data.dirLight =
       ConvertCPULightInfoToGPULightInfo(m_light_infos[0]);
 
-  UpdateMaterialConstants();
+  // The sweep overrides the GUI's selections
+  if (m_settings_sweep.IsActive()) {
+    UpdateSettingsSweep();
+  }
 
   UpdateTargetResolutionState();
   UpdateInternalResolutionState();
@@ -583,13 +891,27 @@ void VkexInfoApp::Render(vkex::Application::RenderData* p_data) {
   // we might want to think about using the Viewport to generate the jitter.
   // Otherwise, the jitter can go into the projection matrix.
 
-  m_constant_buffer_manager.NewFrame(frame_index);
+  // A grown constant buffer ring is a new VkBuffer, so the frame's
+  // descriptors have to follow it before anything is recorded.
+  if (m_constant_buffer_manager.NewFrame(frame_index)) {
+    UpdateConstantBufferDescriptors(frame_index);
+  }
 
   ReadbackGpuTimestamps(frame_index);
+  if (m_gpu_culler.IsInitialized()) {
+    m_gpu_culler.ReadbackStatistics(frame_index);
+  }
+  m_image_metrics.ReadbackResults(frame_index);
+  RecordSweepSample(frame_index);
+
+  BuildDrawList();
 
   RenderInternalAndTarget(p_data->GetCommandBuffer(), frame_index);
 
   SubmitRender(p_data);
+
+  // After the frame's submit, so the copies see everything it renders
+  CaptureFrame();
 }
 
 void VkexInfoApp::Present(vkex::Application::PresentData* p_data) {
@@ -644,7 +966,7 @@ void VkexInfoApp::Present(vkex::Application::PresentData* p_data) {
         m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy]
             .compute_pipeline);
 
-    std::vector<uint32_t> dynamic_offsets = {scaled_constants_dynamic_offset};
+    const uint32_t dynamic_offsets[] = {scaled_constants_dynamic_offset};
     cmd->CmdBindDescriptorSets(
         VK_PIPELINE_BIND_POINT_COMPUTE,
         *(m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy]
@@ -652,7 +974,7 @@ void VkexInfoApp::Present(vkex::Application::PresentData* p_data) {
         0,
         {*(m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy]
                .descriptor_sets[frame_index])},
-        &dynamic_offsets);
+        dynamic_offsets);
 
     vkex::uint3 dispatchDims = CalculateSimpleDispatchDimensions(
         m_generated_shader_states[AppShaderList::TargetToPresentScaledCopy],
@@ -675,9 +997,9 @@ void VkexInfoApp::Present(vkex::Application::PresentData* p_data) {
     VkClearValue dsv_clear = {};
     dsv_clear.depthStencil.depth = 1.0f;
     dsv_clear.depthStencil.stencil = 0xFF;
-    std::vector<VkClearValue> clear_values = {rtv_clear, dsv_clear};
+    const VkClearValue clear_values[] = {rtv_clear, dsv_clear};
 
-    cmd->CmdBeginRenderPass(swapchain_render_pass, &clear_values);
+    cmd->CmdBeginRenderPass(swapchain_render_pass, clear_values);
     cmd->CmdSetViewport(swapchain_render_pass->GetFullRenderArea());
     cmd->CmdSetScissor(swapchain_render_pass->GetFullRenderArea());
 
@@ -698,6 +1020,11 @@ void VkexInfoApp::Present(vkex::Application::PresentData* p_data) {
   SubmitPresent(p_data);
 }
 
+void VkexInfoApp::Destroy() {
+  // The device is idle, the captured frames only need writing out
+  m_frame_capture.Destroy();
+}
+
 int main(int argc, char** argv) {
   VkexInfoApp app;
   vkex::Result vkex_result = app.Run(argc, argv);
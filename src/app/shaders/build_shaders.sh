@@ -27,7 +27,7 @@ CAS_INC_DIR=$(realpath --relative-to=${SCRIPT_DIR} ${SRC_DIR}/../../../third_par
 
 echo ${VKEX_INC_DIR}
 
-HLSL_FILES=(draw_cb.hlsl draw_standard.hlsl)
+HLSL_FILES=(draw_cb.hlsl draw_cb_instanced.hlsl draw_cb_instanced_quantized.hlsl draw_cb_quantized.hlsl draw_instanced.hlsl draw_instanced_quantized.hlsl draw_standard.hlsl draw_standard_quantized.hlsl)
 for src_file in "${HLSL_FILES[@]}"
 do
   echo -e "\nCompiling ${src_file}"
@@ -43,14 +43,15 @@ do
   eval ${cmd} 
 done
 
-HLSL_COMPUTE_FILES=(cas.hlsl checkerboard_upscale.hlsl copy_texture.hlsl image_delta.hlsl)
+# vkex requires Vulkan 1.1, which the subgroup (wave) variants need
+HLSL_COMPUTE_FILES=(cas.hlsl checkerboard_upscale.hlsl copy_texture.hlsl gpu_cull.hlsl hiz_build.hlsl hiz_build_ms.hlsl hiz_downsample.hlsl image_delta.hlsl image_metrics.hlsl image_metrics_reduce.hlsl image_metrics_reduce_wave.hlsl image_metrics_wave.hlsl)
 for src_file in "${HLSL_COMPUTE_FILES[@]}"
 do
   echo -e "\nCompiling ${src_file}"
   base_name=$(basename -s .hlsl ${src_file})
   hlsl_file=${SRC_DIR}/${src_file}
   cs_spv=${SPV_DIR}/${base_name}.cs.spv
-  cmd="dxc -spirv -T cs_6_0 -E csmain -fvk-use-dx-layout -Fo ${cs_spv} -I ${SELF_INC_DIR} -I ${VKEX_INC_DIR} -I ${CAS_INC_DIR} ${hlsl_file}"
+  cmd="dxc -spirv -T cs_6_0 -E csmain -fvk-use-dx-layout -fspv-target-env=vulkan1.1 -Fo ${cs_spv} -I ${SELF_INC_DIR} -I ${VKEX_INC_DIR} -I ${CAS_INC_DIR} ${hlsl_file}"
   echo ${cmd}
   eval ${cmd}
 done
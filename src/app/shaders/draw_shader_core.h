@@ -43,9 +43,19 @@
 
 struct VSInput
 {
+#if defined(ENABLE_QUANTIZED_VERTICES)
+    // R16G16B16A16_UNORM within the primitive's bounds, R16G16_SNORM
+    // octahedral and R16G16_SFLOAT
+    float4 PositionQ : POSITION;
+    float2 NormalOct : NORMAL;
+#else
     float3 PositionOS : POSITION;
     float3 Normal : NORMAL;
+#endif
     float2 UV0 : TEXCOORD0;
+#if defined(ENABLE_INSTANCING)
+    uint InstanceID : SV_InstanceID;
+#endif
 };
 
 struct VSOutput
@@ -98,17 +108,49 @@ struct PSOutput
 ConstantBuffer<PerFrameConstantData> PerFrame : register(b0);
 ConstantBuffer<PerObjectConstantData> PerObject : register(b1);
 
+#if defined(ENABLE_INSTANCING)
+// Stress scene instance transforms, these don't animate
+StructuredBuffer<InstanceData> Instances : register(t8);
+#endif
+
+#if defined(ENABLE_QUANTIZED_VERTICES)
+float3 DecodeOctahedralNormal(float2 e)
+{
+    float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    // The lower hemisphere is folded over the diagonals
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0f) ? -t : t;
+    return normalize(n);
+}
+#endif
+
 VSOutput vsmain(VSInput input)
 {
+#if defined(ENABLE_QUANTIZED_VERTICES)
+    const float3 positionOS = mul(PerObject.positionDequantMatrix, float4(input.PositionQ.xyz, 1)).xyz;
+    const float3 normalOS = DecodeOctahedralNormal(input.NormalOct);
+#else
+    const float3 positionOS = input.PositionOS;
+    const float3 normalOS = input.Normal;
+#endif
+
+    float4x4 worldMatrix = PerObject.worldMatrix;
+    float4x4 prevWorldMatrix = PerObject.prevWorldMatrix;
+#if defined(ENABLE_INSTANCING)
+    const float4x4 instanceMatrix = Instances[input.InstanceID].worldMatrix;
+    worldMatrix = mul(instanceMatrix, worldMatrix);
+    prevWorldMatrix = mul(instanceMatrix, prevWorldMatrix);
+#endif
+
     VSOutput output = (VSOutput)0;
-    output.PositionWS = mul(PerObject.worldMatrix, float4(input.PositionOS, 1)).xyz;
+    output.PositionWS = mul(worldMatrix, float4(positionOS, 1)).xyz;
     output.PositionCS = mul(PerFrame.viewProjectionMatrix, float4(output.PositionWS, 1));
     output.CurrentClipPos = output.PositionCS;
 
-    float3 previousWorldSpace = mul(PerObject.prevWorldMatrix, float4(input.PositionOS, 1)).xyz;
+    float3 previousWorldSpace = mul(prevWorldMatrix, float4(positionOS, 1)).xyz;
     output.PreviousClipPos = mul(PerFrame.prevViewProjectionMatrix, float4(previousWorldSpace, 1));
 
-    output.Normal = normalize(mul(PerObject.worldMatrix, float4(input.Normal, 0.f)).xyz);
+    output.Normal = normalize(mul(worldMatrix, float4(normalOS, 0.f)).xyz);
     output.UV0 = input.UV0;
 
     return output;
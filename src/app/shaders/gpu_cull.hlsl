@@ -0,0 +1,280 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "ConstantBufferStructs.h"
+#include "SharedShaderConstants.h"
+
+// Culls every stress scene instance of every draw list item against the view
+// frustum, then against a Hi-Z pyramid of the previous frame's depth, and
+// appends one indirect draw per surviving instance to the item's run of
+// commands, at the level of detail its distance calls for. The per item count
+// is consumed by vkCmdDrawIndexedIndirectCount.
+//
+// One thread per instance, one row of groups per draw list item.
+
+ConstantBuffer<GpuCullData> Cull : register(b0);
+
+StructuredBuffer<InstanceData> Instances : register(t1);
+StructuredBuffer<CullDrawData> Draws : register(t2);
+Texture2D<float> hizPyramid : register(t3);
+
+// Matches VkDrawIndexedIndirectCommand
+struct DrawIndexedIndirectCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+RWStructuredBuffer<DrawIndexedIndirectCommand> DrawCommands : register(u4);
+RWStructuredBuffer<uint> Counters : register(u5);
+
+// Results are gathered per group so each group makes a handful of global
+// atomics instead of one per thread
+groupshared uint gsFrustumCulled;
+groupshared uint gsOcclusionCulled;
+groupshared uint gsVisibleCount;
+groupshared uint gsFirstCommand;
+groupshared uint gsLodCounts[LOD_MAX_COUNT];
+
+void TransformBounds(float4x4 m, inout float3 center, inout float3 extent)
+{
+    // Arvo: the extent of the transformed box is the extent projected onto
+    // the absolute value of the rotation and scale
+    center = mul(m, float4(center, 1)).xyz;
+    extent = mul(abs((float3x3)m), extent);
+}
+
+bool IsInsideFrustum(float3 center, float3 extent)
+{
+    // Gribb/Hartmann plane extraction. Depth is [0, 1], so the near plane is
+    // the third row alone.
+    const float4x4 vp = Cull.viewProjectionMatrix;
+    const float4 planes[6] = {
+        vp[3] + vp[0], vp[3] - vp[0],
+        vp[3] + vp[1], vp[3] - vp[1],
+        vp[2], vp[3] - vp[2],
+    };
+
+    [unroll]
+    for (uint plane = 0; plane < 6; plane++)
+    {
+        const float distance = dot(planes[plane].xyz, center) + planes[plane].w;
+        const float radius = dot(abs(planes[plane].xyz), extent);
+        if ((distance + radius) < 0.0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsOccluded(float3 center, float3 extent)
+{
+    float3 ndc_min = float3(1e30, 1e30, 1e30);
+    float3 ndc_max = float3(-1e30, -1e30, -1e30);
+
+    [unroll]
+    for (uint corner = 0; corner < 8; corner++)
+    {
+        const float3 offset = float3((corner & 1) ? 1.0 : -1.0,
+                                     (corner & 2) ? 1.0 : -1.0,
+                                     (corner & 4) ? 1.0 : -1.0);
+        const float4 clip = mul(Cull.hizViewProjectionMatrix,
+                                float4(center + (offset * extent), 1));
+
+        // Boxes reaching behind the camera can't be bounded on screen
+        if (clip.w <= 0.0)
+        {
+            return false;
+        }
+
+        const float3 ndc = clip.xyz / clip.w;
+        ndc_min = min(ndc_min, ndc);
+        ndc_max = max(ndc_max, ndc);
+    }
+
+    if (ndc_min.z <= 0.0)
+    {
+        return false;
+    }
+
+    // The scene passes flip Y in the viewport, so NDC +Y is the top row
+    const float2 uv_min = saturate(float2(ndc_min.x, -ndc_max.y) * 0.5 + 0.5);
+    const float2 uv_max = saturate(float2(ndc_max.x, -ndc_min.y) * 0.5 + 0.5);
+
+    // Level 0 texels cover 2x2 depth pixels
+    const uint2 depth_extent = uint2(Cull.depthWidth, Cull.depthHeight);
+    const float2 texel_min = uv_min * float2(depth_extent) * 0.5;
+    const float2 texel_max = uv_max * float2(depth_extent) * 0.5;
+
+    // The level where the box spans at most two texels on each axis
+    const float2 texel_size = texel_max - texel_min;
+    const float max_size = max(max(texel_size.x, texel_size.y), 1.0);
+    const uint mip = min(uint(ceil(log2(max_size))), Cull.hizMipCount - 1);
+
+    const uint2 level0_extent = (depth_extent + 1) / 2;
+    const uint2 mip_max = ((level0_extent + (1u << mip) - 1) >> mip) - 1;
+    const uint2 c0 = min(uint2(texel_min) >> mip, mip_max);
+    const uint2 c1 = min(uint2(texel_max) >> mip, mip_max);
+
+    float hiz_depth = hizPyramid.Load(int3(c0.x, c0.y, mip));
+    hiz_depth = max(hiz_depth, hizPyramid.Load(int3(c1.x, c0.y, mip)));
+    hiz_depth = max(hiz_depth, hizPyramid.Load(int3(c0.x, c1.y, mip)));
+    hiz_depth = max(hiz_depth, hizPyramid.Load(int3(c1.x, c1.y, mip)));
+
+    // Hidden when the nearest point of the box is behind the farthest depth
+    // under it
+    return ndc_min.z > hiz_depth;
+}
+
+// Same test as LodSelector::Select: the coarsest level whose error, seen
+// from the nearest point of the bounding sphere, stays under the threshold
+uint SelectLod(CullDrawData draw, float4x4 instance_matrix, float3 center,
+               float3 extent)
+{
+    if ((Cull.lodPixelScale <= 0.0) || (draw.lodCount <= 1))
+    {
+        return 0;
+    }
+
+    const float distance = length(center - Cull.eyePosition) - length(extent);
+    if (distance <= 0.0)
+    {
+        return 0;
+    }
+
+    const float scale = max(max(length(instance_matrix._11_21_31),
+                                length(instance_matrix._12_22_32)),
+                            length(instance_matrix._13_23_33));
+    uint lod = draw.lodCount - 1;
+    for (; lod > 0; lod--)
+    {
+        if ((draw.lodError[lod] * scale * Cull.lodPixelScale) <= distance)
+        {
+            break;
+        }
+    }
+    return lod;
+}
+
+// clang-format off
+[numthreads(GPU_CULL_GROUP_SIZE, 1, 1)]
+void csmain(uint3 dispatch_id : SV_DispatchThreadID,
+            uint group_index : SV_GroupIndex) // clang-format on
+{
+    if (group_index == 0)
+    {
+        gsFrustumCulled = 0;
+        gsOcclusionCulled = 0;
+        gsVisibleCount = 0;
+    }
+    if (group_index < LOD_MAX_COUNT)
+    {
+        gsLodCounts[group_index] = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    const uint instance = dispatch_id.x;
+    const uint draw_index = dispatch_id.y;
+    const CullDrawData draw = Draws[draw_index];
+
+    bool visible = false;
+    uint local_slot = 0;
+    uint lod = 0;
+    if (instance < Cull.instanceCount)
+    {
+        visible = true;
+
+        // Primitives without bounds are always drawn
+        if ((draw.flags & GPU_CULL_FLAG_UNBOUNDED) == 0)
+        {
+            const float4x4 instance_matrix = Instances[instance].worldMatrix;
+
+            float3 center = draw.boundsCenter;
+            float3 extent = draw.boundsExtent;
+            TransformBounds(instance_matrix, center, extent);
+
+            if (!IsInsideFrustum(center, extent))
+            {
+                visible = false;
+                InterlockedAdd(gsFrustumCulled, 1);
+            }
+            else if (Cull.occlusionEnabled != 0)
+            {
+                // The depth was rendered last frame, so test where the box
+                // was then
+                float3 prev_center = draw.prevBoundsCenter;
+                float3 prev_extent = draw.prevBoundsExtent;
+                TransformBounds(instance_matrix, prev_center, prev_extent);
+
+                if (IsOccluded(prev_center, prev_extent))
+                {
+                    visible = false;
+                    InterlockedAdd(gsOcclusionCulled, 1);
+                }
+            }
+
+            if (visible)
+            {
+                lod = SelectLod(draw, instance_matrix, center, extent);
+            }
+        }
+
+        if (visible)
+        {
+            InterlockedAdd(gsVisibleCount, 1, local_slot);
+            InterlockedAdd(gsLodCounts[lod], 1);
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // One atomic per group reserves a run of the item's commands
+    if (group_index == 0)
+    {
+        InterlockedAdd(Counters[GPU_CULL_COUNTER_COUNT + draw_index],
+                       gsVisibleCount, gsFirstCommand);
+        InterlockedAdd(Counters[GPU_CULL_COUNTER_FRUSTUM_CULLED],
+                       gsFrustumCulled);
+        InterlockedAdd(Counters[GPU_CULL_COUNTER_OCCLUSION_CULLED],
+                       gsOcclusionCulled);
+        InterlockedAdd(Counters[GPU_CULL_COUNTER_DRAWN], gsVisibleCount);
+    }
+    if (group_index < LOD_MAX_COUNT)
+    {
+        InterlockedAdd(Counters[GPU_CULL_COUNTER_LOD_DRAWN + group_index],
+                       gsLodCounts[group_index]);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (visible)
+    {
+        // The instanced scene shaders read the instance transform with
+        // SV_InstanceID, which includes firstInstance
+        DrawIndexedIndirectCommand command;
+        command.indexCount = draw.lodIndexCount[lod];
+        command.instanceCount = 1;
+        command.firstIndex = draw.lodFirstIndex[lod];
+        command.vertexOffset = draw.vertexOffset;
+        command.firstInstance = instance;
+
+        const uint command_index = (draw_index * Cull.maxInstanceCount) +
+                                   gsFirstCommand + local_slot;
+        DrawCommands[command_index] = command;
+    }
+}
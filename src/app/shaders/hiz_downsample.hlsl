@@ -0,0 +1,47 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "ConstantBufferStructs.h"
+
+// Builds one Hi-Z level from the one above it, keeping the farthest depth of
+// each 2x2 footprint. Level extents are rounded up, so an odd source extent
+// clamps its last column or row instead of dropping it.
+
+ConstantBuffer<ScaledTexCopyDimensionsData> HiZDims : register(b0);
+
+RWTexture2D<float> hizSource : register(u1);
+RWTexture2D<float> hizDestination : register(u2);
+
+// clang-format off
+[numthreads(16, 16, 1)]
+void csmain(uint3 dispatch_id : SV_DispatchThreadID) // clang-format on
+{
+    if ((dispatch_id.x >= HiZDims.dstWidth) ||
+        (dispatch_id.y >= HiZDims.dstHeight))
+    {
+        return;
+    }
+
+    const uint2 src_max = uint2(HiZDims.srcWidth - 1, HiZDims.srcHeight - 1);
+    const uint2 src_coords = dispatch_id.xy * 2;
+
+    float depth = hizSource[min(src_coords, src_max)];
+    depth = max(depth, hizSource[min(src_coords + uint2(1, 0), src_max)]);
+    depth = max(depth, hizSource[min(src_coords + uint2(0, 1), src_max)]);
+    depth = max(depth, hizSource[min(src_coords + uint2(1, 1), src_max)]);
+
+    hizDestination[dispatch_id.xy] = depth;
+}
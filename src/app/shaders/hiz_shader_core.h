@@ -0,0 +1,71 @@
+/*
+ Copyright 2020 Google Inc.
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "ConstantBufferStructs.h"
+
+// Builds the first level of the Hi-Z pyramid from a scene depth buffer. Each
+// texel keeps the farthest depth of the 2x2 pixels (and every sample of
+// them) it covers, so a box whose nearest depth lies behind it is hidden.
+// Depth is cleared to 1 and tested with LESS, so farthest is the max.
+
+ConstantBuffer<ScaledTexCopyDimensionsData> HiZDims : register(b0);
+
+#if defined(HIZ_SOURCE_MULTISAMPLED)
+// The checkerboard pass renders 2x MSAA depth
+Texture2DMS<float> sourceDepth : register(t1);
+static const uint kSourceSampleCount = 2;
+#else
+Texture2D<float> sourceDepth : register(t1);
+#endif
+
+RWTexture2D<float> hizLevel0 : register(u2);
+
+float LoadFarthestDepth(int2 location)
+{
+    // Odd source extents clamp the last column and row onto themselves
+    location = min(location, int2(HiZDims.srcWidth - 1, HiZDims.srcHeight - 1));
+
+#if defined(HIZ_SOURCE_MULTISAMPLED)
+    float depth = 0.0;
+    for (uint sampleIndex = 0; sampleIndex < kSourceSampleCount; sampleIndex++)
+    {
+        depth = max(depth, sourceDepth.Load(location, sampleIndex));
+    }
+    return depth;
+#else
+    return sourceDepth.Load(int3(location, 0));
+#endif
+}
+
+// clang-format off
+[numthreads(16, 16, 1)]
+void csmain(uint3 dispatch_id : SV_DispatchThreadID) // clang-format on
+{
+    if ((dispatch_id.x >= HiZDims.dstWidth) ||
+        (dispatch_id.y >= HiZDims.dstHeight))
+    {
+        return;
+    }
+
+    const int2 src_coords = int2(dispatch_id.xy) * 2;
+
+    float depth = LoadFarthestDepth(src_coords);
+    depth = max(depth, LoadFarthestDepth(src_coords + int2(1, 0)));
+    depth = max(depth, LoadFarthestDepth(src_coords + int2(0, 1)));
+    depth = max(depth, LoadFarthestDepth(src_coords + int2(1, 1)));
+
+    hizLevel0[dispatch_id.xy] = depth;
+}
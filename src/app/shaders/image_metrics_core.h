@@ -0,0 +1,284 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "ConstantBufferStructs.h"
+#include "SharedShaderConstants.h"
+
+// Reduces the difference between the upscaled target and the native
+// reference into the sums PSNR, SSIM and a FLIP-style perceptual error are
+// computed from. ImageMetrics.cpp has the CPU version of the same math, keep
+// them in step.
+//
+// The first pass runs one group per IMAGE_METRICS_TILE_SIZE squared window,
+// which is also the SSIM window, and writes the window's squared error, SSIM
+// weighted by its pixel count, perceptual error and pixel count. The second
+// pass folds all windows into one float4 in a single group.
+//
+// IMAGE_METRICS_WAVE_OPS reduces within each subgroup first, and needs
+// subgroup arithmetic in compute shaders.
+
+ConstantBuffer<ImageMetricsData> Metrics : register(b0);
+
+#if defined(IMAGE_METRICS_REDUCE)
+static const uint kGroupThreadCount = IMAGE_METRICS_REDUCE_GROUP_SIZE;
+#else
+static const uint kGroupThreadCount =
+    IMAGE_METRICS_TILE_SIZE * IMAGE_METRICS_TILE_SIZE;
+#endif
+
+groupshared float4 gsSumsA[kGroupThreadCount];
+groupshared float4 gsSumsB[kGroupThreadCount];
+
+#if defined(IMAGE_METRICS_WAVE_OPS)
+groupshared uint gsWaveCount;
+
+// Sums two float4s over the group, the result is valid in every thread
+void GroupSum(inout float4 a, inout float4 b, uint group_index)
+{
+    if (group_index == 0)
+    {
+        gsWaveCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    const float4 wave_a = WaveActiveSum(a);
+    const float4 wave_b = WaveActiveSum(b);
+    // Lanes aren't guaranteed to map to waves in group index order, so each
+    // wave takes the next free slot
+    if (WaveIsFirstLane())
+    {
+        uint slot;
+        InterlockedAdd(gsWaveCount, 1, slot);
+        gsSumsA[slot] = wave_a;
+        gsSumsB[slot] = wave_b;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    a = 0;
+    b = 0;
+    const uint wave_count = gsWaveCount;
+    for (uint slot = 0; slot < wave_count; slot++)
+    {
+        a += gsSumsA[slot];
+        b += gsSumsB[slot];
+    }
+}
+#else
+void GroupSum(inout float4 a, inout float4 b, uint group_index)
+{
+    gsSumsA[group_index] = a;
+    gsSumsB[group_index] = b;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint stride = kGroupThreadCount / 2; stride > 0; stride >>= 1)
+    {
+        if (group_index < stride)
+        {
+            gsSumsA[group_index] += gsSumsA[group_index + stride];
+            gsSumsB[group_index] += gsSumsB[group_index + stride];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    a = gsSumsA[0];
+    b = gsSumsB[0];
+}
+#endif
+
+#if defined(IMAGE_METRICS_REDUCE)
+
+StructuredBuffer<float4> partialSums : register(t1);
+RWStructuredBuffer<float4> results : register(u2);
+
+// clang-format off
+[numthreads(IMAGE_METRICS_REDUCE_GROUP_SIZE, 1, 1)]
+void csmain(uint group_index : SV_GroupIndex) // clang-format on
+{
+    float4 sums = 0;
+    for (uint tile = group_index; tile < Metrics.tileCount;
+         tile += kGroupThreadCount)
+    {
+        sums += partialSums[tile];
+    }
+
+    float4 unused = 0;
+    GroupSum(sums, unused, group_index);
+
+    if (group_index == 0)
+    {
+        results[0] = sums;
+    }
+}
+
+#else
+
+Texture2D<float4> testTexture : register(t1);
+Texture2D<float4> referenceTexture : register(t2);
+RWStructuredBuffer<float4> partialSums : register(u3);
+
+// Same weights as image_delta.hlsl, on the stored values
+static const float3 kLumaWeights = float3(0.2126, 0.7152, 0.0722);
+
+// SSIM stabilizers for a dynamic range of 1
+static const float kSsimC1 = 0.01 * 0.01;
+static const float kSsimC2 = 0.03 * 0.03;
+
+// CIE L*a*b* from sRGB with a D65 white
+static const float3 kWhiteXYZ = float3(0.95047, 1.0, 1.08883);
+static const float kLabEpsilon = 216.0 / 24389.0;
+static const float kLabKappa = 24389.0 / 27.0;
+// HyAB distance between sRGB green and blue, the largest in the gamut
+static const float kMaxHyAB = 308.11;
+
+// The window plus the one pixel border the gradients need
+static const uint kApronSize = IMAGE_METRICS_TILE_SIZE + 2;
+
+// Luma of the test image in x, of the reference in y
+groupshared float2 gsLuma[kApronSize * kApronSize];
+
+float SrgbToLinear(float c)
+{
+    return (c <= 0.04045) ? (c / 12.92) : pow((c + 0.055) / 1.055, 2.4);
+}
+
+float LabF(float t)
+{
+    return (t > kLabEpsilon) ? pow(t, 1.0 / 3.0)
+                             : (((t * kLabKappa) + 16.0) / 116.0);
+}
+
+float3 SrgbToLab(float3 srgb)
+{
+    const float3 rgb = float3(SrgbToLinear(srgb.r), SrgbToLinear(srgb.g),
+                              SrgbToLinear(srgb.b));
+    const float3 xyz =
+        float3(dot(rgb, float3(0.4124564, 0.3575761, 0.1804375)),
+               dot(rgb, float3(0.2126729, 0.7151522, 0.0721750)),
+               dot(rgb, float3(0.0193339, 0.1191920, 0.9503041))) /
+        kWhiteXYZ;
+    const float3 f = float3(LabF(xyz.x), LabF(xyz.y), LabF(xyz.z));
+    return float3((116.0 * f.y) - 16.0, 500.0 * (f.x - f.y),
+                  200.0 * (f.y - f.z));
+}
+
+// Sobel gradient magnitude of both images' luma around a window pixel,
+// scaled so a step from 0 to 1 gives 1
+float2 GradientMagnitudes(uint center)
+{
+    const float2 tl = gsLuma[center - kApronSize - 1];
+    const float2 t = gsLuma[center - kApronSize];
+    const float2 tr = gsLuma[center - kApronSize + 1];
+    const float2 l = gsLuma[center - 1];
+    const float2 r = gsLuma[center + 1];
+    const float2 bl = gsLuma[center + kApronSize - 1];
+    const float2 b = gsLuma[center + kApronSize];
+    const float2 br = gsLuma[center + kApronSize + 1];
+
+    const float2 gx = (tr + (2.0 * r) + br) - (tl + (2.0 * l) + bl);
+    const float2 gy = (bl + (2.0 * b) + br) - (tl + (2.0 * t) + tr);
+    return sqrt((gx * gx) + (gy * gy)) * 0.25;
+}
+
+// A simplified FLIP: the HyAB color difference in L*a*b*, compressed, and
+// raised to one minus the difference in edge strength, so errors on edges
+// the reference doesn't have (or lost ones) count for more. The reference
+// FLIP filters both images with contrast sensitivity functions first, this
+// doesn't.
+float PerceptualError(float3 test, float3 reference, float2 gradients)
+{
+    const float3 lab_test = SrgbToLab(test);
+    const float3 lab_reference = SrgbToLab(reference);
+    const float3 delta = lab_test - lab_reference;
+    const float hyab = abs(delta.x) + sqrt((delta.y * delta.y) +
+                                           (delta.z * delta.z));
+    const float feature_error =
+        sqrt(min(abs(gradients.x - gradients.y) * 0.70710678, 1.0));
+
+    // The color error is compressed with a power of 0.7 first, folded into
+    // the one pow
+    const float exponent = 1.0 - feature_error;
+    return (exponent > 0.0) ? pow(min(hyab / kMaxHyAB, 1.0), 0.7 * exponent)
+                            : 1.0;
+}
+
+// clang-format off
+[numthreads(IMAGE_METRICS_TILE_SIZE, IMAGE_METRICS_TILE_SIZE, 1)]
+void csmain(uint3 group_id : SV_GroupID,
+            uint3 group_thread_id : SV_GroupThreadID,
+            uint group_index : SV_GroupIndex) // clang-format on
+{
+    const int2 tile_origin = int2(group_id.xy) * IMAGE_METRICS_TILE_SIZE;
+    const int2 max_coords = int2(Metrics.width - 1, Metrics.height - 1);
+
+    // Luma of the window and its border, clamped at the image edges
+    for (uint apron_index = group_index;
+         apron_index < (kApronSize * kApronSize);
+         apron_index += kGroupThreadCount)
+    {
+        const int2 apron_coords =
+            int2(apron_index % kApronSize, apron_index / kApronSize);
+        const int3 load_coords =
+            int3(clamp(tile_origin + apron_coords - 1, 0, max_coords), 0);
+        gsLuma[apron_index] =
+            float2(dot(testTexture.Load(load_coords).rgb, kLumaWeights),
+                   dot(referenceTexture.Load(load_coords).rgb, kLumaWeights));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // x, y, x^2, y^2 of the luma for SSIM
+    float4 moments = 0;
+    // xy, squared RGB error, perceptual error, pixel count
+    float4 errors = 0;
+
+    const int2 coords = tile_origin + int2(group_thread_id.xy);
+    if (all(coords <= max_coords))
+    {
+        const float3 test = testTexture.Load(int3(coords, 0)).rgb;
+        const float3 reference = referenceTexture.Load(int3(coords, 0)).rgb;
+        const uint center =
+            ((group_thread_id.y + 1) * kApronSize) + group_thread_id.x + 1;
+        const float2 luma = gsLuma[center];
+        const float3 delta = test - reference;
+
+        moments = float4(luma.x, luma.y, luma.x * luma.x, luma.y * luma.y);
+        errors = float4(
+            luma.x * luma.y, dot(delta, delta),
+            PerceptualError(test, reference, GradientMagnitudes(center)), 1.0);
+    }
+
+    GroupSum(moments, errors, group_index);
+
+    if (group_index == 0)
+    {
+        // Every window covers at least one pixel
+        const float pixel_count = errors.w;
+        const float4 means = moments / pixel_count;
+        const float covariance =
+            (errors.x / pixel_count) - (means.x * means.y);
+        const float variance_x = means.z - (means.x * means.x);
+        const float variance_y = means.w - (means.y * means.y);
+        const float ssim =
+            (((2.0 * means.x * means.y) + kSsimC1) *
+             ((2.0 * covariance) + kSsimC2)) /
+            (((means.x * means.x) + (means.y * means.y) + kSsimC1) *
+             (variance_x + variance_y + kSsimC2));
+
+        partialSums[(group_id.y * Metrics.tileCountX) + group_id.x] =
+            float4(errors.y, ssim * pixel_count, errors.z, pixel_count);
+    }
+}
+
+#endif  // defined(IMAGE_METRICS_REDUCE)
@@ -0,0 +1,126 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if !defined(VKEX_DISABLE_HEAP_ALLOCATION_COUNTER)
+
+static std::atomic<uint64_t> s_heap_allocation_count{0};
+
+static void* CountedAllocate(std::size_t size)
+{
+  s_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) {
+    size = 1;
+  }
+  void* p_memory = std::malloc(size);
+  while (p_memory == nullptr) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      return nullptr;
+    }
+    handler();
+    p_memory = std::malloc(size);
+  }
+  return p_memory;
+}
+
+void* operator new(std::size_t size)
+{
+  void* p_memory = CountedAllocate(size);
+  if (p_memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p_memory;
+}
+
+void* operator new[](std::size_t size)
+{
+  void* p_memory = CountedAllocate(size);
+  if (p_memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p_memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return CountedAllocate(size);
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return CountedAllocate(size);
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* p_memory) noexcept
+{
+  std::free(p_memory);
+}
+
+void operator delete[](void* p_memory) noexcept
+{
+  std::free(p_memory);
+}
+
+void operator delete(void* p_memory, std::size_t) noexcept
+{
+  std::free(p_memory);
+}
+
+void operator delete[](void* p_memory, std::size_t) noexcept
+{
+  std::free(p_memory);
+}
+
+void operator delete(void* p_memory, const std::nothrow_t&) noexcept
+{
+  std::free(p_memory);
+}
+
+void operator delete[](void* p_memory, const std::nothrow_t&) noexcept
+{
+  std::free(p_memory);
+}
+
+#endif // !defined(VKEX_DISABLE_HEAP_ALLOCATION_COUNTER)
+
+namespace vkex {
+
+uint64_t GetHeapAllocationCount()
+{
+#if !defined(VKEX_DISABLE_HEAP_ALLOCATION_COUNTER)
+  return s_heap_allocation_count.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+} // namespace vkex
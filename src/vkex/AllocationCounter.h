@@ -0,0 +1,41 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_ALLOCATION_COUNTER_H__
+#define __VKEX_ALLOCATION_COUNTER_H__
+
+#include <cstdint>
+
+//
+// VKEX replaces the global operator new/delete to count C++ heap
+// allocations for the whole process. Define
+// VKEX_DISABLE_HEAP_ALLOCATION_COUNTER to keep the standard library's
+// operators, in which case the count is always 0.
+//
+// Allocations made with malloc directly (GLFW, ImGui, drivers) are not seen.
+//
+
+namespace vkex {
+
+/** @fn GetHeapAllocationCount
+ *
+ * Number of operator new calls since process start.
+ */
+uint64_t GetHeapAllocationCount();
+
+} // namespace vkex
+
+#endif // __VKEX_ALLOCATION_COUNTER_H__
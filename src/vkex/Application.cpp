@@ -44,6 +44,7 @@ enum {
   kDefaultPhysicalDeviceIndex = 0,
   kDefaultQueueIndex          = 0,
   kDefaultInFlightFrameCount  = 2,
+  kDefaultFrameAllocatorSize  = 1024 * 1024,
 };
 
 static std::map<int32_t, int32_t> sKeyboardMapGlfwToVkex = {
@@ -527,6 +528,11 @@ Application::Application(const std::string& name)
 
   m_configuration.enable_imgui = true;
   m_configuration.enable_screen_shot = false;
+  m_configuration.enable_host_allocator = false;
+  m_configuration.frame_stats_log_interval = 0;
+  m_configuration.flight_recorder.hitch_threshold_ms = 0;
+  m_configuration.flight_recorder.dump_seconds = 3;
+  m_configuration.flight_recorder.max_dumps = 8;
 
   InitializeAssetDirs();
 }
@@ -549,6 +555,11 @@ Application::Application(uint32_t width, uint32_t height, const std::string& nam
 
   m_configuration.enable_imgui = true;
   m_configuration.enable_screen_shot = false;
+  m_configuration.enable_host_allocator = false;
+  m_configuration.frame_stats_log_interval = 0;
+  m_configuration.flight_recorder.hitch_threshold_ms = 0;
+  m_configuration.flight_recorder.dump_seconds = 3;
+  m_configuration.flight_recorder.max_dumps = 8;
 
   InitializeAssetDirs();
 }
@@ -710,6 +721,8 @@ vkex::Result Application::InitializeVkexDevice()
     for (auto& ext : GetConfiguration().optional_device_extensions) {
       device_create_info.optional_extensions.push_back(ext);
     }
+    // Lines GPU timestamps up with the CPU clock for the frame bound stats
+    device_create_info.optional_extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
     vkex::Result vkex_result = vkex::Result::Undefined;
     VKEX_RESULT_CALL(
       vkex_result,
@@ -1212,20 +1225,34 @@ vkex::Result Application::InitializeVkexSwapchain()
     }
   }
 
-  // Screenshot buffer
+  // Screenshot readback, PNG encoded on the readback's workers
   if (m_configuration.enable_screen_shot) {
-    uint64_t size = vkex::RoundUp<uint64_t>(m_configuration.window.width, 4) *
-                    vkex::RoundUp<uint64_t>(m_configuration.window.height, 4) *
-                    vkex::FormatSize(m_configuration.swapchain.color_format);
-    vkex::BufferCreateInfo buffer_create_info = {};
-    buffer_create_info.size                           = size;
-    buffer_create_info.usage_flags.bits.transfer_dst  = true;
-    buffer_create_info.committed                      = true;
-    buffer_create_info.host_visible                   = true;
+    vkex::ImageReadbackCreateInfo readback_create_info = {};
+    readback_create_info.slot_count   = kScreenShotSlotCount;
+    readback_create_info.max_width    = m_configuration.window.width;
+    readback_create_info.max_height   = m_configuration.window.height;
+    readback_create_info.thread_count = 0;
+    readback_create_info.callback     = [this](const vkex::ImageReadbackData& data) {
+      std::stringstream file_name;
+      file_name << "screenshot_" << std::setfill('0') << std::setw(6) << data.tag << ".png";
+      fs::path file_path = GetApplicationPath().parent() / file_name.str();
+      // Lossless, so screenshots can be compared; the strips are encoded in
+      // parallel to keep up with the readback
+      vkex::Result vkex_result = Bitmap::WritePNG(
+        file_path,
+        data.width,
+        data.height,
+        4,
+        data.row_stride,
+        data.p_pixels);
+      if (!vkex_result) {
+        VKEX_LOG_WARN("Couldn't write " << file_path);
+      }
+    };
     vkex::Result vkex_result = vkex::Result::Undefined;
     VKEX_RESULT_CALL(
       vkex_result,
-      m_device->CreateBuffer(buffer_create_info, &m_screenshot_buffer)
+      m_screenshot_readback.Initialize(m_device, readback_create_info)
     );
     if (!vkex_result) {
       return vkex_result;
@@ -1366,6 +1393,11 @@ vkex::Result Application::InitializeVkexPerFramePresentData()
 
 vkex::Result Application::InitializeVkex()
 {
+  // Host allocator
+  if (m_configuration.enable_host_allocator) {
+    m_host_allocator = std::make_unique<vkex::HostAllocator>();
+  }
+
   // Instance
   {
     vkex::InstanceCreateInfo instance_create_info = {};
@@ -1378,7 +1410,10 @@ vkex::Result Application::InitializeVkex()
     vkex::Result vkex_result = vkex::Result::Undefined;
     VKEX_RESULT_CALL(
       vkex_result,
-      vkex::CreateInstanceVKEX(instance_create_info, &m_instance)
+      vkex::CreateInstanceVKEX(
+        instance_create_info,
+        &m_instance,
+        m_host_allocator ? m_host_allocator->GetCallbacks() : nullptr)
     );
     if (!vkex_result) {
       return vkex_result;
@@ -1431,6 +1466,22 @@ vkex::Result Application::InitializeVkex()
     }
   }
 
+  // Frame bound classifier
+  if (IsApplicationModeWindow()) {
+    vkex::FrameBoundClassifierCreateInfo create_info = {};
+    create_info.queue               = m_graphics_queue;
+    create_info.window_frame_count  = kFrameBoundWindowFrames;
+    create_info.gpu_bound_ratio     = 0.9;
+    vkex::Result vkex_result = vkex::Result::Undefined;
+    VKEX_RESULT_CALL(
+      vkex_result,
+      m_frame_bound.Initialize(m_device, create_info)
+    );
+    if (!vkex_result) {
+      return vkex_result;
+    }
+  }
+
   return vkex::Result::Success;
 }
 
@@ -1548,6 +1599,9 @@ vkex::Result Application::InternalCreate()
     }
   }
 
+  // Per frame scratch memory
+  m_frame_allocator.Initialize(kDefaultFrameAllocatorSize);
+
   // VKEX
   {
     vkex::Result vkex_result = InitializeVkex();
@@ -1646,12 +1700,12 @@ vkex::Result Application::DestroyVkexSwapchain()
     }
   }
 
-  // Screenshot buffer
-  if (m_screenshot_buffer) {
+  // Screenshot readback, writes out whatever is still in flight
+  {
     vkex::Result vkex_result = vkex::Result::Undefined;
     VKEX_RESULT_CALL(
       vkex_result,
-      m_device->DestroyBuffer(m_screenshot_buffer)
+      m_screenshot_readback.Destroy()
     );
     if (!vkex_result) {
       return vkex_result;
@@ -1746,6 +1800,14 @@ vkex::Result Application::InternalDestroy()
     m_per_frame_present_data.clear();
   }
 
+  // Frame bound classifier
+  if (IsApplicationModeWindow()) {
+    vkex::Result vkex_result = m_frame_bound.Destroy();
+    if (!vkex_result) {
+      return vkex_result;
+    }
+  }
+
   // Frame fence
   if (IsApplicationModeWindow()) {
     vkex::Result vkex_result = m_device->DestroyFence(m_frame_fence);
@@ -1981,6 +2043,107 @@ void Application::Quit()
   }
 }
 
+void Application::RequestScreenShot()
+{
+  m_screen_shot = true;
+}
+
+void Application::SetScreenShotEveryFrame(bool every_frame)
+{
+  m_screen_shot_every_frame = every_frame;
+}
+
+const char* Application::GetFrameMetricName(Application::FrameMetricTag tag)
+{
+  switch (tag) {
+    case kFrameMetricFrame        : return "frame";
+    case kFrameMetricUpdate       : return "update";
+    case kFrameMetricRender       : return "render";
+    case kFrameMetricPresent      : return "present";
+    case kFrameMetricQueuePresent : return "vkQueuePresentKHR";
+    default: break;
+  }
+  return "";
+}
+
+void Application::AddLoggedFrameMetric(const std::string& name, vkex::FrameMetric* p_metric)
+{
+  VKEX_ASSERT(p_metric != nullptr);
+  m_logged_frame_metrics.emplace_back(name, p_metric);
+}
+
+void Application::LogFrameStats(double interval)
+{
+  auto log_metric = [](const std::string& name, const vkex::FrameMetric& metric) {
+    vkex::QuantileSummary summary = {};
+    metric.GetInterval().GetSummary(&summary);
+    if (summary.count == 0) {
+      return;
+    }
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "   " << std::left << std::setw(24) << name << std::right;
+    ss << " p50 " << std::setw(8) << summary.p50;
+    ss << " p95 " << std::setw(8) << summary.p95;
+    ss << " p99 " << std::setw(8) << summary.p99;
+    ss << " max " << std::setw(8) << summary.max;
+    ss << " ms (" << summary.count << ")";
+    VKEX_LOG_INFO(ss.str());
+  };
+
+  VKEX_LOG_INFO("Frame times over the last " << std::fixed << std::setprecision(1) << interval << " seconds");
+  for (uint32_t i = 0; i < kFrameMetricCount; ++i) {
+    FrameMetricTag tag = static_cast<FrameMetricTag>(i);
+    log_metric(GetFrameMetricName(tag), m_frame_metrics[i]);
+    m_frame_metrics[i].ResetInterval();
+  }
+  for (auto& logged : m_logged_frame_metrics) {
+    log_metric(logged.first, *logged.second);
+    logged.second->ResetInterval();
+  }
+}
+
+void Application::RecordFlightFrame(uint64_t frame_end)
+{
+  uint64_t frame_begin = m_flight_frame_begin;
+  m_flight_frame_begin = frame_end;
+  if (frame_begin == 0) {
+    return;
+  }
+
+  // Called as the next frame starts
+  const uint64_t frame_number = m_elapsed_frame_count - 1;
+  vkex::FlightRecorder::Get().Record("frame", "frame", frame_begin, frame_end, frame_number);
+
+  // Startup frames are slow by nature, leave them out
+  const float threshold_ms = m_configuration.flight_recorder.hitch_threshold_ms;
+  if ((threshold_ms <= 0) || (frame_number < kWindowFrames)) {
+    return;
+  }
+  if (m_flight_dump_count >= m_configuration.flight_recorder.max_dumps) {
+    return;
+  }
+  double frame_ms = vkex::Timer::TimestampToMillis(frame_end - frame_begin);
+  if (frame_ms <= static_cast<double>(threshold_ms)) {
+    return;
+  }
+
+  // One dump covers a run of hitches
+  const double dump_seconds = static_cast<double>(m_configuration.flight_recorder.dump_seconds);
+  if ((m_flight_last_dump > 0) && (vkex::Timer::TimestampToSeconds(frame_end - m_flight_last_dump) < dump_seconds)) {
+    return;
+  }
+
+  std::stringstream file_name;
+  file_name << "flight_" << std::setfill('0') << std::setw(6) << frame_number << ".json";
+  fs::path file_path = GetApplicationPath().parent() / file_name.str();
+  if (vkex::FlightRecorder::Get().DumpAsync(file_path, frame_end, dump_seconds)) {
+    VKEX_LOG_INFO("Frame " << frame_number << " took " << std::fixed << std::setprecision(2) << frame_ms << " ms, flight recorder dumped to " << file_path);
+    m_flight_last_dump = frame_end;
+    m_flight_dump_count += 1;
+  }
+}
+
 const std::string& Application::GetName() const
 {
   return m_configuration.name;
@@ -2236,24 +2399,39 @@ vkex::Result Application::SubmitRender(Application::RenderData* p_data)
 
   // Submit render work
   {
-    std::vector<VkSemaphore> vk_wait_semaphores;
+    // Fixed size containers keep the per frame submit off the heap
+    VkSemaphore vk_wait_semaphores[1] = {};
+    VkPipelineStageFlags vk_pipeline_stages[1] = { vk_pipeline_stage };
+    uint32_t vk_wait_semaphore_count = 0;
     if (vk_present_complete_semaphore != nullptr) {
-    vk_wait_semaphores.push_back(vk_present_complete_semaphore);
+      vk_wait_semaphores[vk_wait_semaphore_count++] = vk_present_complete_semaphore;
     }
-    std::vector<VkCommandBuffer> vk_command_buffers = { vk_command_buffer };
-    std::vector<VkPipelineStageFlags> vk_pipeline_stages = { vk_pipeline_stage };
-    std::vector<VkSemaphore> vk_signal_semaphores = { vk_work_complete_semaphore };
     VkFence vk_work_complete_fence = *(p_data->m_work_complete_fence);
 
+    // Bracket the app's work with the frame bound timestamps
+    VkCommandBuffer vk_command_buffers[3] = {};
+    uint32_t vk_command_buffer_count = 0;
+    VkCommandBuffer vk_timestamp_begin = VK_NULL_HANDLE;
+    VkCommandBuffer vk_timestamp_end = VK_NULL_HANDLE;
+    m_frame_bound.GetSubmitCommandBuffers(kFrameSubmitRender, &vk_timestamp_begin, &vk_timestamp_end);
+    if (vk_timestamp_begin != VK_NULL_HANDLE) {
+      vk_command_buffers[vk_command_buffer_count++] = vk_timestamp_begin;
+    }
+    vk_command_buffers[vk_command_buffer_count++] = vk_command_buffer;
+    if (vk_timestamp_end != VK_NULL_HANDLE) {
+      vk_command_buffers[vk_command_buffer_count++] = vk_timestamp_end;
+    }
+
     VkSubmitInfo vk_submit_info = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    vk_submit_info.waitSemaphoreCount = CountU32(vk_wait_semaphores);
-    vk_submit_info.pWaitSemaphores = DataPtr(vk_wait_semaphores);
-    vk_submit_info.pWaitDstStageMask = DataPtr(vk_pipeline_stages);
-    vk_submit_info.commandBufferCount = CountU32(vk_command_buffers);
-    vk_submit_info.pCommandBuffers = DataPtr(vk_command_buffers);
-    vk_submit_info.signalSemaphoreCount = CountU32(vk_signal_semaphores);
-    vk_submit_info.pSignalSemaphores = DataPtr(vk_signal_semaphores);
+    vk_submit_info.waitSemaphoreCount = vk_wait_semaphore_count;
+    vk_submit_info.pWaitSemaphores = vk_wait_semaphores;
+    vk_submit_info.pWaitDstStageMask = vk_pipeline_stages;
+    vk_submit_info.commandBufferCount = vk_command_buffer_count;
+    vk_submit_info.pCommandBuffers = vk_command_buffers;
+    vk_submit_info.signalSemaphoreCount = 1;
+    vk_submit_info.pSignalSemaphores = &vk_work_complete_semaphore;
     // Queue submit
+    uint64_t submit_begin = vkex::Timer::Timestamp();
     VkResult vk_result = InvalidValue<VkResult>::Value;
     VKEX_VULKAN_RESULT_CALL(
         vk_result,
@@ -2266,6 +2444,9 @@ vkex::Result Application::SubmitRender(Application::RenderData* p_data)
     if (vk_result != VK_SUCCESS) {
         return vkex::Result(vk_result);
     }
+    uint64_t submit_end = vkex::Timer::Timestamp();
+    m_frame_bound.SetSubmitTime(submit_end);
+    vkex::FlightRecorder::Get().Record("submit", "render submit", submit_begin, submit_end, m_elapsed_frame_count);
 
     m_render_submitted = true;
   }
@@ -2289,32 +2470,74 @@ vkex::Result Application::SubmitPresent(Application::PresentData* p_data)
   VkSwapchainKHR vk_swapchain             = *m_swapchain;
   uint32_t vk_swapchain_image_index       = m_current_swapchain_image_index;
 
+  // Screenshot copy, recorded after the app's work in the same submit so it
+  // finishes before the image is presented
+  VkCommandBuffer vk_screenshot_command_buffer = VK_NULL_HANDLE;
+  if (m_screenshot_readback.IsInitialized()) {
+    m_screenshot_readback.Poll();
+    if (m_screen_shot || m_screen_shot_every_frame) {
+      auto rtvs = p_data->GetRenderPass()->GetRtvs();
+      vkex::Image image = rtvs[0]->GetResource()->GetImage();
+      VkExtent2D extent = { m_configuration.window.width, m_configuration.window.height };
+      vk_screenshot_command_buffer = m_screenshot_readback.RecordCopy(
+        image,
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        extent,
+        m_elapsed_frame_count);
+      if (vk_screenshot_command_buffer == VK_NULL_HANDLE) {
+        VKEX_LOG_WARN("Screenshot dropped, all readback slots are busy");
+      }
+    }
+    m_screen_shot = false;
+  }
+
   // Submit present work
   {
-    // Containers
-    std::vector<VkSemaphore> vk_wait_semaphores           = { vk_image_acquired_semaphore };
-    std::vector<VkCommandBuffer> vk_command_buffers       = { vk_command_buffer };
-    std::vector<VkPipelineStageFlags> vk_pipeline_stages  = { vk_pipeline_stage };
-    std::vector<VkSemaphore> vk_signal_semaphores         = { vk_work_complete_for_render_semaphore, vk_work_complete_for_present_semaphore };
+    // Containers - fixed size to keep the per frame submit off the heap
+    VkSemaphore vk_wait_semaphores[2]           = { vk_image_acquired_semaphore };
+    VkPipelineStageFlags vk_pipeline_stages[2]  = { vk_pipeline_stage };
+    VkSemaphore vk_signal_semaphores[2]         = { vk_work_complete_for_render_semaphore, vk_work_complete_for_present_semaphore };
+    uint32_t vk_wait_semaphore_count            = 1;
+    VkCommandBuffer vk_command_buffers[4]       = {};
+    uint32_t vk_command_buffer_count            = 0;
     
     // Add wait for render work if submitted
     if (m_render_submitted) {
       VkSemaphore vk_render_work_completed_semaphore = *(m_current_render_data->GetWorkCompleteSemaphore());
-      vk_wait_semaphores.push_back(vk_render_work_completed_semaphore);
-      vk_pipeline_stages.push_back(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+      vk_wait_semaphores[vk_wait_semaphore_count] = vk_render_work_completed_semaphore;
+      vk_pipeline_stages[vk_wait_semaphore_count] = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+      vk_wait_semaphore_count += 1;
       m_render_submitted = false;
     }
 
+    // App's work and the screenshot copy, between the frame bound timestamps
+    {
+      VkCommandBuffer vk_timestamp_begin = VK_NULL_HANDLE;
+      VkCommandBuffer vk_timestamp_end = VK_NULL_HANDLE;
+      m_frame_bound.GetSubmitCommandBuffers(kFrameSubmitPresent, &vk_timestamp_begin, &vk_timestamp_end);
+      if (vk_timestamp_begin != VK_NULL_HANDLE) {
+        vk_command_buffers[vk_command_buffer_count++] = vk_timestamp_begin;
+      }
+      vk_command_buffers[vk_command_buffer_count++] = vk_command_buffer;
+      if (vk_screenshot_command_buffer != VK_NULL_HANDLE) {
+        vk_command_buffers[vk_command_buffer_count++] = vk_screenshot_command_buffer;
+      }
+      if (vk_timestamp_end != VK_NULL_HANDLE) {
+        vk_command_buffers[vk_command_buffer_count++] = vk_timestamp_end;
+      }
+    }
+
     // Submit info
     VkSubmitInfo vk_submit_info = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    vk_submit_info.waitSemaphoreCount   = CountU32(vk_wait_semaphores);
-    vk_submit_info.pWaitSemaphores      = DataPtr(vk_wait_semaphores);
-    vk_submit_info.pWaitDstStageMask    = DataPtr(vk_pipeline_stages);
-    vk_submit_info.commandBufferCount   = CountU32(vk_command_buffers);
-    vk_submit_info.pCommandBuffers      = DataPtr(vk_command_buffers);
-    vk_submit_info.signalSemaphoreCount = CountU32(vk_signal_semaphores);
-    vk_submit_info.pSignalSemaphores    = DataPtr(vk_signal_semaphores);
+    vk_submit_info.waitSemaphoreCount   = vk_wait_semaphore_count;
+    vk_submit_info.pWaitSemaphores      = vk_wait_semaphores;
+    vk_submit_info.pWaitDstStageMask    = vk_pipeline_stages;
+    vk_submit_info.commandBufferCount   = vk_command_buffer_count;
+    vk_submit_info.pCommandBuffers      = vk_command_buffers;
+    vk_submit_info.signalSemaphoreCount = 2;
+    vk_submit_info.pSignalSemaphores    = vk_signal_semaphores;
     // Queue submit
+    uint64_t submit_begin = vkex::Timer::Timestamp();
     VkResult vk_result = InvalidValue<VkResult>::Value;
     VKEX_VULKAN_RESULT_CALL(
       vk_result,
@@ -2327,22 +2550,31 @@ vkex::Result Application::SubmitPresent(Application::PresentData* p_data)
     if (vk_result != VK_SUCCESS) {
       return vkex::Result(vk_result);
     }
+    uint64_t submit_end = vkex::Timer::Timestamp();
+    m_frame_bound.SetSubmitTime(submit_end);
+    vkex::FlightRecorder::Get().Record("submit", "present submit", submit_begin, submit_end, m_elapsed_frame_count);
+  }
+
+  if (vk_screenshot_command_buffer != VK_NULL_HANDLE) {
+    vkex::Result vkex_result = vkex::Result::Undefined;
+    VKEX_RESULT_CALL(
+      vkex_result,
+      m_screenshot_readback.SubmitFence(m_graphics_queue)
+    );
+    if (!vkex_result) {
+      return vkex_result;
+    }
   }
 
   // Submit present request
   {
-    // Containers
-    std::vector<VkSemaphore> vk_wait_semaphores       = { vk_work_complete_for_present_semaphore };
-    std::vector<VkSwapchainKHR> vk_swapchains         = { vk_swapchain };
-    std::vector<uint32_t> vk_swapchain_image_indices  = { vk_swapchain_image_index };
-
     // Present info
     VkPresentInfoKHR vk_present_info = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
-    vk_present_info.waitSemaphoreCount  = CountU32(vk_wait_semaphores);
-    vk_present_info.pWaitSemaphores     = DataPtr(vk_wait_semaphores);
-    vk_present_info.swapchainCount      = CountU32(vk_swapchains);
-    vk_present_info.pSwapchains         = DataPtr(vk_swapchains);
-    vk_present_info.pImageIndices       = DataPtr(vk_swapchain_image_indices);
+    vk_present_info.waitSemaphoreCount  = 1;
+    vk_present_info.pWaitSemaphores     = &vk_work_complete_for_present_semaphore;
+    vk_present_info.swapchainCount      = 1;
+    vk_present_info.pSwapchains         = &vk_swapchain;
+    vk_present_info.pImageIndices       = &vk_swapchain_image_index;
     vk_present_info.pResults            = nullptr;
 
 #if defined(VKEX_LINUX_GGP)
@@ -2351,8 +2583,7 @@ vkex::Result Application::SubmitPresent(Application::PresentData* p_data)
 #endif
 
     // Time start
-    TimeRange time_range = {};
-    time_range.start = static_cast<float>(GetElapsedTime());
+    uint64_t wait_begin = vkex::Timer::Timestamp();
 
     // Queue present
     VkResult vk_result = InvalidValue<VkResult>::Value;
@@ -2367,126 +2598,10 @@ vkex::Result Application::SubmitPresent(Application::PresentData* p_data)
     }
 
     // End time
-    time_range.end = static_cast<float>(GetElapsedTime());
-    time_range.diff = time_range.end - time_range.start;
-    m_vk_queue_present_times.push_back(time_range);
-    // Average queue present time
-    {
-      m_average_vk_queue_present_time = 0;
-      const size_t n = m_vk_queue_present_times.size();
-      for (size_t i = 0; i < n; ++i) {
-        m_average_vk_queue_present_time += m_vk_queue_present_times[i].diff;
-      }
-      m_average_vk_queue_present_time *= 1.0f / static_cast<float>(n);
-    }
-  }
-
-  // Write screenshot if flag is set and option is not disabled
-  if (m_screen_shot && m_configuration.enable_screen_shot) {
-    // Wait for queue idle
-    VkResult vk_result = InvalidValue<VkResult>::Value;
-    VKEX_VULKAN_RESULT_CALL(vk_result, vkex::QueueWaitIdle(*m_graphics_queue));
-
-    // Build command buffer
-    vkex::CommandBuffer command_buffer = p_data->GetCommandBuffer();
-    {
-      auto rtvs = p_data->GetRenderPass()->GetRtvs();
-      vkex::Image image = rtvs[0]->GetResource()->GetImage();
-      command_buffer->Begin();
-      // Transition image
-      command_buffer->CmdTransitionImageLayout(
-        *image, image->GetAspectFlags(), 
-        0, 
-        image->GetMipLevels(), 
-        0, 
-        image->GetArrayLayers(), 
-        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        VK_PIPELINE_STAGE_TRANSFER_BIT);
-      // Copy
-      VkBufferImageCopy region                = {};
-      region.bufferOffset                     = 0;
-      region.bufferRowLength                  = m_configuration.window.width;
-      region.bufferImageHeight                = m_configuration.window.height;
-      region.imageSubresource.aspectMask      = image->GetAspectFlags();
-      region.imageSubresource.mipLevel        = 0;
-      region.imageSubresource.baseArrayLayer  = 0;
-      region.imageSubresource.layerCount      = 1;
-      region.imageOffset                      = { 0, 0, 0 };
-      region.imageExtent                      = { m_configuration.window.width, m_configuration.window.height, 1 };
-      command_buffer->CmdCopyImageToBuffer(*image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *m_screenshot_buffer, 1, &region);
-      // Transition image
-      command_buffer->CmdTransitionImageLayout(
-        *image, image->GetAspectFlags(), 
-        0, 
-        image->GetMipLevels(), 
-        0, 
-        image->GetArrayLayers(), 
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
-        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-      command_buffer->End();
-    }
-
-    // Get Vulkan command buffer handle
-    VkCommandBuffer vk_command_buffer = *command_buffer;
-
-    // Submit info
-    VkSubmitInfo vk_submit_info = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    vk_submit_info.pWaitDstStageMask    = &vk_pipeline_stage;
-    vk_submit_info.commandBufferCount   = 1;
-    vk_submit_info.pCommandBuffers      = &vk_command_buffer;
-    
-    // Queue submit
-    vk_result = InvalidValue<VkResult>::Value;
-    VKEX_VULKAN_RESULT_CALL(
-      vk_result,
-      vkex::QueueSubmit(*m_graphics_queue, 1, &vk_submit_info, VK_NULL_HANDLE)
-    );
-    if (vk_result != VK_SUCCESS) {
-      return vkex::Result(vk_result);
-    }
-
-    // Wait for queue idle again
-    VKEX_VULKAN_RESULT_CALL(vk_result, vkex::QueueWaitIdle(*m_graphics_queue));
-
-    // Write image
-    {
-      std::stringstream file_name;
-      file_name << "screenshot_" << std::setfill('0') << std::setw(6) << m_elapsed_frame_count << ".jpg";
-      fs::path file_path = GetApplicationPath().parent() / file_name.str();
-      uint32_t component_count = FormatComponentCount(m_configuration.swapchain.color_format);
-      uint32_t pixel_stride = FormatSize(m_configuration.swapchain.color_format);
-      uint32_t row_stride = m_configuration.window.width * pixel_stride;
-
-      void* mapped_address = nullptr;
-      m_screenshot_buffer->MapMemory(&mapped_address);
-
-      // Swap channels and fill alpha
-      if (m_configuration.swapchain.color_format == VK_FORMAT_B8G8R8A8_UNORM) {
-        uint8_t* row = static_cast<uint8_t*>(mapped_address);
-        for (uint32_t y = 0; y < m_configuration.window.height; ++y) {
-          uint8_t* pixel = row;
-          for (uint32_t x = 0; x < m_configuration.window.width; ++x) {
-            std::swap(pixel[0], pixel[2]);
-            pixel += pixel_stride;
-          }
-          row += row_stride;
-        }
-      }
-      
-      // Write JPEG since STB's PNG write is *really* slow.
-      vkex::Result vkex_result = Bitmap::WriteJPG(
-        file_path,
-        m_configuration.window.width,
-        m_configuration.window.height,
-        component_count,
-        row_stride,
-        mapped_address);
-    }
-
-    // Clear screenshot flag
-    m_screen_shot = false;
+    uint64_t wait_end = vkex::Timer::Timestamp();
+    m_frame_bound.AddWait(kFrameWaitPresent, wait_begin, wait_end);
+    vkex::FlightRecorder::Get().Record("wait", "vkQueuePresentKHR", wait_begin, wait_end);
+    m_frame_metrics[kFrameMetricQueuePresent].Add(vkex::Timer::TimestampToMillis(wait_end - wait_begin));
   }
 
   return vkex::Result::Success;
@@ -2572,6 +2687,9 @@ vkex::Result Application::Run(int argn, const char* const* argv)
   // Call app setup
   DispatchCallSetup();
 
+  vkex::FlightRecorder& flight_recorder = vkex::FlightRecorder::Get();
+  flight_recorder.SetThreadName("main");
+
   // Set time to 0
   if (IsApplicationModeWindow()) {
     glfwSetTime(0);
@@ -2582,6 +2700,9 @@ vkex::Result Application::Run(int argn, const char* const* argv)
   // -----------------------------------------------------------------------------------------------
   m_running = true;
   while(IsRunning()) {
+    // Reclaim last frame's scratch memory
+    m_frame_allocator.Reset();
+
     // Poll GLFW events
     if (IsApplicationModeWindow()) {
       glfwPollEvents();
@@ -2589,11 +2710,18 @@ vkex::Result Application::Run(int argn, const char* const* argv)
 
     // Frame fence, time, total, average, rate
     {
+      // Frames run from one frame fence wait to the next
+      uint64_t frame_begin = vkex::Timer::Timestamp();
+      RecordFlightFrame(frame_begin);
+
       if (IsApplicationModeWindow()) {
         vkex::Result vkex_result = ProcessFrameFence();
         if (!vkex_result) {
           return vkex_result;
         }
+        uint64_t wait_end = vkex::Timer::Timestamp();
+        m_frame_bound.BeginFrame(frame_begin, wait_end);
+        flight_recorder.Record("wait", "frame fence", frame_begin, wait_end);
       }
 
       // Current time
@@ -2641,6 +2769,7 @@ vkex::Result Application::Run(int argn, const char* const* argv)
 
     // Call app update
     {
+      vkex::FlightScope flight_scope("app", "update");
       double start_time = GetElapsedTime();
       DispatchCallUpdate(m_frame_elapsed_time);
       double end_time = GetElapsedTime();
@@ -2661,12 +2790,17 @@ vkex::Result Application::Run(int argn, const char* const* argv)
     // Call app render
     {
       {
+        uint64_t wait_begin = vkex::Timer::Timestamp();
         vkex::Result vkex_result = ProcessRenderFence(m_current_render_data);
         if (!vkex_result) {
           return vkex_result;
         }
+        uint64_t wait_end = vkex::Timer::Timestamp();
+        m_frame_bound.AddWait(kFrameWaitRenderFence, wait_begin, wait_end);
+        flight_recorder.Record("wait", "render fence", wait_begin, wait_end);
       }
 
+      vkex::FlightScope flight_scope("app", "render");
       double start_time = GetElapsedTime();
       DispatchCallRender(m_current_render_data);
       double end_time = GetElapsedTime();
@@ -2676,6 +2810,7 @@ vkex::Result Application::Run(int argn, const char* const* argv)
     // Acquire next image
     m_current_swapchain_image_index = UINT32_MAX;
     if (IsApplicationModeWindow()) {
+      uint64_t wait_begin = vkex::Timer::Timestamp();
       vkex::Result vkex_result = vkex::Result::Undefined;
       VKEX_RESULT_CALL(
         vkex_result,
@@ -2684,6 +2819,9 @@ vkex::Result Application::Run(int argn, const char* const* argv)
       if (!vkex_result) {
         return vkex_result;
       }
+      uint64_t wait_end = vkex::Timer::Timestamp();
+      m_frame_bound.AddWait(kFrameWaitAcquire, wait_begin, wait_end);
+      flight_recorder.Record("wait", "acquire", wait_begin, wait_end);
     }
 
     // Pace fames - if needed
@@ -2694,7 +2832,11 @@ vkex::Result Application::Run(int argn, const char* const* argv)
         double expected_time = m_frame_0_time + (m_elapsed_frame_count * paced_fps);
         double diff = expected_time - current_time;
         if (diff > 0) {
+          uint64_t wait_begin = vkex::Timer::Timestamp();
           vkex::Timer::SleepSeconds(diff);
+          uint64_t wait_end = vkex::Timer::Timestamp();
+          m_frame_bound.AddWait(kFrameWaitPacing, wait_begin, wait_end);
+          flight_recorder.Record("wait", "pacing", wait_begin, wait_end);
         }
       }
       else {
@@ -2710,12 +2852,53 @@ vkex::Result Application::Run(int argn, const char* const* argv)
 
     // Call app present
     if (IsApplicationModeWindow()) {
+      vkex::FlightScope flight_scope("app", "present");
       double start_time = GetElapsedTime();
       DispatchCallPresent(m_current_present_data);
       double end_time = GetElapsedTime();
       m_present_fn_time = end_time - start_time;
     }
+
+    // Frame loop times, and their percentiles in the log once an interval
+    {
+      if (m_elapsed_frame_count > 0) {
+        m_frame_metrics[kFrameMetricFrame].Add(m_frame_elapsed_time * 1000.0);
+      }
+      m_frame_metrics[kFrameMetricUpdate].Add(m_update_fn_time * 1000.0);
+      m_frame_metrics[kFrameMetricRender].Add(m_render_fn_time * 1000.0);
+      if (IsApplicationModeWindow()) {
+        m_frame_metrics[kFrameMetricPresent].Add(m_present_fn_time * 1000.0);
+      }
+
+      const uint32_t log_interval = m_configuration.frame_stats_log_interval;
+      if (log_interval > 0) {
+        double current_time = GetElapsedTime();
+        double interval = current_time - m_frame_stats_log_time;
+        if (interval >= static_cast<double>(log_interval)) {
+          LogFrameStats(interval);
+          m_frame_stats_log_time = current_time;
+        }
+      }
+    }
     
+    // Heap allocations made by this frame, the steady state starts once the
+    // first frame time window has been filled
+    {
+      uint64_t heap_allocation_count = vkex::GetHeapAllocationCount();
+      m_heap_allocations_per_frame = heap_allocation_count - m_heap_allocation_count;
+      m_heap_allocation_count = heap_allocation_count;
+      if (m_elapsed_frame_count > kWindowFrames) {
+        m_max_steady_heap_allocations_per_frame = std::max(m_max_steady_heap_allocations_per_frame, m_heap_allocations_per_frame);
+      }
+    }
+
+    // Host allocations made by this frame
+    if (m_host_allocator) {
+      uint64_t host_allocation_count = m_host_allocator->GetTotalAllocationCount();
+      m_host_allocations_per_frame = host_allocation_count - m_host_allocation_count;
+      m_host_allocation_count = host_allocation_count;
+    }
+
     // Increment present count
     m_elapsed_frame_count += 1;
     // In flight image index
@@ -2740,6 +2923,9 @@ vkex::Result Application::Run(int argn, const char* const* argv)
     }
   }
 
+  // Let a hitch dump that's still being written finish
+  flight_recorder.WaitForDump();
+
   // Call app destroy
   DispatchCallDestroy();
 
@@ -2749,6 +2935,19 @@ vkex::Result Application::Run(int argn, const char* const* argv)
     return vkex_result;
   }
 
+  // Report host allocations, including anything the driver leaked
+  if (m_host_allocator) {
+    m_host_allocator->LogStatistics();
+  }
+
+  VKEX_LOG_INFO("Frame allocator high water mark        : " << m_frame_allocator.GetHighWaterMark() << " bytes");
+  if (m_max_steady_heap_allocations_per_frame > 0) {
+    VKEX_LOG_WARN("Max heap allocations per steady frame  : " << m_max_steady_heap_allocations_per_frame);
+  }
+  else {
+    VKEX_LOG_INFO("Max heap allocations per steady frame  : 0");
+  }
+
   VKEX_LOG_INFO("");
   VKEX_LOG_INFO("Application exited cleanly");
   VKEX_LOG_INFO("");
@@ -2939,6 +3138,54 @@ void Application::DrawDebugApplicationInfo()
         ImGui::Text("%f ms", m_present_fn_time * 1000.0f);
         ImGui::NextColumn();
       }
+      // Heap allocations
+      {
+        ImGui::Text("Heap Allocations/Frame");
+        ImGui::NextColumn();
+        ImGui::Text("%llu (steady max %llu)",
+          static_cast<unsigned long long>(m_heap_allocations_per_frame),
+          static_cast<unsigned long long>(m_max_steady_heap_allocations_per_frame));
+        ImGui::NextColumn();
+      }
+      // Frame allocator
+      {
+        ImGui::Text("Frame Allocator");
+        ImGui::NextColumn();
+        ImGui::Text("%.1f / %.1f KiB",
+          m_frame_allocator.GetHighWaterMark() / 1024.0,
+          m_frame_allocator.GetCapacity() / 1024.0);
+        ImGui::NextColumn();
+      }
+      ImGui::Columns(1);
+    }
+
+    // Vulkan host allocations
+    if (m_host_allocator) {
+      ImGui::Separator();
+
+      vkex::HostAllocatorStatistics statistics = {};
+      m_host_allocator->GetStatistics(&statistics);
+
+      ImGui::Columns(2);
+      // Allocations per frame
+      {
+        ImGui::Text("Host Allocations/Frame");
+        ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(m_host_allocations_per_frame));
+        ImGui::NextColumn();
+      }
+      // Per scope
+      for (uint32_t scope = 0; scope < vkex::kHostAllocationScopeCount; ++scope) {
+        const vkex::HostAllocationScopeStatistics& scope_stats = statistics.scopes[scope];
+        ImGui::Text("Host %s Scope", vkex::HostAllocator::GetScopeName(static_cast<VkSystemAllocationScope>(scope)));
+        ImGui::NextColumn();
+        ImGui::Text("%llu live, %.1f KiB (peak %.1f KiB), %llu total",
+          static_cast<unsigned long long>(scope_stats.live_count),
+          scope_stats.live_bytes / 1024.0,
+          scope_stats.peak_bytes / 1024.0,
+          static_cast<unsigned long long>(scope_stats.allocation_count));
+        ImGui::NextColumn();
+      }
       ImGui::Columns(1);
     }
 
@@ -2987,28 +3234,83 @@ void Application::DrawDebugApplicationInfo()
 
     ImGui::Separator();
 
-    // Vulkan call times
+    // Frame loop times, over the whole run
     {
-      ImGui::Columns(2);
-      // vkQueuePresentKHR
+      ImGui::Columns(5);
       {
-        ImGui::Text("vkQueuePresentKHR"); 
-        ImGui::NextColumn(); 
-        ImGui::Text("%f", m_average_vk_queue_present_time); 
-        ImGui::NextColumn(); 
+        const char* headings[5] = { "Time (ms)", "P50", "P95", "P99", "Max" };
+        for (uint32_t i = 0; i < 5; ++i) {
+          ImGui::Text("%s", headings[i]);
+          ImGui::NextColumn();
+        }
+      }
+      for (uint32_t i = 0; i < kFrameMetricCount; ++i) {
+        FrameMetricTag tag = static_cast<FrameMetricTag>(i);
+        vkex::QuantileSummary summary = {};
+        m_frame_metrics[i].GetRun().GetSummary(&summary);
+        ImGui::Text("%s", GetFrameMetricName(tag));
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", summary.p50);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", summary.p95);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", summary.p99);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", summary.max);
+        ImGui::NextColumn();
       }
       ImGui::Columns(1);
+    }
 
-      //ImGui::PlotLines(
-      //  "0 to 100us",
-      //  (float*)m_queue_present_times.data() + 2,
-      //  m_queue_present_times.size(),
-      //  0,
-      //  nullptr,
-      //  0,
-      //  100 * 0.000001f, // microseconds
-      //  ImVec2(0, 64),
-      //  sizeof(TimeRange));
+    // Frame bound, over the last window of frames
+    if (m_frame_bound.IsInitialized()) {
+      ImGui::Separator();
+
+      const vkex::FrameBoundStats& stats = m_frame_bound.GetStats();
+      ImGui::Columns(2);
+      for (uint32_t i = 0; i < kFrameBoundCount; ++i) {
+        vkex::FrameBound bound = static_cast<vkex::FrameBound>(i);
+        ImGui::Text("%s Bound", FrameBoundClassifier::ToString(bound));
+        ImGui::NextColumn();
+        ImGui::Text("%.1f%%", stats.GetBoundPercent(bound));
+        ImGui::NextColumn();
+      }
+      // GPU busy
+      {
+        ImGui::Text("GPU Busy");
+        ImGui::NextColumn();
+        if (stats.gpu_timed) {
+          ImGui::Text("%.3f ms%s", stats.gpu_busy_ms, stats.calibrated ? "" : " (uncalibrated)");
+        }
+        else {
+          ImGui::Text("n/a");
+        }
+        ImGui::NextColumn();
+      }
+      // GPU latency
+      if (stats.calibrated) {
+        ImGui::Text("GPU Done After Submit");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.gpu_latency_ms);
+        ImGui::NextColumn();
+      }
+      // Waits
+      {
+        const char* names[kFrameWaitCount] = {
+          "Frame Fence Wait",
+          "Render Fence Wait",
+          "Acquire Wait",
+          "Pacing Wait",
+          "Present Wait",
+        };
+        for (uint32_t wait = 0; wait < kFrameWaitCount; ++wait) {
+          ImGui::Text("%s", names[wait]);
+          ImGui::NextColumn();
+          ImGui::Text("%.3f ms", stats.wait_ms[wait]);
+          ImGui::NextColumn();
+        }
+      }
+      ImGui::Columns(1);
     }
   }
   ImGui::End();
@@ -17,13 +17,20 @@
 #ifndef __VKEX_APPLICATION_H__
 #define __VKEX_APPLICATION_H__
 
+#include <vkex/AllocationCounter.h>
 #include <vkex/ArgParser.h>
 #include <vkex/Bitmap.h>
 #include <vkex/Camera.h>
 #include <vkex/Cast.h>
 #include <vkex/FileSystem.h>
+#include <vkex/FlightRecorder.h>
+#include <vkex/FrameBound.h>
+#include <vkex/FrameStats.h>
 #include <vkex/Geometry.h>
+#include <vkex/HostAllocator.h>
+#include <vkex/ImageReadback.h>
 #include <vkex/Instance.h>
+#include <vkex/LinearAllocator.h>
 #include <vkex/Timer.h>
 #include <vkex/ToString.h>
 #include <vkex/Transform.h>
@@ -214,51 +221,6 @@ enum JoystickInput {
 };
 
 
-template <typename T, size_t SizeValue>
-class HistoryT {
-public:
-  HistoryT() {}
-  ~HistoryT() {}
-
-  const T& operator[](size_t n) const {
-    return m_data[n];
-  }
-
-  const T* data() const {
-    const T* ptr = m_data.data();
-    return ptr;
-  }
-
-  size_t size() const {
-    return m_data.size();
-  }
-
-  void push_back(const T& value) {
-    if (m_data.size() == SizeValue) {
-      for (size_t i = 0; i < (SizeValue - 1); ++i) {
-        m_data[i] = m_data[i + 1];
-      }
-      m_data[SizeValue - 1] = value;
-    }
-    else {
-      m_data.push_back(value);
-    }
-  }
-
-private:
-  std::vector<T>  m_data;
-};
-
-/** @struct TimeRange
- *
- */
-struct TimeRange {
-  float start;
-  float end;
-  float diff;
-};
-
-
 /** @struct Configuration
  *
  */
@@ -346,6 +308,36 @@ struct Configuration {
 
   // Screenshot
   bool                        enable_screen_shot;
+
+  // Route Vulkan host allocations through vkex::HostAllocator
+  //
+  // Default: false
+  //
+  bool                        enable_host_allocator;
+
+  // Seconds between frame time percentile log lines
+  //
+  // Default: 0 (no log lines)
+  //
+  uint32_t                    frame_stats_log_interval;
+
+  // Flight recorder hitch dumps
+  struct {
+    // Frames longer than this dump the recorder as Chrome trace JSON
+    //
+    // Default: 0 (no dumps)
+    //
+    float                     hitch_threshold_ms;
+
+    // Default: 3
+    float                     dump_seconds;
+
+    // Dumps written per run
+    //
+    // Default: 8
+    //
+    uint32_t                  max_dumps;
+  } flight_recorder;
 };
 
 /** @class Application
@@ -412,6 +404,18 @@ public:
   //! @fn Quit
   void Quit();
 
+  //! @fn RequestScreenShot
+  //!
+  //! Captures the next presented frame, same as the print screen key. Needs
+  //! 'enable_screen_shot'.
+  void RequestScreenShot();
+
+  //! @fn SetScreenShotEveryFrame
+  //!
+  //! Captures every presented frame until turned off. Frames are dropped
+  //! rather than waited on when the writers fall behind.
+  void SetScreenShotEveryFrame(bool every_frame);
+
   //! @fn GetName
   const std::string& GetName() const;
 
@@ -556,6 +560,10 @@ public:
   float GetMinWindowFrameTime() const {
     return static_cast<float>(m_min_window_frame_time);
   }
+  //! @fn GetFrameBoundStats - Returns what held frames back over the last kFrameBoundWindowFrames frames
+  const vkex::FrameBoundStats& GetFrameBoundStats() const {
+    return m_frame_bound.GetStats();
+  }
 
   //! @fn SetSwapchainFormat
   void SetSwapchainFormat(VkFormat format, VkColorSpaceKHR color_space = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR);
@@ -566,11 +574,35 @@ public:
   //! @fn GetGraphicsQueue
   vkex::Queue GetGraphicsQueue() const;
 
-  //! @fn GetAverageVkQueuePresentTime
+  //! @fn GetFrameAllocator - Returns the per frame scratch allocator. Memory is reclaimed when the next frame starts.
+  vkex::LinearAllocator& GetFrameAllocator() {
+    return m_frame_allocator;
+  }
+
+  //! @fn GetAverageVkQueuePresentTime - Returns the average over the last FrameMetric::kRecentCount presents in seconds
   float GetAverageVkQueuePresentTime() const {
-    return m_average_vk_queue_present_time;
+    return static_cast<float>(m_frame_metrics[kFrameMetricQueuePresent].GetRecentAverage() / 1000.0);
   }
 
+  enum FrameMetricTag {
+    kFrameMetricFrame         = 0,
+    kFrameMetricUpdate        = 1,
+    kFrameMetricRender        = 2,
+    kFrameMetricPresent       = 3,
+    kFrameMetricQueuePresent  = 4,
+    kFrameMetricCount         = 5,
+  };
+
+  //! @fn GetFrameMetric - Returns the percentiles of one of the frame loop's times, in milliseconds
+  const vkex::FrameMetric& GetFrameMetric(FrameMetricTag tag) const {
+    return m_frame_metrics[tag];
+  }
+  //! @fn GetFrameMetricName
+  static const char* GetFrameMetricName(FrameMetricTag tag);
+
+  //! @fn AddLoggedFrameMetric - Logs 'p_metric' with the frame loop's times, it must outlive Run()
+  void AddLoggedFrameMetric(const std::string& name, vkex::FrameMetric* p_metric);
+
   //! @fn DrawDebugApplicationInfo
   void DrawDebugApplicationInfo();
 
@@ -580,6 +612,12 @@ private:
   //! @fn InitializeAssetDirs
   void InitializeAssetDirs();
 
+  //! @fn LogFrameStats
+  void LogFrameStats(double interval);
+
+  //! @fn RecordFlightFrame - Records the frame that ends at 'frame_end', dumping the recorder if it hitched
+  void RecordFlightFrame(uint64_t frame_end);
+
   //! @fn InitializeWindow
   vkex::Result InitializeWindow();
 
@@ -671,6 +709,11 @@ protected:
   double                        m_total_frame_time = 0;
   double                        m_frame_elapsed_time = 0;
 
+  vkex::LinearAllocator         m_frame_allocator;
+  uint64_t                      m_heap_allocation_count = 0;
+  uint64_t                      m_heap_allocations_per_frame = 0;
+  uint64_t                      m_max_steady_heap_allocations_per_frame = 0;
+
   double                        m_update_fn_time = 0;
   double                        m_render_fn_time = 0;
   double                        m_present_fn_time = 0;
@@ -680,6 +723,11 @@ protected:
   double                        m_max_window_frame_time = 0;
   double                        m_min_window_frame_time = std::numeric_limits<double>::max();
 
+  // Declared before the instance so that it outlives every Vulkan object
+  std::unique_ptr<vkex::HostAllocator>  m_host_allocator;
+  uint64_t                      m_host_allocation_count = 0;
+  uint64_t                      m_host_allocations_per_frame = 0;
+
   vkex::Instance                m_instance = nullptr;
   vkex::Device                  m_device = nullptr;
   vkex::Queue                   m_graphics_queue = nullptr;
@@ -717,11 +765,29 @@ protected:
 
   bool                          m_keys[kNumKeys] = {false};
 
+  enum {
+    // Screenshots copied and not yet picked up by a writer, one per frame
+    // in flight plus room for the writers to fall behind a little
+    kScreenShotSlotCount = 4,
+  };
   bool                          m_screen_shot = false;
-  vkex::Buffer                  m_screenshot_buffer = nullptr;
+  bool                          m_screen_shot_every_frame = false;
+  vkex::ImageReadback           m_screenshot_readback;
+
+  enum {
+    // Two seconds at 60 Hz
+    kFrameBoundWindowFrames = 120,
+  };
+  vkex::FrameBoundClassifier    m_frame_bound;
+
+  // Fixed size, nothing in here grows over a long run
+  vkex::FrameMetric             m_frame_metrics[kFrameMetricCount];
+  std::vector<std::pair<std::string, vkex::FrameMetric*>> m_logged_frame_metrics;
+  double                        m_frame_stats_log_time = 0;
 
-  HistoryT<TimeRange, 100>      m_vk_queue_present_times;
-  float                         m_average_vk_queue_present_time = 0;
+  uint64_t                      m_flight_frame_begin = 0;
+  uint64_t                      m_flight_last_dump = 0;
+  uint32_t                      m_flight_dump_count = 0;
 };
 
 } // namespace vkex
@@ -26,6 +26,17 @@
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include "stb_image_resize.h"
 
+#include <fstream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKEX_BITMAP_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
 namespace vkex {
 
 Bitmap::Bitmap()
@@ -685,6 +696,694 @@ vkex::Result Bitmap::GetDataFootprint(
   return vkex::Result::Success;
 }
 
+// -------------------------------------------------------------------------------------------------
+// PNG encoding
+//
+// Rows are Paeth filtered and deflated in horizontal strips, one thread per
+// strip. Each strip is an independent dynamic Huffman block whose only
+// matches are byte runs at distance 1, which is where most of the gain is
+// on filtered rendered images, then a sync flush so it ends on a byte
+// boundary. The strips go in their own IDAT chunks; their concatenation is
+// one zlib stream, closed by an empty final block and the Adler-32 of all
+// strips combined.
+// -------------------------------------------------------------------------------------------------
+enum {
+  kPngMaxStripCount   = 16,
+  kPngMinStripRows    = 32,
+  kDeflateMaxRun      = 258,
+  kDeflateMinRun      = 3,
+  kDeflateLitLenCount = 286,
+  kDeflateDistCount   = 30,
+  kDeflateCodeLenCount= 19,
+  kDeflateEndOfBlock  = 256,
+  // Tokens past the literals are runs, 256 + length
+  kPngRunToken        = 256,
+};
+
+struct DeflateLengthCode {
+  uint16_t symbol;
+  uint8_t  extra_bits;
+  uint16_t extra_value;
+};
+
+// Length 3..258 to its deflate symbol and extra bits
+static const DeflateLengthCode* GetDeflateLengthCodes()
+{
+  static const DeflateLengthCode* s_codes = []() {
+    static DeflateLengthCode codes[kDeflateMaxRun + 1] = {};
+    static const uint16_t kBase[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t  kExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    for (uint32_t i = 0; i < 29; ++i) {
+      const uint32_t end = (i < 28) ? kBase[i + 1] : (kDeflateMaxRun + 1);
+      for (uint32_t length = kBase[i]; length < end; ++length) {
+        codes[length].symbol      = static_cast<uint16_t>(257 + i);
+        codes[length].extra_bits  = kExtra[i];
+        codes[length].extra_value = static_cast<uint16_t>(length - kBase[i]);
+      }
+    }
+    return codes;
+  }();
+  return s_codes;
+}
+
+// Slicing by 8, table 0 is the usual byte at a time table
+static const uint32_t (*GetCrc32Tables())[256]
+{
+  static const uint32_t (*s_tables)[256] = []() {
+    static uint32_t tables[8][256] = {};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (uint32_t k = 0; k < 8; ++k) {
+        c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+      }
+      tables[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; ++n) {
+      for (uint32_t t = 1; t < 8; ++t) {
+        tables[t][n] = tables[0][tables[t - 1][n] & 0xFF] ^ (tables[t - 1][n] >> 8);
+      }
+    }
+    return tables;
+  }();
+  return s_tables;
+}
+
+static uint32_t UpdateCrc32(uint32_t crc, const uint8_t* p_data, size_t size)
+{
+  const uint32_t (*p_tables)[256] = GetCrc32Tables();
+  crc = ~crc;
+  // Little endian hosts only, like the rest of the encoder
+  for (; size >= 8; size -= 8, p_data += 8) {
+    uint32_t low  = 0;
+    uint32_t high = 0;
+    memcpy(&low, p_data, 4);
+    memcpy(&high, p_data + 4, 4);
+    low ^= crc;
+    crc = p_tables[7][low & 0xFF] ^ p_tables[6][(low >> 8) & 0xFF] ^
+          p_tables[5][(low >> 16) & 0xFF] ^ p_tables[4][low >> 24] ^
+          p_tables[3][high & 0xFF] ^ p_tables[2][(high >> 8) & 0xFF] ^
+          p_tables[1][(high >> 16) & 0xFF] ^ p_tables[0][high >> 24];
+  }
+  for (size_t i = 0; i < size; ++i) {
+    crc = p_tables[0][(crc ^ p_data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static const uint32_t kAdlerBase = 65521;
+
+static uint32_t UpdateAdler32(uint32_t adler, const uint8_t* p_data, size_t size)
+{
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (size > 0) {
+    // Largest run that can't overflow 32 bits before the modulo
+    const size_t count = std::min<size_t>(size, 5552);
+    for (size_t i = 0; i < count; ++i) {
+      a += p_data[i];
+      b += a;
+    }
+    a %= kAdlerBase;
+    b %= kAdlerBase;
+    p_data += count;
+    size -= count;
+  }
+  return (b << 16) | a;
+}
+
+// The Adler-32 of A followed by B, from the checksums of each and B's size
+static uint32_t CombineAdler32(uint32_t adler_a, uint32_t adler_b, uint64_t size_b)
+{
+  const uint32_t rem = static_cast<uint32_t>(size_b % kAdlerBase);
+  uint32_t sum1 = adler_a & 0xFFFF;
+  uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % kAdlerBase);
+  sum1 += (adler_b & 0xFFFF) + kAdlerBase - 1;
+  sum2 += (adler_a >> 16) + (adler_b >> 16) + kAdlerBase - rem;
+  if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+  if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+  if (sum2 >= (kAdlerBase << 1)) sum2 -= (kAdlerBase << 1);
+  if (sum2 >= kAdlerBase) sum2 -= kAdlerBase;
+  return (sum2 << 16) | sum1;
+}
+
+// Huffman code lengths no longer than 'max_length'. Frequencies are halved
+// until the tree fits, which costs a little size only on pathological input.
+static void BuildHuffmanLengths(const uint32_t* p_freqs, uint32_t count, uint32_t max_length, uint8_t* p_lengths)
+{
+  struct Node {
+    uint64_t weight;
+    int32_t  parent;
+  };
+
+  std::vector<uint32_t> freqs(p_freqs, p_freqs + count);
+  std::vector<Node> nodes;
+  std::vector<std::pair<uint64_t, int32_t>> heap;
+  while (true) {
+    std::fill(p_lengths, p_lengths + count, static_cast<uint8_t>(0));
+    nodes.clear();
+    heap.clear();
+    std::vector<int32_t> leaves;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (freqs[i] > 0) {
+        leaves.push_back(static_cast<int32_t>(i));
+        heap.emplace_back(freqs[i], static_cast<int32_t>(nodes.size()));
+        nodes.push_back({ freqs[i], -1 });
+      }
+    }
+    if (leaves.empty()) {
+      return;
+    }
+    if (leaves.size() == 1) {
+      p_lengths[leaves[0]] = 1;
+      return;
+    }
+
+    auto greater = [](const std::pair<uint64_t, int32_t>& a, const std::pair<uint64_t, int32_t>& b) {
+      return (a.first > b.first) || ((a.first == b.first) && (a.second > b.second));
+    };
+    std::make_heap(heap.begin(), heap.end(), greater);
+    while (heap.size() > 1) {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      auto first = heap.back();
+      heap.pop_back();
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      auto second = heap.back();
+      heap.pop_back();
+
+      const int32_t parent = static_cast<int32_t>(nodes.size());
+      nodes.push_back({ first.first + second.first, -1 });
+      nodes[first.second].parent  = parent;
+      nodes[second.second].parent = parent;
+      heap.emplace_back(first.first + second.first, parent);
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
+
+    // Parents always come after their children, so one backwards pass
+    // gives every node's depth
+    std::vector<uint32_t> depths(nodes.size(), 0);
+    for (int32_t i = static_cast<int32_t>(nodes.size()) - 2; i >= 0; --i) {
+      depths[i] = depths[nodes[i].parent] + 1;
+    }
+
+    uint32_t longest = 0;
+    for (size_t i = 0; i < leaves.size(); ++i) {
+      p_lengths[leaves[i]] = static_cast<uint8_t>(depths[i]);
+      longest = std::max(longest, depths[i]);
+    }
+    if (longest <= max_length) {
+      return;
+    }
+
+    for (auto& freq : freqs) {
+      freq = (freq > 0) ? std::max<uint32_t>(freq >> 1, 1) : 0;
+    }
+  }
+}
+
+// Canonical codes for 'p_lengths', bit reversed for deflate's LSB first
+// packing
+static void BuildHuffmanCodes(const uint8_t* p_lengths, uint32_t count, uint16_t* p_codes)
+{
+  uint32_t length_counts[16] = {};
+  for (uint32_t i = 0; i < count; ++i) {
+    ++length_counts[p_lengths[i]];
+  }
+  length_counts[0] = 0;
+
+  uint32_t next_code[16] = {};
+  uint32_t code = 0;
+  for (uint32_t bits = 1; bits < 16; ++bits) {
+    code = (code + length_counts[bits - 1]) << 1;
+    next_code[bits] = code;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t length = p_lengths[i];
+    if (length == 0) {
+      p_codes[i] = 0;
+      continue;
+    }
+    uint32_t value = next_code[length]++;
+    uint32_t reversed = 0;
+    for (uint32_t bit = 0; bit < length; ++bit) {
+      reversed = (reversed << 1) | (value & 1);
+      value >>= 1;
+    }
+    p_codes[i] = static_cast<uint16_t>(reversed);
+  }
+}
+
+// Packs bits LSB first into a buffer the caller sized for the worst case
+class DeflateBitWriter {
+public:
+  explicit DeflateBitWriter(uint8_t* p_out) : m_p_next(p_out) {}
+
+  // Up to 32 bits at a time
+  void Put(uint32_t value, uint32_t bit_count)
+  {
+    m_bits |= static_cast<uint64_t>(value) << m_bit_count;
+    m_bit_count += bit_count;
+    if (m_bit_count >= 32) {
+      const uint32_t low = static_cast<uint32_t>(m_bits);
+      // Deflate's stream is little endian, like every host this runs on
+      memcpy(m_p_next, &low, sizeof(low));
+      m_p_next += 4;
+      m_bits >>= 32;
+      m_bit_count -= 32;
+    }
+  }
+
+  void AlignToByte()
+  {
+    while (m_bit_count > 0) {
+      *m_p_next++ = static_cast<uint8_t>(m_bits);
+      m_bits >>= 8;
+      m_bit_count = (m_bit_count > 8) ? (m_bit_count - 8) : 0;
+    }
+    m_bits = 0;
+  }
+
+  void PutBytes(const uint8_t* p_bytes, size_t count)
+  {
+    VKEX_ASSERT(m_bit_count == 0);
+    memcpy(m_p_next, p_bytes, count);
+    m_p_next += count;
+  }
+
+  uint8_t* GetNext() const { return m_p_next; }
+
+private:
+  uint8_t* m_p_next    = nullptr;
+  uint64_t m_bits      = 0;
+  uint32_t m_bit_count = 0;
+};
+
+// Worst case WriteDeflateStrip size: a header under 320 bytes, then at most
+// 15 + 5 + 1 bits a token, then the flush
+static size_t GetDeflateStripBound(size_t token_count)
+{
+  return 320 + (token_count * 3) + 8;
+}
+
+// Writes one dynamic Huffman block of 'tokens' followed by a sync flush and
+// returns the end of what was written. 'p_lit_freqs' counts the literal and
+// length symbols of the tokens.
+static uint8_t* WriteDeflateStrip(const uint16_t* p_tokens, size_t token_count, uint32_t* p_lit_freqs, uint8_t* p_out)
+{
+  const DeflateLengthCode* p_length_codes = GetDeflateLengthCodes();
+
+  uint32_t* lit_freqs = p_lit_freqs;
+  uint32_t dist_freqs[kDeflateDistCount]  = {};
+  lit_freqs[kDeflateEndOfBlock] = 1;
+  // Every run is distance 1, code 0. Always present, a lone one bit code is
+  // how deflate says there are no distances
+  dist_freqs[0] = 1;
+
+  uint8_t  lit_lengths[kDeflateLitLenCount] = {};
+  uint8_t  dist_lengths[kDeflateDistCount]  = {};
+  uint16_t lit_codes[kDeflateLitLenCount]   = {};
+  uint16_t dist_codes[kDeflateDistCount]    = {};
+  BuildHuffmanLengths(lit_freqs, kDeflateLitLenCount, 15, lit_lengths);
+  BuildHuffmanLengths(dist_freqs, kDeflateDistCount, 15, dist_lengths);
+  BuildHuffmanCodes(lit_lengths, kDeflateLitLenCount, lit_codes);
+  BuildHuffmanCodes(dist_lengths, kDeflateDistCount, dist_codes);
+
+  uint32_t lit_count = kDeflateLitLenCount;
+  while ((lit_count > 257) && (lit_lengths[lit_count - 1] == 0)) {
+    --lit_count;
+  }
+  const uint32_t dist_count = 1;
+
+  // Both length tables, run length coded with the code length alphabet
+  std::vector<uint8_t> lengths(lit_lengths, lit_lengths + lit_count);
+  lengths.insert(lengths.end(), dist_lengths, dist_lengths + dist_count);
+  std::vector<std::pair<uint8_t, uint8_t>> length_tokens;
+  for (size_t i = 0; i < lengths.size();) {
+    const uint8_t length = lengths[i];
+    size_t run = 1;
+    while (((i + run) < lengths.size()) && (lengths[i + run] == length)) {
+      ++run;
+    }
+    if (length == 0) {
+      size_t remaining = run;
+      while (remaining >= 11) {
+        const size_t count = std::min<size_t>(remaining, 138);
+        length_tokens.emplace_back(18, static_cast<uint8_t>(count - 11));
+        remaining -= count;
+      }
+      if (remaining >= 3) {
+        length_tokens.emplace_back(17, static_cast<uint8_t>(remaining - 3));
+        remaining = 0;
+      }
+      for (; remaining > 0; --remaining) {
+        length_tokens.emplace_back(0, 0);
+      }
+    }
+    else {
+      length_tokens.emplace_back(length, 0);
+      size_t remaining = run - 1;
+      while (remaining >= 3) {
+        const size_t count = std::min<size_t>(remaining, 6);
+        length_tokens.emplace_back(16, static_cast<uint8_t>(count - 3));
+        remaining -= count;
+      }
+      for (; remaining > 0; --remaining) {
+        length_tokens.emplace_back(length, 0);
+      }
+    }
+    i += run;
+  }
+
+  uint32_t code_length_freqs[kDeflateCodeLenCount] = {};
+  for (const auto& token : length_tokens) {
+    ++code_length_freqs[token.first];
+  }
+  uint8_t  code_length_lengths[kDeflateCodeLenCount] = {};
+  uint16_t code_length_codes[kDeflateCodeLenCount]   = {};
+  BuildHuffmanLengths(code_length_freqs, kDeflateCodeLenCount, 7, code_length_lengths);
+  BuildHuffmanCodes(code_length_lengths, kDeflateCodeLenCount, code_length_codes);
+
+  static const uint8_t kCodeLengthOrder[kDeflateCodeLenCount] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+  uint32_t code_length_count = kDeflateCodeLenCount;
+  while ((code_length_count > 4) && (code_length_lengths[kCodeLengthOrder[code_length_count - 1]] == 0)) {
+    --code_length_count;
+  }
+
+  DeflateBitWriter writer(p_out);
+  // Not final, dynamic Huffman
+  writer.Put(0, 1);
+  writer.Put(2, 2);
+  writer.Put(lit_count - 257, 5);
+  writer.Put(dist_count - 1, 5);
+  writer.Put(code_length_count - 4, 4);
+  for (uint32_t i = 0; i < code_length_count; ++i) {
+    writer.Put(code_length_lengths[kCodeLengthOrder[i]], 3);
+  }
+  for (const auto& token : length_tokens) {
+    writer.Put(code_length_codes[token.first], code_length_lengths[token.first]);
+    if (token.first == 16) {
+      writer.Put(token.second, 2);
+    }
+    else if (token.first == 17) {
+      writer.Put(token.second, 3);
+    }
+    else if (token.first == 18) {
+      writer.Put(token.second, 7);
+    }
+  }
+
+  // Every token's bits in one lookup, a run carries its length symbol,
+  // extra bits and distance code together, at most 15 + 5 + 1 bits
+  uint32_t token_codes[kPngRunToken + kDeflateMaxRun + 1]   = {};
+  uint8_t  token_lengths[kPngRunToken + kDeflateMaxRun + 1] = {};
+  for (uint32_t value = 0; value < 256; ++value) {
+    token_codes[value]   = lit_codes[value];
+    token_lengths[value] = lit_lengths[value];
+  }
+  for (uint32_t run = kDeflateMinRun; run <= kDeflateMaxRun; ++run) {
+    const DeflateLengthCode& length_code = p_length_codes[run];
+    const uint32_t symbol_length = lit_lengths[length_code.symbol];
+    token_codes[kPngRunToken + run] =
+      lit_codes[length_code.symbol] |
+      (static_cast<uint32_t>(length_code.extra_value) << symbol_length) |
+      (static_cast<uint32_t>(dist_codes[0]) << (symbol_length + length_code.extra_bits));
+    token_lengths[kPngRunToken + run] = static_cast<uint8_t>(symbol_length + length_code.extra_bits + dist_lengths[0]);
+  }
+  for (size_t i = 0; i < token_count; ++i) {
+    const uint16_t token = p_tokens[i];
+    writer.Put(token_codes[token], token_lengths[token]);
+  }
+  writer.Put(lit_codes[kDeflateEndOfBlock], lit_lengths[kDeflateEndOfBlock]);
+
+  // Sync flush, an empty stored block brings the strip to a byte boundary
+  writer.Put(0, 3);
+  writer.AlignToByte();
+  const uint8_t kEmptyStored[4] = { 0x00, 0x00, 0xFF, 0xFF };
+  writer.PutBytes(kEmptyStored, sizeof(kEmptyStored));
+  return writer.GetNext();
+}
+
+static void StoreBigEndian32(uint32_t value, uint8_t* p_dst)
+{
+  p_dst[0] = static_cast<uint8_t>(value >> 24);
+  p_dst[1] = static_cast<uint8_t>(value >> 16);
+  p_dst[2] = static_cast<uint8_t>(value >> 8);
+  p_dst[3] = static_cast<uint8_t>(value);
+}
+
+static void AppendBigEndian32(uint32_t value, std::vector<uint8_t>* p_out)
+{
+  uint8_t bytes[4] = {};
+  StoreBigEndian32(value, bytes);
+  p_out->insert(p_out->end(), bytes, bytes + 4);
+}
+
+// Wraps 'data' in a chunk of 'type' at the end of 'p_out'
+static void AppendPngChunk(const char* type, const uint8_t* p_data, size_t size, std::vector<uint8_t>* p_out)
+{
+  AppendBigEndian32(static_cast<uint32_t>(size), p_out);
+  const size_t type_offset = p_out->size();
+  p_out->insert(p_out->end(), type, type + 4);
+  p_out->insert(p_out->end(), p_data, p_data + size);
+  const uint32_t crc = UpdateCrc32(0, p_out->data() + type_offset, 4 + size);
+  AppendBigEndian32(crc, p_out);
+}
+
+struct PngStrip {
+  uint32_t                   first_row     = 0;
+  uint32_t                   row_count     = 0;
+  uint32_t                   adler         = 1;
+  uint64_t                   filtered_size = 0;
+  // The strip's whole IDAT chunk
+  std::unique_ptr<uint8_t[]> chunk;
+  size_t                     chunk_size    = 0;
+};
+
+#if defined(VKEX_BITMAP_SSE2)
+// Set bits of a 16 bit mask counted from bit 0 up, and from bit 15 down
+static uint32_t CountLowOnes16(uint32_t mask)
+{
+  // Bit 16 stops the scan on a full mask
+  const uint32_t zeros = ~mask & 0x1FFFF;
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward(&index, zeros);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctz(zeros));
+#endif
+}
+
+static uint32_t CountHighOnes16(uint32_t mask)
+{
+  // Bit 31 of the shifted mask stands for bit 15, the low bit stops the scan
+  const uint32_t zeros = (~(mask << 16)) | 1;
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanReverse(&index, zeros);
+  return 31 - static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_clz(zeros));
+#endif
+}
+#endif
+
+// Paeth filters 'row_size' bytes of 'p_row' against 'p_up', the row above or
+// zeros, into 'p_dst'
+static void PaethFilterRow(const uint8_t* p_row, const uint8_t* p_up, size_t row_size, uint32_t pixel_size, uint8_t* p_dst)
+{
+  // The first pixel has nothing to its left, Paeth picks up
+  size_t i = 0;
+  for (; (i < pixel_size) && (i < row_size); ++i) {
+    p_dst[i] = static_cast<uint8_t>(p_row[i] - p_up[i]);
+  }
+
+#if defined(VKEX_BITMAP_SSE2)
+  // The predictors only read unfiltered bytes, so unlike decoding every byte
+  // is independent. 16 bit lanes keep a + b - 2c in range.
+  const __m128i zero = _mm_setzero_si128();
+  for (; (i + 16) <= row_size; i += 16) {
+    const __m128i x  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_row + i));
+    const __m128i a8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_row + i - pixel_size));
+    const __m128i b8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_up + i));
+    const __m128i c8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_up + i - pixel_size));
+
+    __m128i predictor[2];
+    for (int half = 0; half < 2; ++half) {
+      const __m128i a = half ? _mm_unpackhi_epi8(a8, zero) : _mm_unpacklo_epi8(a8, zero);
+      const __m128i b = half ? _mm_unpackhi_epi8(b8, zero) : _mm_unpacklo_epi8(b8, zero);
+      const __m128i c = half ? _mm_unpackhi_epi8(c8, zero) : _mm_unpacklo_epi8(c8, zero);
+      const __m128i b_c = _mm_sub_epi16(b, c);
+      const __m128i a_c = _mm_sub_epi16(a, c);
+      const __m128i abc = _mm_add_epi16(b_c, a_c);
+      const __m128i pa  = _mm_max_epi16(b_c, _mm_sub_epi16(zero, b_c));
+      const __m128i pb  = _mm_max_epi16(a_c, _mm_sub_epi16(zero, a_c));
+      const __m128i pc  = _mm_max_epi16(abc, _mm_sub_epi16(zero, abc));
+      const __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+      const __m128i not_b = _mm_cmpgt_epi16(pb, pc);
+      const __m128i b_or_c = _mm_or_si128(_mm_andnot_si128(not_b, b), _mm_and_si128(not_b, c));
+      predictor[half] = _mm_or_si128(_mm_andnot_si128(not_a, a), _mm_and_si128(not_a, b_or_c));
+    }
+    const __m128i packed = _mm_packus_epi16(predictor[0], predictor[1]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst + i), _mm_sub_epi8(x, packed));
+  }
+#endif
+
+  for (; i < row_size; ++i) {
+    const int32_t a = p_row[i - pixel_size];
+    const int32_t b = p_up[i];
+    const int32_t c = p_up[i - pixel_size];
+    const int32_t pa = std::abs(b - c);
+    const int32_t pb = std::abs(a - c);
+    const int32_t pc = std::abs(a + b - (2 * c));
+    const int32_t predictor = ((pa <= pb) && (pa <= pc)) ? a : ((pb <= pc) ? b : c);
+    p_dst[i] = static_cast<uint8_t>(p_row[i] - predictor);
+  }
+}
+
+static void EncodePngStrip(
+  const uint8_t* p_data,
+  uint32_t       width,
+  uint32_t       row_stride,
+  uint32_t       pixel_size,
+  bool           zlib_header,
+  PngStrip*      p_strip)
+{
+  const DeflateLengthCode* p_length_codes = GetDeflateLengthCodes();
+
+  const size_t row_size = static_cast<size_t>(width) * pixel_size;
+  std::vector<uint8_t> filtered(1 + row_size);
+  // Stands in for the row above the image
+  std::vector<uint8_t> zero_row(row_size, 0);
+  // A token per byte at worst. Left uninitialized, only the pages the
+  // tokens reach get touched
+  std::unique_ptr<uint16_t[]> tokens(new uint16_t[(1 + row_size) * p_strip->row_count]);
+  uint16_t* p_token = tokens.get();
+  uint32_t lit_freqs[kDeflateLitLenCount] = {};
+
+  uint32_t adler = 1;
+  int32_t  last  = -1;
+  uint32_t run   = 0;
+  auto flush_run = [&]() {
+    if (run >= kDeflateMinRun) {
+      *p_token++ = static_cast<uint16_t>(kPngRunToken + run);
+      ++lit_freqs[p_length_codes[run].symbol];
+    }
+    else {
+      for (uint32_t i = 0; i < run; ++i) {
+        *p_token++ = static_cast<uint16_t>(last);
+      }
+      lit_freqs[last] += run;
+    }
+    run = 0;
+  };
+
+  for (uint32_t row = 0; row < p_strip->row_count; ++row) {
+    const uint32_t y = p_strip->first_row + row;
+    const uint8_t* p_row = p_data + (static_cast<size_t>(y) * row_stride);
+    const uint8_t* p_up  = (y > 0) ? (p_row - row_stride) : zero_row.data();
+
+    // Paeth everywhere, it's the best single filter on rendered frames and
+    // reads the unfiltered rows only, so strips don't depend on each other
+    filtered[0] = 4;
+    PaethFilterRow(p_row, p_up, row_size, pixel_size, filtered.data() + 1);
+    adler = UpdateAdler32(adler, filtered.data(), filtered.size());
+
+    const uint8_t* p_filtered = filtered.data();
+    const size_t   size       = filtered.size();
+    size_t i = 0;
+    while (i < size) {
+#if defined(VKEX_BITMAP_SSE2)
+      // 16 bytes at a time. Runs only start on 4 or more repeats, shorter
+      // ones go out as literals, which keeps the branches predictable
+      if ((i > 0) && ((i + 16) <= size)) {
+        const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_filtered + i));
+        if (run > 0) {
+          const uint32_t same = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current, _mm_set1_epi8(static_cast<char>(last)))));
+          const uint32_t same_count = CountLowOnes16(same);
+          if ((run + same_count) <= kDeflateMaxRun) {
+            run += same_count;
+            i += same_count;
+            if (same_count < 16) {
+              flush_run();
+            }
+            continue;
+          }
+        }
+        else {
+          const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_filtered + i - 1));
+          const uint32_t repeats = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)));
+          const uint32_t leading = CountLowOnes16(repeats);
+          if (leading >= 4) {
+            run = leading;
+            i += leading;
+            if (leading < 16) {
+              flush_run();
+            }
+            continue;
+          }
+
+          // Literals up to a streak of repeats that reaches the end of the
+          // block, the next pass starts a run on it
+          uint32_t literal_count = 16 - CountHighOnes16(repeats);
+          if ((16 - literal_count) < 4) {
+            literal_count = 16;
+          }
+          const __m128i zero = _mm_setzero_si128();
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(p_token), _mm_unpacklo_epi8(current, zero));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(p_token + 8), _mm_unpackhi_epi8(current, zero));
+          p_token += literal_count;
+          for (uint32_t k = 0; k < literal_count; ++k) {
+            ++lit_freqs[p_filtered[i + k]];
+          }
+          i += literal_count;
+          last = p_filtered[i - 1];
+          continue;
+        }
+      }
+#endif
+      const uint8_t value = p_filtered[i++];
+      if (static_cast<int32_t>(value) == last) {
+        if (run == kDeflateMaxRun) {
+          // A full run, the next one starts right after it
+          flush_run();
+        }
+        ++run;
+        continue;
+      }
+      if (run > 0) {
+        flush_run();
+      }
+      *p_token++ = value;
+      ++lit_freqs[value];
+      last = value;
+    }
+  }
+  flush_run();
+
+  // The chunk is built in place: length, type, zlib header on the first
+  // strip, deflate data and CRC. Left uninitialized like the tokens.
+  const size_t token_count = static_cast<size_t>(p_token - tokens.get());
+  p_strip->chunk.reset(new uint8_t[8 + 2 + GetDeflateStripBound(token_count) + 4]);
+  uint8_t* p_chunk = p_strip->chunk.get();
+  uint8_t* p_next  = p_chunk + 8;
+  memcpy(p_chunk + 4, "IDAT", 4);
+  if (zlib_header) {
+    // Deflate, 32K window, no dictionary, fastest
+    *p_next++ = 0x78;
+    *p_next++ = 0x01;
+  }
+  p_next = WriteDeflateStrip(tokens.get(), token_count, lit_freqs, p_next);
+
+  const size_t data_size = static_cast<size_t>(p_next - (p_chunk + 8));
+  StoreBigEndian32(static_cast<uint32_t>(data_size), p_chunk);
+  StoreBigEndian32(UpdateCrc32(0, p_chunk + 4, 4 + data_size), p_next);
+  p_strip->chunk_size = 8 + data_size + 4;
+
+  p_strip->adler         = adler;
+  p_strip->filtered_size = static_cast<uint64_t>(1 + row_size) * p_strip->row_count;
+}
+
 vkex::Result Bitmap::WriteJPG(
   const fs::path& file_path,
   uint32_t        width,
@@ -709,4 +1408,109 @@ vkex::Result Bitmap::WriteJPG(
   return vkex::Result::Success;
 }
 
+vkex::Result Bitmap::EncodePNG(
+  uint32_t              width,
+  uint32_t              height,
+  uint32_t              component_count,
+  uint32_t              row_stride,
+  const void*           p_data,
+  uint32_t              thread_count,
+  std::vector<uint8_t>* p_png)
+{
+  if ((width == 0) || (height == 0) || (component_count < 1) || (component_count > 4)) {
+    return vkex::Result::ErrorImageWriteFailed;
+  }
+
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  // Short strips cost more in block headers than their threads win back
+  uint32_t strip_count = std::min(thread_count, static_cast<uint32_t>(kPngMaxStripCount));
+  strip_count = std::min(strip_count, std::max((height + kPngMinStripRows - 1) / kPngMinStripRows, 1u));
+  const uint32_t rows_per_strip = (height + strip_count - 1) / strip_count;
+  strip_count = (height + rows_per_strip - 1) / rows_per_strip;
+
+  std::vector<PngStrip> strips(strip_count);
+  for (uint32_t i = 0; i < strip_count; ++i) {
+    strips[i].first_row = i * rows_per_strip;
+    strips[i].row_count = std::min(rows_per_strip, height - strips[i].first_row);
+  }
+
+  const uint8_t* p_pixels = static_cast<const uint8_t*>(p_data);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < strip_count; ++i) {
+    threads.emplace_back(EncodePngStrip, p_pixels, width, row_stride, component_count, false, &strips[i]);
+  }
+  EncodePngStrip(p_pixels, width, row_stride, component_count, true, &strips[0]);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+  // Gray, gray alpha, RGB, RGBA
+  static const uint8_t kColorTypes[5] = { 0, 0, 4, 2, 6 };
+
+  size_t png_size = sizeof(kSignature) + 25 + 18 + 12;
+  for (const auto& strip : strips) {
+    png_size += strip.chunk_size;
+  }
+  p_png->clear();
+  p_png->reserve(png_size);
+  p_png->insert(p_png->end(), kSignature, kSignature + sizeof(kSignature));
+
+  std::vector<uint8_t> header;
+  AppendBigEndian32(width, &header);
+  AppendBigEndian32(height, &header);
+  header.push_back(8);
+  header.push_back(kColorTypes[component_count]);
+  // Deflate, adaptive filtering, no interlace
+  header.push_back(0);
+  header.push_back(0);
+  header.push_back(0);
+  AppendPngChunk("IHDR", header.data(), header.size(), p_png);
+
+  uint32_t adler = strips[0].adler;
+  for (const auto& strip : strips) {
+    p_png->insert(p_png->end(), strip.chunk.get(), strip.chunk.get() + strip.chunk_size);
+    if (&strip != &strips[0]) {
+      adler = CombineAdler32(adler, strip.adler, strip.filtered_size);
+    }
+  }
+
+  // An empty final fixed Huffman block closes the stream
+  std::vector<uint8_t> trailer = { 0x03, 0x00 };
+  AppendBigEndian32(adler, &trailer);
+  AppendPngChunk("IDAT", trailer.data(), trailer.size(), p_png);
+  AppendPngChunk("IEND", nullptr, 0, p_png);
+
+  return vkex::Result::Success;
+}
+
+vkex::Result Bitmap::WritePNG(
+  const fs::path& file_path,
+  uint32_t        width,
+  uint32_t        height,
+  uint32_t        component_count,
+  uint32_t        row_stride,
+  const void*     p_data,
+  uint32_t        thread_count)
+{
+  std::vector<uint8_t> png;
+  vkex::Result vkex_result = EncodePNG(width, height, component_count, row_stride, p_data, thread_count, &png);
+  if (!vkex_result) {
+    return vkex_result;
+  }
+
+  std::ofstream file(file_path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return vkex::Result::ErrorImageWriteFailed;
+  }
+  file.write(reinterpret_cast<const char*>(png.data()), png.size());
+  if (!file) {
+    return vkex::Result::ErrorImageWriteFailed;
+  }
+
+  return vkex::Result::Success;
+}
+
 } // namespace vkex
\ No newline at end of file
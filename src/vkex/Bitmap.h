@@ -147,6 +147,33 @@ public:
     uint32_t        row_stride,
     const void*     p_data);
 
+  /** @fn EncodePNG
+   *
+   * Lossless 8 bit PNG of 1 to 4 components. Row strips are filtered and
+   * deflated on up to 'thread_count' threads, 0 uses every hardware thread.
+   * Trades some size for speed: only byte runs are matched.
+   */
+  static vkex::Result EncodePNG(
+    uint32_t              width,
+    uint32_t              height,
+    uint32_t              component_count,
+    uint32_t              row_stride,
+    const void*           p_data,
+    uint32_t              thread_count,
+    std::vector<uint8_t>* p_png);
+
+  /** @fn WritePNG
+   *
+   */
+  static vkex::Result WritePNG(
+    const fs::path& file_path,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        component_count,
+    uint32_t        row_stride,
+    const void*     p_data,
+    uint32_t        thread_count = 0);
+
 private:
   bool AllocateStorage();
   bool CopyToMip0(const uint8_t* p_src_data, uint32_t src_row_stride, uint32_t src_height);
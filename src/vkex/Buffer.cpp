@@ -35,7 +35,10 @@ VkResult CBuffer::InitializeCommitted(bool host_visible, bool device_local)
 {
   // Allocate
   VmaMemoryUsage usage = VMA_MEMORY_USAGE_GPU_ONLY;
-  if (host_visible && device_local) {
+  if (host_visible && m_create_info.host_readback) {
+    usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+  }
+  else if (host_visible && device_local) {
     usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
   }
   else if (host_visible) {
@@ -231,6 +234,15 @@ bool CBuffer::IsMemoryMapped() const
   return is_mapped;
 }
 
+void CBuffer::InvalidateMemory()
+{
+  vmaInvalidateAllocation(
+    m_device->GetVmaAllocator(),
+    m_vma_allocation,
+    0,
+    VK_WHOLE_SIZE);
+}
+
 VkDeviceSize CBuffer::GetMemoryOffset() const
 {
   return m_vma_allocation_info.offset;
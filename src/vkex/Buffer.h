@@ -41,6 +41,9 @@ struct BufferCreateInfo {
   bool                        host_visible;
   // 'device_local' is only applicable to AMD GPUs.
   bool                        device_local;
+  // With 'host_visible', prefers cached host memory, for buffers the CPU
+  // reads back from.
+  bool                        host_readback;
 };
 
 /** @class IBuffer
@@ -131,6 +134,13 @@ public:
    */
   bool IsMemoryMapped() const;
 
+  /** @fn InvalidateMemory
+   *
+   * Makes GPU writes visible to the mapping when the memory isn't host
+   * coherent, does nothing when it is.
+   */
+  void InvalidateMemory();
+
   /** @fn GetOffset
    *
    */
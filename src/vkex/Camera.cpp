@@ -31,6 +31,8 @@ Camera::Camera(float near_clip, float far_clip)
 void Camera::LookAt(const float3& eye, const float3& center, const float3& up)
 {
   m_eye_position = eye;
+  m_look_at = center;
+  m_world_up = up;
   m_view_matrix = glm::lookAt(m_eye_position, center, up);
 }
 
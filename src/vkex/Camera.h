@@ -33,6 +33,8 @@ public:
   void              LookAt(const float3& eye, const float3& center, const float3& up);
 
   const float3&     GetEyePosition() const { return m_eye_position; }
+  const float3&     GetLookAt() const { return m_look_at; }
+  const float3&     GetWorldUp() const { return m_world_up; }
 
   const float4x4&   GetViewMatrix() const { return m_view_matrix ;}
   const float4x4&   GetProjectionMatrix() const { return m_projection_matrix ;}
@@ -77,6 +79,9 @@ public:
 
   void SetPerspective(float fov_degrees, float aspect, float near_clip, float far_clip);
 
+  float GetFovDegrees() const { return m_fov_degrees; }
+  float GetAspect() const { return m_aspect; }
+
 private:
   bool  m_pixel_aligned   = false;
   float m_fov_degrees     = 60.0f;
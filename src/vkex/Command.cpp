@@ -258,6 +258,20 @@ void CCommandBuffer::CmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset
     stride);
 }
 
+void CCommandBuffer::CmdDrawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+  // Requires VK_KHR_draw_indirect_count
+  VkCommandBuffer vk_command_buffer = GetVkObject();
+  vkex::CmdDrawIndexedIndirectCountKHR(
+    vk_command_buffer,
+    buffer,
+    offset,
+    countBuffer,
+    countBufferOffset,
+    maxDrawCount,
+    stride);
+}
+
 void CCommandBuffer::CmdDispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
   VkCommandBuffer vk_command_buffer = GetVkObject();
@@ -576,6 +590,11 @@ void CCommandBuffer::CmdSetViewport(uint32_t firstViewport, const std::vector<Vk
   this->CmdSetViewport(firstViewport, CountU32(*pViewports), DataPtr(*pViewports));
 }
 
+void CCommandBuffer::CmdSetViewport(uint32_t firstViewport, vkex::Span<const VkViewport> viewports)
+{
+  this->CmdSetViewport(firstViewport, CountU32(viewports), DataPtr(viewports));
+}
+
 void CCommandBuffer::CmdSetViewport(const VkRect2D& area, float minDepth, float maxDepth)
 {
   VkViewport view_port = BuildInvertedYViewport(area, minDepth, maxDepth);
@@ -587,6 +606,11 @@ void CCommandBuffer::CmdSetScissor(uint32_t firstScissor, const std::vector<VkRe
   this->CmdSetScissor(firstScissor, CountU32(*pScissors), DataPtr(*pScissors));
 }
 
+void CCommandBuffer::CmdSetScissor(uint32_t firstScissor, vkex::Span<const VkRect2D> scissors)
+{
+  this->CmdSetScissor(firstScissor, CountU32(scissors), DataPtr(scissors));
+}
+
 void CCommandBuffer::CmdSetScissor(const VkRect2D& area)
 {
   this->CmdSetScissor(0, 1, &area);
@@ -608,6 +632,18 @@ void CCommandBuffer::CmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint
     (pDynamicOffsets != nullptr ? DataPtr(*pDynamicOffsets)  : nullptr));
 }
 
+void CCommandBuffer::CmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, vkex::Span<const VkDescriptorSet> descriptorSets, vkex::Span<const uint32_t> dynamicOffsets)
+{
+  this->CmdBindDescriptorSets(
+    pipelineBindPoint, 
+    layout, 
+    firstSet,
+    CountU32(descriptorSets),
+    DataPtr(descriptorSets),
+    CountU32(dynamicOffsets),
+    DataPtr(dynamicOffsets));
+}
+
 void CCommandBuffer::CmdBindIndexBuffer(vkex::Buffer buffer, VkDeviceSize offset, VkIndexType indexType)
 {
   VkBuffer vk_buffer = *buffer;
@@ -744,6 +780,16 @@ void CCommandBuffer::CmdBeginRenderPass(const vkex::RenderPass renderPass, const
     pNext);
 }
 
+void CCommandBuffer::CmdBeginRenderPass(const vkex::RenderPass renderPass, vkex::Span<const VkClearValue> clearValues, VkSubpassContents contents, void* pNext)
+{
+  this->CmdBeginRenderPass(
+    renderPass,
+    CountU32(clearValues),
+    DataPtr(clearValues),
+    contents,
+    pNext);
+}
+
 void CCommandBuffer::CmdBeginRenderPass(const vkex::RenderPass renderPass, VkSubpassContents contents)
 {
   const std::vector<VkClearValue>& clearValues = renderPass->GetClearValues();
@@ -1004,10 +1050,7 @@ vkex::Result CCommandPool::InternalCreate(
 vkex::Result CCommandPool::InternalDestroy(const VkAllocationCallbacks* p_allocator)
 {
   // Collect command buffers
-  std::vector<vkex::CommandBuffer> command_buffers;
-  for (auto& obj : m_stored_command_buffers) {
-    command_buffers.push_back(obj.get());
-  }
+  std::vector<vkex::CommandBuffer> command_buffers = m_stored_command_buffers.GetObjects();
   // Free command buffers
   FreeCommandBuffers(&command_buffers);
 
@@ -86,6 +86,7 @@ public:
   void  CmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
   void  CmdDrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
   void  CmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+  void  CmdDrawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride);
   void  CmdDispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
   void  CmdDispatchIndirect(VkBuffer buffer, VkDeviceSize offset);
   void  CmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions);
@@ -120,11 +121,14 @@ public:
   void  CmdBindPipeline(vkex::ComputePipeline pipeline);
   void  CmdBindPipeline(vkex::GraphicsPipeline pipeline);
   void  CmdSetViewport(uint32_t firstViewport, const std::vector<VkViewport>* pViewports);
+  void  CmdSetViewport(uint32_t firstViewport, vkex::Span<const VkViewport> viewports);
   void  CmdSetViewport(const VkRect2D& area, float minDepth = 0.0f, float maxDepth = 1.0f);
   void  CmdSetScissor(uint32_t firstScissor, const std::vector<VkRect2D>* pScissors);
+  void  CmdSetScissor(uint32_t firstScissor, vkex::Span<const VkRect2D> scissors);
   void  CmdSetScissor(const VkRect2D& area);
   void  CmdSetBlendConstants(float bc0, float bc1, float bc2, float bc3);
   void  CmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, const std::vector<VkDescriptorSet>& descriptorSets, const std::vector<uint32_t>* pDynamicOffsets = nullptr);
+  void  CmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, vkex::Span<const VkDescriptorSet> descriptorSets, vkex::Span<const uint32_t> dynamicOffsets);
   void  CmdBindIndexBuffer(vkex::Buffer buffer, VkDeviceSize offset, VkIndexType indexType);
   void  CmdBindVertexBuffers(uint32_t firstBinding, const std::vector<VkBuffer>* pBuffers, const VkDeviceSize* pOffsets);
   void  CmdBindVertexBuffers(vkex::Buffer buffer, VkDeviceSize offset = 0);
@@ -148,6 +152,7 @@ public:
   void  CmdPushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, const std::vector<uint8_t>* pValues);
   void  CmdBeginRenderPass(const vkex::RenderPass renderPass, uint32_t clearValueCount, const VkClearValue* pClearValues, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, void* pNext = nullptr);
   void  CmdBeginRenderPass(const vkex::RenderPass renderPass, const std::vector<VkClearValue>* pClearValues, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, void* pNext = nullptr);
+  void  CmdBeginRenderPass(const vkex::RenderPass renderPass, vkex::Span<const VkClearValue> clearValues, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, void* pNext = nullptr);
   void  CmdBeginRenderPass(const vkex::RenderPass renderPass, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void  CmdExecuteCommands(const std::vector<VkCommandBuffer>* pCommandBuffers);
 
@@ -290,7 +295,7 @@ private:
   vkex::CommandPoolCreateInfo                   m_create_info = {};
   VkCommandPoolCreateInfo                       m_vk_create_info = {};
   VkCommandPool                                 m_vk_object = VK_NULL_HANDLE;
-  std::vector<std::unique_ptr<CCommandBuffer>>  m_stored_command_buffers;
+  ObjectStorage<CCommandBuffer>                 m_stored_command_buffers;
 };
 
 } // namespace vkex
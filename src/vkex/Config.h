@@ -40,6 +40,7 @@
 #include "vkex/Forward.h"
 #include "vkex/Log.h"
 #include "vkex/ConfigMath.h"
+#include "vkex/Span.h"
 #include "vkex/Util.h"
 
 #define VKEX_MINIMUM_REQUIRED_VULKAN_VERSION  VK_MAKE_VERSION(1, 1, 0)
@@ -314,6 +315,24 @@ uint32_t CountU32(const std::vector<T>& v)
   return static_cast<uint32_t>(v.size());
 }
 
+/** @fn CountU32
+ *
+ */
+template <typename T>
+uint32_t CountU32(const vkex::Span<T>& s)
+{
+  return static_cast<uint32_t>(s.size());
+}
+
+/** @fn CountU32
+ *
+ */
+template <typename T, size_t N>
+uint32_t CountU32(const T (&)[N])
+{
+  return static_cast<uint32_t>(N);
+}
+
 /** @fn DataPtr
  *
  */
@@ -323,6 +342,15 @@ const T* DataPtr(const std::vector<T>& v)
   return v.empty() ? nullptr : v.data();
 }
 
+/** @fn DataPtr
+ *
+ */
+template <typename T>
+T* DataPtr(const vkex::Span<T>& s)
+{
+  return s.empty() ? nullptr : s.data();
+}
+
 /** @fn DataPtr
  *
  */
@@ -45,6 +45,11 @@ size_t ElementDataStore::GetDataSize() const
   return size;
 }
 
+void ElementDataStore::Reserve(size_t size)
+{
+  m_data.reserve(size);
+}
+
 uint8_t* ElementDataStore::GetData()
 {
   uint8_t* p_data = m_data.data();
@@ -53,6 +53,28 @@ public:
     return p_data;
   }
 
+  /** @fn Reserve
+   *
+   * Allocates room for 'size' bytes up front, so a run of AppendData()
+   * calls doesn't reallocate as it grows.
+   *
+   */
+  void Reserve(size_t size);
+
+  /** @fn Resize
+   *
+   * Sizes the store for 'element_count' elements of T in one allocation and
+   * returns them for the caller to write in place.
+   *
+   */
+  template <typename T>
+  T* Resize(size_t element_count) {
+    m_element_count = element_count;
+    m_data.resize(element_count * sizeof(T));
+    T* p_data = reinterpret_cast<T*>(m_data.data());
+    return p_data;
+  }
+
   template <typename T>
   void AppendData(const T& src_data) {
     size_t src_data_size = sizeof(T);
@@ -16,6 +16,7 @@
 
 #include "vkex/Descriptor.h"
 #include "vkex/Device.h"
+#include "vkex/FlightRecorder.h"
 #include "vkex/ToString.h"
 
 namespace vkex {
@@ -124,6 +125,8 @@ const VkDescriptorSetLayoutBinding* CDescriptorSet::FindDescriptorBinding(uint32
 
 void CDescriptorSet::UpdateDescriptors(uint32_t binding, VkDescriptorType descriptor_type, uint32_t array_element, uint32_t count, const VkDescriptorBufferInfo* p_infos)
 {
+  vkex::FlightScope flight_scope("descriptor", "update descriptors", count);
+
   VkWriteDescriptorSet vk_write_descriptor = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
   vk_write_descriptor.dstSet            = m_create_info.vk_object;
   vk_write_descriptor.dstBinding        = binding;
@@ -144,6 +147,8 @@ void CDescriptorSet::UpdateDescriptors(uint32_t binding, VkDescriptorType descri
 
 void CDescriptorSet::UpdateDescriptors(uint32_t binding, VkDescriptorType descriptor_type, uint32_t array_element, uint32_t count, const VkDescriptorImageInfo* p_infos)
 {
+  vkex::FlightScope flight_scope("descriptor", "update descriptors", count);
+
   VkWriteDescriptorSet vk_write_descriptor = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
   vk_write_descriptor.dstSet            = m_create_info.vk_object;
   vk_write_descriptor.dstBinding        = binding;
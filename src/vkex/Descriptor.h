@@ -294,7 +294,7 @@ private:
   VkDescriptorPoolCreateInfo                    m_vk_create_info = {};
   std::vector<VkDescriptorPoolSize>             m_vk_descriptor_pool_sizes;
   VkDescriptorPool                              m_vk_object = VK_NULL_HANDLE;
-  std::vector<std::unique_ptr<CDescriptorSet>>  m_stored_descriptor_sets;
+  ObjectStorage<CDescriptorSet>                 m_stored_descriptor_sets;
 };
 
 } // namespace vkex
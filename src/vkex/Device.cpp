@@ -15,6 +15,7 @@
 */
 
 #include "vkex/Device.h"
+#include "vkex/FlightRecorder.h"
 #include "vkex/Instance.h"
 #include "vkex/Log.h"
 
@@ -49,10 +50,15 @@ vkex::Result CPhysicalDevice::InternalCreate(
 
   // Properties
   {
+    // Subgroup properties are core in Vulkan 1.1, which vkex requires. The
+    // chain is cut afterwards so the stored properties don't point into it.
+    m_vk_subgroup_properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES };
     m_vk_physical_device_properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+    m_vk_physical_device_properties.pNext = &m_vk_subgroup_properties;
     vkex::GetPhysicalDeviceProperties2(
       m_create_info.vk_object,
       &m_vk_physical_device_properties);
+    m_vk_physical_device_properties.pNext = nullptr;
   }
 
   // Descriptive name
@@ -87,6 +93,86 @@ vkex::Result CPhysicalDevice::InternalDestroy(const VkAllocationCallbacks* p_all
   return vkex::Result::Success;
 }
 
+VkDeviceSize CPhysicalDevice::GetDirectUploadHeapSize() const
+{
+  const VkMemoryPropertyFlags direct_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+  const VkPhysicalDeviceMemoryProperties& properties = GetPhysicalDeviceMemoryProperties();
+  VkDeviceSize heap_size = 0;
+  for (uint32_t type_index = 0; type_index < properties.memoryTypeCount; ++type_index) {
+    const VkMemoryType& memory_type = properties.memoryTypes[type_index];
+    if ((memory_type.propertyFlags & direct_flags) == direct_flags) {
+      heap_size = std::max(heap_size, properties.memoryHeaps[memory_type.heapIndex].size);
+    }
+  }
+  return heap_size;
+}
+
+bool CPhysicalDevice::SupportsDirectUpload() const
+{
+  VkDeviceSize direct_heap_size = GetDirectUploadHeapSize();
+  if (direct_heap_size == 0) {
+    return false;
+  }
+
+  const VkPhysicalDeviceMemoryProperties& properties = GetPhysicalDeviceMemoryProperties();
+  VkDeviceSize device_local_heap_size = 0;
+  for (uint32_t heap_index = 0; heap_index < properties.memoryHeapCount; ++heap_index) {
+    const VkMemoryHeap& heap = properties.memoryHeaps[heap_index];
+    if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0) {
+      device_local_heap_size = std::max(device_local_heap_size, heap.size);
+    }
+  }
+  return direct_heap_size >= device_local_heap_size;
+}
+
+bool CPhysicalDevice::IsUnifiedMemory() const
+{
+  const VkPhysicalDeviceType device_type = GetPhysicalDeviceProperties().properties.deviceType;
+  bool is_unified = (device_type == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) ||
+                    (device_type == VK_PHYSICAL_DEVICE_TYPE_CPU);
+  return is_unified;
+}
+
+VkFormatFeatureFlags CPhysicalDevice::GetLinearTilingFeatures(VkFormat format) const
+{
+  VkFormatProperties2 vk_format_properties = { VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2 };
+  vkex::GetPhysicalDeviceFormatProperties2(
+    m_create_info.vk_object,
+    format,
+    &vk_format_properties);
+  return vk_format_properties.formatProperties.linearTilingFeatures;
+}
+
+bool CPhysicalDevice::IsImageFormatSupported(
+  VkFormat            format,
+  VkImageType         image_type,
+  VkImageTiling       tiling,
+  VkImageUsageFlags   usage,
+  const VkExtent3D&   extent,
+  uint32_t            mip_levels
+) const
+{
+  VkImageFormatProperties properties = {};
+  VkResult vk_result = vkex::GetPhysicalDeviceImageFormatProperties(
+    m_create_info.vk_object,
+    format,
+    image_type,
+    tiling,
+    usage,
+    0,
+    &properties);
+  if (vk_result != VK_SUCCESS) {
+    return false;
+  }
+
+  bool supported = (extent.width <= properties.maxExtent.width) &&
+                   (extent.height <= properties.maxExtent.height) &&
+                   (extent.depth <= properties.maxExtent.depth) &&
+                   (mip_levels <= properties.maxMipLevels);
+  return supported;
+}
+
 void CPhysicalDevice::InitializeVendorProperties()
 {
   //
@@ -544,6 +630,9 @@ vkex::Result CDevice::InternalCreate(
   // Copy create info
   m_create_info = create_info;
 
+  // Child objects created without explicit callbacks use the device's
+  m_allocation_callbacks = p_allocator;
+
   // Check Vulkan API version number - VKEX requires at least Vulkan 1.1
   {
     uint32_t api_version = m_create_info.physical_device->GetApiVersion();
@@ -581,6 +670,8 @@ vkex::Result CDevice::InternalCreate(
     m_create_info.enabled_features.pipelineStatisticsQuery  = VK_TRUE;
     m_create_info.enabled_features.samplerAnisotropy        = VK_TRUE;
     m_create_info.enabled_features.sampleRateShading        = VK_TRUE;
+    m_create_info.enabled_features.multiDrawIndirect        = VK_TRUE;
+    m_create_info.enabled_features.drawIndirectFirstInstance = VK_TRUE;
 
     InitializeExtensionFeatures();
   }
@@ -686,6 +777,7 @@ vkex::Result CDevice::InternalCreate(
     VmaAllocatorCreateInfo vma_allocator_create_info = {};
     vma_allocator_create_info.physicalDevice = *m_create_info.physical_device;
     vma_allocator_create_info.device = m_vk_object;
+    vma_allocator_create_info.pAllocationCallbacks = m_allocation_callbacks;
 
     VkResult vk_result = InvalidValue<VkResult>::Value;
     VKEX_VULKAN_RESULT_CALL(
@@ -754,6 +846,9 @@ vkex::Result CDevice::DestroyAllStoredObjects(const VkAllocationCallbacks* p_all
 
 vkex::Result CDevice::InternalDestroy(const VkAllocationCallbacks* p_allocator)
 {
+  // Must match the callbacks the device was created with
+  p_allocator = ResolveAllocationCallbacks(p_allocator);
+
   // Wait for device idle
   {
     VkResult vk_result = InvalidValue<VkResult>::Value;
@@ -795,11 +890,8 @@ vkex::Result CDevice::GetQueue(
   vkex::Queue*    p_queue
 ) const
 {
-  auto it = FindIf(
-    m_stored_queues,
-    [queue_type, queue_family_index, queue_index](const std::unique_ptr<CQueue>& elem) -> bool {
-        // There should never be a null IQueue object
-        VKEX_ASSERT_MSG(elem, "Null IQueue object encountered!");
+  vkex::Queue queue = m_stored_queues.FindIf(
+    [queue_type, queue_family_index, queue_index](const CQueue* elem) -> bool {
         auto& elem_supported_queue_flags = elem->GetSupportedQueueFlags();
         uint32_t elem_queue_family_index = elem->GetVkQueueFamilyIndex();
         uint32_t elem_queue_index   = elem->GetVkQueueIndex();
@@ -810,12 +902,12 @@ vkex::Result CDevice::GetQueue(
         return found;
     });
 
-  bool found = (it != std::end(m_stored_queues));
+  bool found = (queue != nullptr);
   if (!found) {
     return vkex::Result::ErrorSupportedQueueSlotNotFound;
   }
 
-  *p_queue = (*it).get();
+  *p_queue = queue;
 
   return vkex::Result::Success;
 }
@@ -837,7 +929,7 @@ vkex::Result CDevice::CreateBuffer(
 {
   vkex::Result vkex_result = CreateObject<CBuffer>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_buffers,
     &CBuffer::SetDevice,
     this,
@@ -858,7 +950,7 @@ vkex::Result CDevice::DestroyBuffer(
   vkex::Result vkex_result = DestroyObject<CBuffer>(
     m_stored_buffers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -875,7 +967,7 @@ vkex::Result CDevice::CreateCommandPool(
 {
   vkex::Result vkex_result = CreateObject<CCommandPool>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_command_pools,
     &CCommandPool::SetDevice,
     this,
@@ -896,7 +988,7 @@ vkex::Result CDevice::DestroyCommandPool(
   vkex::Result vkex_result = DestroyObject<CCommandPool>(
     m_stored_command_pools,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -911,9 +1003,11 @@ vkex::Result CDevice::CreateComputePipeline(
   const VkAllocationCallbacks*            p_allocator
 )
 {
+  vkex::FlightScope flight_scope("pipeline", "create compute pipeline");
+
   vkex::Result vkex_result = CreateObject<CComputePipeline>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_compute_pipelines,
     &CComputePipeline::SetDevice,
     this,
@@ -934,7 +1028,7 @@ vkex::Result CDevice::DestroyComputePipeline(
   vkex::Result vkex_result = DestroyObject<CComputePipeline>(
     m_stored_compute_pipelines,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -955,7 +1049,7 @@ vkex::Result CDevice::CreateConstantBuffer(
 
   vkex::Result vkex_result = CreateObject<CBuffer>(
     use_create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_buffers,
     &CBuffer::SetDevice,
     this,
@@ -976,7 +1070,7 @@ vkex::Result CDevice::DestroyConstantBuffer(
   vkex::Result vkex_result = DestroyObject<CBuffer>(
     m_stored_buffers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -993,7 +1087,7 @@ vkex::Result CDevice::CreateDepthStencilView(
 {
   vkex::Result vkex_result = CreateObject<CDepthStencilView>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_depth_stencil_views,
     &CDepthStencilView::SetDevice,
     this,
@@ -1014,7 +1108,7 @@ vkex::Result CDevice::DestroyDepthStencilView(
   vkex::Result vkex_result = DestroyObject<CDepthStencilView>(
     m_stored_depth_stencil_views,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1031,7 +1125,7 @@ vkex::Result CDevice::CreateDescriptorSetLayout(
 {
   vkex::Result vkex_result = CreateObject<CDescriptorSetLayout>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_descriptor_set_layouts,
     &CDescriptorSetLayout::SetDevice,
     this,
@@ -1052,7 +1146,7 @@ vkex::Result CDevice::DestroyDescriptorSetLayout(
   vkex::Result vkex_result = DestroyObject<CDescriptorSetLayout>(
     m_stored_descriptor_set_layouts,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1123,7 +1217,7 @@ vkex::Result CDevice::CreateDescriptorPool(
 {
   vkex::Result vkex_result = CreateObject<CDescriptorPool>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_descriptor_pools,
     &CDescriptorPool::SetDevice,
     this,
@@ -1144,7 +1238,7 @@ vkex::Result CDevice::DestroyDescriptorPool(
   vkex::Result vkex_result = DestroyObject<CDescriptorPool>(
     m_stored_descriptor_pools,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1161,7 +1255,7 @@ vkex::Result CDevice::CreateFence(
 {
   vkex::Result vkex_result = CreateObject<CFence>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_fences,
     &CFence::SetDevice,
     this,
@@ -1182,7 +1276,7 @@ vkex::Result CDevice::DestroyFence(
   vkex::Result vkex_result = DestroyObject<CFence>(
     m_stored_fences,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1197,9 +1291,11 @@ vkex::Result CDevice::CreateGraphicsPipeline(
   const VkAllocationCallbacks*            p_allocator
 )
 {
+  vkex::FlightScope flight_scope("pipeline", "create graphics pipeline");
+
   vkex::Result vkex_result = CreateObject<CGraphicsPipeline>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_graphics_pipelines,
     &CGraphicsPipeline::SetDevice,
     this,
@@ -1221,7 +1317,7 @@ vkex::Result CDevice::DestroyGraphicsPipeline(
   vkex::Result vkex_result = DestroyObject<CGraphicsPipeline>(
     m_stored_graphics_pipelines,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1238,7 +1334,7 @@ vkex::Result CDevice::CreateImage(
 {
   vkex::Result vkex_result = CreateObject<CImage>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_images,
     &CImage::SetDevice,
     this,
@@ -1260,7 +1356,7 @@ vkex::Result CDevice::DestroyImage(
   vkex::Result vkex_result = DestroyObject<CImage>(
     m_stored_images,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1277,7 +1373,7 @@ vkex::Result CDevice::CreateImageView(
 {
   vkex::Result vkex_result = CreateObject<CImageView>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_image_views,
     &CImageView::SetDevice,
     this,
@@ -1299,7 +1395,7 @@ vkex::Result CDevice::DestroyImageView(
   vkex::Result vkex_result = DestroyObject<CImageView>(
     m_stored_image_views,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1320,7 +1416,7 @@ vkex::Result CDevice::CreateIndexBuffer(
 
   vkex::Result vkex_result = CreateObject<CBuffer>(
     use_create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_buffers,
     &CBuffer::SetDevice,
     this,
@@ -1341,7 +1437,7 @@ vkex::Result CDevice::DestroyIndexBuffer(
   vkex::Result vkex_result = DestroyObject<CBuffer>(
     m_stored_buffers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1362,7 +1458,7 @@ vkex::Result CDevice::CreateIndirectBuffer(
 
   vkex::Result vkex_result = CreateObject<CBuffer>(
     use_create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_buffers,
     &CBuffer::SetDevice,
     this,
@@ -1383,7 +1479,7 @@ vkex::Result CDevice::DestroyIndirectBuffer(
   vkex::Result vkex_result = DestroyObject<CBuffer>(
     m_stored_buffers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1400,7 +1496,7 @@ vkex::Result CDevice::CreatePipelineCache(
 {
   vkex::Result vkex_result = CreateObject<CPipelineCache>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_pipeline_caches,
     &CPipelineCache::SetDevice,
     this,
@@ -1421,7 +1517,7 @@ vkex::Result CDevice::DestroyPipelineCache(
   vkex::Result vkex_result = DestroyObject<CPipelineCache>(
     m_stored_pipeline_caches,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1438,7 +1534,7 @@ vkex::Result CDevice::CreatePipelineLayout(
 {
   vkex::Result vkex_result = CreateObject<CPipelineLayout>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_pipeline_layouts,
     &CPipelineLayout::SetDevice,
     this,
@@ -1459,7 +1555,7 @@ vkex::Result CDevice::DestroyPipelineLayout(
   vkex::Result vkex_result = DestroyObject<CPipelineLayout>(
     m_stored_pipeline_layouts,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1476,7 +1572,7 @@ vkex::Result CDevice::CreateQueryPool(
 {
   vkex::Result vkex_result = CreateObject<CQueryPool>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_query_pools,
     &CQueryPool::SetDevice,
     this,
@@ -1497,7 +1593,7 @@ vkex::Result CDevice::DestroyQueryPool(
   vkex::Result vkex_result = DestroyObject<CQueryPool>(
     m_stored_query_pools,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1514,7 +1610,7 @@ vkex::Result CDevice::CreateRenderPass(
 {
   vkex::Result vkex_result = CreateObject<CRenderPass>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_render_passes,
     &CRenderPass::SetDevice,
     this,
@@ -1535,7 +1631,7 @@ vkex::Result CDevice::DestroyRenderPass(
   vkex::Result vkex_result = DestroyObject<CRenderPass>(
     m_stored_render_passes,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1552,7 +1648,7 @@ vkex::Result CDevice::CreateRenderTargetView(
 {
   vkex::Result vkex_result = CreateObject<CRenderTargetView>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_render_target_views,
     &CRenderTargetView::SetDevice,
     this,
@@ -1573,7 +1669,7 @@ vkex::Result CDevice::DestroyRenderTargetView(
   vkex::Result vkex_result = DestroyObject<CRenderTargetView>(
     m_stored_render_target_views,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1590,7 +1686,7 @@ vkex::Result CDevice::CreateSampler(
 {
   vkex::Result vkex_result = CreateObject<CSampler>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_samplers,
     &CSampler::SetDevice,
     this,
@@ -1611,7 +1707,7 @@ vkex::Result CDevice::DestroySampler(
   vkex::Result vkex_result = DestroyObject<CSampler>(
     m_stored_samplers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1628,7 +1724,7 @@ vkex::Result CDevice::CreateSemaphore(
 {
   vkex::Result vkex_result = CreateObject<CSemaphore>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_semaphores,
     &CSemaphore::SetDevice,
     this,
@@ -1649,7 +1745,7 @@ vkex::Result CDevice::DestroySemaphore(
   vkex::Result vkex_result = DestroyObject<CSemaphore>(
     m_stored_semaphores,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1666,7 +1762,7 @@ vkex::Result CDevice::CreateShaderModule(
 {
   vkex::Result vkex_result = CreateObject<CShaderModule>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_shader_modules,
     &CShaderModule::SetDevice,
     this,
@@ -1687,7 +1783,7 @@ vkex::Result CDevice::DestroyShaderModule(
   vkex::Result vkex_result = DestroyObject<CShaderModule>(
     m_stored_shader_modules,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1704,7 +1800,7 @@ vkex::Result CDevice::CreateShaderProgram(
 {
   vkex::Result vkex_result = CreateObject<CShaderProgram>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_shader_programs,
     &CShaderProgram::SetDevice,
     this,
@@ -1725,7 +1821,7 @@ vkex::Result CDevice::DestroyShaderProgram(
   vkex::Result vkex_result = DestroyObject<CShaderProgram>(
     m_stored_shader_programs,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1746,7 +1842,7 @@ vkex::Result CDevice::CreateStorageBuffer(
 
   vkex::Result vkex_result = CreateObject<CBuffer>(
     use_create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_buffers,
     &CBuffer::SetDevice,
     this,
@@ -1767,7 +1863,7 @@ vkex::Result CDevice::DestroyStorageBuffer(
   vkex::Result vkex_result = DestroyObject<CBuffer>(
     m_stored_buffers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1784,7 +1880,7 @@ vkex::Result CDevice::CreateSwapchain(
 {
   vkex::Result vkex_result = CreateObject<CSwapchain>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_swapchains,
     &CSwapchain::SetDevice,
     this,
@@ -1805,7 +1901,7 @@ vkex::Result CDevice::DestroySwapchain(
   vkex::Result vkex_result = DestroyObject<CSwapchain>(
     m_stored_swapchains,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1822,7 +1918,7 @@ vkex::Result CDevice::CreateTexture(
 {
   vkex::Result vkex_result = CreateObject<CTexture>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_textures,
     &CTexture::SetDevice,
     this,
@@ -1843,7 +1939,7 @@ vkex::Result CDevice::DestroyTexture(
   vkex::Result vkex_result = DestroyObject<CTexture>(
     m_stored_textures,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -1864,7 +1960,7 @@ vkex::Result CDevice::CreateVertexBuffer(
 
   vkex::Result vkex_result = CreateObject<CBuffer>(
     use_create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_buffers,
     &CBuffer::SetDevice,
     this,
@@ -1885,7 +1981,7 @@ vkex::Result CDevice::DestroyVertexBuffer(
   vkex::Result vkex_result = DestroyObject<CBuffer>(
     m_stored_buffers,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
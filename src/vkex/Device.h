@@ -123,6 +123,13 @@ public:
     return m_extension_owned_properties.sample_locations_properties;
   }
 
+  /** @fn GetSubgroupProperties
+   *
+   */
+  const VkPhysicalDeviceSubgroupProperties& GetSubgroupProperties() const {
+    return m_vk_subgroup_properties;
+  }
+
   /** @fn GetVkPhysicalDeviceLimits
    *
    */
@@ -186,6 +193,47 @@ public:
   const VkPhysicalDeviceMemoryProperties& GetPhysicalDeviceMemoryProperties() const {
     return m_vk_physical_device_memory_properties.memoryProperties;
   }
+
+  /** @fn GetDirectUploadHeapSize
+   *
+   * Size of the largest heap backing a DEVICE_LOCAL | HOST_VISIBLE memory
+   * type, 0 if there is none.
+   */
+  VkDeviceSize GetDirectUploadHeapSize() const;
+
+  /** @fn SupportsDirectUpload
+   *
+   * True when all of device local memory is also host visible: integrated
+   * GPUs, CPU drivers and discrete GPUs with resizable BAR. Resources can then
+   * be written in place instead of through a staging buffer. A 256 MiB BAR
+   * window next to a larger VRAM heap does not count.
+   */
+  bool SupportsDirectUpload() const;
+
+  /** @fn IsUnifiedMemory
+   *
+   * True for integrated GPUs and CPU drivers, where device local memory is
+   * system memory. Resizable BAR on a discrete GPU does not count: its
+   * memory is host visible, but it is still VRAM across the bus.
+   */
+  bool IsUnifiedMemory() const;
+
+  /** @fn GetLinearTilingFeatures
+   *
+   */
+  VkFormatFeatureFlags GetLinearTilingFeatures(VkFormat format) const;
+
+  /** @fn IsImageFormatSupported
+   *
+   */
+  bool IsImageFormatSupported(
+    VkFormat            format,
+    VkImageType         image_type,
+    VkImageTiling       tiling,
+    VkImageUsageFlags   usage,
+    const VkExtent3D&   extent,
+    uint32_t            mip_levels
+  ) const;
   
   /** @fn SupportsPresent
    *
@@ -235,6 +283,7 @@ private:
   vkex::Instance                              m_instance = nullptr;
   PhysicalDeviceCreateInfo                    m_create_info = {};
   VkPhysicalDeviceProperties2                 m_vk_physical_device_properties = {};
+  VkPhysicalDeviceSubgroupProperties          m_vk_subgroup_properties = {};
   VkPhysicalDeviceFeatures2                   m_vk_physical_device_features = {};
   std::vector<VkQueueFamilyProperties2>       m_vk_queue_family_properties;
   VkPhysicalDeviceMemoryProperties2           m_vk_physical_device_memory_properties = {};
@@ -346,6 +395,13 @@ public:
     return m_vma_allocator;
   }
 
+  /** @fn GetAllocationCallbacks
+   *
+   */
+  const VkAllocationCallbacks* GetAllocationCallbacks() const {
+    return m_allocation_callbacks;
+  }
+
   /** @fn GetQueue
    * 
    */
@@ -869,6 +925,15 @@ private:
     const VkAllocationCallbacks*  p_allocator
   );
 
+  /** @fn ResolveAllocationCallbacks
+   *
+   * Objects created or destroyed without explicit callbacks use the ones
+   * the device was created with.
+   */
+  const VkAllocationCallbacks* ResolveAllocationCallbacks(const VkAllocationCallbacks* p_allocator) const {
+    return (p_allocator != nullptr) ? p_allocator : m_allocation_callbacks;
+  }
+
   /** @fn DestroyAllObjects
    *
    */
@@ -895,30 +960,31 @@ private:
   VkDeviceCreateInfo                    m_vk_create_info = {};
   VkDevice                              m_vk_object = VK_NULL_HANDLE;
   VmaAllocator                          m_vma_allocator = VK_NULL_HANDLE;
-
-  std::vector<std::unique_ptr<CBuffer>>               m_stored_buffers;
-  std::vector<std::unique_ptr<CCommandPool>>          m_stored_command_pools;
-  std::vector<std::unique_ptr<CComputePipeline>>      m_stored_compute_pipelines;
-  std::vector<std::unique_ptr<CDepthStencilView>>     m_stored_depth_stencil_views;
-  std::vector<std::unique_ptr<CDescriptorPool>>       m_stored_descriptor_pools;
-  std::vector<std::unique_ptr<CDescriptorSetLayout>>  m_stored_descriptor_set_layouts;
-  std::vector<std::unique_ptr<CEvent>>                m_stored_events;
-  std::vector<std::unique_ptr<CFence>>                m_stored_fences;
-  std::vector<std::unique_ptr<CGraphicsPipeline>>     m_stored_graphics_pipelines;
-  std::vector<std::unique_ptr<CImage>>                m_stored_images;
-  std::vector<std::unique_ptr<CImageView>>            m_stored_image_views;
-  std::vector<std::unique_ptr<CPipelineCache>>        m_stored_pipeline_caches;
-  std::vector<std::unique_ptr<CPipelineLayout>>       m_stored_pipeline_layouts;
-  std::vector<std::unique_ptr<CQueryPool>>            m_stored_query_pools;
-  std::vector<std::unique_ptr<CQueue>>                m_stored_queues;
-  std::vector<std::unique_ptr<CRenderPass>>           m_stored_render_passes;
-  std::vector<std::unique_ptr<CRenderTargetView>>     m_stored_render_target_views;
-  std::vector<std::unique_ptr<CSampler>>              m_stored_samplers;
-  std::vector<std::unique_ptr<CSemaphore>>            m_stored_semaphores;
-  std::vector<std::unique_ptr<CShaderModule>>         m_stored_shader_modules;
-  std::vector<std::unique_ptr<CShaderProgram>>        m_stored_shader_programs;
-  std::vector<std::unique_ptr<CSwapchain>>            m_stored_swapchains;
-  std::vector<std::unique_ptr<CTexture>>              m_stored_textures;
+  const VkAllocationCallbacks*          m_allocation_callbacks = nullptr;
+
+  ObjectStorage<CBuffer>                              m_stored_buffers;
+  ObjectStorage<CCommandPool>                         m_stored_command_pools;
+  ObjectStorage<CComputePipeline>                     m_stored_compute_pipelines;
+  ObjectStorage<CDepthStencilView>                    m_stored_depth_stencil_views;
+  ObjectStorage<CDescriptorPool>                      m_stored_descriptor_pools;
+  ObjectStorage<CDescriptorSetLayout>                 m_stored_descriptor_set_layouts;
+  ObjectStorage<CEvent>                               m_stored_events;
+  ObjectStorage<CFence>                               m_stored_fences;
+  ObjectStorage<CGraphicsPipeline>                    m_stored_graphics_pipelines;
+  ObjectStorage<CImage>                               m_stored_images;
+  ObjectStorage<CImageView>                           m_stored_image_views;
+  ObjectStorage<CPipelineCache>                       m_stored_pipeline_caches;
+  ObjectStorage<CPipelineLayout>                      m_stored_pipeline_layouts;
+  ObjectStorage<CQueryPool>                           m_stored_query_pools;
+  ObjectStorage<CQueue>                               m_stored_queues;
+  ObjectStorage<CRenderPass>                          m_stored_render_passes;
+  ObjectStorage<CRenderTargetView>                    m_stored_render_target_views;
+  ObjectStorage<CSampler>                             m_stored_samplers;
+  ObjectStorage<CSemaphore>                           m_stored_semaphores;
+  ObjectStorage<CShaderModule>                        m_stored_shader_modules;
+  ObjectStorage<CShaderProgram>                       m_stored_shader_programs;
+  ObjectStorage<CSwapchain>                           m_stored_swapchains;
+  ObjectStorage<CTexture>                             m_stored_textures;
 };
 
 } // namespace vkex
@@ -29,6 +29,8 @@
 #include <vector>
 
 #if defined(__linux__)
+ #include <fcntl.h>
+ #include <sys/mman.h>
  #include <sys/types.h>
  #include <sys/stat.h>
  #include <unistd.h>
@@ -375,6 +377,81 @@ inline std::vector<uint8_t> load_file(const fs::path& p)
   return data;
 }
 
+/*! @class mapped_file
+
+   Read-only view of a whole file. The file is memory mapped where the
+   platform supports it so its pages come straight from the page cache,
+   otherwise it is loaded into memory with load_file.
+
+ */
+class mapped_file {
+public:
+  mapped_file() {}
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  ~mapped_file() {
+    close();
+  }
+
+  bool open(const fs::path& p) {
+    close();
+#if defined(__linux__)
+    int fd = ::open(p.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info = {};
+    if ((0 != fstat(fd, &info)) || (info.st_size <= 0)) {
+      ::close(fd);
+      return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* p_mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file
+    ::close(fd);
+    if (p_mapped == MAP_FAILED) {
+      return false;
+    }
+    m_data = static_cast<const uint8_t*>(p_mapped);
+    m_size = size;
+    m_mapped = true;
+#else
+    m_fallback = load_file(p);
+    if (m_fallback.empty()) {
+      return false;
+    }
+    m_data = m_fallback.data();
+    m_size = m_fallback.size();
+#endif
+    return true;
+  }
+
+  void close() {
+#if defined(__linux__)
+    if (m_mapped) {
+      munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    std::vector<uint8_t>().swap(m_fallback);
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+  }
+
+  bool            is_open() const { return m_data != nullptr; }
+  bool            is_mapped() const { return m_mapped; }
+  const uint8_t*  data() const { return m_data; }
+  size_t          size() const { return m_size; }
+
+private:
+  const uint8_t*        m_data = nullptr;
+  size_t                m_size = 0;
+  bool                  m_mapped = false;
+  std::vector<uint8_t>  m_fallback;
+};
+
 } // namespace fs
 } // namespace vkex
 
@@ -0,0 +1,222 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/FlightRecorder.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace vkex {
+
+// One recorder per process, so one ring per thread
+static thread_local void* s_thread_ring = nullptr;
+
+static void WriteJsonString(std::ostream& os, const char* str)
+{
+  os << '"';
+  for (const char* c = str; *c != '\0'; ++c) {
+    if ((*c == '"') || (*c == '\\')) {
+      os << '\\';
+    }
+    os << *c;
+  }
+  os << '"';
+}
+
+// =================================================================================================
+// FlightRecorder
+// =================================================================================================
+FlightRecorder::FlightRecorder()
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+  WaitForDump();
+}
+
+vkex::FlightRecorder& FlightRecorder::Get()
+{
+  static FlightRecorder s_recorder;
+  return s_recorder;
+}
+
+FlightRecorder::ThreadRing* FlightRecorder::GetThreadRing()
+{
+  ThreadRing* p_ring = static_cast<ThreadRing*>(s_thread_ring);
+  if (p_ring == nullptr) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto ring = std::make_unique<ThreadRing>();
+    ring->thread_index = static_cast<uint32_t>(m_rings.size());
+    p_ring = ring.get();
+    m_rings.push_back(std::move(ring));
+    s_thread_ring = p_ring;
+  }
+  return p_ring;
+}
+
+void FlightRecorder::Record(const char* category, const char* name, uint64_t begin, uint64_t end, uint64_t arg)
+{
+  ThreadRing* p_ring = GetThreadRing();
+
+  // Only this thread writes the ring, the sequence is what readers trust
+  const uint64_t index = p_ring->head.load(std::memory_order_relaxed);
+  Slot& slot = p_ring->slots[index % kThreadEventCount];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.category.store(category, std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin.store(begin, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  slot.arg.store(arg, std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+  p_ring->head.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::SetThreadName(const std::string& name)
+{
+  ThreadRing* p_ring = GetThreadRing();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  p_ring->name = name;
+}
+
+void FlightRecorder::Snapshot(uint64_t begin, uint64_t end, std::vector<vkex::FlightEvent>* p_events, std::vector<std::string>* p_thread_names) const
+{
+  p_events->clear();
+  p_thread_names->clear();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& ring : m_rings) {
+    p_thread_names->push_back(ring->name);
+
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t count = std::min<uint64_t>(head, kThreadEventCount);
+    for (uint64_t index = head - count; index < head; ++index) {
+      const Slot& slot = ring->slots[index % kThreadEventCount];
+      const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence != (index + 1)) {
+        continue;
+      }
+
+      vkex::FlightEvent event = {};
+      event.category      = slot.category.load(std::memory_order_relaxed);
+      event.name          = slot.name.load(std::memory_order_relaxed);
+      event.begin         = slot.begin.load(std::memory_order_relaxed);
+      event.end           = slot.end.load(std::memory_order_relaxed);
+      event.arg           = slot.arg.load(std::memory_order_relaxed);
+      event.thread_index  = ring->thread_index;
+
+      // Overwritten while it was copied
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        continue;
+      }
+
+      if ((event.end >= begin) && (event.end <= end)) {
+        p_events->push_back(event);
+      }
+    }
+  }
+
+  std::sort(
+    p_events->begin(),
+    p_events->end(),
+    [](const vkex::FlightEvent& a, const vkex::FlightEvent& b) -> bool {
+      return a.begin < b.begin;
+    });
+}
+
+bool FlightRecorder::DumpAsync(const fs::path& file_path, uint64_t end, double seconds)
+{
+  if (m_dump_busy.exchange(true)) {
+    return false;
+  }
+  if (m_dump_thread.joinable()) {
+    m_dump_thread.join();
+  }
+
+  const uint64_t span = static_cast<uint64_t>(seconds * VKEX_TIMER_SECONDS_TO_NANOS);
+  const uint64_t begin = (end > span) ? (end - span) : 0;
+
+  // The rings hold more than a dump covers, so the copy can wait for the
+  // thread too
+  m_dump_thread = std::thread([this, file_path, begin, end]() {
+    std::vector<vkex::FlightEvent> events;
+    std::vector<std::string> thread_names;
+    Snapshot(begin, end, &events, &thread_names);
+    vkex::Result vkex_result = WriteChromeTrace(file_path, events, thread_names);
+    if (!vkex_result) {
+      VKEX_LOG_WARN("Couldn't write flight recorder dump " << file_path);
+    }
+    m_dump_busy.store(false);
+  });
+
+  return true;
+}
+
+void FlightRecorder::WaitForDump()
+{
+  if (m_dump_thread.joinable()) {
+    m_dump_thread.join();
+  }
+}
+
+vkex::Result FlightRecorder::WriteChromeTrace(const fs::path& file_path, const std::vector<vkex::FlightEvent>& events, const std::vector<std::string>& thread_names)
+{
+  std::ofstream file(file_path.c_str());
+  if (!file.is_open()) {
+    return vkex::Result::ErrorFailed;
+  }
+
+  const uint64_t origin = events.empty() ? 0 : events.front().begin;
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (uint32_t i = 0; i < static_cast<uint32_t>(thread_names.size()); ++i) {
+    if (thread_names[i].empty()) {
+      continue;
+    }
+    file << (first ? "" : ",\n");
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+    WriteJsonString(file, thread_names[i].c_str());
+    file << "}}";
+    first = false;
+  }
+
+  file << std::fixed << std::setprecision(3);
+  for (auto& event : events) {
+    const double ts = static_cast<double>(event.begin - origin) * VKEX_TIMER_NANOS_TO_MICROS;
+    const double dur = static_cast<double>(event.end - event.begin) * VKEX_TIMER_NANOS_TO_MICROS;
+    file << (first ? "" : ",\n");
+    file << "{\"name\":";
+    WriteJsonString(file, event.name);
+    file << ",\"cat\":";
+    WriteJsonString(file, event.category);
+    file << ",\"ph\":\"X\",\"ts\":" << ts << ",\"dur\":" << dur;
+    file << ",\"pid\":1,\"tid\":" << event.thread_index;
+    file << ",\"args\":{\"value\":" << event.arg << "}}";
+    first = false;
+  }
+  file << "\n]}\n";
+
+  if (!file.good()) {
+    return vkex::Result::ErrorFailed;
+  }
+  return vkex::Result::Success;
+}
+
+} // namespace vkex
@@ -0,0 +1,156 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_FLIGHT_RECORDER_H__
+#define __VKEX_FLIGHT_RECORDER_H__
+
+#include "vkex/Config.h"
+#include "vkex/FileSystem.h"
+#include "vkex/Timer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace vkex {
+
+/** @struct FlightEvent
+ *
+ * 'begin' and 'end' are vkex::Timer timestamps.
+ */
+struct FlightEvent {
+  const char* category;
+  const char* name;
+  uint64_t    begin;
+  uint64_t    end;
+  uint64_t    arg;
+  uint32_t    thread_index;
+};
+
+/** @class FlightRecorder
+ *
+ * Always on record of what the process did over the last few seconds, to
+ * be dumped when a frame hitches. Every thread that records gets its own
+ * ring of kThreadEventCount events, so recording is a handful of relaxed
+ * stores with no locks and no allocation after the thread's first event.
+ * Rings are kept for the life of the process, so record from long lived
+ * threads only.
+ *
+ * Each slot carries a sequence number written last, so a dump reading the
+ * rings while they're written skips the slots it catches half written
+ * instead of stopping the writers.
+ */
+class FlightRecorder {
+public:
+  enum { kThreadEventCount = 16384 };
+
+  static vkex::FlightRecorder& Get();
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  //! @fn Record
+  //!
+  //! 'category' and 'name' are kept as pointers, so they must be string
+  //! literals or otherwise outlive the recorder.
+  void          Record(const char* category, const char* name, uint64_t begin, uint64_t end, uint64_t arg = 0);
+
+  //! @fn SetThreadName
+  //!
+  //! Names the calling thread in dumps.
+  void          SetThreadName(const std::string& name);
+
+  //! @fn Snapshot
+  //!
+  //! Every event that ended in [begin, end], sorted by start.
+  void          Snapshot(uint64_t begin, uint64_t end, std::vector<vkex::FlightEvent>* p_events, std::vector<std::string>* p_thread_names) const;
+
+  //! @fn DumpAsync
+  //!
+  //! Writes the events that ended in the last 'seconds' before 'end' to
+  //! 'file_path' as Chrome trace event JSON, on a thread of its own so the
+  //! frame that triggered it doesn't hitch again. Returns false when the
+  //! previous dump is still being written.
+  bool          DumpAsync(const fs::path& file_path, uint64_t end, double seconds);
+
+  //! @fn WaitForDump
+  //!
+  void          WaitForDump();
+
+  //! @fn WriteChromeTrace
+  //!
+  //! Complete ("X") events with microsecond times from the first event,
+  //! one trace thread per recording thread. Opens in chrome://tracing and
+  //! Perfetto.
+  static vkex::Result WriteChromeTrace(const fs::path& file_path, const std::vector<vkex::FlightEvent>& events, const std::vector<std::string>& thread_names);
+
+private:
+  FlightRecorder();
+  ~FlightRecorder();
+
+  struct Slot {
+    // Event index + 1 once written, 0 while it's being written
+    std::atomic<uint64_t>     sequence{0};
+    std::atomic<const char*>  category{nullptr};
+    std::atomic<const char*>  name{nullptr};
+    std::atomic<uint64_t>     begin{0};
+    std::atomic<uint64_t>     end{0};
+    std::atomic<uint64_t>     arg{0};
+  };
+
+  struct ThreadRing {
+    uint32_t                  thread_index = 0;
+    std::string               name;
+    std::atomic<uint64_t>     head{0};
+    Slot                      slots[kThreadEventCount];
+  };
+
+  ThreadRing*   GetThreadRing();
+
+private:
+  mutable std::mutex                        m_mutex;
+  std::vector<std::unique_ptr<ThreadRing>>  m_rings;
+
+  std::thread                               m_dump_thread;
+  std::atomic<bool>                         m_dump_busy{false};
+};
+
+/** @class FlightScope
+ *
+ * Records an event covering its own lifetime.
+ */
+class FlightScope {
+public:
+  FlightScope(const char* category, const char* name, uint64_t arg = 0)
+    : m_category(category), m_name(name), m_arg(arg), m_begin(vkex::Timer::Timestamp()) {}
+  ~FlightScope() {
+    vkex::FlightRecorder::Get().Record(m_category, m_name, m_begin, vkex::Timer::Timestamp(), m_arg);
+  }
+
+  FlightScope(const FlightScope&) = delete;
+  FlightScope& operator=(const FlightScope&) = delete;
+
+private:
+  const char* m_category;
+  const char* m_name;
+  uint64_t    m_arg;
+  uint64_t    m_begin;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_FLIGHT_RECORDER_H__
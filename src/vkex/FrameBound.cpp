@@ -0,0 +1,470 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/FrameBound.h"
+#include "vkex/Device.h"
+#include "vkex/Timer.h"
+
+#include <algorithm>
+
+namespace vkex {
+
+// =================================================================================================
+// FrameBoundStats
+// =================================================================================================
+float FrameBoundStats::GetBoundPercent(vkex::FrameBound bound) const
+{
+  if (frame_count == 0) {
+    return 0.0f;
+  }
+  uint32_t count = bound_counts[static_cast<uint32_t>(bound)];
+  return 100.0f * static_cast<float>(count) / static_cast<float>(frame_count);
+}
+
+// =================================================================================================
+// FrameBoundClassifier
+// =================================================================================================
+FrameBoundClassifier::FrameBoundClassifier()
+{
+}
+
+FrameBoundClassifier::~FrameBoundClassifier()
+{
+  Destroy();
+}
+
+vkex::Result FrameBoundClassifier::Initialize(vkex::Device device, const vkex::FrameBoundClassifierCreateInfo& create_info)
+{
+  VKEX_ASSERT(!IsInitialized());
+  VKEX_ASSERT(create_info.queue != nullptr);
+  VKEX_ASSERT(create_info.window_frame_count > 0);
+
+  m_device = device;
+  m_gpu_bound_ratio = create_info.gpu_bound_ratio;
+
+  vkex::PhysicalDevice physical_device = m_device->GetPhysicalDevice();
+  const uint32_t queue_family_index = create_info.queue->GetVkQueueFamilyIndex();
+
+  uint32_t timestamp_valid_bits = 0;
+  {
+    VkQueueFamilyProperties2 properties = { VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2 };
+    if (physical_device->GetQueueFamilyProperties(queue_family_index, &properties)) {
+      timestamp_valid_bits = properties.queueFamilyProperties.timestampValidBits;
+    }
+  }
+
+  // Timestamps around each submit, skipped when the queue can't write them
+  if (timestamp_valid_bits > 0) {
+    m_timestamp_mask = (timestamp_valid_bits >= 64) ? UINT64_MAX : ((1ull << timestamp_valid_bits) - 1);
+    m_timestamp_period = static_cast<double>(physical_device->GetPhysicalDeviceLimits().timestampPeriod);
+
+    // Query pool
+    {
+      vkex::QueryPoolCreateInfo query_pool_create_info = {};
+      query_pool_create_info.query_type  = VK_QUERY_TYPE_TIMESTAMP;
+      query_pool_create_info.query_count = kFrameSubmitCount * 2;
+      vkex::Result vkex_result = vkex::Result::Undefined;
+      VKEX_RESULT_CALL(
+        vkex_result,
+        m_device->CreateQueryPool(query_pool_create_info, &m_query_pool)
+      );
+      if (!vkex_result) {
+        return vkex_result;
+      }
+    }
+
+    // Command pool
+    {
+      vkex::CommandPoolCreateInfo command_pool_create_info = {};
+      command_pool_create_info.queue_family_index = queue_family_index;
+      vkex::Result vkex_result = vkex::Result::Undefined;
+      VKEX_RESULT_CALL(
+        vkex_result,
+        m_device->CreateCommandPool(command_pool_create_info, &m_command_pool)
+      );
+      if (!vkex_result) {
+        return vkex_result;
+      }
+    }
+
+    // Command buffers, recorded once and submitted every frame
+    {
+      vkex::CommandBufferAllocateInfo command_buffer_allocate_info = {};
+      command_buffer_allocate_info.command_buffer_count = kFrameSubmitCount * 2;
+      vkex::Result vkex_result = vkex::Result::Undefined;
+      VKEX_RESULT_CALL(
+        vkex_result,
+        m_command_pool->AllocateCommandBuffers(command_buffer_allocate_info, &m_command_buffers)
+      );
+      if (!vkex_result) {
+        return vkex_result;
+      }
+
+      for (uint32_t submit = 0; submit < kFrameSubmitCount; ++submit) {
+        const uint32_t first_query = submit * 2;
+
+        vkex::CommandBuffer begin = m_command_buffers[first_query + 0];
+        begin->Begin(0);
+        begin->CmdResetQueryPool(m_query_pool, first_query, 2);
+        begin->CmdWriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, first_query + 0);
+        begin->End();
+
+        vkex::CommandBuffer end = m_command_buffers[first_query + 1];
+        end->Begin(0);
+        end->CmdWriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, first_query + 1);
+        end->End();
+      }
+    }
+  }
+
+  // Calibration needs the device domain and the domain vkex::Timer reads
+#if defined(VKEX_WIN32)
+  {
+    LARGE_INTEGER frequency = {};
+    QueryPerformanceFrequency(&frequency);
+    m_host_time_domain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+    m_host_nanos_per_count = 1.0e9 / static_cast<double>(frequency.QuadPart);
+  }
+#elif defined(VKEX_TIMER_FORCE_MONOTONIC)
+  m_host_time_domain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#else
+  m_host_time_domain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_RAW_EXT;
+#endif
+
+  m_calibrated = false;
+  std::string calibrated_timestamps_name = VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+  if ((m_query_pool != nullptr) &&
+      vkex::Contains(m_device->GetLoadedExtensions(), calibrated_timestamps_name) &&
+      (vkex::GetPhysicalDeviceCalibrateableTimeDomainsEXT != nullptr) &&
+      (vkex::GetCalibratedTimestampsEXT != nullptr))
+  {
+    uint32_t count = 0;
+    vkex::GetPhysicalDeviceCalibrateableTimeDomainsEXT(*physical_device, &count, nullptr);
+    std::vector<VkTimeDomainEXT> time_domains(count);
+    vkex::GetPhysicalDeviceCalibrateableTimeDomainsEXT(*physical_device, &count, DataPtr(time_domains));
+    m_calibrated = vkex::Contains(time_domains, VK_TIME_DOMAIN_DEVICE_EXT) &&
+                   vkex::Contains(time_domains, m_host_time_domain);
+  }
+  if (m_calibrated) {
+    Calibrate();
+  }
+
+  m_samples.resize(create_info.window_frame_count);
+  m_sample_index = 0;
+  m_sample_count = 0;
+  m_frames_since_calibration = 0;
+  m_frame_started = false;
+
+  return vkex::Result::Success;
+}
+
+vkex::Result FrameBoundClassifier::Destroy()
+{
+  if (!IsInitialized()) {
+    return vkex::Result::Success;
+  }
+
+  if (m_query_pool != nullptr) {
+    vkex::Result vkex_result = vkex::Result::Undefined;
+    VKEX_RESULT_CALL(
+      vkex_result,
+      m_device->DestroyQueryPool(m_query_pool)
+    );
+    if (!vkex_result) {
+      return vkex_result;
+    }
+    m_query_pool = nullptr;
+  }
+
+  m_command_buffers.clear();
+  if (m_command_pool != nullptr) {
+    vkex::Result vkex_result = vkex::Result::Undefined;
+    VKEX_RESULT_CALL(
+      vkex_result,
+      m_device->DestroyCommandPool(m_command_pool)
+    );
+    if (!vkex_result) {
+      return vkex_result;
+    }
+    m_command_pool = nullptr;
+  }
+
+  m_samples.clear();
+  m_sample_sums = Sample();
+  m_gpu_timed_count = 0;
+  m_gpu_latency_count = 0;
+  std::fill(std::begin(m_bound_counts), std::end(m_bound_counts), 0);
+  m_stats = vkex::FrameBoundStats();
+  m_calibrated = false;
+
+  return vkex::Result::Success;
+}
+
+void FrameBoundClassifier::BeginFrame(uint64_t wait_begin, uint64_t wait_end)
+{
+  if (!IsInitialized()) {
+    return;
+  }
+
+  if (m_frame_started) {
+    ClassifyFrame(wait_begin);
+  }
+
+  // Recalibrate once a window, the clocks drift apart slowly
+  if (m_calibrated && (++m_frames_since_calibration >= m_samples.size())) {
+    Calibrate();
+    m_frames_since_calibration = 0;
+  }
+
+  m_frame = Frame();
+  m_frame.begin = wait_begin;
+  m_frame.waits[kFrameWaitFrameFence] = wait_end - wait_begin;
+  m_frame_started = true;
+}
+
+void FrameBoundClassifier::AddWait(vkex::FrameWait wait, uint64_t begin, uint64_t end)
+{
+  VKEX_ASSERT(wait < kFrameWaitCount);
+  m_frame.waits[wait] += end - begin;
+}
+
+void FrameBoundClassifier::GetSubmitCommandBuffers(vkex::FrameSubmit submit, VkCommandBuffer* p_begin, VkCommandBuffer* p_end)
+{
+  VKEX_ASSERT(submit < kFrameSubmitCount);
+  if (m_command_buffers.empty()) {
+    *p_begin = VK_NULL_HANDLE;
+    *p_end = VK_NULL_HANDLE;
+    return;
+  }
+
+  *p_begin = *(m_command_buffers[submit * 2 + 0]);
+  *p_end = *(m_command_buffers[submit * 2 + 1]);
+  m_frame.submitted[submit] = true;
+}
+
+const char* FrameBoundClassifier::ToString(vkex::FrameBound bound)
+{
+  switch (bound) {
+    case vkex::FrameBound::Cpu     : return "CPU";
+    case vkex::FrameBound::Gpu     : return "GPU";
+    case vkex::FrameBound::Present : return "Present";
+  }
+  return "";
+}
+
+void FrameBoundClassifier::Calibrate()
+{
+  VkCalibratedTimestampInfoEXT infos[2] = {};
+  infos[0].sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+  infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+  infos[1].sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+  infos[1].timeDomain = m_host_time_domain;
+
+  uint64_t timestamps[2] = {};
+  uint64_t max_deviation = 0;
+  VkResult vk_result = vkex::GetCalibratedTimestampsEXT(*m_device, 2, infos, timestamps, &max_deviation);
+  if (vk_result != VK_SUCCESS) {
+    m_calibrated = false;
+    return;
+  }
+
+  // vkex::Timer converts performance counter ticks the same way on Windows
+  m_calibration_gpu_ticks = timestamps[0];
+  m_calibration_host_time = static_cast<uint64_t>(static_cast<double>(timestamps[1]) * m_host_nanos_per_count);
+}
+
+int64_t FrameBoundClassifier::TickDelta(uint64_t from, uint64_t to) const
+{
+  // Only the valid bits count, a wrap in between reads as a small delta
+  uint64_t delta = (to - from) & m_timestamp_mask;
+  if ((m_timestamp_mask != UINT64_MAX) && (delta > (m_timestamp_mask >> 1))) {
+    return static_cast<int64_t>(delta) - static_cast<int64_t>(m_timestamp_mask) - 1;
+  }
+  return static_cast<int64_t>(delta);
+}
+
+void FrameBoundClassifier::ClassifyFrame(uint64_t end)
+{
+  Sample sample = {};
+
+  const double frame_ns = static_cast<double>(end - m_frame.begin);
+  double wait_ns = 0;
+  sample.frame_ms = frame_ns * VKEX_TIMER_NANOS_TO_MILLIS;
+  for (uint32_t wait = 0; wait < kFrameWaitCount; ++wait) {
+    wait_ns += static_cast<double>(m_frame.waits[wait]);
+    sample.wait_ms[wait] = static_cast<double>(m_frame.waits[wait]) * VKEX_TIMER_NANOS_TO_MILLIS;
+  }
+
+  // The frame fence finished every submit of the frame, so the queries are
+  // ready and there's no need to wait on them
+  uint64_t ticks[kFrameSubmitCount][2] = {};
+  bool timed[kFrameSubmitCount] = {};
+  uint32_t timed_count = 0;
+  for (uint32_t submit = 0; submit < kFrameSubmitCount; ++submit) {
+    if (!m_frame.submitted[submit]) {
+      continue;
+    }
+    VkResult vk_result = vkex::GetQueryPoolResults(
+      *m_device,
+      *m_query_pool,
+      submit * 2,
+      2,
+      sizeof(ticks[submit]),
+      ticks[submit],
+      sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT);
+    timed[submit] = (vk_result == VK_SUCCESS);
+    timed_count += timed[submit] ? 1 : 0;
+  }
+
+  if (timed_count > 0) {
+    // Spans in nanoseconds from the start of the frame when calibrated,
+    // otherwise from the first timed submit's start
+    uint64_t origin_ticks = 0;
+    double origin_ns = 0;
+    if (m_calibrated) {
+      origin_ticks = m_calibration_gpu_ticks;
+      origin_ns = static_cast<double>(static_cast<int64_t>(m_calibration_host_time - m_frame.begin));
+    }
+    else {
+      origin_ticks = timed[kFrameSubmitRender] ? ticks[kFrameSubmitRender][0] : ticks[kFrameSubmitPresent][0];
+    }
+
+    double span_begin[kFrameSubmitCount] = {};
+    double span_end[kFrameSubmitCount] = {};
+    uint32_t span_count = 0;
+    for (uint32_t submit = 0; submit < kFrameSubmitCount; ++submit) {
+      if (!timed[submit]) {
+        continue;
+      }
+      double gpu_begin = origin_ns + TicksToNanos(TickDelta(origin_ticks, ticks[submit][0]));
+      double gpu_end = origin_ns + TicksToNanos(TickDelta(origin_ticks, ticks[submit][1]));
+      if (m_calibrated) {
+        if ((submit == kFrameSubmitPresent) && (m_frame.submit_time != 0)) {
+          double submit_ns = static_cast<double>(m_frame.submit_time - m_frame.begin);
+          sample.gpu_latency_ms = std::max(gpu_end - submit_ns, 0.0) * VKEX_TIMER_NANOS_TO_MILLIS;
+          sample.has_gpu_latency = true;
+        }
+        // Only the busy time inside this frame's interval held it back
+        gpu_begin = std::min(std::max(gpu_begin, 0.0), frame_ns);
+        gpu_end = std::min(std::max(gpu_end, 0.0), frame_ns);
+      }
+      span_begin[span_count] = gpu_begin;
+      span_end[span_count] = gpu_end;
+      ++span_count;
+    }
+
+    // Submits can overlap on the GPU, count the union of the spans
+    if ((span_count == 2) && (span_begin[1] < span_begin[0])) {
+      std::swap(span_begin[0], span_begin[1]);
+      std::swap(span_end[0], span_end[1]);
+    }
+    double busy_ns = 0;
+    double cursor = span_begin[0];
+    for (uint32_t i = 0; i < span_count; ++i) {
+      double begin = std::max(span_begin[i], cursor);
+      if (span_end[i] > begin) {
+        busy_ns += span_end[i] - begin;
+        cursor = span_end[i];
+      }
+    }
+    busy_ns = std::min(busy_ns, frame_ns);
+
+    sample.gpu_busy_ms = busy_ns * VKEX_TIMER_NANOS_TO_MILLIS;
+    sample.gpu_timed = true;
+  }
+
+  // Classify
+  if (sample.gpu_timed && (sample.gpu_busy_ms >= (m_gpu_bound_ratio * sample.frame_ms))) {
+    sample.bound = vkex::FrameBound::Gpu;
+  }
+  else {
+    const double gpu_wait_ms = sample.wait_ms[kFrameWaitFrameFence] + sample.wait_ms[kFrameWaitRenderFence];
+    const double present_wait_ms = sample.wait_ms[kFrameWaitAcquire] + sample.wait_ms[kFrameWaitPacing] + sample.wait_ms[kFrameWaitPresent];
+    const double cpu_ms = std::max(frame_ns - wait_ns, 0.0) * VKEX_TIMER_NANOS_TO_MILLIS;
+    sample.bound = vkex::FrameBound::Cpu;
+    if ((gpu_wait_ms > cpu_ms) && (gpu_wait_ms >= present_wait_ms)) {
+      sample.bound = vkex::FrameBound::Gpu;
+    }
+    else if (present_wait_ms > cpu_ms) {
+      sample.bound = vkex::FrameBound::Present;
+    }
+  }
+
+  AddSample(sample);
+}
+
+void FrameBoundClassifier::AddSample(const Sample& sample)
+{
+  const uint32_t window_frame_count = static_cast<uint32_t>(m_samples.size());
+
+  // Running sums, the oldest sample drops out once the window is full
+  auto accumulate = [this](const Sample& s, bool add) {
+    const double sign = add ? 1.0 : -1.0;
+    m_sample_sums.frame_ms += sign * s.frame_ms;
+    for (uint32_t wait = 0; wait < kFrameWaitCount; ++wait) {
+      m_sample_sums.wait_ms[wait] += sign * s.wait_ms[wait];
+    }
+    m_sample_sums.gpu_busy_ms += sign * s.gpu_busy_ms;
+    m_sample_sums.gpu_latency_ms += sign * s.gpu_latency_ms;
+    const uint32_t bound = static_cast<uint32_t>(s.bound);
+    if (add) {
+      m_gpu_timed_count += s.gpu_timed ? 1 : 0;
+      m_gpu_latency_count += s.has_gpu_latency ? 1 : 0;
+      m_bound_counts[bound] += 1;
+    }
+    else {
+      m_gpu_timed_count -= s.gpu_timed ? 1 : 0;
+      m_gpu_latency_count -= s.has_gpu_latency ? 1 : 0;
+      m_bound_counts[bound] -= 1;
+    }
+  };
+
+  if (m_sample_count == window_frame_count) {
+    accumulate(m_samples[m_sample_index], false);
+  }
+  else {
+    ++m_sample_count;
+  }
+  m_samples[m_sample_index] = sample;
+  accumulate(sample, true);
+  m_sample_index = (m_sample_index + 1) % window_frame_count;
+
+  // Resum once a window so rounding doesn't build up in the running sums
+  if (m_sample_index == 0) {
+    m_sample_sums = Sample();
+    m_gpu_timed_count = 0;
+    m_gpu_latency_count = 0;
+    std::fill(std::begin(m_bound_counts), std::end(m_bound_counts), 0);
+    for (uint32_t i = 0; i < m_sample_count; ++i) {
+      accumulate(m_samples[i], true);
+    }
+  }
+
+  const double inv_count = 1.0 / static_cast<double>(m_sample_count);
+  m_stats.frame_count = m_sample_count;
+  std::copy(std::begin(m_bound_counts), std::end(m_bound_counts), std::begin(m_stats.bound_counts));
+  m_stats.frame_ms = m_sample_sums.frame_ms * inv_count;
+  for (uint32_t wait = 0; wait < kFrameWaitCount; ++wait) {
+    m_stats.wait_ms[wait] = m_sample_sums.wait_ms[wait] * inv_count;
+  }
+  m_stats.gpu_busy_ms = m_sample_sums.gpu_busy_ms * inv_count;
+  m_stats.gpu_latency_ms = (m_gpu_latency_count > 0) ? (m_sample_sums.gpu_latency_ms / static_cast<double>(m_gpu_latency_count)) : 0.0;
+  m_stats.gpu_timed = (m_gpu_timed_count > 0);
+  m_stats.calibrated = m_calibrated;
+}
+
+} // namespace vkex
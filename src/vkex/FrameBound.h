@@ -0,0 +1,209 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_FRAME_BOUND_H__
+#define __VKEX_FRAME_BOUND_H__
+
+#include "vkex/Command.h"
+#include "vkex/QueryPool.h"
+#include "vkex/Queue.h"
+
+namespace vkex {
+
+/** @enum FrameBound
+ *
+ */
+enum class FrameBound : uint32_t {
+  Cpu     = 0,
+  Gpu     = 1,
+  Present = 2,
+};
+
+enum {
+  kFrameBoundCount = 3,
+};
+
+/** @enum FrameWait
+ *
+ * Places the frame loop blocks. The fences are waits on the GPU, acquire,
+ * pacing and present are waits on the display.
+ */
+enum FrameWait : uint32_t {
+  kFrameWaitFrameFence  = 0,
+  kFrameWaitRenderFence = 1,
+  kFrameWaitAcquire     = 2,
+  kFrameWaitPacing      = 3,
+  kFrameWaitPresent     = 4,
+  kFrameWaitCount       = 5,
+};
+
+/** @enum FrameSubmit
+ *
+ */
+enum FrameSubmit : uint32_t {
+  kFrameSubmitRender  = 0,
+  kFrameSubmitPresent = 1,
+  kFrameSubmitCount   = 2,
+};
+
+/** @struct FrameBoundStats
+ *
+ * Averages over the frames in the window, in milliseconds.
+ */
+struct FrameBoundStats {
+  uint32_t  frame_count                     = 0;
+  uint32_t  bound_counts[kFrameBoundCount]  = {};
+  double    frame_ms                        = 0;
+  double    wait_ms[kFrameWaitCount]        = {};
+  // Frames without GPU timestamps count as 0
+  double    gpu_busy_ms                     = 0;
+  // From the last submit returning to the GPU finishing the frame, only
+  // measured when the clocks are calibrated
+  double    gpu_latency_ms                  = 0;
+  bool      gpu_timed                       = false;
+  bool      calibrated                      = false;
+
+  float GetBoundPercent(vkex::FrameBound bound) const;
+};
+
+/** @struct FrameBoundClassifierCreateInfo
+ *
+ */
+struct FrameBoundClassifierCreateInfo {
+  // Queue the frame's render and present work is submitted to
+  vkex::Queue queue;
+  // Frames the stats are averaged over
+  uint32_t    window_frame_count;
+  // GPU busy for at least this fraction of the frame makes it GPU bound
+  double      gpu_bound_ratio;
+};
+
+/** @class FrameBoundClassifier
+ *
+ * Works out what held each frame back. The frame runs from one frame fence
+ * wait to the next, and the loop reports how long it blocked in each
+ * FrameWait. The render and present submits are bracketed by timestamp
+ * command buffers recorded once at initialization, so the GPU's busy time
+ * costs nothing to record each frame. With VK_EXT_calibrated_timestamps
+ * the GPU timestamps are mapped onto the vkex::Timer clock, so only the
+ * busy time inside the frame's interval counts; without it the GPU's busy
+ * span is used as is.
+ *
+ * A frame is GPU bound when the GPU was busy for most of it. Otherwise it's
+ * bound by the larger of the GPU waits, the display waits and the CPU time
+ * left after every wait.
+ *
+ * The frame fence covers everything submitted for the previous frame, so
+ * its timestamps are ready to read, without waiting, right after the wait
+ * and a single set of queries is enough.
+ */
+class FrameBoundClassifier {
+public:
+  FrameBoundClassifier();
+  ~FrameBoundClassifier();
+
+  FrameBoundClassifier(const FrameBoundClassifier&) = delete;
+  FrameBoundClassifier& operator=(const FrameBoundClassifier&) = delete;
+
+  vkex::Result  Initialize(vkex::Device device, const vkex::FrameBoundClassifierCreateInfo& create_info);
+  bool          IsInitialized() const { return !m_samples.empty(); }
+  vkex::Result  Destroy();
+
+  //! @fn BeginFrame
+  //!
+  //! Call right after the frame fence wait, 'wait_begin' and 'wait_end'
+  //! being vkex::Timer timestamps around it. Classifies the previous frame.
+  void          BeginFrame(uint64_t wait_begin, uint64_t wait_end);
+
+  //! @fn AddWait
+  //!
+  void          AddWait(vkex::FrameWait wait, uint64_t begin, uint64_t end);
+
+  //! @fn GetSubmitCommandBuffers
+  //!
+  //! Command buffers to put first and last in 'submit', VK_NULL_HANDLE when
+  //! the queue can't write timestamps.
+  void          GetSubmitCommandBuffers(vkex::FrameSubmit submit, VkCommandBuffer* p_begin, VkCommandBuffer* p_end);
+
+  //! @fn SetSubmitTime
+  //!
+  //! vkex::Timer timestamp of the last queue submit of the frame returning.
+  void          SetSubmitTime(uint64_t timestamp) { m_frame.submit_time = timestamp; }
+
+  const vkex::FrameBoundStats& GetStats() const { return m_stats; }
+  bool          IsCalibrated() const { return m_calibrated; }
+
+  static const char* ToString(vkex::FrameBound bound);
+
+private:
+  struct Frame {
+    uint64_t  begin                     = 0;
+    uint64_t  waits[kFrameWaitCount]    = {};
+    uint64_t  submit_time               = 0;
+    bool      submitted[kFrameSubmitCount] = {};
+  };
+
+  struct Sample {
+    vkex::FrameBound  bound                   = vkex::FrameBound::Cpu;
+    double            frame_ms                = 0;
+    double            wait_ms[kFrameWaitCount] = {};
+    double            gpu_busy_ms             = 0;
+    double            gpu_latency_ms          = 0;
+    bool              gpu_timed               = false;
+    bool              has_gpu_latency         = false;
+  };
+
+  void          Calibrate();
+  int64_t       TickDelta(uint64_t from, uint64_t to) const;
+  double        TicksToNanos(int64_t ticks) const { return static_cast<double>(ticks) * m_timestamp_period; }
+  void          ClassifyFrame(uint64_t end);
+  void          AddSample(const Sample& sample);
+
+private:
+  vkex::Device              m_device = nullptr;
+  double                    m_gpu_bound_ratio = 0.9;
+
+  vkex::QueryPool           m_query_pool = nullptr;
+  vkex::CommandPool         m_command_pool = nullptr;
+  // Begin and end for each FrameSubmit
+  std::vector<vkex::CommandBuffer> m_command_buffers;
+  uint64_t                  m_timestamp_mask = 0;
+  double                    m_timestamp_period = 0;
+
+  // GPU timestamp and vkex::Timer timestamp taken at the same moment
+  bool                      m_calibrated = false;
+  VkTimeDomainEXT           m_host_time_domain = VK_TIME_DOMAIN_DEVICE_EXT;
+  double                    m_host_nanos_per_count = 1.0;
+  uint64_t                  m_calibration_gpu_ticks = 0;
+  uint64_t                  m_calibration_host_time = 0;
+
+  Frame                     m_frame;
+  bool                      m_frame_started = false;
+
+  std::vector<Sample>       m_samples;
+  uint32_t                  m_sample_index = 0;
+  uint32_t                  m_sample_count = 0;
+  uint32_t                  m_frames_since_calibration = 0;
+  Sample                    m_sample_sums;
+  uint32_t                  m_gpu_timed_count = 0;
+  uint32_t                  m_gpu_latency_count = 0;
+  uint32_t                  m_bound_counts[kFrameBoundCount] = {};
+  vkex::FrameBoundStats     m_stats;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_FRAME_BOUND_H__
@@ -0,0 +1,197 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vkex {
+
+// =================================================================================================
+// QuantileSketch
+// =================================================================================================
+const double QuantileSketch::kRelativeAccuracy = 0.01;
+const double QuantileSketch::kMinValue         = 0.001;
+
+// Bucket i > 0 covers [kMinValue * gamma^(i - 1), kMinValue * gamma^i), so
+// 1023 buckets reach past 10 minutes at 1%
+static const double s_gamma         = (1.0 + QuantileSketch::kRelativeAccuracy) / (1.0 - QuantileSketch::kRelativeAccuracy);
+static const double s_inv_log_gamma = 1.0 / std::log(s_gamma);
+
+QuantileSketch::QuantileSketch()
+  : m_buckets(kBucketCount, 0)
+{
+}
+
+void QuantileSketch::Reset()
+{
+  std::fill(m_buckets.begin(), m_buckets.end(), 0);
+  m_count = 0;
+  m_sum   = 0;
+  m_min   = 0;
+  m_max   = 0;
+}
+
+uint32_t QuantileSketch::GetBucketIndex(double value) const
+{
+  if (!(value >= kMinValue)) {
+    return 0;
+  }
+  double index = 1.0 + std::floor(std::log(value / kMinValue) * s_inv_log_gamma);
+  return static_cast<uint32_t>(std::min(index, static_cast<double>(kBucketCount - 1)));
+}
+
+double QuantileSketch::GetBucketValue(uint32_t index) const
+{
+  if (index == 0) {
+    return 0.0;
+  }
+  // The point with the same relative error to both ends of the bucket
+  double lower = kMinValue * std::pow(s_gamma, static_cast<double>(index - 1));
+  return lower * 2.0 * s_gamma / (1.0 + s_gamma);
+}
+
+void QuantileSketch::Add(double value)
+{
+  m_buckets[GetBucketIndex(value)] += 1;
+  if (m_count == 0) {
+    m_min = value;
+    m_max = value;
+  }
+  else {
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+  }
+  m_sum += value;
+  m_count += 1;
+}
+
+void QuantileSketch::Merge(const vkex::QuantileSketch& sketch)
+{
+  if (sketch.m_count == 0) {
+    return;
+  }
+  for (uint32_t i = 0; i < kBucketCount; ++i) {
+    m_buckets[i] += sketch.m_buckets[i];
+  }
+  m_min = (m_count > 0) ? std::min(m_min, sketch.m_min) : sketch.m_min;
+  m_max = (m_count > 0) ? std::max(m_max, sketch.m_max) : sketch.m_max;
+  m_sum += sketch.m_sum;
+  m_count += sketch.m_count;
+}
+
+void QuantileSketch::GetQuantiles(uint32_t count, const double* p_quantiles, double* p_values) const
+{
+  if (m_count == 0) {
+    std::fill(p_values, p_values + count, 0.0);
+    return;
+  }
+
+  uint32_t bucket = 0;
+  uint64_t cumulative = m_buckets[0];
+  for (uint32_t i = 0; i < count; ++i) {
+    VKEX_ASSERT((i == 0) || (p_quantiles[i] >= p_quantiles[i - 1]));
+    double quantile = std::min(std::max(p_quantiles[i], 0.0), 1.0);
+    // Zero based rank of the value wanted
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(m_count - 1));
+    while ((cumulative <= rank) && ((bucket + 1) < kBucketCount)) {
+      ++bucket;
+      cumulative += m_buckets[bucket];
+    }
+    // The exact ends keep the extremes and the first and last buckets honest
+    p_values[i] = std::min(std::max(GetBucketValue(bucket), m_min), m_max);
+    if (quantile >= 1.0) {
+      p_values[i] = m_max;
+    }
+  }
+}
+
+double QuantileSketch::GetQuantile(double quantile) const
+{
+  double value = 0;
+  GetQuantiles(1, &quantile, &value);
+  return value;
+}
+
+void QuantileSketch::GetSummary(vkex::QuantileSummary* p_summary) const
+{
+  const double quantiles[3] = { 0.50, 0.95, 0.99 };
+  double values[3] = {};
+  GetQuantiles(3, quantiles, values);
+
+  p_summary->count = m_count;
+  p_summary->mean  = GetMean();
+  p_summary->p50   = values[0];
+  p_summary->p95   = values[1];
+  p_summary->p99   = values[2];
+  p_summary->max   = GetMax();
+}
+
+// =================================================================================================
+// FrameMetric
+// =================================================================================================
+FrameMetric::FrameMetric()
+{
+  m_recent.fill(0);
+}
+
+void FrameMetric::Add(double value)
+{
+  if (m_recent_count == kRecentCount) {
+    m_recent_sum -= m_recent[m_recent_index];
+  }
+  else {
+    ++m_recent_count;
+  }
+  m_recent[m_recent_index] = value;
+  m_recent_sum += value;
+  m_recent_index = (m_recent_index + 1) % kRecentCount;
+
+  // Resum once around the ring so rounding doesn't build up over a long run
+  if (m_recent_index == 0) {
+    m_recent_sum = 0;
+    for (uint32_t i = 0; i < m_recent_count; ++i) {
+      m_recent_sum += m_recent[i];
+    }
+  }
+
+  m_run.Add(value);
+  m_interval.Add(value);
+}
+
+void FrameMetric::ResetInterval()
+{
+  m_interval.Reset();
+}
+
+double FrameMetric::GetRecentAverage() const
+{
+  if (m_recent_count == 0) {
+    return 0.0;
+  }
+  return m_recent_sum / static_cast<double>(m_recent_count);
+}
+
+double FrameMetric::GetLast() const
+{
+  if (m_recent_count == 0) {
+    return 0.0;
+  }
+  return m_recent[(m_recent_index + kRecentCount - 1) % kRecentCount];
+}
+
+} // namespace vkex
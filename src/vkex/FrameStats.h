@@ -0,0 +1,129 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_FRAME_STATS_H__
+#define __VKEX_FRAME_STATS_H__
+
+#include "vkex/Config.h"
+
+#include <array>
+#include <vector>
+
+namespace vkex {
+
+/** @struct QuantileSummary
+ *
+ */
+struct QuantileSummary {
+  uint64_t  count = 0;
+  double    mean  = 0;
+  double    p50   = 0;
+  double    p95   = 0;
+  double    p99   = 0;
+  double    max   = 0;
+};
+
+/** @class QuantileSketch
+ *
+ * Streaming quantiles in fixed memory. Values are counted in logarithmic
+ * buckets, each kRelativeAccuracy wide either side of its midpoint, so a
+ * quantile is within that relative error of the true value no matter how
+ * many values went in. Count, mean, min and max are exact. Values are
+ * expected in milliseconds: anything under kMinValue shares the first
+ * bucket and the last bucket holds everything past it.
+ */
+class QuantileSketch {
+public:
+  enum { kBucketCount = 1024 };
+  static const double kRelativeAccuracy;
+  static const double kMinValue;
+
+  QuantileSketch();
+  ~QuantileSketch() {}
+
+  void      Add(double value);
+  void      Merge(const vkex::QuantileSketch& sketch);
+  void      Reset();
+
+  uint64_t  GetCount() const { return m_count; }
+  double    GetMean() const { return (m_count > 0) ? (m_sum / static_cast<double>(m_count)) : 0.0; }
+  double    GetMin() const { return (m_count > 0) ? m_min : 0.0; }
+  double    GetMax() const { return (m_count > 0) ? m_max : 0.0; }
+
+  //! @fn GetQuantiles
+  //!
+  //! 'quantiles' in [0, 1] and ascending, answered in one pass over the
+  //! buckets. 0 when nothing has been added.
+  void      GetQuantiles(uint32_t count, const double* p_quantiles, double* p_values) const;
+  double    GetQuantile(double quantile) const;
+
+  //! @fn GetSummary
+  //!
+  void      GetSummary(vkex::QuantileSummary* p_summary) const;
+
+private:
+  uint32_t  GetBucketIndex(double value) const;
+  double    GetBucketValue(uint32_t index) const;
+
+private:
+  // kBucketCount, on the heap so apps can keep sketches on the stack
+  std::vector<uint32_t> m_buckets;
+  uint64_t              m_count = 0;
+  double                m_sum   = 0;
+  double                m_min   = 0;
+  double                m_max   = 0;
+};
+
+/** @class FrameMetric
+ *
+ * One per frame time, in milliseconds. Keeps the last kRecentCount values
+ * in a ring with their running sum for the overlay's averages, and two
+ * sketches: one over the whole run and one over the current log interval.
+ * Adding a value is constant time and nothing grows with uptime.
+ */
+class FrameMetric {
+public:
+  enum { kRecentCount = 128 };
+
+  FrameMetric();
+  ~FrameMetric() {}
+
+  void      Add(double value);
+
+  //! @fn ResetInterval
+  //!
+  //! Starts a new log interval, the run's sketch and the ring carry on.
+  void      ResetInterval();
+
+  uint32_t  GetRecentCount() const { return m_recent_count; }
+  double    GetRecentAverage() const;
+  double    GetLast() const;
+
+  const vkex::QuantileSketch& GetRun() const { return m_run; }
+  const vkex::QuantileSketch& GetInterval() const { return m_interval; }
+
+private:
+  std::array<double, kRecentCount> m_recent;
+  uint32_t              m_recent_index = 0;
+  uint32_t              m_recent_count = 0;
+  double                m_recent_sum   = 0;
+  vkex::QuantileSketch  m_run;
+  vkex::QuantileSketch  m_interval;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_FRAME_STATS_H__
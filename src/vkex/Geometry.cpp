@@ -16,6 +16,14 @@
 
 #include <vkex/Geometry.h>
 
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKEX_GEOMETRY_BUILDER_SSE
+#include <emmintrin.h>
+#endif
+
 namespace vkex {
 
 // =================================================================================================
@@ -227,6 +235,12 @@ PlatonicSolid PlatonicSolid::Cube(const vkex::PlatonicSolid::Options& options)
   // Vertex data
   std::vector<float> vertex_data;
   {
+    uint32_t float_count = 3
+                         + (options.vertex_colors ? 3 : 0)
+                         + (options.tex_coords ? 2 : 0)
+                         + (options.normals ? 3 : 0);
+    vertex_data.reserve(36 * float_count);
+
     // Front +Z (near to camera)
     AppendVertexData(positions[0], colors[0], uvs[0], normals[0], options, vertex_data);
     AppendVertexData(positions[1], colors[0], uvs[1], normals[0], options, vertex_data);
@@ -335,6 +349,18 @@ void TriangleList::InternalAppendVertex(const TriangleList::Vertex& vertex)
   m_vertex_count += 1;
 }
 
+void TriangleList::Reserve(uint32_t vertex_count, uint32_t triangle_count)
+{
+  size_t vertex_size = sizeof(float3)
+                     + (m_options.vertex_colors ? sizeof(float3) : 0)
+                     + (m_options.tex_coords ? sizeof(float2) : 0)
+                     + (m_options.normals ? sizeof(float3) : 0);
+  m_vertex_data[0].Reserve(vertex_count * vertex_size);
+  if (m_options.indices) {
+    m_index_data.Reserve(triangle_count * 3 * sizeof(uint32_t));
+  }
+}
+
 uint32_t TriangleList::GetIndexCount() const
 {
   return m_index_count;
@@ -398,4 +424,529 @@ vkex::VertexBufferData* TriangleList::GetVertexBuffer() const
   return ptr;
 }
 
-} // namespace vkex
\ No newline at end of file
+// =================================================================================================
+// GeometryBuilder
+// =================================================================================================
+
+// Vertex components, in the order rows are evaluated into scratch
+enum GridComponent {
+  GRID_COMPONENT_POSITION_X = 0,
+  GRID_COMPONENT_POSITION_Y,
+  GRID_COMPONENT_POSITION_Z,
+  GRID_COMPONENT_TEX_COORD_U,
+  GRID_COMPONENT_TEX_COORD_V,
+  GRID_COMPONENT_NORMAL_X,
+  GRID_COMPONENT_NORMAL_Y,
+  GRID_COMPONENT_NORMAL_Z,
+  GRID_COMPONENT_COUNT,
+};
+
+/** @struct GeometryBuilder::Grid
+ *
+ * Shapes are separable: per column and per row tables are computed once,
+ * and a vertex only combines the two with a few multiplies.
+ *
+ * Surfaces of revolution (sphere, torus):
+ *   position = (ring * cos, y, ring * sin)
+ *   normal   = (normal_ring * cos, normal_y, normal_ring * sin)
+ *
+ * Heightfield:
+ *   position = (x, amplitude * sin(fx) * cos(fz), z)
+ *   normal   = normalize(-dy/dx, 1, -dy/dz)
+ *
+ */
+struct GeometryBuilder::Grid {
+  bool      heightfield   = false;
+  // Heightfields face +Y, which reverses the winding of the grid
+  bool      flip_winding  = false;
+  uint32_t  columns       = 0;
+  uint32_t  rows          = 0;
+  float     amplitude     = 0;
+  float     frequency     = 0;
+
+  // Per column, columns + 1 entries padded to a multiple of 4 so every row
+  // is whole SIMD blocks. Revolution: a = cos, b = sin. Heightfield: a = x,
+  // b = sin(fx), c = cos(fx).
+  std::vector<float> column_a;
+  std::vector<float> column_b;
+  std::vector<float> column_c;
+  std::vector<float> column_u;
+
+  // Per row, rows + 1 entries. Revolution: a = ring, b = y, c = normal
+  // ring, d = normal y. Heightfield: a = z, b = sin(fz), c = cos(fz).
+  std::vector<float> row_a;
+  std::vector<float> row_b;
+  std::vector<float> row_c;
+  std::vector<float> row_d;
+  std::vector<float> row_v;
+
+  uint32_t GetPaddedColumnCount() const {
+    return ((columns + 1) + 3) & ~3u;
+  }
+
+  void Allocate(uint32_t column_count, uint32_t row_count) {
+    columns = column_count;
+    rows = row_count;
+    uint32_t padded_count = GetPaddedColumnCount();
+    column_a.assign(padded_count, 0.0f);
+    column_b.assign(padded_count, 0.0f);
+    column_c.assign(padded_count, 0.0f);
+    column_u.assign(padded_count, 0.0f);
+    row_a.assign(rows + 1, 0.0f);
+    row_b.assign(rows + 1, 0.0f);
+    row_c.assign(rows + 1, 0.0f);
+    row_d.assign(rows + 1, 0.0f);
+    row_v.assign(rows + 1, 0.0f);
+  }
+};
+
+namespace {
+
+// Components written to one vertex buffer, in order, at a stride of
+// component_count floats
+struct GridStream {
+  float*    p_data           = nullptr;
+  uint32_t  component_count  = 0;
+  uint32_t  components[GRID_COMPONENT_COUNT];
+};
+
+void EvaluateGridRow(
+  const GeometryBuilder::Grid&  grid,
+  uint32_t                      row,
+  float* const*                 pp_scratch
+);
+
+void StoreGridRow(
+  const GridStream&   stream,
+  const float* const* pp_scratch,
+  uint32_t            vertex_count,
+  uint32_t            first_vertex
+);
+
+} // namespace
+
+#if defined(VKEX_GEOMETRY_BUILDER_SSE)
+
+namespace {
+
+void EvaluateGridRow(
+  const GeometryBuilder::Grid&  grid,
+  uint32_t                      row,
+  float* const*                 pp_scratch
+)
+{
+  const uint32_t padded_count = grid.GetPaddedColumnCount();
+  const __m128 row_a = _mm_set1_ps(grid.row_a[row]);
+  const __m128 row_b = _mm_set1_ps(grid.row_b[row]);
+  const __m128 row_c = _mm_set1_ps(grid.row_c[row]);
+  const __m128 row_d = _mm_set1_ps(grid.row_d[row]);
+  const __m128 row_v = _mm_set1_ps(grid.row_v[row]);
+
+  if (!grid.heightfield) {
+    for (uint32_t column = 0; column < padded_count; column += 4) {
+      const __m128 cos_theta = _mm_loadu_ps(grid.column_a.data() + column);
+      const __m128 sin_theta = _mm_loadu_ps(grid.column_b.data() + column);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_POSITION_X] + column, _mm_mul_ps(row_a, cos_theta));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_POSITION_Y] + column, row_b);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_POSITION_Z] + column, _mm_mul_ps(row_a, sin_theta));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_TEX_COORD_U] + column, _mm_loadu_ps(grid.column_u.data() + column));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_TEX_COORD_V] + column, row_v);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_NORMAL_X] + column, _mm_mul_ps(row_c, cos_theta));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_NORMAL_Y] + column, row_d);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_NORMAL_Z] + column, _mm_mul_ps(row_c, sin_theta));
+    }
+  }
+  else {
+    const __m128 amplitude = _mm_set1_ps(grid.amplitude);
+    const __m128 slope = _mm_set1_ps(grid.amplitude * grid.frequency);
+    const __m128 one = _mm_set1_ps(1.0f);
+    // Row terms of the two slopes
+    const __m128 slope_x_row = _mm_mul_ps(slope, row_c);
+    const __m128 slope_z_row = _mm_mul_ps(slope, row_b);
+    for (uint32_t column = 0; column < padded_count; column += 4) {
+      const __m128 x = _mm_loadu_ps(grid.column_a.data() + column);
+      const __m128 sin_x = _mm_loadu_ps(grid.column_b.data() + column);
+      const __m128 cos_x = _mm_loadu_ps(grid.column_c.data() + column);
+      const __m128 y = _mm_mul_ps(_mm_mul_ps(amplitude, sin_x), row_c);
+      // n = (-dy/dx, 1, -dy/dz) with dy/dz = -slope * sin(fx) * sin(fz)
+      const __m128 nx = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(slope_x_row, cos_x));
+      const __m128 nz = _mm_mul_ps(slope_z_row, sin_x);
+      const __m128 length_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), one), _mm_mul_ps(nz, nz));
+      const __m128 inv_length = _mm_div_ps(one, _mm_sqrt_ps(length_sq));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_POSITION_X] + column, x);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_POSITION_Y] + column, y);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_POSITION_Z] + column, row_a);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_TEX_COORD_U] + column, _mm_loadu_ps(grid.column_u.data() + column));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_TEX_COORD_V] + column, row_v);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_NORMAL_X] + column, _mm_mul_ps(nx, inv_length));
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_NORMAL_Y] + column, inv_length);
+      _mm_storeu_ps(pp_scratch[GRID_COMPONENT_NORMAL_Z] + column, _mm_mul_ps(nz, inv_length));
+    }
+  }
+}
+
+// Writes four vertices at a time: the stream's components are transposed
+// from scratch in groups of four, and each vertex is stored with whole
+// 16 byte stores. A store past the end of a vertex lands on the next one,
+// which is written right after, so only the last vertex of the row is
+// stored through a temporary.
+void StoreGridRow(
+  const GridStream&   stream,
+  const float* const* pp_scratch,
+  uint32_t            vertex_count,
+  uint32_t            first_vertex
+)
+{
+  const uint32_t stride = stream.component_count;
+  const uint32_t chunk_count = (stride + 3) / 4;
+  float* p_dst_row = stream.p_data + size_t(first_vertex) * stride;
+
+  for (uint32_t column = 0; column < vertex_count; column += 4) {
+    // chunks[chunk][lane] holds components 4 * chunk .. 4 * chunk + 3 of
+    // vertex column + lane
+    __m128 chunks[2][4];
+    for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+      __m128 r[4];
+      for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t component = chunk * 4 + i;
+        r[i] = (component < stride)
+               ? _mm_loadu_ps(pp_scratch[stream.components[component]] + column)
+               : _mm_setzero_ps();
+      }
+      _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+      for (uint32_t lane = 0; lane < 4; ++lane) {
+        chunks[chunk][lane] = r[lane];
+      }
+    }
+
+    uint32_t lane_count = std::min<uint32_t>(4, vertex_count - column);
+    for (uint32_t lane = 0; lane < lane_count; ++lane) {
+      uint32_t vertex = column + lane;
+      float* p_dst = p_dst_row + size_t(vertex) * stride;
+      if ((vertex + 1) < vertex_count) {
+        for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+          _mm_storeu_ps(p_dst + chunk * 4, chunks[chunk][lane]);
+        }
+      }
+      else {
+        alignas(16) float temp[8];
+        for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+          _mm_store_ps(temp + chunk * 4, chunks[chunk][lane]);
+        }
+        std::memcpy(p_dst, temp, stride * sizeof(float));
+      }
+    }
+  }
+}
+
+} // namespace
+
+#else
+
+namespace {
+
+void EvaluateGridRow(
+  const GeometryBuilder::Grid&  grid,
+  uint32_t                      row,
+  float* const*                 pp_scratch
+)
+{
+  const uint32_t column_count = grid.columns + 1;
+  const float row_a = grid.row_a[row];
+  const float row_b = grid.row_b[row];
+  const float row_c = grid.row_c[row];
+  const float row_d = grid.row_d[row];
+  const float row_v = grid.row_v[row];
+
+  if (!grid.heightfield) {
+    for (uint32_t column = 0; column < column_count; ++column) {
+      const float cos_theta = grid.column_a[column];
+      const float sin_theta = grid.column_b[column];
+      pp_scratch[GRID_COMPONENT_POSITION_X][column] = row_a * cos_theta;
+      pp_scratch[GRID_COMPONENT_POSITION_Y][column] = row_b;
+      pp_scratch[GRID_COMPONENT_POSITION_Z][column] = row_a * sin_theta;
+      pp_scratch[GRID_COMPONENT_TEX_COORD_U][column] = grid.column_u[column];
+      pp_scratch[GRID_COMPONENT_TEX_COORD_V][column] = row_v;
+      pp_scratch[GRID_COMPONENT_NORMAL_X][column] = row_c * cos_theta;
+      pp_scratch[GRID_COMPONENT_NORMAL_Y][column] = row_d;
+      pp_scratch[GRID_COMPONENT_NORMAL_Z][column] = row_c * sin_theta;
+    }
+  }
+  else {
+    const float slope = grid.amplitude * grid.frequency;
+    const float slope_x_row = slope * row_c;
+    const float slope_z_row = slope * row_b;
+    for (uint32_t column = 0; column < column_count; ++column) {
+      const float sin_x = grid.column_b[column];
+      const float cos_x = grid.column_c[column];
+      const float nx = 0.0f - slope_x_row * cos_x;
+      const float nz = slope_z_row * sin_x;
+      const float inv_length = 1.0f / sqrtf(nx * nx + 1.0f + nz * nz);
+      pp_scratch[GRID_COMPONENT_POSITION_X][column] = grid.column_a[column];
+      pp_scratch[GRID_COMPONENT_POSITION_Y][column] = grid.amplitude * sin_x * row_c;
+      pp_scratch[GRID_COMPONENT_POSITION_Z][column] = row_a;
+      pp_scratch[GRID_COMPONENT_TEX_COORD_U][column] = grid.column_u[column];
+      pp_scratch[GRID_COMPONENT_TEX_COORD_V][column] = row_v;
+      pp_scratch[GRID_COMPONENT_NORMAL_X][column] = nx * inv_length;
+      pp_scratch[GRID_COMPONENT_NORMAL_Y][column] = inv_length;
+      pp_scratch[GRID_COMPONENT_NORMAL_Z][column] = nz * inv_length;
+    }
+  }
+}
+
+void StoreGridRow(
+  const GridStream&   stream,
+  const float* const* pp_scratch,
+  uint32_t            vertex_count,
+  uint32_t            first_vertex
+)
+{
+  const uint32_t stride = stream.component_count;
+  float* p_dst = stream.p_data + size_t(first_vertex) * stride;
+  for (uint32_t column = 0; column < vertex_count; ++column) {
+    for (uint32_t i = 0; i < stride; ++i) {
+      *p_dst = pp_scratch[stream.components[i]][column];
+      ++p_dst;
+    }
+  }
+}
+
+} // namespace
+
+#endif // defined(VKEX_GEOMETRY_BUILDER_SSE)
+
+GeometryBuilder::GeometryBuilder(const GeometryBuilder::Options& options)
+  : m_options(options)
+{
+}
+
+GeometryBuilder::~GeometryBuilder()
+{
+}
+
+uint32_t GeometryBuilder::GetVertexCount() const
+{
+  return m_vertex_count;
+}
+
+uint32_t GeometryBuilder::GetIndexCount() const
+{
+  return m_index_count;
+}
+
+uint32_t GeometryBuilder::GetTriangleCount() const
+{
+  return m_index_count / 3;
+}
+
+const char* GeometryBuilder::GetKernelName()
+{
+#if defined(VKEX_GEOMETRY_BUILDER_SSE)
+  return "SSE2";
+#else
+  return "Scalar";
+#endif
+}
+
+void GeometryBuilder::Sphere(float radius, uint32_t slices, uint32_t stacks)
+{
+  const float kPi = 3.14159265358979323846f;
+
+  Grid grid = {};
+  grid.Allocate(std::max<uint32_t>(slices, 3), std::max<uint32_t>(stacks, 2));
+  for (uint32_t column = 0; column <= grid.columns; ++column) {
+    float u = column / static_cast<float>(grid.columns);
+    float theta = 2.0f * kPi * u;
+    grid.column_a[column] = cosf(theta);
+    grid.column_b[column] = sinf(theta);
+    grid.column_u[column] = u;
+  }
+  // Rows run from the +Y pole down
+  for (uint32_t row = 0; row <= grid.rows; ++row) {
+    float v = row / static_cast<float>(grid.rows);
+    float phi = kPi * v;
+    float sin_phi = sinf(phi);
+    float cos_phi = cosf(phi);
+    grid.row_a[row] = radius * sin_phi;
+    grid.row_b[row] = radius * cos_phi;
+    grid.row_c[row] = sin_phi;
+    grid.row_d[row] = cos_phi;
+    grid.row_v[row] = v;
+  }
+
+  Build(grid);
+}
+
+void GeometryBuilder::Torus(float major_radius, float minor_radius, uint32_t rings, uint32_t sides)
+{
+  const float kPi = 3.14159265358979323846f;
+
+  Grid grid = {};
+  grid.Allocate(std::max<uint32_t>(rings, 3), std::max<uint32_t>(sides, 3));
+  for (uint32_t column = 0; column <= grid.columns; ++column) {
+    float u = column / static_cast<float>(grid.columns);
+    float theta = 2.0f * kPi * u;
+    grid.column_a[column] = cosf(theta);
+    grid.column_b[column] = sinf(theta);
+    grid.column_u[column] = u;
+  }
+  // Rows start at the outer equator and head down first, matching the
+  // sphere's winding
+  for (uint32_t row = 0; row <= grid.rows; ++row) {
+    float v = row / static_cast<float>(grid.rows);
+    float phi = 2.0f * kPi * v;
+    float sin_phi = sinf(phi);
+    float cos_phi = cosf(phi);
+    grid.row_a[row] = major_radius + minor_radius * cos_phi;
+    grid.row_b[row] = -minor_radius * sin_phi;
+    grid.row_c[row] = cos_phi;
+    grid.row_d[row] = -sin_phi;
+    grid.row_v[row] = v;
+  }
+
+  Build(grid);
+}
+
+void GeometryBuilder::Heightfield(float size, uint32_t resolution, float amplitude, float frequency)
+{
+  Grid grid = {};
+  grid.Allocate(std::max<uint32_t>(resolution, 1), std::max<uint32_t>(resolution, 1));
+  grid.heightfield = true;
+  grid.flip_winding = true;
+  grid.amplitude = amplitude;
+  grid.frequency = frequency;
+  for (uint32_t column = 0; column <= grid.columns; ++column) {
+    float u = column / static_cast<float>(grid.columns);
+    float x = (u - 0.5f) * size;
+    grid.column_a[column] = x;
+    grid.column_b[column] = sinf(frequency * x);
+    grid.column_c[column] = cosf(frequency * x);
+    grid.column_u[column] = u;
+  }
+  for (uint32_t row = 0; row <= grid.rows; ++row) {
+    float v = row / static_cast<float>(grid.rows);
+    float z = (v - 0.5f) * size;
+    grid.row_a[row] = z;
+    grid.row_b[row] = sinf(frequency * z);
+    grid.row_c[row] = cosf(frequency * z);
+    grid.row_v[row] = v;
+  }
+
+  Build(grid);
+}
+
+void GeometryBuilder::Build(const GeometryBuilder::Grid& grid)
+{
+  const uint32_t row_vertex_count = grid.columns + 1;
+  const uint32_t row_index_count = grid.columns * 6;
+  m_vertex_count = row_vertex_count * (grid.rows + 1);
+  m_index_count = row_index_count * grid.rows;
+
+  // Vertex buffers, sized once for the whole mesh
+  GridStream streams[3] = {};
+  uint32_t stream_count = 0;
+  {
+    const bool interleaved = (m_options.layout == LAYOUT_INTERLEAVED);
+    m_vertex_data.clear();
+
+    uint32_t location = 0;
+    vkex::VertexBindingDescription vertex_description = vkex::VertexBindingDescription(0, VK_VERTEX_INPUT_RATE_VERTEX);
+    GridStream* p_stream = &streams[0];
+    auto add_attribute = [&](VkFormat format, GridComponent first_component, uint32_t component_count) {
+      if (!interleaved && (location > 0)) {
+        vertex_description = vkex::VertexBindingDescription(stream_count, VK_VERTEX_INPUT_RATE_VERTEX);
+      }
+      vertex_description.AddAttribute(location, format);
+      ++location;
+      for (uint32_t i = 0; i < component_count; ++i) {
+        p_stream->components[p_stream->component_count] = first_component + i;
+        ++p_stream->component_count;
+      }
+      if (!interleaved) {
+        m_vertex_data.push_back(vkex::VertexBufferData(vertex_description));
+        ++stream_count;
+        p_stream = &streams[stream_count];
+      }
+    };
+    add_attribute(VK_FORMAT_R32G32B32_SFLOAT, GRID_COMPONENT_POSITION_X, 3);
+    if (m_options.tex_coords) {
+      add_attribute(VK_FORMAT_R32G32_SFLOAT, GRID_COMPONENT_TEX_COORD_U, 2);
+    }
+    if (m_options.normals) {
+      add_attribute(VK_FORMAT_R32G32B32_SFLOAT, GRID_COMPONENT_NORMAL_X, 3);
+    }
+    if (interleaved) {
+      m_vertex_data.push_back(vkex::VertexBufferData(vertex_description));
+      stream_count = 1;
+    }
+
+    for (uint32_t i = 0; i < stream_count; ++i) {
+      size_t float_count = size_t(m_vertex_count) * streams[i].component_count;
+      streams[i].p_data = m_vertex_data[i].Resize<float>(float_count);
+    }
+  }
+
+  m_index_data = vkex::IndexBufferData(std::vector<uint32_t>());
+  uint32_t* p_indices = m_index_data.Resize<uint32_t>(m_index_count);
+
+  // Rows are split evenly across threads, each thread writes the vertices
+  // of its rows and the quads below them
+  uint32_t thread_count = m_options.thread_count;
+  if (thread_count == 0) {
+    thread_count = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+  }
+  thread_count = std::min<uint32_t>(thread_count, grid.rows + 1);
+  const uint32_t rows_per_thread = (grid.rows + 1 + thread_count - 1) / thread_count;
+
+  auto build_rows = [&](uint32_t first_row, uint32_t end_row) {
+    const uint32_t padded_count = grid.GetPaddedColumnCount();
+    std::vector<float> scratch(size_t(padded_count) * GRID_COMPONENT_COUNT);
+    float* pp_scratch[GRID_COMPONENT_COUNT];
+    for (uint32_t i = 0; i < GRID_COMPONENT_COUNT; ++i) {
+      pp_scratch[i] = scratch.data() + size_t(i) * padded_count;
+    }
+
+    for (uint32_t row = first_row; row < end_row; ++row) {
+      EvaluateGridRow(grid, row, pp_scratch);
+      for (uint32_t i = 0; i < stream_count; ++i) {
+        StoreGridRow(streams[i], pp_scratch, row_vertex_count, row * row_vertex_count);
+      }
+
+      if (row >= grid.rows) {
+        continue;
+      }
+      uint32_t* p_dst = p_indices + size_t(row) * row_index_count;
+      for (uint32_t column = 0; column < grid.columns; ++column) {
+        uint32_t a = row * row_vertex_count + column;
+        uint32_t b = a + row_vertex_count;
+        uint32_t c = b + 1;
+        uint32_t d = a + 1;
+        if (grid.flip_winding) {
+          std::swap(b, d);
+        }
+        p_dst[0] = a;
+        p_dst[1] = c;
+        p_dst[2] = b;
+        p_dst[3] = a;
+        p_dst[4] = d;
+        p_dst[5] = c;
+        p_dst += 6;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint32_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+    uint32_t first_row = thread_index * rows_per_thread;
+    uint32_t end_row = std::min<uint32_t>(first_row + rows_per_thread, grid.rows + 1);
+    if (first_row < end_row) {
+      threads.emplace_back(build_rows, first_row, end_row);
+    }
+  }
+  build_rows(0, std::min<uint32_t>(rows_per_thread, grid.rows + 1));
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace vkex
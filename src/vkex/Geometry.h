@@ -126,6 +126,14 @@ public:
   TriangleList(const Options& options = Options{});
   ~TriangleList();
 
+  /** @fn Reserve
+   *
+   * Allocates vertex and index storage for the given counts up front, so
+   * appending them doesn't reallocate.
+   *
+   */
+  void Reserve(uint32_t vertex_count, uint32_t triangle_count);
+
   uint32_t  GetIndexCount() const;
 
   uint32_t  GetVertexCount() const;
@@ -165,6 +173,95 @@ private:
   uint32_t              m_triangle_count  = 0;
 };
 
+// =================================================================================================
+// GeometryBuilder
+// =================================================================================================
+
+/** @class GeometryBuilder
+ *
+ * Generates high tessellation procedural meshes for synthetic load tests.
+ *
+ * Every shape is a regular grid of quads over two parameters, so the vertex
+ * and index counts are known before anything is written. Storage is sized
+ * once, then rows of the grid are split across worker threads, each writing
+ * its own range in place. Rows are evaluated four vertices at a time with
+ * SSE into structure of arrays scratch and stored to the vertex streams
+ * with 4x4 transposes. Builds without SSE use a scalar path.
+ *
+ * Indices are 32-bit triangle lists, counter clockwise when seen from
+ * outside. Seam vertices are duplicated so texcoords wrap cleanly, and
+ * sphere poles keep their degenerate triangles to keep the grid regular.
+ *
+ */
+class GeometryBuilder : public Geometry {
+public:
+  enum Layout {
+    // One vertex buffer at binding 0, attributes interleaved
+    LAYOUT_INTERLEAVED  = 0,
+    // One vertex buffer per attribute, bound in attribute order
+    LAYOUT_PLANAR       = 1,
+  };
+
+  struct Options {
+    Options() {}
+    Layout    layout        = LAYOUT_INTERLEAVED;
+    bool      tex_coords    = false;
+    bool      normals       = false;
+    // Worker threads, 0 uses every hardware thread
+    uint32_t  thread_count  = 0;
+  };
+
+  GeometryBuilder(const Options& options = Options{});
+  ~GeometryBuilder();
+
+  /** @fn Sphere
+   *
+   * UV sphere around the origin, 'slices' around Y and 'stacks' from pole
+   * to pole. 2 * slices * stacks triangles.
+   *
+   */
+  void Sphere(float radius, uint32_t slices, uint32_t stacks);
+
+  /** @fn Torus
+   *
+   * Torus around Y, 'rings' around the major radius and 'sides' around the
+   * minor one. 2 * rings * sides triangles.
+   *
+   */
+  void Torus(float major_radius, float minor_radius, uint32_t rings, uint32_t sides);
+
+  /** @fn Heightfield
+   *
+   * Square grid of 'size' on XZ centered at the origin, displaced on Y by
+   * amplitude * sin(frequency * x) * cos(frequency * z).
+   * 2 * resolution^2 triangles.
+   *
+   */
+  void Heightfield(float size, uint32_t resolution, float amplitude, float frequency);
+
+  uint32_t  GetVertexCount() const;
+  uint32_t  GetIndexCount() const;
+  uint32_t  GetTriangleCount() const;
+
+  /** @fn GetKernelName
+   *
+   * Instruction set the row evaluation was compiled for.
+   *
+   */
+  static const char* GetKernelName();
+
+  // Per row and per column tables of a shape, see Geometry.cpp
+  struct Grid;
+
+private:
+  void Build(const Grid& grid);
+
+private:
+  Options   m_options       = {};
+  uint32_t  m_vertex_count  = 0;
+  uint32_t  m_index_count   = 0;
+};
+
 } // namespace vkex
 
 #endif // __VKEX_GEOMETRY_H__
\ No newline at end of file
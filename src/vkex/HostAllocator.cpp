@@ -0,0 +1,361 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/HostAllocator.h"
+
+#include <cstddef>
+#include <cstdlib>
+
+namespace vkex {
+
+// Stored immediately in front of every pointer handed to Vulkan
+struct HostBlockHeader {
+  void*     p_block;
+  size_t    size;
+  uint32_t  size_class;
+  uint32_t  scope;
+};
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t value)
+{
+  uint64_t current = peak.load(std::memory_order_relaxed);
+  while ((value > current) && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+static HostBlockHeader* GetHeader(void* p_memory)
+{
+  return reinterpret_cast<HostBlockHeader*>(static_cast<uint8_t*>(p_memory) - sizeof(HostBlockHeader));
+}
+
+// =================================================================================================
+// HostAllocator
+// =================================================================================================
+HostAllocator::HostAllocator()
+{
+  m_callbacks.pUserData             = this;
+  m_callbacks.pfnAllocation         = &HostAllocator::Allocation;
+  m_callbacks.pfnReallocation       = &HostAllocator::Reallocation;
+  m_callbacks.pfnFree               = &HostAllocator::Free;
+  m_callbacks.pfnInternalAllocation = &HostAllocator::InternalAllocation;
+  m_callbacks.pfnInternalFree       = &HostAllocator::InternalFree;
+}
+
+HostAllocator::~HostAllocator()
+{
+  for (uint32_t scope = 0; scope < kHostAllocationScopeCount; ++scope) {
+    for (uint32_t size_class = 0; size_class < kSizeClassCount; ++size_class) {
+      Pool& pool = m_pools[scope][size_class];
+      for (auto& p_chunk : pool.chunks) {
+        std::free(p_chunk);
+      }
+      pool.chunks.clear();
+      pool.p_free_list = nullptr;
+    }
+  }
+}
+
+void* HostAllocator::Allocation(
+  void*                   p_user_data,
+  size_t                  size,
+  size_t                  alignment,
+  VkSystemAllocationScope scope
+)
+{
+  HostAllocator* p_allocator = static_cast<HostAllocator*>(p_user_data);
+  return p_allocator->Allocate(size, alignment, scope);
+}
+
+void* HostAllocator::Reallocation(
+  void*                   p_user_data,
+  void*                   p_original,
+  size_t                  size,
+  size_t                  alignment,
+  VkSystemAllocationScope scope
+)
+{
+  HostAllocator* p_allocator = static_cast<HostAllocator*>(p_user_data);
+  return p_allocator->Reallocate(p_original, size, alignment, scope);
+}
+
+void HostAllocator::Free(
+  void* p_user_data,
+  void* p_memory
+)
+{
+  HostAllocator* p_allocator = static_cast<HostAllocator*>(p_user_data);
+  p_allocator->Release(p_memory);
+}
+
+void HostAllocator::InternalAllocation(
+  void*                     p_user_data,
+  size_t                    size,
+  VkInternalAllocationType  allocation_type,
+  VkSystemAllocationScope   scope
+)
+{
+  HostAllocator* p_allocator = static_cast<HostAllocator*>(p_user_data);
+  ScopeCounters& counters = p_allocator->m_counters[scope];
+  uint64_t live_bytes = counters.internal_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  UpdatePeak(counters.internal_peak_bytes, live_bytes);
+}
+
+void HostAllocator::InternalFree(
+  void*                     p_user_data,
+  size_t                    size,
+  VkInternalAllocationType  allocation_type,
+  VkSystemAllocationScope   scope
+)
+{
+  HostAllocator* p_allocator = static_cast<HostAllocator*>(p_user_data);
+  ScopeCounters& counters = p_allocator->m_counters[scope];
+  counters.internal_live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void* HostAllocator::Allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+  if (size == 0) {
+    return nullptr;
+  }
+
+  // Header must stay naturally aligned in front of the returned pointer
+  alignment = std::max<size_t>(alignment, alignof(std::max_align_t));
+
+  uint32_t size_class = kSystemSizeClass;
+  size_t   offset     = AlignUp(sizeof(HostBlockHeader), alignment);
+  // Pool blocks are kPoolAlignment aligned, so the offset is exact for them
+  if (alignment <= kPoolAlignment) {
+    size_t block_size = offset + size;
+    for (uint32_t i = 0; i < kSizeClassCount; ++i) {
+      if (block_size <= (size_t(1) << (kMinSizeClassShift + i))) {
+        size_class = i;
+        break;
+      }
+    }
+  }
+
+  void*    p_block  = nullptr;
+  uint8_t* p_memory = nullptr;
+  if (size_class != kSystemSizeClass) {
+    p_block = AllocateBlock(scope, size_class);
+    if (p_block == nullptr) {
+      return nullptr;
+    }
+    p_memory = static_cast<uint8_t*>(p_block) + offset;
+    m_pooled_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  else {
+    p_block = std::malloc(sizeof(HostBlockHeader) + alignment + size);
+    if (p_block == nullptr) {
+      return nullptr;
+    }
+    uintptr_t address = reinterpret_cast<uintptr_t>(p_block) + sizeof(HostBlockHeader);
+    p_memory = reinterpret_cast<uint8_t*>(AlignUp(address, alignment));
+    m_system_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  HostBlockHeader* p_header = GetHeader(p_memory);
+  p_header->p_block     = p_block;
+  p_header->size        = size;
+  p_header->size_class  = size_class;
+  p_header->scope       = static_cast<uint32_t>(scope);
+
+  ScopeCounters& counters = m_counters[scope];
+  counters.allocation_count.fetch_add(1, std::memory_order_relaxed);
+  counters.live_count.fetch_add(1, std::memory_order_relaxed);
+  uint64_t live_bytes = counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  UpdatePeak(counters.peak_bytes, live_bytes);
+
+  return p_memory;
+}
+
+void* HostAllocator::Reallocate(void* p_original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+  if (p_original == nullptr) {
+    return Allocate(size, alignment, scope);
+  }
+
+  if (size == 0) {
+    Release(p_original);
+    return nullptr;
+  }
+
+  HostBlockHeader* p_header = GetHeader(p_original);
+  m_counters[p_header->scope].reallocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  // Grow or shrink in place if the pooled block still fits
+  if (p_header->size_class != kSystemSizeClass) {
+    size_t offset = static_cast<uint8_t*>(p_original) - static_cast<uint8_t*>(p_header->p_block);
+    size_t capacity = (size_t(1) << (kMinSizeClassShift + p_header->size_class)) - offset;
+    if (size <= capacity) {
+      ScopeCounters& counters = m_counters[p_header->scope];
+      if (size > p_header->size) {
+        uint64_t delta = size - p_header->size;
+        uint64_t live_bytes = counters.live_bytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+        UpdatePeak(counters.peak_bytes, live_bytes);
+      }
+      else {
+        counters.live_bytes.fetch_sub(p_header->size - size, std::memory_order_relaxed);
+      }
+      p_header->size = size;
+      return p_original;
+    }
+  }
+
+  void* p_memory = Allocate(size, alignment, scope);
+  if (p_memory == nullptr) {
+    // Original allocation must be left untouched on failure
+    return nullptr;
+  }
+  std::memcpy(p_memory, p_original, std::min(size, p_header->size));
+  Release(p_original);
+
+  return p_memory;
+}
+
+void HostAllocator::Release(void* p_memory)
+{
+  if (p_memory == nullptr) {
+    return;
+  }
+
+  HostBlockHeader* p_header = GetHeader(p_memory);
+  ScopeCounters& counters = m_counters[p_header->scope];
+  counters.free_count.fetch_add(1, std::memory_order_relaxed);
+  counters.live_count.fetch_sub(1, std::memory_order_relaxed);
+  counters.live_bytes.fetch_sub(p_header->size, std::memory_order_relaxed);
+
+  if (p_header->size_class != kSystemSizeClass) {
+    ReleaseBlock(p_header->scope, p_header->size_class, p_header->p_block);
+  }
+  else {
+    std::free(p_header->p_block);
+  }
+}
+
+void* HostAllocator::AllocateBlock(uint32_t scope, uint32_t size_class)
+{
+  Pool& pool = m_pools[scope][size_class];
+  std::lock_guard<std::mutex> lock(pool.mutex);
+
+  if (pool.p_free_list == nullptr) {
+    const size_t block_size  = size_t(1) << (kMinSizeClassShift + size_class);
+    const size_t block_count = kChunkSize / block_size;
+    // Over-allocate so the first block can be moved up to kPoolAlignment
+    void* p_chunk = std::malloc(kChunkSize + kPoolAlignment);
+    if (p_chunk == nullptr) {
+      return nullptr;
+    }
+    pool.chunks.push_back(p_chunk);
+    m_pool_reserved_bytes.fetch_add(kChunkSize + kPoolAlignment, std::memory_order_relaxed);
+
+    uint8_t* p_first = reinterpret_cast<uint8_t*>(AlignUp(reinterpret_cast<uintptr_t>(p_chunk), kPoolAlignment));
+    for (size_t i = block_count; i > 0; --i) {
+      FreeBlock* p_free_block = reinterpret_cast<FreeBlock*>(p_first + (i - 1) * block_size);
+      p_free_block->p_next = pool.p_free_list;
+      pool.p_free_list = p_free_block;
+    }
+  }
+
+  FreeBlock* p_block = pool.p_free_list;
+  pool.p_free_list = p_block->p_next;
+  return p_block;
+}
+
+void HostAllocator::ReleaseBlock(uint32_t scope, uint32_t size_class, void* p_block)
+{
+  Pool& pool = m_pools[scope][size_class];
+  std::lock_guard<std::mutex> lock(pool.mutex);
+
+  FreeBlock* p_free_block = static_cast<FreeBlock*>(p_block);
+  p_free_block->p_next = pool.p_free_list;
+  pool.p_free_list = p_free_block;
+}
+
+void HostAllocator::GetStatistics(vkex::HostAllocatorStatistics* p_statistics) const
+{
+  for (uint32_t scope = 0; scope < kHostAllocationScopeCount; ++scope) {
+    const ScopeCounters& counters = m_counters[scope];
+    HostAllocationScopeStatistics& stats = p_statistics->scopes[scope];
+    stats.allocation_count    = counters.allocation_count.load(std::memory_order_relaxed);
+    stats.reallocation_count  = counters.reallocation_count.load(std::memory_order_relaxed);
+    stats.free_count          = counters.free_count.load(std::memory_order_relaxed);
+    stats.live_count          = counters.live_count.load(std::memory_order_relaxed);
+    stats.live_bytes          = counters.live_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes          = counters.peak_bytes.load(std::memory_order_relaxed);
+    stats.internal_live_bytes = counters.internal_live_bytes.load(std::memory_order_relaxed);
+    stats.internal_peak_bytes = counters.internal_peak_bytes.load(std::memory_order_relaxed);
+  }
+  p_statistics->pooled_allocation_count = m_pooled_allocation_count.load(std::memory_order_relaxed);
+  p_statistics->system_allocation_count = m_system_allocation_count.load(std::memory_order_relaxed);
+  p_statistics->pool_reserved_bytes     = m_pool_reserved_bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t HostAllocator::GetTotalAllocationCount() const
+{
+  uint64_t count = 0;
+  for (uint32_t scope = 0; scope < kHostAllocationScopeCount; ++scope) {
+    count += m_counters[scope].allocation_count.load(std::memory_order_relaxed);
+    count += m_counters[scope].reallocation_count.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+void HostAllocator::LogStatistics() const
+{
+  vkex::HostAllocatorStatistics statistics = {};
+  GetStatistics(&statistics);
+
+  VKEX_LOG_INFO("");
+  VKEX_LOG_INFO("Vulkan host allocations:");
+  for (uint32_t scope = 0; scope < kHostAllocationScopeCount; ++scope) {
+    const HostAllocationScopeStatistics& stats = statistics.scopes[scope];
+    VKEX_LOG_INFO("   " << GetScopeName(static_cast<VkSystemAllocationScope>(scope)) << " :"
+                  << " allocs=" << stats.allocation_count
+                  << " reallocs=" << stats.reallocation_count
+                  << " frees=" << stats.free_count
+                  << " peak=" << stats.peak_bytes << " bytes"
+                  << " internal_peak=" << stats.internal_peak_bytes << " bytes");
+    if (stats.live_count > 0) {
+      VKEX_LOG_WARN("   " << GetScopeName(static_cast<VkSystemAllocationScope>(scope))
+                    << " : " << stats.live_count << " allocations (" << stats.live_bytes << " bytes) still live");
+    }
+  }
+  VKEX_LOG_INFO("   " << "Pooled allocations : " << statistics.pooled_allocation_count);
+  VKEX_LOG_INFO("   " << "System allocations : " << statistics.system_allocation_count);
+  VKEX_LOG_INFO("   " << "Pool reserved      : " << statistics.pool_reserved_bytes << " bytes");
+  VKEX_LOG_INFO("");
+}
+
+const char* HostAllocator::GetScopeName(VkSystemAllocationScope scope)
+{
+  switch (scope) {
+    default: break;
+    case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND  : return "Command"; break;
+    case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT   : return "Object"; break;
+    case VK_SYSTEM_ALLOCATION_SCOPE_CACHE    : return "Cache"; break;
+    case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE   : return "Device"; break;
+    case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE : return "Instance"; break;
+  }
+  return "Unknown";
+}
+
+} // namespace vkex
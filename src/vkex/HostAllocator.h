@@ -0,0 +1,176 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_HOST_ALLOCATOR_H__
+#define __VKEX_HOST_ALLOCATOR_H__
+
+#include "vkex/Config.h"
+
+#include <atomic>
+
+namespace vkex {
+
+enum {
+  kHostAllocationScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1,
+};
+
+/** @struct HostAllocationScopeStatistics
+ *
+ * Counters for one VkSystemAllocationScope. 'internal_*' values come from the
+ * driver's pfnInternalAllocation/pfnInternalFree notifications and are not
+ * part of the allocator's own bookkeeping.
+ */
+struct HostAllocationScopeStatistics {
+  uint64_t  allocation_count;
+  uint64_t  reallocation_count;
+  uint64_t  free_count;
+  uint64_t  live_count;
+  uint64_t  live_bytes;
+  uint64_t  peak_bytes;
+  uint64_t  internal_live_bytes;
+  uint64_t  internal_peak_bytes;
+};
+
+/** @struct HostAllocatorStatistics
+ *
+ */
+struct HostAllocatorStatistics {
+  HostAllocationScopeStatistics scopes[kHostAllocationScopeCount];
+  // Allocations served from size class pools vs. sent to the system heap
+  uint64_t                      pooled_allocation_count;
+  uint64_t                      system_allocation_count;
+  // Bytes reserved by pool chunks, across all scopes
+  uint64_t                      pool_reserved_bytes;
+};
+
+/** @class HostAllocator
+ *
+ * Host memory allocator for Vulkan's VkAllocationCallbacks. Small allocations
+ * are served from per-scope, per-size-class free lists carved out of larger
+ * chunks, so command and object scoped churn never reaches the system heap.
+ * Chunks are kept until the allocator is destroyed, which makes every scope
+ * behave like an arena. Large or over-aligned allocations fall back to the
+ * system heap and are still tracked.
+ *
+ * The allocator must outlive every Vulkan object created with its callbacks.
+ */
+class HostAllocator {
+public:
+  HostAllocator();
+  ~HostAllocator();
+
+  HostAllocator(const HostAllocator&) = delete;
+  HostAllocator& operator=(const HostAllocator&) = delete;
+
+  const VkAllocationCallbacks*  GetCallbacks() const { return &m_callbacks; }
+
+  //! @fn GetStatistics
+  //!
+  //! Snapshot of the counters. Values are read individually, so the snapshot
+  //! is only exact when no other thread is allocating.
+  void GetStatistics(vkex::HostAllocatorStatistics* p_statistics) const;
+
+  //! @fn GetTotalAllocationCount
+  //!
+  //! Sum of allocations and reallocations across all scopes. Sampling this
+  //! once per frame gives the allocation churn of the frame loop.
+  uint64_t GetTotalAllocationCount() const;
+
+  //! @fn LogStatistics
+  //!
+  void LogStatistics() const;
+
+  static const char* GetScopeName(VkSystemAllocationScope scope);
+
+private:
+  enum {
+    kMinSizeClassShift  = 6,    // 64 bytes
+    kMaxSizeClassShift  = 12,   // 4096 bytes
+    kSizeClassCount     = kMaxSizeClassShift - kMinSizeClassShift + 1,
+    kSystemSizeClass    = kSizeClassCount,
+    kPoolAlignment      = 64,
+    kChunkSize          = 64 * 1024,
+  };
+
+  struct FreeBlock {
+    FreeBlock* p_next;
+  };
+
+  struct Pool {
+    std::mutex          mutex;
+    FreeBlock*          p_free_list = nullptr;
+    std::vector<void*>  chunks;
+  };
+
+  struct ScopeCounters {
+    std::atomic<uint64_t> allocation_count{0};
+    std::atomic<uint64_t> reallocation_count{0};
+    std::atomic<uint64_t> free_count{0};
+    std::atomic<uint64_t> live_count{0};
+    std::atomic<uint64_t> live_bytes{0};
+    std::atomic<uint64_t> peak_bytes{0};
+    std::atomic<uint64_t> internal_live_bytes{0};
+    std::atomic<uint64_t> internal_peak_bytes{0};
+  };
+
+  static void* VKAPI_PTR Allocation(
+    void*                   p_user_data,
+    size_t                  size,
+    size_t                  alignment,
+    VkSystemAllocationScope scope);
+
+  static void* VKAPI_PTR Reallocation(
+    void*                   p_user_data,
+    void*                   p_original,
+    size_t                  size,
+    size_t                  alignment,
+    VkSystemAllocationScope scope);
+
+  static void VKAPI_PTR Free(
+    void* p_user_data,
+    void* p_memory);
+
+  static void VKAPI_PTR InternalAllocation(
+    void*                     p_user_data,
+    size_t                    size,
+    VkInternalAllocationType  allocation_type,
+    VkSystemAllocationScope   scope);
+
+  static void VKAPI_PTR InternalFree(
+    void*                     p_user_data,
+    size_t                    size,
+    VkInternalAllocationType  allocation_type,
+    VkSystemAllocationScope   scope);
+
+  void* Allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+  void* Reallocate(void* p_original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+  void  Release(void* p_memory);
+
+  void* AllocateBlock(uint32_t scope, uint32_t size_class);
+  void  ReleaseBlock(uint32_t scope, uint32_t size_class, void* p_block);
+
+private:
+  VkAllocationCallbacks m_callbacks = {};
+  Pool                  m_pools[kHostAllocationScopeCount][kSizeClassCount];
+  ScopeCounters         m_counters[kHostAllocationScopeCount];
+  std::atomic<uint64_t> m_pooled_allocation_count{0};
+  std::atomic<uint64_t> m_system_allocation_count{0};
+  std::atomic<uint64_t> m_pool_reserved_bytes{0};
+};
+
+} // namespace vkex
+
+#endif // __VKEX_HOST_ALLOCATOR_H__
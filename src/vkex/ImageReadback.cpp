@@ -0,0 +1,370 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/ImageReadback.h"
+#include "vkex/Device.h"
+#include "vkex/VulkanUtil.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKEX_IMAGE_READBACK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace vkex {
+
+ImageReadback::ImageReadback()
+{
+}
+
+ImageReadback::~ImageReadback()
+{
+  Destroy();
+}
+
+vkex::Result ImageReadback::Initialize(vkex::Device device, const vkex::ImageReadbackCreateInfo& create_info)
+{
+  VKEX_ASSERT(!IsInitialized());
+  VKEX_ASSERT(create_info.slot_count > 0);
+  VKEX_ASSERT(create_info.callback);
+
+  m_device = device;
+  m_callback = create_info.callback;
+  m_stop = false;
+
+  // Command pool
+  {
+    vkex::CommandPoolCreateInfo command_pool_create_info = {};
+    command_pool_create_info.flags.bits.reset_command_buffer = true;
+    vkex::Result vkex_result = vkex::Result::Undefined;
+    VKEX_RESULT_CALL(
+      vkex_result,
+      m_device->CreateCommandPool(command_pool_create_info, &m_command_pool)
+    );
+    if (!vkex_result) {
+      return vkex_result;
+    }
+  }
+
+  const uint64_t slot_size = static_cast<uint64_t>(create_info.max_width) * create_info.max_height * 4;
+  for (uint32_t slot_index = 0; slot_index < create_info.slot_count; ++slot_index) {
+    auto slot = std::make_unique<Slot>();
+
+    // Buffer
+    {
+      vkex::BufferCreateInfo buffer_create_info = {};
+      buffer_create_info.size                           = slot_size;
+      buffer_create_info.usage_flags.bits.transfer_dst  = true;
+      buffer_create_info.committed                      = true;
+      buffer_create_info.host_visible                   = true;
+      buffer_create_info.host_readback                  = true;
+      vkex::Result vkex_result = vkex::Result::Undefined;
+      VKEX_RESULT_CALL(
+        vkex_result,
+        m_device->CreateBuffer(buffer_create_info, &slot->buffer)
+      );
+      if (!vkex_result) {
+        return vkex_result;
+      }
+
+      void* p_mapped = nullptr;
+      VkResult vk_result = slot->buffer->MapMemory(&p_mapped);
+      if (vk_result != VK_SUCCESS) {
+        return vkex::Result(vk_result);
+      }
+      slot->p_mapped = static_cast<const uint8_t*>(p_mapped);
+    }
+
+    // Command buffer
+    {
+      vkex::CommandBufferAllocateInfo command_buffer_allocate_info = {};
+      command_buffer_allocate_info.command_buffer_count = 1;
+      vkex::Result vkex_result = vkex::Result::Undefined;
+      VKEX_RESULT_CALL(
+        vkex_result,
+        m_command_pool->AllocateCommandBuffer(command_buffer_allocate_info, &slot->command_buffer)
+      );
+      if (!vkex_result) {
+        return vkex_result;
+      }
+    }
+
+    // Fence
+    {
+      vkex::FenceCreateInfo fence_create_info = {};
+      vkex::Result vkex_result = vkex::Result::Undefined;
+      VKEX_RESULT_CALL(
+        vkex_result,
+        m_device->CreateFence(fence_create_info, &slot->fence)
+      );
+      if (!vkex_result) {
+        return vkex_result;
+      }
+    }
+
+    m_slots.push_back(std::move(slot));
+  }
+
+  uint32_t thread_count = create_info.thread_count;
+  if (thread_count == 0) {
+    thread_count = std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), 4u);
+  }
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    m_threads.emplace_back(&ImageReadback::WorkerMain, this);
+  }
+
+  return vkex::Result::Success;
+}
+
+vkex::Result ImageReadback::Destroy()
+{
+  if (!IsInitialized()) {
+    return vkex::Result::Success;
+  }
+
+  // Finish what's in flight so nothing captured is lost
+  for (auto& slot : m_slots) {
+    if (slot->state.load(std::memory_order_acquire) == kSlotInFlight) {
+      slot->fence->WaitForFence();
+    }
+  }
+  Poll();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+  m_threads.clear();
+
+  for (auto& slot : m_slots) {
+    slot->buffer->UnmapMemory();
+    m_device->DestroyBuffer(slot->buffer);
+    m_device->DestroyFence(slot->fence);
+  }
+  m_slots.clear();
+  m_device->DestroyCommandPool(m_command_pool);
+  m_command_pool = nullptr;
+  m_recorded_slot = UINT32_MAX;
+
+  return vkex::Result::Success;
+}
+
+VkCommandBuffer ImageReadback::RecordCopy(vkex::Image image, VkImageLayout layout, VkExtent2D extent, uint64_t tag)
+{
+  VKEX_ASSERT(m_recorded_slot == UINT32_MAX);
+  VKEX_ASSERT(vkex::FormatSize(image->GetFormat()) == 4);
+
+  uint32_t slot_index = 0;
+  for (; slot_index < m_slots.size(); ++slot_index) {
+    if (m_slots[slot_index]->state.load(std::memory_order_acquire) == kSlotFree) {
+      break;
+    }
+  }
+  if (slot_index == m_slots.size()) {
+    ++m_dropped_count;
+    return VK_NULL_HANDLE;
+  }
+
+  Slot& slot = *m_slots[slot_index];
+  VKEX_ASSERT((static_cast<VkDeviceSize>(extent.width) * extent.height * 4) <= slot.buffer->GetSize());
+
+  slot.extent = extent;
+  slot.tag = tag;
+  slot.swizzle = (image->GetFormat() == VK_FORMAT_B8G8R8A8_UNORM) ||
+                 (image->GetFormat() == VK_FORMAT_B8G8R8A8_SRGB);
+  slot.fence->ResetFence();
+
+  vkex::CommandBuffer command_buffer = slot.command_buffer;
+  command_buffer->Begin();
+  command_buffer->CmdTransitionImageLayout(
+    *image, image->GetAspectFlags(),
+    0,
+    image->GetMipLevels(),
+    0,
+    image->GetArrayLayers(),
+    layout,
+    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    VK_PIPELINE_STAGE_TRANSFER_BIT);
+  VkBufferImageCopy region                = {};
+  region.bufferOffset                     = 0;
+  region.bufferRowLength                  = extent.width;
+  region.bufferImageHeight                = extent.height;
+  region.imageSubresource.aspectMask      = image->GetAspectFlags();
+  region.imageSubresource.mipLevel        = 0;
+  region.imageSubresource.baseArrayLayer  = 0;
+  region.imageSubresource.layerCount      = 1;
+  region.imageOffset                      = { 0, 0, 0 };
+  region.imageExtent                      = { extent.width, extent.height, 1 };
+  command_buffer->CmdCopyImageToBuffer(*image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *slot.buffer, 1, &region);
+  command_buffer->CmdTransitionImageLayout(
+    *image, image->GetAspectFlags(),
+    0,
+    image->GetMipLevels(),
+    0,
+    image->GetArrayLayers(),
+    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    layout,
+    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+  command_buffer->End();
+
+  slot.state.store(kSlotRecorded, std::memory_order_release);
+  m_recorded_slot = slot_index;
+
+  return *command_buffer;
+}
+
+bool ImageReadback::HasFreeSlot() const
+{
+  for (const auto& slot : m_slots) {
+    if (slot->state.load(std::memory_order_acquire) == kSlotFree) {
+      return true;
+    }
+  }
+  return false;
+}
+
+vkex::Result ImageReadback::SubmitFence(vkex::Queue queue)
+{
+  VKEX_ASSERT(m_recorded_slot != UINT32_MAX);
+  Slot& slot = *m_slots[m_recorded_slot];
+  m_recorded_slot = UINT32_MAX;
+
+  // An empty submit signals once all earlier submissions on the queue finish
+  VkResult vk_result = InvalidValue<VkResult>::Value;
+  VKEX_VULKAN_RESULT_CALL(
+    vk_result,
+    vkex::QueueSubmit(*queue, 0, nullptr, *slot.fence)
+  );
+  if (vk_result != VK_SUCCESS) {
+    slot.state.store(kSlotFree, std::memory_order_release);
+    return vkex::Result(vk_result);
+  }
+
+  slot.state.store(kSlotInFlight, std::memory_order_release);
+  return vkex::Result::Success;
+}
+
+void ImageReadback::Poll()
+{
+  bool queued = false;
+  for (uint32_t slot_index = 0; slot_index < m_slots.size(); ++slot_index) {
+    Slot& slot = *m_slots[slot_index];
+    if (slot.state.load(std::memory_order_acquire) != kSlotInFlight) {
+      continue;
+    }
+    if (slot.fence->GetFenceStatus() != VK_SUCCESS) {
+      continue;
+    }
+
+    slot.state.store(kSlotQueued, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.push_back(slot_index);
+    }
+    queued = true;
+  }
+
+  if (queued) {
+    m_condition.notify_all();
+  }
+}
+
+void ImageReadback::WorkerMain()
+{
+  // Reused between jobs, so steady state capture doesn't allocate
+  std::vector<uint8_t> pixels;
+
+  while (true) {
+    uint32_t slot_index = UINT32_MAX;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+      // Queued jobs are finished before stopping
+      if (m_jobs.empty()) {
+        return;
+      }
+      slot_index = m_jobs.front();
+      m_jobs.pop_front();
+    }
+
+    Slot& slot = *m_slots[slot_index];
+    ImageReadbackData data = {};
+    data.width      = slot.extent.width;
+    data.height     = slot.extent.height;
+    data.row_stride = slot.extent.width * 4;
+    data.tag        = slot.tag;
+
+    slot.buffer->InvalidateMemory();
+    const size_t pixel_count = static_cast<size_t>(data.width) * data.height;
+    pixels.resize(pixel_count * 4);
+    if (slot.swizzle) {
+      SwizzleRedBlue(slot.p_mapped, pixels.data(), pixel_count);
+    }
+    else {
+      memcpy(pixels.data(), slot.p_mapped, pixels.size());
+    }
+    data.p_pixels = pixels.data();
+
+    // The pixels are out of the buffer, it can take the next copy
+    slot.state.store(kSlotFree, std::memory_order_release);
+
+    m_callback(data);
+    ++m_completed_count;
+  }
+}
+
+void ImageReadback::SwizzleRedBlue(const uint8_t* p_src, uint8_t* p_dst, size_t pixel_count)
+{
+  size_t i = 0;
+#if defined(VKEX_IMAGE_READBACK_SSE2)
+  // Without SSSE3's byte shuffle: keep green and alpha in place, move the
+  // other two bytes of every pixel 16 bits over
+  const __m128i green_alpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+  const __m128i low_byte    = _mm_set1_epi32(0x000000FF);
+  for (; (i + 4) <= pixel_count; i += 4) {
+    const __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + (i * 4)));
+    const __m128i ga  = _mm_and_si128(src, green_alpha);
+    const __m128i r   = _mm_and_si128(_mm_srli_epi32(src, 16), low_byte);
+    const __m128i b   = _mm_slli_epi32(_mm_and_si128(src, low_byte), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst + (i * 4)), _mm_or_si128(ga, _mm_or_si128(r, b)));
+  }
+#endif
+  for (; i < pixel_count; ++i) {
+    const uint8_t b = p_src[(i * 4) + 0];
+    const uint8_t r = p_src[(i * 4) + 2];
+    p_dst[(i * 4) + 0] = r;
+    p_dst[(i * 4) + 1] = p_src[(i * 4) + 1];
+    p_dst[(i * 4) + 2] = b;
+    p_dst[(i * 4) + 3] = p_src[(i * 4) + 3];
+  }
+}
+
+const char* ImageReadback::GetSwizzleKernelName()
+{
+#if defined(VKEX_IMAGE_READBACK_SSE2)
+  return "SSE2";
+#else
+  return "Scalar";
+#endif
+}
+
+} // namespace vkex
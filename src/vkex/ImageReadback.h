@@ -0,0 +1,172 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_IMAGE_READBACK_H__
+#define __VKEX_IMAGE_READBACK_H__
+
+#include "vkex/Buffer.h"
+#include "vkex/Command.h"
+#include "vkex/Image.h"
+#include "vkex/Queue.h"
+#include "vkex/Sync.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace vkex {
+
+/** @struct ImageReadbackData
+ *
+ * One image read back by ImageReadback, tightly packed 4 byte pixels, RGBA8
+ * for color. Only valid for the duration of the callback.
+ */
+struct ImageReadbackData {
+  const uint8_t*  p_pixels;
+  uint32_t        width;
+  uint32_t        height;
+  uint32_t        row_stride;
+  // Whatever was passed to RecordCopy, a frame number usually
+  uint64_t        tag;
+};
+
+using ImageReadbackCallback = std::function<void(const vkex::ImageReadbackData&)>;
+
+/** @struct ImageReadbackCreateInfo
+ *
+ */
+struct ImageReadbackCreateInfo {
+  // Copies that can be in flight or waiting for a worker at once
+  uint32_t              slot_count;
+  // Largest image that will be copied
+  uint32_t              max_width;
+  uint32_t              max_height;
+  // Worker threads running the callback, 0 picks from the hardware threads
+  uint32_t              thread_count;
+  // Called on a worker thread for every finished copy
+  ImageReadbackCallback callback;
+};
+
+/** @class ImageReadback
+ *
+ * Reads images back to the CPU without stalling the frame. Each slot of the
+ * ring is a host cached buffer with its own command buffer and fence. A copy
+ * is recorded into a free slot and submitted with the frame's work, the
+ * fence is polled every frame, and finished copies go to worker threads.
+ * The workers swizzle BGRA to RGBA while moving the pixels out of the
+ * buffer, which frees the slot, then run the callback on their own copy.
+ *
+ * When every slot is busy a copy is dropped instead of waiting, so slow
+ * callbacks lose frames rather than stall rendering.
+ */
+class ImageReadback {
+public:
+  ImageReadback();
+  ~ImageReadback();
+
+  ImageReadback(const ImageReadback&) = delete;
+  ImageReadback& operator=(const ImageReadback&) = delete;
+
+  vkex::Result  Initialize(vkex::Device device, const vkex::ImageReadbackCreateInfo& create_info);
+  bool          IsInitialized() const { return !m_slots.empty(); }
+
+  //! @fn Destroy
+  //!
+  //! Waits for copies in flight, runs their callbacks and stops the workers.
+  vkex::Result  Destroy();
+
+  //! @fn RecordCopy
+  //!
+  //! Records a copy of 'extent' of mip 0 of 'image', any 4 byte per pixel
+  //! format in 'layout', into a free slot. 8 bit BGRA arrives as RGBA, other
+  //! formats as they are. The image is back in 'layout'
+  //! when the command buffer finishes. Returns the command buffer to submit
+  //! after the work that writes the image, or VK_NULL_HANDLE when every slot
+  //! is busy. Call SubmitFence right after submitting it.
+  VkCommandBuffer RecordCopy(vkex::Image image, VkImageLayout layout, VkExtent2D extent, uint64_t tag);
+
+  //! @fn HasFreeSlot
+  //!
+  //! True when the next RecordCopy won't be dropped, so several rings can
+  //! take copies of the same frame all or none.
+  bool          HasFreeSlot() const;
+
+  //! @fn SubmitFence
+  //!
+  //! Signals the recorded slot's fence when everything submitted to 'queue'
+  //! so far has finished.
+  vkex::Result  SubmitFence(vkex::Queue queue);
+
+  //! @fn Poll
+  //!
+  //! Hands finished copies to the workers, never blocks. Call once a frame.
+  void          Poll();
+
+  uint64_t      GetCompletedCount() const { return m_completed_count; }
+  uint64_t      GetDroppedCount() const { return m_dropped_count; }
+
+  //! @fn SwizzleRedBlue
+  //!
+  //! Copies 'pixel_count' 4 byte pixels swapping bytes 0 and 2. 'p_src' and
+  //! 'p_dst' may be the same.
+  static void   SwizzleRedBlue(const uint8_t* p_src, uint8_t* p_dst, size_t pixel_count);
+  static const char* GetSwizzleKernelName();
+
+private:
+  enum SlotState : uint32_t {
+    kSlotFree     = 0,
+    kSlotRecorded = 1,
+    kSlotInFlight = 2,
+    kSlotQueued   = 3,
+  };
+
+  struct Slot {
+    vkex::Buffer          buffer          = nullptr;
+    vkex::CommandBuffer   command_buffer  = nullptr;
+    vkex::Fence           fence           = nullptr;
+    const uint8_t*        p_mapped        = nullptr;
+    VkExtent2D            extent          = {};
+    bool                  swizzle         = false;
+    uint64_t              tag             = 0;
+    // Written by the render thread, freed by a worker
+    std::atomic<uint32_t> state{kSlotFree};
+  };
+
+  void WorkerMain();
+
+private:
+  vkex::Device                        m_device = nullptr;
+  vkex::CommandPool                   m_command_pool = nullptr;
+  ImageReadbackCallback               m_callback;
+  std::vector<std::unique_ptr<Slot>>  m_slots;
+  uint32_t                            m_recorded_slot = UINT32_MAX;
+
+  std::vector<std::thread>            m_threads;
+  std::mutex                          m_mutex;
+  std::condition_variable             m_condition;
+  std::deque<uint32_t>                m_jobs;
+  bool                                m_stop = false;
+
+  std::atomic<uint64_t>               m_completed_count{0};
+  uint64_t                            m_dropped_count = 0;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_IMAGE_READBACK_H__
@@ -465,6 +465,9 @@ vkex::Result CInstance::InternalCreate(
   // Copy create info
   m_create_info = create_info;
 
+  // Devices and surfaces created without explicit callbacks use the instance's
+  m_allocation_callbacks = p_allocator;
+
   // Initialize loader
   vkex::VkexLoaderInitialize(vkex::LOAD_MODE_SO_DIRECT);
 
@@ -682,6 +685,9 @@ vkex::Result CInstance::InternalCreate(
 
 vkex::Result CInstance::InternalDestroy(const VkAllocationCallbacks* p_allocator)
 {
+  // Must match the callbacks the instance was created with
+  p_allocator = ResolveAllocationCallbacks(p_allocator);
+
   // Destroy all devices
   for (auto& device : m_stored_devices) {
     vkex::Result vkex_result = device->InternalDestroy(p_allocator);
@@ -805,7 +811,7 @@ vkex::Result CInstance::CreateDevice(
 {
   vkex::Result vkex_result = CreateObject<CDevice>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_devices,
     &CDevice::SetInstance,
     this,
@@ -826,7 +832,7 @@ vkex::Result CInstance::DestroyDevice(
   vkex::Result vkex_result = DestroyObject<CDevice>(
     m_stored_devices,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
@@ -843,7 +849,7 @@ vkex::Result CInstance::CreateSurface(
 {
   vkex::Result vkex_result = CreateObject<CSurface>(
     create_info,
-    p_allocator,
+    ResolveAllocationCallbacks(p_allocator),
     m_stored_surfaces,
     &CSurface::SetInstance,
     this,
@@ -864,7 +870,7 @@ vkex::Result CInstance::DestroySurface(
   vkex::Result vkex_result = DestroyObject<CSurface>(
     m_stored_surfaces,
     object,
-    p_allocator);
+    ResolveAllocationCallbacks(p_allocator));
 
   if (!vkex_result) {
     return vkex_result;
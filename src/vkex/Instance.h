@@ -266,6 +266,13 @@ private:
    */
   vkex::Result InternalDestroy(const VkAllocationCallbacks* p_allocator);
 
+  /** @fn ResolveAllocationCallbacks
+   *
+   */
+  const VkAllocationCallbacks* ResolveAllocationCallbacks(const VkAllocationCallbacks* p_allocator) const {
+    return (p_allocator != nullptr) ? p_allocator : m_allocation_callbacks;
+  }
+
 private:
   InstanceCreateInfo                    m_create_info = {};
   uint32_t                              m_found_api_version;
@@ -279,6 +286,7 @@ private:
   VkInstance                            m_vk_object = VK_NULL_HANDLE;
   VkDebugUtilsMessengerEXT              m_vk_messenger = VK_NULL_HANDLE;
   bool                                  m_validation_layers_loaded = false;
+  const VkAllocationCallbacks*          m_allocation_callbacks = nullptr;
 
   std::vector<std::unique_ptr<CPhysicalDevice>> m_stored_physical_devices;
   std::vector<std::unique_ptr<CDevice>>         m_stored_devices;
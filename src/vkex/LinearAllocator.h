@@ -0,0 +1,121 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_LINEAR_ALLOCATOR_H__
+#define __VKEX_LINEAR_ALLOCATOR_H__
+
+#include "vkex/Config.h"
+
+namespace vkex {
+
+/** @class LinearAllocator
+ *
+ * Bump allocator over a fixed block of memory reserved up front. Allocations
+ * are never freed individually; Reset() releases everything at once. Only
+ * trivially destructible types can be allocated since no destructors are
+ * run. Not thread safe.
+ */
+class LinearAllocator {
+public:
+  LinearAllocator() {}
+  ~LinearAllocator() {}
+
+  LinearAllocator(const LinearAllocator&) = delete;
+  LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+  /** @fn Initialize
+   *
+   */
+  void Initialize(size_t capacity) {
+    m_storage.reset(new uint8_t[capacity]);
+    m_capacity = capacity;
+    m_offset = 0;
+    m_high_water_mark = 0;
+  }
+
+  /** @fn Reset
+   *
+   */
+  void Reset() {
+    m_offset = 0;
+  }
+
+  /** @fn Allocate
+   *
+   * Returns a default initialized array of 'count' elements, or an empty
+   * span if the allocator is exhausted.
+   */
+  template <typename T>
+  vkex::Span<T> Allocate(size_t count) {
+    static_assert(
+      std::is_trivially_destructible<T>::value,
+      "LinearAllocator can only hold trivially destructible types"
+    );
+
+    void* p_memory = AllocateBytes(count * sizeof(T), alignof(T));
+    if (p_memory == nullptr) {
+      return vkex::Span<T>();
+    }
+    T* p_objects = static_cast<T*>(p_memory);
+    for (size_t i = 0; i < count; ++i) {
+      new (p_objects + i) T();
+    }
+    return vkex::Span<T>(p_objects, count);
+  }
+
+  /** @fn Allocate
+   *
+   * Returns a copy of 'values'.
+   */
+  template <typename T>
+  vkex::Span<T> Allocate(std::initializer_list<T> values) {
+    vkex::Span<T> objects = Allocate<T>(values.size());
+    if (!objects.empty()) {
+      std::copy(values.begin(), values.end(), objects.begin());
+    }
+    return objects;
+  }
+
+  /** @fn AllocateBytes
+   *
+   */
+  void* AllocateBytes(size_t size, size_t alignment) {
+    size_t offset = RoundUp(m_offset, alignment);
+    // Exhaustion is a sizing bug; callers get nullptr rather than a silent
+    // heap fallback so the zero allocation guarantee holds.
+    VKEX_ASSERT_MSG((offset + size) <= m_capacity, "LinearAllocator exhausted");
+    if ((offset + size) > m_capacity) {
+      return nullptr;
+    }
+    m_offset = offset + size;
+    m_high_water_mark = std::max(m_high_water_mark, m_offset);
+    return m_storage.get() + offset;
+  }
+
+  size_t GetCapacity() const { return m_capacity; }
+  size_t GetUsedSize() const { return m_offset; }
+  size_t GetHighWaterMark() const { return m_high_water_mark; }
+
+private:
+  std::unique_ptr<uint8_t[]>  m_storage;
+  size_t                      m_capacity = 0;
+  size_t                      m_offset = 0;
+  size_t                      m_high_water_mark = 0;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_LINEAR_ALLOCATOR_H__
@@ -0,0 +1,367 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_OBJECT_STORAGE_H__
+#define __VKEX_OBJECT_STORAGE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace vkex {
+
+/** @struct ObjectHandle
+ *
+ * Weak reference into an ObjectStorage. A handle goes stale as soon as
+ * the object it refers to is freed, even if the slot gets reused.
+ */
+struct ObjectHandle {
+  uint32_t  index;
+  uint32_t  generation;
+};
+
+/** @class ObjectStorage
+ *
+ * Generational slot storage for VKEX objects. Objects are constructed in
+ * place inside fixed size chunks that never move, so the raw object pointer
+ * stays valid as the public handle. Free slots are kept on an intrusive free
+ * list which makes Allocate() O(1); functions taking an object pointer find
+ * its chunk through a hash of the address, also O(1), so pointers that
+ * aren't from this storage are never dereferenced. All functions are safe to
+ * call from multiple threads; the lock is never held while an object's
+ * constructor or destructor runs, and a slot only turns live once its object
+ * is fully constructed.
+ */
+template <typename T>
+class ObjectStorage {
+public:
+  enum {
+    kSlotsPerChunk  = 64,
+    kInvalidIndex   = UINT32_MAX,
+  };
+
+  ObjectStorage() {}
+
+  ~ObjectStorage() {
+    Clear();
+  }
+
+  ObjectStorage(const ObjectStorage&) = delete;
+  ObjectStorage& operator=(const ObjectStorage&) = delete;
+
+  /** @fn Allocate
+   *
+   * Returns a default constructed object, or nullptr if memory for a new
+   * chunk could not be allocated.
+   */
+  T* Allocate() {
+    Slot* p_slot = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_free_head == kInvalidIndex) {
+        if (!AddChunk()) {
+          return nullptr;
+        }
+      }
+      // Off the free list but still dead, so nothing else can reach it
+      p_slot = GetSlot(m_free_head);
+      m_free_head = p_slot->next_free;
+      p_slot->next_free = kInvalidIndex;
+    }
+    T* p_object = new (&p_slot->object) T();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      // Odd generation marks the slot as live
+      const uint32_t generation = p_slot->generation.load(std::memory_order_relaxed);
+      p_slot->generation.store(generation + 1, std::memory_order_release);
+      m_count += 1;
+    }
+    return p_object;
+  }
+
+  /** @fn Free
+   *
+   * Destroys the object and returns its slot to the free list. Returns false
+   * if the object is not a live member of this storage.
+   */
+  bool Free(T* p_object) {
+    if (!Retire(p_object)) {
+      return false;
+    }
+    Release(p_object);
+    return true;
+  }
+
+  /** @fn Retire
+   *
+   * First half of Free(): marks the object dead without destroying it, so
+   * handles stop resolving and no other thread can retire or free it too.
+   * Returns false if the object is not a live member of this storage, true
+   * means the caller owns the object and must pass it to Release().
+   */
+  bool Retire(T* p_object) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Slot* p_slot = FindSlot(p_object);
+    if (!IsLive(p_slot)) {
+      return false;
+    }
+    const uint32_t generation = p_slot->generation.load(std::memory_order_relaxed);
+    p_slot->generation.store(generation + 1, std::memory_order_release);
+    m_count -= 1;
+    return true;
+  }
+
+  /** @fn Release
+   *
+   * Second half of Free(): destroys a retired object and returns its slot to
+   * the free list.
+   */
+  void Release(T* p_object) {
+    Slot* p_slot = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      p_slot = FindSlot(p_object);
+    }
+    if (p_slot == nullptr) {
+      return;
+    }
+    p_object->~T();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      p_slot->next_free = m_free_head;
+      m_free_head = p_slot->index;
+    }
+  }
+
+  /** @fn Contains
+   *
+   */
+  bool Contains(const T* p_object) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bool contains = IsLive(FindSlot(p_object));
+    return contains;
+  }
+
+  /** @fn GetHandle
+   *
+   */
+  ObjectHandle GetHandle(const T* p_object) const {
+    ObjectHandle handle = { kInvalidIndex, 0 };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Slot* p_slot = FindSlot(p_object);
+    if (IsLive(p_slot)) {
+      handle.index = p_slot->index;
+      handle.generation = p_slot->generation.load(std::memory_order_acquire);
+    }
+    return handle;
+  }
+
+  /** @fn Resolve
+   *
+   * Returns nullptr if the handle is stale.
+   */
+  T* Resolve(const ObjectHandle& handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle.index >= GetCapacity()) {
+      return nullptr;
+    }
+    Slot* p_slot = GetSlot(handle.index);
+    // A zeroed handle must not resolve to a slot that was never constructed
+    if (!IsLive(p_slot) || (p_slot->generation.load(std::memory_order_acquire) != handle.generation)) {
+      return nullptr;
+    }
+    return reinterpret_cast<T*>(&p_slot->object);
+  }
+
+  /** @fn GetCount
+   *
+   */
+  uint32_t GetCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+  }
+
+  /** @fn GetObjects
+   *
+   * Snapshot of all live objects in slot order. For storages that never
+   * free, slot order is creation order.
+   */
+  std::vector<T*> GetObjects() const {
+    std::vector<T*> objects;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    objects.reserve(m_count);
+    const uint32_t capacity = GetCapacity();
+    for (uint32_t index = 0; index < capacity; ++index) {
+      Slot* p_slot = GetSlot(index);
+      if (IsLive(p_slot)) {
+        objects.push_back(reinterpret_cast<T*>(&p_slot->object));
+      }
+    }
+    return objects;
+  }
+
+  /** @fn FindIf
+   *
+   */
+  template <typename PredicateT>
+  T* FindIf(PredicateT predicate) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint32_t capacity = GetCapacity();
+    for (uint32_t index = 0; index < capacity; ++index) {
+      Slot* p_slot = GetSlot(index);
+      if (!IsLive(p_slot)) {
+        continue;
+      }
+      T* p_object = reinterpret_cast<T*>(&p_slot->object);
+      if (predicate(p_object)) {
+        return p_object;
+      }
+    }
+    return nullptr;
+  }
+
+  /** @fn Clear
+   *
+   * Destroys all live objects and releases the chunk memory.
+   */
+  void Clear() {
+    std::vector<T*> objects = GetObjects();
+    for (auto& p_object : objects) {
+      Free(p_object);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chunks.clear();
+    m_chunk_granules.clear();
+    m_free_head = kInvalidIndex;
+    m_count = 0;
+  }
+
+private:
+  // 'object' must remain the first member so that a T* at the start of a
+  // slot is also the Slot*.
+  struct Slot {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type  object;
+    uint32_t              index;
+    // Stored with release once the object is constructed or retired
+    std::atomic<uint32_t> generation;
+    uint32_t              next_free;
+  };
+
+  // The address space split into pieces the size of a chunk. A chunk covers
+  // at most two granules and a granule overlaps at most two chunks.
+  struct ChunkGranule {
+    uint32_t  chunk_indices[2] = { kInvalidIndex, kInvalidIndex };
+  };
+
+  static uintptr_t GetChunkSize() {
+    return static_cast<uintptr_t>(kSlotsPerChunk * sizeof(Slot));
+  }
+
+  // nullptr unless 'p_object' is the start of a slot in one of this
+  // storage's chunks. Must be called with the lock held.
+  Slot* FindSlot(const T* p_object) const {
+    if (p_object == nullptr) {
+      return nullptr;
+    }
+    const uintptr_t address = reinterpret_cast<uintptr_t>(p_object);
+    auto it = m_chunk_granules.find(address / GetChunkSize());
+    if (it == m_chunk_granules.end()) {
+      return nullptr;
+    }
+    for (uint32_t chunk_index : it->second.chunk_indices) {
+      if (chunk_index == kInvalidIndex) {
+        continue;
+      }
+      Slot* p_chunk = m_chunks[chunk_index].get();
+      const uintptr_t chunk_begin = reinterpret_cast<uintptr_t>(p_chunk);
+      const uintptr_t chunk_end = chunk_begin + GetChunkSize();
+      if ((address < chunk_begin) || (address >= chunk_end)) {
+        continue;
+      }
+      if (((address - chunk_begin) % sizeof(Slot)) != 0) {
+        return nullptr;
+      }
+      return &p_chunk[(address - chunk_begin) / sizeof(Slot)];
+    }
+    return nullptr;
+  }
+
+  bool IsLive(const Slot* p_slot) const {
+    bool is_live = (p_slot != nullptr) &&
+                   ((p_slot->generation.load(std::memory_order_acquire) & 1) != 0);
+    return is_live;
+  }
+
+  uint32_t GetCapacity() const {
+    uint32_t capacity = static_cast<uint32_t>(m_chunks.size()) * kSlotsPerChunk;
+    return capacity;
+  }
+
+  Slot* GetSlot(uint32_t index) const {
+    Slot* p_chunk = m_chunks[index / kSlotsPerChunk].get();
+    return &p_chunk[index % kSlotsPerChunk];
+  }
+
+  bool AddChunk() {
+    static_assert(
+      std::is_standard_layout<Slot>::value,
+      "ObjectStorage slot must be standard layout"
+    );
+
+    std::unique_ptr<Slot[]> chunk(new (std::nothrow) Slot[kSlotsPerChunk]);
+    if (!chunk) {
+      return false;
+    }
+    const uint32_t base_index = GetCapacity();
+    // Link slots so the lowest index is handed out first
+    for (uint32_t i = 0; i < kSlotsPerChunk; ++i) {
+      Slot& slot = chunk[i];
+      slot.index      = base_index + i;
+      slot.generation.store(0, std::memory_order_relaxed);
+      slot.next_free  = (i + 1 < kSlotsPerChunk) ? (base_index + i + 1) : m_free_head;
+    }
+
+    const uint32_t chunk_index = static_cast<uint32_t>(m_chunks.size());
+    const uintptr_t chunk_begin = reinterpret_cast<uintptr_t>(chunk.get());
+    const uintptr_t first_granule = chunk_begin / GetChunkSize();
+    const uintptr_t last_granule = (chunk_begin + GetChunkSize() - 1) / GetChunkSize();
+    for (uintptr_t granule = first_granule; granule <= last_granule; ++granule) {
+      ChunkGranule& entry = m_chunk_granules[granule];
+      const uint32_t free_entry = (entry.chunk_indices[0] == kInvalidIndex) ? 0 : 1;
+      entry.chunk_indices[free_entry] = chunk_index;
+    }
+
+    m_chunks.push_back(std::move(chunk));
+    m_free_head = base_index;
+    return true;
+  }
+
+private:
+  mutable std::mutex                           m_mutex;
+  std::vector<std::unique_ptr<Slot[]>>         m_chunks;
+  std::unordered_map<uintptr_t, ChunkGranule>  m_chunk_granules;
+  uint32_t                                     m_free_head = kInvalidIndex;
+  uint32_t                                     m_count = 0;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_OBJECT_STORAGE_H__
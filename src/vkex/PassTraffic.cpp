@@ -0,0 +1,73 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "vkex/PassTraffic.h"
+
+namespace vkex {
+
+// =================================================================================================
+// PassTraffic
+// =================================================================================================
+void PassTraffic::AddRead(VkFormat format, const VkExtent2D& extent, VkSampleCountFlagBits samples)
+{
+  bytes_read += ImageTrafficBytes(format, extent, samples);
+}
+
+void PassTraffic::AddWrite(VkFormat format, const VkExtent2D& extent, VkSampleCountFlagBits samples)
+{
+  bytes_written += ImageTrafficBytes(format, extent, samples);
+}
+
+void PassTraffic::AddRead(const vkex::Texture& texture, const VkExtent2D& extent)
+{
+  VKEX_ASSERT(texture != nullptr);
+  AddRead(texture->GetFormat(), extent, texture->GetSamples());
+}
+
+void PassTraffic::AddWrite(const vkex::Texture& texture, const VkExtent2D& extent)
+{
+  VKEX_ASSERT(texture != nullptr);
+  AddWrite(texture->GetFormat(), extent, texture->GetSamples());
+}
+
+void PassTraffic::Add(const vkex::PassTraffic& traffic)
+{
+  bytes_read    += traffic.bytes_read;
+  bytes_written += traffic.bytes_written;
+}
+
+// =================================================================================================
+// Functions
+// =================================================================================================
+uint64_t ImageTrafficBytes(VkFormat format, const VkExtent2D& extent, VkSampleCountFlagBits samples)
+{
+  // The sample count flag bits are the counts themselves
+  uint64_t bytes = static_cast<uint64_t>(vkex::FormatSize(format));
+  bytes *= static_cast<uint64_t>(extent.width) * static_cast<uint64_t>(extent.height);
+  bytes *= static_cast<uint64_t>(samples);
+  return bytes;
+}
+
+double AchievedBandwidth(uint64_t bytes, double milliseconds)
+{
+  if ((bytes == 0) || (milliseconds <= 0.0)) {
+    return 0.0;
+  }
+  // Bytes per millisecond to 10^9 bytes per second
+  return (static_cast<double>(bytes) / milliseconds) * 1.0e-6;
+}
+
+} // namespace vkex
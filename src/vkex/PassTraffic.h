@@ -0,0 +1,68 @@
+/*
+ Copyright 2020 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_PASS_TRAFFIC_H__
+#define __VKEX_PASS_TRAFFIC_H__
+
+#include "vkex/Texture.h"
+
+namespace vkex {
+
+/** @struct PassTraffic
+ *
+ * Modeled memory traffic of a compute or graphics pass: each image it reads
+ * or writes touched once over the extent the pass covers, at the image's
+ * format size times its sample count. Caches, compression and cleared
+ * attachments only ever make the real traffic lower, and overdraw or
+ * neighborhood reads that miss make it higher, so this is the traffic the
+ * pass can't avoid rather than what it does.
+ */
+struct PassTraffic {
+  uint64_t bytes_read    = 0;
+  uint64_t bytes_written = 0;
+
+  void AddRead(VkFormat format, const VkExtent2D& extent, VkSampleCountFlagBits samples);
+  void AddWrite(VkFormat format, const VkExtent2D& extent, VkSampleCountFlagBits samples);
+
+  /** @fn AddRead
+   *
+   * 'extent' is the area of the texture the pass covers, which is smaller
+   * than the texture when it's allocated for the largest resolution.
+   */
+  void AddRead(const vkex::Texture& texture, const VkExtent2D& extent);
+  void AddWrite(const vkex::Texture& texture, const VkExtent2D& extent);
+
+  void Add(const vkex::PassTraffic& traffic);
+
+  uint64_t GetTotalBytes() const {
+    return bytes_read + bytes_written;
+  }
+};
+
+/** @fn ImageTrafficBytes
+ *
+ */
+uint64_t ImageTrafficBytes(VkFormat format, const VkExtent2D& extent, VkSampleCountFlagBits samples);
+
+/** @fn AchievedBandwidth
+ *
+ * GB/s (10^9 bytes) for 'bytes' moved in 'milliseconds', 0 when either is 0.
+ */
+double AchievedBandwidth(uint64_t bytes, double milliseconds);
+
+} // namespace vkex
+
+#endif // __VKEX_PASS_TRAFFIC_H__
@@ -0,0 +1,100 @@
+/*
+ Copyright 2018-2019 Google Inc.
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef __VKEX_SPAN_H__
+#define __VKEX_SPAN_H__
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+namespace vkex {
+
+/** @class Span
+ *
+ * Non-owning view of a contiguous array. Used by functions that only read
+ * their array arguments so callers can pass stack arrays, braced lists or
+ * frame allocator memory instead of building a std::vector.
+ *
+ * A Span built from a braced list is only valid until the end of the full
+ * expression, which is enough for passing it straight into a function call.
+ */
+template <typename T>
+class Span {
+public:
+  using element_type  = T;
+  using value_type    = typename std::remove_cv<T>::type;
+  using iterator      = T*;
+
+  Span() {}
+
+  Span(T* p_data, size_t size)
+    : m_data(p_data), m_size(size) {}
+
+  template <size_t N>
+  Span(T (&array)[N])
+    : m_data(array), m_size(N) {}
+
+  template <size_t N>
+  Span(std::array<value_type, N>& array)
+    : m_data(array.data()), m_size(N) {}
+
+  template <size_t N, typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+  Span(const std::array<value_type, N>& array)
+    : m_data(array.data()), m_size(N) {}
+
+  Span(std::vector<value_type>& vector)
+    : m_data(vector.data()), m_size(vector.size()) {}
+
+  template <typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+  Span(const std::vector<value_type>& vector)
+    : m_data(vector.data()), m_size(vector.size()) {}
+
+  // The list's array lives until the end of the full expression (see above)
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 9)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winit-list-lifetime"
+#endif
+  template <typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+  Span(std::initializer_list<value_type> list)
+    : m_data(list.begin()), m_size(list.size()) {}
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 9)
+#pragma GCC diagnostic pop
+#endif
+
+  // Span<T> converts to Span<const T>
+  template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+  Span(const Span<U>& other)
+    : m_data(other.data()), m_size(other.size()) {}
+
+  T*        data() const { return m_data; }
+  size_t    size() const { return m_size; }
+  bool      empty() const { return m_size == 0; }
+  iterator  begin() const { return m_data; }
+  iterator  end() const { return m_data + m_size; }
+
+  T& operator[](size_t index) const { return m_data[index]; }
+
+private:
+  T*      m_data = nullptr;
+  size_t  m_size = 0;
+};
+
+} // namespace vkex
+
+#endif // __VKEX_SPAN_H__
@@ -18,6 +18,7 @@
 #define __VKEX_TRAITS_H__
 
 #include <vkex/Config.h>
+#include <vkex/ObjectStorage.h>
 
 namespace vkex {
 
@@ -133,6 +134,98 @@ protected:
     }
     storage.clear();
 
+    return vkex::Result::Success;
+  }
+  /** @fn CreateObject
+   *
+   */
+  template <
+    typename IObjectT,
+    typename SetParentMemberFnT,
+    typename ParentT,
+    typename CreateInfoT,
+    typename HandleT = typename std::add_pointer<IObjectT>::type
+  >
+  vkex::Result CreateObject(
+    const CreateInfoT&            create_info, 
+    const VkAllocationCallbacks*  p_allocator,
+    ObjectStorage<IObjectT>&      storage,
+    SetParentMemberFnT            p_set_parent_member_fn,
+    ParentT                       parent,  
+    HandleT*                      p_object
+  )
+  {
+    // Allocate object from the storage's pooled memory
+    HandleT raw_obj = storage.Allocate();
+    if (raw_obj == nullptr) {
+      return vkex::Result::ErrorAllocationFailed;
+    }
+    // Set parent
+    (raw_obj->*p_set_parent_member_fn)(parent);
+    // Internal create
+    vkex::Result vkex_result = raw_obj->InternalCreate(create_info, p_allocator);
+    if (!vkex_result) {
+      storage.Free(raw_obj);
+      return vkex_result;
+    }
+    // Grab object pointer
+    *p_object = raw_obj;
+    // Success
+    return vkex::Result::Success;
+  }
+
+  /** @fn DestroyObject
+   *
+   */
+  template <
+    typename IObjectT,
+    typename HandleT = typename std::add_pointer<IObjectT>::type
+  >
+  vkex::Result DestroyObject(
+    ObjectStorage<IObjectT>&      storage,
+    HandleT                       object, 
+    const VkAllocationCallbacks*  p_allocator
+  )
+  {
+    // Exit if object isn't found. Retiring claims the object under the
+    // storage's lock, so a second destroy of it racing this one exits here.
+    if (!storage.Retire(object)) {
+      return vkex::Result::Success;
+    }
+
+    vkex::Result vkex_result = object->InternalDestroy(p_allocator);
+
+    // Slot is released even if the internal destroy failed
+    storage.Release(object);
+
+    if (!vkex_result) {
+      return vkex_result;
+    }
+
+    return vkex::Result::Success;
+  }
+
+  /** @fn DestroyAllObjects
+   *
+   */
+  template <
+    typename IObjectT,
+    typename StoredT = IObjectT
+  >
+  vkex::Result DestroyAllObjects(
+    ObjectStorage<StoredT>&       storage,
+    const VkAllocationCallbacks*  p_allocator
+  )
+  {
+    std::vector<StoredT*> objects = storage.GetObjects();
+    for (auto& obj : objects) {
+      vkex::Result vkex_result = obj->InternalDestroy(p_allocator);
+      if (!vkex_result) {
+        return vkex_result;
+      }
+    }
+    storage.Clear();
+
     return vkex::Result::Success;
   }
 };
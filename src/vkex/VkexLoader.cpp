@@ -453,6 +453,7 @@ static void LoadVkApiFnsInstance(VkInstance instance, vkex::GetInstanceProcType
   p_table->DestroyDebugUtilsMessengerEXT                          = (PFN_vkDestroyDebugUtilsMessengerEXT)fnProcLoad(instance, "vkDestroyDebugUtilsMessengerEXT");
   p_table->SubmitDebugUtilsMessageEXT                             = (PFN_vkSubmitDebugUtilsMessageEXT)fnProcLoad(instance, "vkSubmitDebugUtilsMessageEXT");
   p_table->GetPhysicalDeviceMultisamplePropertiesEXT              = (PFN_vkGetPhysicalDeviceMultisamplePropertiesEXT)fnProcLoad(instance, "vkGetPhysicalDeviceMultisamplePropertiesEXT");
+  p_table->GetPhysicalDeviceCalibrateableTimeDomainsEXT           = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)fnProcLoad(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 #endif // defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -555,6 +556,7 @@ static void LoadVkApiFnsDevice(VkDevice device, vkex::GetDeviceProcType fnProcLo
   p_table->CmdEndDebugUtilsLabelEXT                               = (PFN_vkCmdEndDebugUtilsLabelEXT)fnProcLoad(device, "vkCmdEndDebugUtilsLabelEXT");
   p_table->CmdInsertDebugUtilsLabelEXT                            = (PFN_vkCmdInsertDebugUtilsLabelEXT)fnProcLoad(device, "vkCmdInsertDebugUtilsLabelEXT");
   p_table->CmdSetSampleLocationsEXT                               = (PFN_vkCmdSetSampleLocationsEXT)fnProcLoad(device, "vkCmdSetSampleLocationsEXT");
+  p_table->GetCalibratedTimestampsEXT                             = (PFN_vkGetCalibratedTimestampsEXT)fnProcLoad(device, "vkGetCalibratedTimestampsEXT");
   p_table->CreateValidationCacheEXT                               = (PFN_vkCreateValidationCacheEXT)fnProcLoad(device, "vkCreateValidationCacheEXT");
   p_table->DestroyValidationCacheEXT                              = (PFN_vkDestroyValidationCacheEXT)fnProcLoad(device, "vkDestroyValidationCacheEXT");
   p_table->MergeValidationCachesEXT                               = (PFN_vkMergeValidationCachesEXT)fnProcLoad(device, "vkMergeValidationCachesEXT");
@@ -676,6 +678,7 @@ static void LoadProcAddrInstance(VkInstance instance, vkex::GetInstanceProcType
   p_table->DestroyDebugUtilsMessengerEXT                          = (PFN_vkDestroyDebugUtilsMessengerEXT)fnProcLoad(instance, "vkDestroyDebugUtilsMessengerEXT");
   p_table->SubmitDebugUtilsMessageEXT                             = (PFN_vkSubmitDebugUtilsMessageEXT)fnProcLoad(instance, "vkSubmitDebugUtilsMessageEXT");
   p_table->GetPhysicalDeviceMultisamplePropertiesEXT              = (PFN_vkGetPhysicalDeviceMultisamplePropertiesEXT)fnProcLoad(instance, "vkGetPhysicalDeviceMultisamplePropertiesEXT");
+  p_table->GetPhysicalDeviceCalibrateableTimeDomainsEXT           = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)fnProcLoad(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
   p_table->CreateAndroidSurfaceKHR                                = (PFN_vkCreateAndroidSurfaceKHR)fnProcLoad(instance, "vkCreateAndroidSurfaceKHR");
@@ -944,6 +947,7 @@ static void LoadProcAddrDevice(VkDevice device, vkex::GetDeviceProcType fnProcLo
   p_table->CmdEndDebugUtilsLabelEXT                               = (PFN_vkCmdEndDebugUtilsLabelEXT)fnProcLoad(device, "vkCmdEndDebugUtilsLabelEXT");
   p_table->CmdInsertDebugUtilsLabelEXT                            = (PFN_vkCmdInsertDebugUtilsLabelEXT)fnProcLoad(device, "vkCmdInsertDebugUtilsLabelEXT");
   p_table->CmdSetSampleLocationsEXT                               = (PFN_vkCmdSetSampleLocationsEXT)fnProcLoad(device, "vkCmdSetSampleLocationsEXT");
+  p_table->GetCalibratedTimestampsEXT                             = (PFN_vkGetCalibratedTimestampsEXT)fnProcLoad(device, "vkGetCalibratedTimestampsEXT");
   p_table->CreateValidationCacheEXT                               = (PFN_vkCreateValidationCacheEXT)fnProcLoad(device, "vkCreateValidationCacheEXT");
   p_table->DestroyValidationCacheEXT                              = (PFN_vkDestroyValidationCacheEXT)fnProcLoad(device, "vkDestroyValidationCacheEXT");
   p_table->MergeValidationCachesEXT                               = (PFN_vkMergeValidationCachesEXT)fnProcLoad(device, "vkMergeValidationCachesEXT");
@@ -1067,6 +1071,7 @@ static void AssignProcsInstance(const vkex::InstanceFunctionTable* p_table)
   vkex::DestroyDebugUtilsMessengerEXT                          = p_table->DestroyDebugUtilsMessengerEXT;
   vkex::SubmitDebugUtilsMessageEXT                             = p_table->SubmitDebugUtilsMessageEXT;
   vkex::GetPhysicalDeviceMultisamplePropertiesEXT              = p_table->GetPhysicalDeviceMultisamplePropertiesEXT;
+  vkex::GetPhysicalDeviceCalibrateableTimeDomainsEXT           = p_table->GetPhysicalDeviceCalibrateableTimeDomainsEXT;
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
   vkex::CreateAndroidSurfaceKHR                                = p_table->CreateAndroidSurfaceKHR;
@@ -1335,6 +1340,7 @@ static void AssignProcsDevice(const vkex::DeviceFunctionTable* p_table)
   vkex::CmdEndDebugUtilsLabelEXT                               = p_table->CmdEndDebugUtilsLabelEXT;
   vkex::CmdInsertDebugUtilsLabelEXT                            = p_table->CmdInsertDebugUtilsLabelEXT;
   vkex::CmdSetSampleLocationsEXT                               = p_table->CmdSetSampleLocationsEXT;
+  vkex::GetCalibratedTimestampsEXT                             = p_table->GetCalibratedTimestampsEXT;
   vkex::CreateValidationCacheEXT                               = p_table->CreateValidationCacheEXT;
   vkex::DestroyValidationCacheEXT                              = p_table->DestroyValidationCacheEXT;
   vkex::MergeValidationCachesEXT                               = p_table->MergeValidationCachesEXT;
@@ -1670,6 +1676,8 @@ PFN_vkDestroyDebugUtilsMessengerEXT                    DestroyDebugUtilsMessenge
 PFN_vkSubmitDebugUtilsMessageEXT                       SubmitDebugUtilsMessageEXT = nullptr;
 PFN_vkCmdSetSampleLocationsEXT                         CmdSetSampleLocationsEXT = nullptr;
 PFN_vkGetPhysicalDeviceMultisamplePropertiesEXT        GetPhysicalDeviceMultisamplePropertiesEXT = nullptr;
+PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT    GetPhysicalDeviceCalibrateableTimeDomainsEXT = nullptr;
+PFN_vkGetCalibratedTimestampsEXT                       GetCalibratedTimestampsEXT = nullptr;
 PFN_vkCreateValidationCacheEXT                         CreateValidationCacheEXT = nullptr;
 PFN_vkDestroyValidationCacheEXT                        DestroyValidationCacheEXT = nullptr;
 PFN_vkMergeValidationCachesEXT                         MergeValidationCachesEXT = nullptr;
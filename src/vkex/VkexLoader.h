@@ -147,6 +147,7 @@ struct InstanceFunctionTable {
   PFN_vkDestroyDebugUtilsMessengerEXT                    DestroyDebugUtilsMessengerEXT;
   PFN_vkSubmitDebugUtilsMessageEXT                       SubmitDebugUtilsMessageEXT;
   PFN_vkGetPhysicalDeviceMultisamplePropertiesEXT        GetPhysicalDeviceMultisamplePropertiesEXT;
+  PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT    GetPhysicalDeviceCalibrateableTimeDomainsEXT;
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
   PFN_vkCreateAndroidSurfaceKHR                          CreateAndroidSurfaceKHR;
@@ -414,6 +415,7 @@ struct DeviceFunctionTable {
   PFN_vkCmdEndDebugUtilsLabelEXT                         CmdEndDebugUtilsLabelEXT;
   PFN_vkCmdInsertDebugUtilsLabelEXT                      CmdInsertDebugUtilsLabelEXT;
   PFN_vkCmdSetSampleLocationsEXT                         CmdSetSampleLocationsEXT;
+  PFN_vkGetCalibratedTimestampsEXT                       GetCalibratedTimestampsEXT;
   PFN_vkCreateValidationCacheEXT                         CreateValidationCacheEXT;
   PFN_vkDestroyValidationCacheEXT                        DestroyValidationCacheEXT;
   PFN_vkMergeValidationCachesEXT                         MergeValidationCachesEXT;
@@ -752,6 +754,8 @@ extern PFN_vkDestroyDebugUtilsMessengerEXT                    DestroyDebugUtilsM
 extern PFN_vkSubmitDebugUtilsMessageEXT                       SubmitDebugUtilsMessageEXT;
 extern PFN_vkCmdSetSampleLocationsEXT                         CmdSetSampleLocationsEXT;
 extern PFN_vkGetPhysicalDeviceMultisamplePropertiesEXT        GetPhysicalDeviceMultisamplePropertiesEXT;
+extern PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT    GetPhysicalDeviceCalibrateableTimeDomainsEXT;
+extern PFN_vkGetCalibratedTimestampsEXT                       GetCalibratedTimestampsEXT;
 extern PFN_vkCreateValidationCacheEXT                         CreateValidationCacheEXT;
 extern PFN_vkDestroyValidationCacheEXT                        DestroyValidationCacheEXT;
 extern PFN_vkMergeValidationCachesEXT                         MergeValidationCachesEXT;
@@ -19,6 +19,7 @@
 #include <vkex/Image.h>
 #include <vkex/VulkanUtil.h>
 #include <vkex/DebugMarker.h>
+#include <vkex/FlightRecorder.h>
 
 namespace vkex {
 
@@ -788,6 +789,7 @@ vkex::Result CopyResource(
   uint32_t            region_count,
   const VkBufferCopy* p_regions)
 {
+  vkex::FlightScope flight_scope("upload", "buffer copy");
   // Grab device
   vkex::Device device = queue->GetDevice();
   // Create command pool
@@ -875,6 +877,7 @@ vkex::Result CopyResource(
   const void*         p_src_data,
   vkex::Buffer        dst)
 {
+  vkex::FlightScope flight_scope("upload", "buffer upload", src_size);
   // Grab device
   vkex::Device device = queue->GetDevice();
   // Create temporary buffer
@@ -936,6 +939,7 @@ vkex::Result CopyResource(
   uint32_t           region_count,
   const VkImageCopy* p_regions)
 {
+  vkex::FlightScope flight_scope("upload", "image copy");
   // Grab device
   vkex::Device device = queue->GetDevice();
   // Create command pool
@@ -1012,6 +1016,7 @@ vkex::Result CopyResource(
   uint32_t                 region_count,
   const VkBufferImageCopy* p_regions)
 {
+  vkex::FlightScope flight_scope("upload", "buffer to image copy");
   // Grab device
   vkex::Device device = queue->GetDevice();
   // Create command pool